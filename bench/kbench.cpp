@@ -0,0 +1,235 @@
+#include "kbench.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+KBench::KBench(const Options& options) : options_{options}
+{
+}
+
+void KBench::add(const char *name, Fn fn)
+{
+    entries_.push_back(Entry{name, fn});
+}
+
+bool KBench::selected(const std::string& name) const
+{
+    if (options_.filters.empty())
+        return true;
+    for (const std::string& filter : options_.filters)
+        if (name.find(filter) != std::string::npos)
+            return true;
+    return false;
+}
+
+size_t KBench::run()
+{
+    size_t count = 0;
+    for (const Entry& entry : entries_)
+    {
+        if (!selected(entry.name))
+            continue;
+        fprintf(stderr, "%s\n", entry.name.c_str());
+        current_ = &entry;
+        size_t before = results_.size();
+        entry.fn(*this);
+        if (results_.size() == before)
+            fprintf(stderr, "  %s measured nothing\n", entry.name.c_str());
+        ++count;
+    }
+    current_ = nullptr;
+    return count;
+}
+
+void KBench::list() const
+{
+    for (const Entry& entry : entries_)
+        if (selected(entry.name))
+            printf("%s\n", entry.name.c_str());
+}
+
+// Nearest rank on sorted samples.
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+void KBench::record(double items, const char *unit, uint64_t calls, std::vector<double> samples)
+{
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double s : sorted)
+        total += s;
+
+    KBenchResult result{};
+    result.name = current_ ? current_->name : "unnamed";
+    result.unit = unit;
+    result.items = items;
+    result.calls_per_sample = calls;
+    result.samples = std::move(samples);
+    KBenchSummary& s = result.summary;
+    s.min_ns = sorted.front();
+    s.median_ns = percentile(sorted, 0.5);
+    s.mean_ns = total / sorted.size();
+    s.p90_ns = percentile(sorted, 0.9);
+    s.p99_ns = percentile(sorted, 0.99);
+    s.max_ns = sorted.back();
+    s.items_per_second = s.median_ns > 0.0 ? items / s.median_ns * 1e9 : 0.0;
+    results_.push_back(std::move(result));
+}
+
+void KBench::counter(const char *name, double value)
+{
+    assert(!results_.empty());
+    results_.back().counters.emplace_back(name, value);
+}
+
+// Scales a count for reading, e.g. 1.25e+09 as "1.25 G".
+static void format_rate(char *out, size_t size, double rate)
+{
+    static const char *prefixes[]{"", "k", "M", "G", "T"};
+    int i = 0;
+    while (rate >= 1000.0 && i < 4)
+    {
+        rate /= 1000.0;
+        ++i;
+    }
+    snprintf(out, size, "%.3g %s", rate, prefixes[i]);
+}
+
+static void format_time(char *out, size_t size, double ns)
+{
+    if (ns < 1e3)
+        snprintf(out, size, "%.1f ns", ns);
+    else if (ns < 1e6)
+        snprintf(out, size, "%.2f us", ns * 1e-3);
+    else if (ns < 1e9)
+        snprintf(out, size, "%.2f ms", ns * 1e-6);
+    else
+        snprintf(out, size, "%.2f s", ns * 1e-9);
+}
+
+void KBench::print() const
+{
+    printf("%-44s %11s %11s %11s %22s\n", "benchmark", "median", "p99", "max", "throughput");
+    for (const KBenchResult& r : results_)
+    {
+        char median[32], p99[32], max[32], rate[32], throughput[64];
+        format_time(median, sizeof(median), r.summary.median_ns);
+        format_time(p99, sizeof(p99), r.summary.p99_ns);
+        format_time(max, sizeof(max), r.summary.max_ns);
+        format_rate(rate, sizeof(rate), r.summary.items_per_second);
+        snprintf(throughput, sizeof(throughput), "%s%s/s", rate, r.unit.c_str());
+        printf("%-44s %11s %11s %11s %22s\n", r.name.c_str(), median, p99, max, throughput);
+        for (const auto& counter : r.counters)
+            printf("  %-42s %11.6g\n", counter.first.c_str(), counter.second);
+    }
+}
+
+bool KBench::write_json(const char *filename, const char *revision) const
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == nullptr)
+        return false;
+
+    // Names, units and counters are written as they are; they come from the
+    // benchmark sources and hold no characters that need escaping.
+    fprintf(file, "{\n  \"revision\": \"%s\",\n  \"benchmarks\": [", revision);
+    for (size_t i = 0; i < results_.size(); ++i)
+    {
+        const KBenchResult& r = results_[i];
+        const KBenchSummary& s = r.summary;
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"items\": %.17g, "
+                      "\"samples\": %zu, \"calls_per_sample\": %llu,\n"
+                      "     \"ns\": {\"min\": %.6g, \"median\": %.6g, \"mean\": %.6g, "
+                      "\"p90\": %.6g, \"p99\": %.6g, \"max\": %.6g},\n"
+                      "     \"items_per_second\": %.6g",
+                i == 0 ? "" : ",", r.name.c_str(), r.unit.c_str(), r.items,
+                r.samples.size(), static_cast<unsigned long long>(r.calls_per_sample),
+                s.min_ns, s.median_ns, s.mean_ns, s.p90_ns, s.p99_ns, s.max_ns,
+                s.items_per_second);
+        if (!r.counters.empty())
+        {
+            fprintf(file, ",\n     \"counters\": {");
+            for (size_t j = 0; j < r.counters.size(); ++j)
+                fprintf(file, "%s\"%s\": %.17g", j == 0 ? "" : ", ", r.counters[j].first.c_str(), r.counters[j].second);
+            fprintf(file, "}");
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    bool ok = ferror(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    return ok;
+}
+
+// Reads back the medians from write_json()'s output. It is not a
+// general JSON parser; it relies on the layout written above.
+static bool read_medians(const char *filename, std::map<std::string, double>& medians)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == nullptr)
+        return false;
+    std::string text;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, n);
+    fclose(file);
+
+    static const char kName[]{"\"name\": \""};
+    static const char kMedian[]{"\"median\": "};
+    size_t at = 0;
+    while ((at = text.find(kName, at)) != std::string::npos)
+    {
+        at += sizeof(kName) - 1;
+        size_t end = text.find('"', at);
+        size_t median = text.find(kMedian, at);
+        if (end == std::string::npos || median == std::string::npos)
+            return false;
+        medians[text.substr(at, end - at)] = strtod(text.c_str() + median + sizeof(kMedian) - 1, nullptr);
+        at = median;
+    }
+    return !medians.empty();
+}
+
+bool KBench::compare(const char *filename, double threshold) const
+{
+    std::map<std::string, double> baseline;
+    if (!read_medians(filename, baseline))
+    {
+        fprintf(stderr, "could not read a baseline from %s\n", filename);
+        return false;
+    }
+
+    bool ok = true;
+    printf("\n%-44s %11s %11s %9s\n", "benchmark", "baseline", "median", "change");
+    for (const KBenchResult& r : results_)
+    {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0.0)
+            continue;
+        char before[32], after[32];
+        format_time(before, sizeof(before), it->second);
+        format_time(after, sizeof(after), r.summary.median_ns);
+        double change = r.summary.median_ns / it->second - 1.0;
+        bool regressed = change > threshold;
+        ok = ok && !regressed;
+        printf("%-44s %11s %11s %+8.1f%%%s\n", r.name.c_str(), before, after, 100.0 * change,
+               regressed ? "  REGRESSED" : "");
+    }
+    return ok;
+}
+
+#pragma warning(pop)
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "kclock.h"
+
+// A small benchmark harness for the CPU-side code of the samples,
+// built headless by the CMake project in the repository's root.
+//
+// A benchmark is a named function that sets up its data and then hands
+// the code to time to KBench::measure(). measure() calls it in batches
+// long enough for the clock to resolve, and collects at least
+// min_samples batches and min_seconds of them. Every batch is one
+// sample of the time per call, so the report holds a latency
+// distribution (min, median, mean, p90, p99, max) as well as the
+// throughput, in the benchmark's own units of work per second.
+//
+// The report is printed as a table and, with --json, written as JSON
+// keyed by the source revision, along with any counters a benchmark
+// reports. --baseline compares a run against such
+// a file from another commit and fails on regressions.
+//
+// USAGE:
+//
+// static void bench_fill(KBench& bench)
+// {
+//     KBitmap bitmap{1024, 1024};
+//     bench.measure(1024.0 * 1024.0, "pixels", [&] { bitmap.clear(0xff336699); });
+// }
+//
+// void register_bitmap_benchmarks(KBench& bench)
+// {
+//     bench.add("bitmap/clear/1024", bench_fill);
+// }
+
+struct KBenchSummary
+{
+    double min_ns;          // Per call.
+    double median_ns;
+    double mean_ns;
+    double p90_ns;
+    double p99_ns;
+    double max_ns;
+    double items_per_second;
+};
+
+struct KBenchResult
+{
+    std::string name;
+    std::string unit;
+    double items;                   // Units of work per call.
+    uint64_t calls_per_sample;
+    std::vector<double> samples;    // Nanoseconds per call.
+    KBenchSummary summary;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+class KBench
+{
+public:
+    using Fn = void (*)(KBench& bench);
+
+    struct Options
+    {
+        double min_seconds{0.2};
+        size_t min_samples{10};
+        size_t max_samples{1000};
+        int64_t min_sample_ns{100000};  // Batches are grown to last this long.
+        std::vector<std::string> filters;   // Substrings of names; empty runs all.
+    };
+
+    explicit KBench(const Options& options);
+
+    void add(const char *name, Fn fn);
+
+    // Runs the benchmarks whose names pass the filters, in the order
+    // they were added. Returns how many ran.
+    size_t run();
+    void list() const;
+
+    // Times fn(), where one call does items units of work. Call it once
+    // per benchmark function.
+    template <typename F>
+    void measure(double items, const char *unit, F fn);
+    // Reports a number besides the time, such as how many state changes
+    // a call made, with the last measurement.
+    void counter(const char *name, double value);
+
+    const std::vector<KBenchResult>& results() const;
+    void print() const;
+    bool write_json(const char *filename, const char *revision) const;
+    // Prints each median against the one of the same name in a JSON
+    // report from an earlier run. Returns false if the file can't be
+    // read or a benchmark got slower by more than threshold, a fraction.
+    bool compare(const char *filename, double threshold) const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        Fn fn;
+    };
+
+    bool selected(const std::string& name) const;
+    void record(double items, const char *unit, uint64_t calls, std::vector<double> samples);
+
+    Options options_;
+    std::vector<Entry> entries_;
+    std::vector<KBenchResult> results_;
+    const Entry *current_{};
+};
+
+inline const std::vector<KBenchResult>& KBench::results() const { return results_; }
+
+// Keeps the compiler from discarding a result that is never used.
+template <typename T>
+inline void bench_keep(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+template <typename F>
+void KBench::measure(double items, const char *unit, F fn)
+{
+    // Warm up, then double the batch until it outlasts min_sample_ns.
+    fn();
+    uint64_t calls = 1;
+    for (;;)
+    {
+        int64_t begin = monotonic_nanoseconds();
+        for (uint64_t i = 0; i < calls; ++i)
+            fn();
+        int64_t elapsed = monotonic_nanoseconds() - begin;
+        if (elapsed >= options_.min_sample_ns || calls >= (uint64_t{1} << 30))
+            break;
+        calls *= 2;
+    }
+
+    std::vector<double> samples;
+    int64_t total = 0;
+    while (samples.size() < options_.max_samples &&
+           (samples.size() < options_.min_samples || total < static_cast<int64_t>(options_.min_seconds * 1e9)))
+    {
+        int64_t begin = monotonic_nanoseconds();
+        for (uint64_t i = 0; i < calls; ++i)
+            fn();
+        int64_t elapsed = monotonic_nanoseconds() - begin;
+        total += elapsed;
+        samples.push_back(static_cast<double>(elapsed) / static_cast<double>(calls));
+    }
+    record(items, unit, calls, std::move(samples));
+}
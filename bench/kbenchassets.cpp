@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "kbench.h"
+#include "kjobsystem.h"
+#include "kmappedfile.h"
+#include "kmipmap.h"
+#include "kobjloader.h"
+#include "ktexturecache.h"
+
+#if !defined(KBENCH_LIGHTING_DIR)
+#define KBENCH_LIGHTING_DIR "."
+#endif
+
+// KD3DSurface's start-up without a device: the same jobs, with the same
+// dependencies, on a KJobSystem that outlives the loads, as the
+// surface's does. The first frame can be presented once the placeholder
+// texture exists and the jobs are queued; the last job runs when every
+// asset is ready. There is no WIC or shader compiler here, so the
+// texture job processes a synthetic image of texture.jpg's size and each
+// shader job maps and hashes its source instead of compiling it.
+
+static const uint32_t kTextureWidth{85};
+static const uint32_t kTextureHeight{120};
+// texture.jpg's width isn't a multiple of 4, so the surface uploads it
+// uncompressed, as DXGI_FORMAT_R8G8B8A8_UNORM_SRGB.
+static const uint32_t kTextureFormat{29};
+
+static std::vector<uint8_t> make_texture()
+{
+    std::vector<uint8_t> texels(static_cast<size_t>(kTextureWidth) * kTextureHeight * 4);
+    for (size_t i = 0; i < texels.size(); ++i)
+        texels[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    return texels;
+}
+
+static KTexturePayload process_texture(const std::vector<uint8_t>& image)
+{
+    // The copy stands in for the texels the decoder would have written.
+    std::vector<uint8_t> texels(image);
+    KMipChain chain = generate_mip_chain(texels.data(), kTextureWidth, kTextureHeight, kTextureWidth * 4);
+    return make_texture_payload(std::move(chain), kTextureFormat);
+}
+
+static void bench_load(KBench& bench)
+{
+    const std::string dir = KBENCH_LIGHTING_DIR;
+    const std::string obj = dir + "/3dmodel.obj";
+    const std::filesystem::path shaders[]{dir + "/lights.hlsl", dir + "/lights.hlsl",
+                                          dir + "/blinnphong.hlsl", dir + "/blinnphong.hlsl"};
+    std::vector<uint8_t> image = make_texture();
+    const uint8_t white[4]{0xff, 0xff, 0xff, 0xff};
+
+    KJobSystem jobs{};
+    int64_t first_frame = 0;
+    int64_t ready = 0;
+    uint64_t loads = 0;
+    bench.measure(1.0, "loads", [&] {
+        int64_t start = monotonic_nanoseconds();
+
+        KTexturePayload placeholder = make_texture_payload(generate_mip_chain(white, 1, 1, 4, KMipFilter::kBox, 1),
+                                                           kTextureFormat);
+
+        KOBJBlob mesh{};
+        std::shared_ptr<const KTexturePayload> texture;
+        uint64_t shader_hashes[4]{};
+
+        KJobHandle mesh_job = jobs.submit([&] { mesh = load_obj(obj.c_str()); });
+        KJobHandle texture_job = jobs.submit([&] {
+            texture = std::make_shared<const KTexturePayload>(process_texture(image));
+        });
+        std::vector<KJobHandle> assets{mesh_job, texture_job};
+        for (int i = 0; i < 4; ++i)
+        {
+            assets.push_back(jobs.submit([&, i] {
+                KMappedFile file;
+                if (file.open(shaders[i]))
+                    shader_hashes[i] = hash_bytes(file.data(), file.size());
+            }));
+        }
+        KJobHandle assets_job = jobs.submit([] {}, assets);
+        first_frame += monotonic_nanoseconds() - start;
+
+        jobs.wait(assets_job);
+        ready += monotonic_nanoseconds() - start;
+        ++loads;
+        bench_keep(placeholder.data.size() + texture->data.size() + mesh.numIndices + shader_hashes[3]);
+        free_obj(mesh);
+    });
+    bench.counter("first frame us", static_cast<double>(first_frame) * 1e-3 / static_cast<double>(loads));
+    bench.counter("all assets ready us", static_cast<double>(ready) * 1e-3 / static_cast<double>(loads));
+}
+
+void register_asset_benchmarks(KBench& bench)
+{
+    bench.add("assets/load/lighting", bench_load);
+}
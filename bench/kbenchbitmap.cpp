@@ -0,0 +1,329 @@
+#include <cstdint>
+#include <vector>
+#include "kbench.h"
+#include "kbitmap.h"
+#include "kscene.h"
+#include "kparticles.h"
+#include "kpath.h"
+#include "krasterizer.h"
+#include "ktiledbitmap.h"
+
+// Colors are premultiplied 0xaarrggbb.
+static const uint32_t kOpaque{0xff336699};
+static const uint32_t kTranslucent{0x80402010};
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KBitmap.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static void bench_clear(KBench& bench)
+{
+    KBitmap bitmap{1024, 1024};
+    bench.measure(1024.0 * 1024.0, "pixels", [&] {
+        bitmap.clear(kOpaque);
+        bitmap.clear_dirty();
+        bench_keep(bitmap.data()[0]);
+    });
+}
+
+static void bench_fill_rect(KBench& bench)
+{
+    // Odd offsets and widths, so that rows start and end unaligned.
+    KBitmap bitmap{1024, 1024};
+    bench.measure(509.0 * 509.0, "pixels", [&] {
+        bitmap.fill_rect(3, 5, 509, 509, kOpaque);
+        bitmap.clear_dirty();
+        bench_keep(bitmap.data()[0]);
+    });
+}
+
+static void bench_blend(KBench& bench)
+{
+    KBitmap src{512, 512};
+    src.clear(kTranslucent);
+    KBitmap dst{1024, 1024};
+    dst.clear(kOpaque);
+    bench.measure(512.0 * 512.0, "pixels", [&] {
+        dst.blend(src, 0, 0, 512, 512, 1, 1);
+        dst.clear_dirty();
+        bench_keep(dst.data()[0]);
+    });
+}
+
+static void bench_blit_scaled(KBench& bench)
+{
+    KBitmap src{256, 256};
+    for (int y = 0; y < 256; ++y)
+        for (int x = 0; x < 256; ++x)
+            src.put_pixel(x, y, 0xff000000 | (x << 16) | (y << 8) | ((x ^ y) & 0xff));
+    KBitmap dst{1024, 1024};
+    bench.measure(1024.0 * 1024.0, "pixels", [&] {
+        dst.blit_scaled(src, 0, 0, 1024, 1024);
+        dst.clear_dirty();
+        bench_keep(dst.data()[0]);
+    });
+}
+
+// Whole frames at 3840x2160, where the rows are far larger than the
+// caches and the kernels run at memory speed.
+static const int k4KWidth{3840};
+static const int k4KHeight{2160};
+static const double k4KPixels{static_cast<double>(k4KWidth) * k4KHeight};
+
+static void bench_clear_4k(KBench& bench)
+{
+    KBitmap bitmap{k4KWidth, k4KHeight};
+    bench.measure(k4KPixels, "pixels", [&] {
+        bitmap.clear(kOpaque);
+        bitmap.clear_dirty();
+        bench_keep(bitmap.data()[0]);
+    });
+}
+
+static void bench_blit_4k(KBench& bench)
+{
+    KBitmap src{k4KWidth, k4KHeight};
+    src.clear(kTranslucent);
+    KBitmap dst{k4KWidth, k4KHeight};
+    bench.measure(k4KPixels, "pixels", [&] {
+        dst.blit(src, 0, 0, k4KWidth, k4KHeight, 0, 0);
+        dst.clear_dirty();
+        bench_keep(dst.data()[0]);
+    });
+}
+
+static void bench_blend_4k(KBench& bench)
+{
+    KBitmap src{k4KWidth, k4KHeight};
+    src.clear(kTranslucent);
+    KBitmap dst{k4KWidth, k4KHeight};
+    dst.clear(kOpaque);
+    bench.measure(k4KPixels, "pixels", [&] {
+        dst.blend(src, 0, 0, k4KWidth, k4KHeight, 0, 0);
+        dst.clear_dirty();
+        bench_keep(dst.data()[0]);
+    });
+}
+
+static void bench_blit_scaled_4k(KBench& bench)
+{
+    KBitmap src{k4KWidth / 2, k4KHeight / 2};
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            src.put_pixel(x, y, 0xff000000 | ((x & 0xff) << 16) | ((y & 0xff) << 8) | ((x ^ y) & 0xff));
+    KBitmap dst{k4KWidth, k4KHeight};
+    bench.measure(k4KPixels, "pixels", [&] {
+        dst.blit_scaled(src, 0, 0, k4KWidth, k4KHeight);
+        dst.clear_dirty();
+        bench_keep(dst.data()[0]);
+    });
+}
+
+// KBitmap::draw as the surface calls it once a frame, after KScene::update.
+static void bench_draw(KBench& bench, uint32_t particle_count)
+{
+    KScene scene{128, 128, particle_count};
+    KBitmap bitmap{128, 128};
+    bench.measure(1.0, "frames", [&] {
+        bitmap.draw(scene);
+        bitmap.clear_dirty();
+        bench_keep(bitmap.data()[0]);
+    });
+}
+
+static void bench_draw_point(KBench& bench) { bench_draw(bench, 0); }
+static void bench_draw_particles(KBench& bench) { bench_draw(bench, 2048); }
+
+// What a frame leaves to upload, as d2d.hwndrt's render() copies it:
+// the point of KScene moving a pixel at a time, and 200 pixels scattered
+// over the bitmap, which the rectangle cap merges into larger areas.
+// A whole 1024x1024 frame would be 4 MB.
+static void bench_dirty_sparse(KBench& bench)
+{
+    KScene scene{1024, 1024};
+    KBitmap bitmap{1024, 1024};
+    bitmap.clear_dirty();
+    size_t bytes = 0;
+    uint64_t frames = 0;
+    bench.measure(1.0, "frames", [&] {
+        scene.update();
+        bitmap.draw(scene);
+        bytes += bitmap.dirty_bytes();
+        ++frames;
+        bitmap.clear_dirty();
+    });
+    bench.counter("bytes per frame", static_cast<double>(bytes) / static_cast<double>(frames));
+}
+
+static void bench_dirty_dense(KBench& bench)
+{
+    const int pixels = 200;
+    KBitmap bitmap{1024, 1024};
+    bitmap.clear_dirty();
+    uint32_t state = 3;
+    size_t bytes = 0;
+    uint64_t frames = 0;
+    bench.measure(pixels, "pixels", [&] {
+        for (int i = 0; i < pixels; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            bitmap.put_pixel((state >> 8) % 1024, (state >> 18) % 1024, kOpaque);
+        }
+        bytes += bitmap.dirty_bytes();
+        ++frames;
+        bitmap.clear_dirty();
+    });
+    bench.counter("bytes per frame", static_cast<double>(bytes) / static_cast<double>(frames));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KScene and KParticles.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static void bench_scene_update(KBench& bench)
+{
+    const int steps = 1000;
+    KScene scene{128, 128};
+    bench.measure(steps, "steps", [&] {
+        for (int i = 0; i < steps; ++i)
+            scene.update();
+        bench_keep(scene.x_);
+    });
+}
+
+static const uint32_t kParticles{1 << 16};
+
+static void bench_particles_update(KBench& bench)
+{
+    KParticles particles{1024, 1024};
+    particles.reset(kParticles, 1);
+    bench.measure(kParticles, "particles", [&] {
+        particles.update(1);
+        bench_keep(particles.x()[0]);
+    });
+}
+
+static void bench_particles_update_scalar(KBench& bench)
+{
+    KParticles particles{1024, 1024};
+    particles.reset(kParticles, 1);
+    bench.measure(kParticles, "particles", [&] {
+        particles.update_scalar();
+        bench_keep(particles.x()[0]);
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KTiledBitmap.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Small rectangles scattered over a large, mostly untouched canvas.
+static void bench_tiled_fill_sparse(KBench& bench)
+{
+    const int rects = 256;
+    KTiledBitmap canvas{16384, 16384};
+    bench.measure(rects * 100.0 * 100.0, "pixels", [&] {
+        canvas.clear(0xffffffff);
+        uint32_t state = 1;
+        for (int i = 0; i < rects; ++i)
+        {
+            state = state * 1664525u + 1013904223u;
+            canvas.fill_rect((state >> 8) % 16284, (state >> 18) % 16284, 100, 100, kOpaque);
+        }
+        bench_keep(canvas.allocated_tiles());
+    });
+}
+
+static void bench_tiled_read(KBench& bench)
+{
+    KTiledBitmap canvas{4096, 4096};
+    canvas.fill_rect(1000, 1000, 1500, 1500, kOpaque);
+    canvas.fill_rect(1500, 1200, 300, 300, kTranslucent);
+    KBitmap view{1024, 1024};
+    bench.measure(1024.0 * 1024.0, "pixels", [&] {
+        canvas.read(1200, 1100, 1024, 1024, view, 0, 0);
+        view.clear_dirty();
+        bench_keep(view.data()[0]);
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KPath and KRasterizer.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const int kEllipses{1000};
+
+static void queue_ellipses(KRasterizer& rasterizer)
+{
+    uint32_t state = 7;
+    for (int i = 0; i < kEllipses; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        KPath path;
+        path.add_ellipse(static_cast<float>((state >> 8) % 1024),
+                         static_cast<float>((state >> 18) % 1024),
+                         4.f + (state >> 4) % 40,
+                         4.f + (state >> 12) % 40);
+        rasterizer.fill(path, 0xc0000000 | (state & 0x00c0c0c0));
+    }
+}
+
+static void bench_rasterizer_queue(KBench& bench)
+{
+    KRasterizer rasterizer{1024, 1024};
+    bench.measure(kEllipses, "ellipses", [&] {
+        rasterizer.reset();
+        queue_ellipses(rasterizer);
+        bench_keep(rasterizer.edge_count());
+    });
+}
+
+static void bench_rasterizer_render(KBench& bench)
+{
+    KRasterizer rasterizer{1024, 1024};
+    queue_ellipses(rasterizer);
+    KBitmap bitmap{1024, 1024};
+    bench.measure(kEllipses, "ellipses", [&] {
+        bitmap.clear(0xffffffff);
+        rasterizer.render(bitmap, 1);
+        bitmap.clear_dirty();
+        bench_keep(bitmap.data()[0]);
+    });
+}
+
+static void bench_path_stroke(KBench& bench)
+{
+    KPath path;
+    path.add_ellipse(512.f, 512.f, 400.f, 300.f);
+    KStrokeStyle style;
+    style.width = 3.f;
+    style.dashes = {12.f, 6.f};
+    bench.measure(1.0, "strokes", [&] {
+        KPath outline = path.stroke(style);
+        bench_keep(outline.points().size());
+    });
+}
+
+void register_bitmap_benchmarks(KBench& bench)
+{
+    bench.add("bitmap/clear/1024", bench_clear);
+    bench.add("bitmap/fill_rect/509", bench_fill_rect);
+    bench.add("bitmap/blend/512", bench_blend);
+    bench.add("bitmap/blit_scaled/256to1024", bench_blit_scaled);
+    bench.add("bitmap/clear/3840x2160", bench_clear_4k);
+    bench.add("bitmap/blit/3840x2160", bench_blit_4k);
+    bench.add("bitmap/blend/3840x2160", bench_blend_4k);
+    bench.add("bitmap/blit_scaled/1920x1080to3840x2160", bench_blit_scaled_4k);
+    bench.add("bitmap/draw/point", bench_draw_point);
+    bench.add("bitmap/draw/particles2048", bench_draw_particles);
+    bench.add("bitmap/dirty/sparse", bench_dirty_sparse);
+    bench.add("bitmap/dirty/dense", bench_dirty_dense);
+    bench.add("scene/update", bench_scene_update);
+    bench.add("particles/update/65536", bench_particles_update);
+    bench.add("particles/update_scalar/65536", bench_particles_update_scalar);
+    bench.add("tiledbitmap/fill_rect/sparse", bench_tiled_fill_sparse);
+    bench.add("tiledbitmap/read/1024", bench_tiled_read);
+    bench.add("rasterizer/queue/ellipses", bench_rasterizer_queue);
+    bench.add("rasterizer/render/ellipses", bench_rasterizer_render);
+    bench.add("path/stroke/dashed_ellipse", bench_path_stroke);
+}
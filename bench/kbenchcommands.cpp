@@ -0,0 +1,111 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "kbench.h"
+#include "kcommandbuffer.h"
+#include "kconstantring.h"
+
+// A scene of opaque objects, each a mesh, a material and a distance,
+// visited in no useful order, as a scene graph or a spatial grid would
+// hand them over. Materials pick one of a few shaders, each with its own
+// input layout and constant buffers, and one of many textures.
+static const int kDraws{4096};
+static const uint16_t kShaders{6};
+static const uint16_t kTextures{96};
+static const uint16_t kMeshes{12};
+
+static std::vector<KDraw> make_scene()
+{
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<int> shader(1, kShaders);
+    std::uniform_int_distribution<int> texture(1, kTextures);
+    std::uniform_int_distribution<int> mesh(1, kMeshes);
+    std::uniform_real_distribution<float> depth(0.5f, 200.f);
+
+    std::vector<KDraw> draws(kDraws);
+    for (KDraw& draw : draws)
+    {
+        uint16_t s = static_cast<uint16_t>(shader(rng));
+        uint16_t m = static_cast<uint16_t>(mesh(rng));
+        draw.state[KStateSlot::kVertexShader] = s;
+        draw.state[KStateSlot::kPixelShader] = s;
+        draw.state[KStateSlot::kInputLayout] = s;
+        draw.state[KStateSlot::kVSConstants] = s;
+        draw.state[KStateSlot::kPSConstants] = s;
+        draw.state[KStateSlot::kTexture] = static_cast<uint16_t>(texture(rng));
+        draw.state[KStateSlot::kSampler] = static_cast<uint16_t>(1 + s % 2);
+        draw.state[KStateSlot::kVertexBuffer] = m;
+        draw.state[KStateSlot::kIndexBuffer] = m;
+        draw.state[KStateSlot::kRasterizerState] = 1;
+        draw.state[KStateSlot::kDepthStencilState] = 1;
+        draw.state[KStateSlot::kTopology] = 4;
+        draw.depth = depth(rng);
+        draw.index_count = 36u * m;
+    }
+    return draws;
+}
+
+static void bench_submit(KBench& bench, KDrawOrder order)
+{
+    std::vector<KDraw> scene = make_scene();
+    KCommandBuffer commands;
+    KRecordingDevice device;
+    bench.measure(kDraws, "draws", [&] {
+        device.reset();
+        commands.reset();
+        for (const KDraw& draw : scene)
+            commands.draw(draw);
+        commands.submit(device, order);
+        bench_keep(device.draws().size());
+    });
+
+    // Binding every slot for every draw, as a renderer without the
+    // layer does, would be kStateSlotCount * kDraws binds.
+    bench.counter("binds", static_cast<double>(device.total_binds()));
+    bench.counter("shader binds", static_cast<double>(device.binds(KStateSlot::kVertexShader) +
+                                                      device.binds(KStateSlot::kPixelShader)));
+    bench.counter("texture binds", static_cast<double>(device.binds(KStateSlot::kTexture)));
+}
+
+static void bench_submit_recorded(KBench& bench) { bench_submit(bench, KDrawOrder::kRecorded); }
+static void bench_submit_sorted(KBench& bench) { bench_submit(bench, KDrawOrder::kSorted); }
+
+// A frame's worth of per-draw constants from a 4 MB ring while the GPU
+// is two frames behind, as in the lighting sample: the sizes are its
+// three constant structs. An allocation that finds the ring full waits
+// for the oldest frame, which here is only counted.
+static void bench_constant_ring(KBench& bench)
+{
+    static const uint32_t kSizes[]{80, 176, 64};
+    const uint64_t kLatency = 2;
+    KConstantRing ring{4u << 20};
+    uint64_t frame = 0;
+    uint64_t retired = 0;
+    uint64_t stalls = 0;
+    bench.measure(kDraws, "allocations", [&] {
+        if (frame >= kLatency)
+        {
+            ring.retire(frame - kLatency);
+            retired = frame - kLatency + 1;
+        }
+        for (int i = 0; i < kDraws; ++i)
+        {
+            uint32_t offset;
+            while (!ring.allocate(kSizes[i % 3], &offset))
+            {
+                ring.retire(retired++);
+                ++stalls;
+            }
+            bench_keep(offset);
+        }
+        ring.end_frame(frame++);
+    });
+    bench.counter("stalls per frame", static_cast<double>(stalls) / static_cast<double>(frame));
+}
+
+void register_command_benchmarks(KBench& bench)
+{
+    bench.add("commands/submit/recorded/4096", bench_submit_recorded);
+    bench.add("commands/submit/sorted/4096", bench_submit_sorted);
+    bench.add("commands/constant_ring/4096", bench_constant_ring);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// The test image of the texture benchmarks, and of the tests that hold
+// the encoders to a quality floor on it: a smooth gradient with some
+// detail, opaque but for a soft-edged disc of partial alpha, in the
+// BGRA layout WIC decodes to. Rows are width * 4 bytes apart.
+//
+// USAGE:
+//
+// std::vector<uint8_t> image = make_image(512, 512);
+
+inline std::vector<uint8_t> make_image(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> texels(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            float u = static_cast<float>(x) / width;
+            float v = static_cast<float>(y) / height;
+            float r = std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+            uint8_t *p = &texels[(static_cast<size_t>(y) * width + x) * 4];
+            p[0] = static_cast<uint8_t>(255.f * u);
+            p[1] = static_cast<uint8_t>(127.5f + 127.5f * std::sin(40.f * u) * std::cos(30.f * v));
+            p[2] = static_cast<uint8_t>(255.f * v);
+            p[3] = static_cast<uint8_t>(r < 0.25f ? 128.f + 512.f * r : 255.f);
+        }
+    }
+    return texels;
+}
@@ -0,0 +1,117 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "kbench.h"
+#include "kcpu.h"
+
+#if !defined(KBENCH_REVISION)
+#define KBENCH_REVISION "unknown"
+#endif
+
+void register_mesh_benchmarks(KBench& bench);
+void register_texture_benchmarks(KBench& bench);
+void register_time_benchmarks(KBench& bench);
+void register_bitmap_benchmarks(KBench& bench);
+void register_shape_benchmarks(KBench& bench);
+void register_command_benchmarks(KBench& bench);
+void register_asset_benchmarks(KBench& bench);
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: kbench [options] [filter...]\n"
+            "  Runs the benchmarks whose names contain any filter, or all of them.\n"
+            "  --list              print the names instead of running them\n"
+            "  --json FILE         write the results as JSON to FILE\n"
+            "  --revision ID       label the JSON with ID instead of the configured revision\n"
+            "  --baseline FILE     compare with the JSON of an earlier run\n"
+            "  --threshold PERCENT slowdown against the baseline that fails the run (10)\n"
+            "  --min-time SECONDS  time each benchmark for at least this long (0.2)\n"
+            "  --min-samples N     and for at least N samples (10)\n"
+            "  --max-samples N     but for no more than N samples (1000)\n"
+            "  --isa NAME          cap the instruction set of the kernels that pick one at\n"
+            "                      run time: scalar, sse2, sse4.1, avx2 or avx512\n");
+}
+
+int main(int argc, char **argv)
+{
+    KBench::Options options;
+    const char *json = nullptr;
+    const char *revision = KBENCH_REVISION;
+    const char *baseline = nullptr;
+    double threshold = 0.1;
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--list") == 0)
+            list = true;
+        else if (strcmp(arg, "--json") == 0 && has_value)
+            json = argv[++i];
+        else if (strcmp(arg, "--revision") == 0 && has_value)
+            revision = argv[++i];
+        else if (strcmp(arg, "--baseline") == 0 && has_value)
+            baseline = argv[++i];
+        else if (strcmp(arg, "--threshold") == 0 && has_value)
+            threshold = atof(argv[++i]) / 100.0;
+        else if (strcmp(arg, "--min-time") == 0 && has_value)
+            options.min_seconds = atof(argv[++i]);
+        else if (strcmp(arg, "--min-samples") == 0 && has_value)
+            options.min_samples = static_cast<size_t>(atol(argv[++i]));
+        else if (strcmp(arg, "--max-samples") == 0 && has_value)
+            options.max_samples = static_cast<size_t>(atol(argv[++i]));
+        else if (strcmp(arg, "--isa") == 0 && has_value)
+        {
+            KIsa isa;
+            if (!isa_from_name(argv[++i], &isa))
+            {
+                usage();
+                return 2;
+            }
+            limit_cpu_isa(isa);
+        }
+        else if (arg[0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+            options.filters.push_back(arg);
+    }
+    if (options.min_samples < 1)
+        options.min_samples = 1;
+    if (options.max_samples < options.min_samples)
+        options.max_samples = options.min_samples;
+
+    fprintf(stderr, "isa: %s\n", isa_name(cpu_isa()));
+    KBench bench{options};
+    register_mesh_benchmarks(bench);
+    register_texture_benchmarks(bench);
+    register_time_benchmarks(bench);
+    register_bitmap_benchmarks(bench);
+    register_shape_benchmarks(bench);
+    register_command_benchmarks(bench);
+    register_asset_benchmarks(bench);
+
+    if (list)
+    {
+        bench.list();
+        return 0;
+    }
+    if (bench.run() == 0)
+    {
+        fprintf(stderr, "no benchmark matches\n");
+        return 1;
+    }
+    bench.print();
+    if (json && !bench.write_json(json, revision))
+    {
+        fprintf(stderr, "could not write %s\n", json);
+        return 1;
+    }
+    if (baseline && !bench.compare(baseline, threshold))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,270 @@
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "kbench.h"
+#include "kmath.h"
+#include "kcamera.h"
+#include "kworldstate.h"
+#include "kobjloader.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// load_obj() on synthetic meshes: an n x n grid of quads over a rippled
+// height field, two triangles each, with positions, UVs and normals.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static std::string write_grid_obj(int n)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 ("kbench_grid" + std::to_string(n) + ".obj");
+    std::string filename = path.string();
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+        return {};
+
+    for (int j = 0; j <= n; ++j)
+    {
+        for (int i = 0; i <= n; ++i)
+        {
+            float u = static_cast<float>(i) / n;
+            float v = static_cast<float>(j) / n;
+            float h = 0.1f * sinf(6.f * u) * cosf(4.f * v);
+            float3 normal = normalize(float3{-0.6f * cosf(6.f * u) * cosf(4.f * v),
+                                             1.f,
+                                             0.4f * sinf(6.f * u) * sinf(4.f * v)});
+            fprintf(file, "v %.6f %.6f %.6f\n", u * 2.f - 1.f, h, v * 2.f - 1.f);
+            fprintf(file, "vt %.6f %.6f\n", u, v);
+            fprintf(file, "vn %.6f %.6f %.6f\n", normal.x, normal.y, normal.z);
+        }
+    }
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            int a = j * (n + 1) + i + 1;    // OBJ indices start at 1.
+            int b = a + 1;
+            int c = a + n + 1;
+            int d = c + 1;
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b);
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, c, c, c, d, d, d);
+        }
+    }
+    fclose(file);
+    return filename;
+}
+
+static void bench_load_obj(KBench& bench, int n)
+{
+    std::string filename = write_grid_obj(n);
+    if (filename.empty())
+        return;
+    bench.measure(2.0 * n * n, "tris", [&] {
+        KOBJBlob blob = load_obj(filename.c_str());
+        bench_keep(blob.numIndices);
+        free_obj(blob);
+    });
+    std::error_code ec;
+    std::filesystem::remove(filename, ec);
+}
+
+// Only vertices, and one face to keep them, so that parsing the
+// numbers is most of the work rather than welding the vertices.
+static std::string write_vertices_obj(int count)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                 ("kbench_vertices" + std::to_string(count) + ".obj");
+    std::string filename = path.string();
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+        return {};
+
+    for (int i = 0; i < count; ++i)
+    {
+        float a = 0.001f * i;
+        fprintf(file, "v %.6f %.6f %.6f\n", 40.f * sinf(a), -3.5f * a, 12.f * cosf(3.f * a));
+        fprintf(file, "vt %.6f %.6f\n", 0.5f + 0.5f * sinf(a), a - floorf(a));
+        fprintf(file, "vn %.6f %.6f %.6f\n", sinf(a), 0.f, -cosf(a));
+    }
+    fprintf(file, "f 1/1/1 2/2/2 3/3/3\n");
+    fclose(file);
+    return filename;
+}
+
+static void bench_load_obj_vertices(KBench& bench)
+{
+    const int count = 1 << 16;
+    std::string filename = write_vertices_obj(count);
+    if (filename.empty())
+        return;
+    bench.measure(8.0 * count, "floats", [&] {
+        KOBJBlob blob = load_obj(filename.c_str());
+        bench_keep(blob.numIndices);
+        free_obj(blob);
+    });
+    std::error_code ec;
+    std::filesystem::remove(filename, ec);
+}
+
+static void bench_load_obj_16(KBench& bench) { bench_load_obj(bench, 16); }
+static void bench_load_obj_32(KBench& bench) { bench_load_obj(bench, 32); }
+static void bench_load_obj_64(KBench& bench) { bench_load_obj(bench, 64); }
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// kmath.h.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const int kBatch{1024};
+
+static std::vector<float4x4> make_matrices(int count)
+{
+    std::vector<float4x4> matrices(count);
+    for (int i = 0; i < count; ++i)
+    {
+        float a = 0.01f * i;
+        matrices[i] = rotation_x_matrix(a) * rotation_y_matrix(0.5f * a) *
+                      translation_matrix(float3{a, -a, 2.f * a});
+    }
+    return matrices;
+}
+
+static void bench_matrix_multiply(KBench& bench)
+{
+    std::vector<float4x4> a = make_matrices(kBatch);
+    std::vector<float4x4> b = make_matrices(kBatch + 1);
+    std::vector<float4x4> out(kBatch);
+    bench.measure(kBatch, "muls", [&] {
+        for (int i = 0; i < kBatch; ++i)
+            out[i] = a[i] * b[i + 1];
+        bench_keep(out[0]);
+    });
+}
+
+static void bench_transform(KBench& bench)
+{
+    const int count = 4096;
+    float4x4 m = make_matrices(8)[7] * make_perspective_matrix(16.f / 9.f, degrees_to_radians(60.f), 0.1f, 100.f);
+    std::vector<float4> in(count);
+    std::vector<float4> out(count);
+    for (int i = 0; i < count; ++i)
+        in[i] = float4{0.001f * i, 0.5f, -0.002f * i, 1.f};
+    bench.measure(count, "vectors", [&] {
+        for (int i = 0; i < count; ++i)
+            out[i] = in[i] * m;
+        bench_keep(out[0]);
+    });
+}
+
+static void bench_multiply_matrices(KBench& bench)
+{
+    std::vector<float4x4> a = make_matrices(kBatch);
+    float4x4 b = make_perspective_matrix(16.f / 9.f, degrees_to_radians(60.f), 0.1f, 100.f);
+    std::vector<float4x4> out(kBatch);
+    bench.measure(kBatch, "muls", [&] {
+        multiply_matrices(a.data(), b, out.data(), kBatch);
+        bench_keep(out[0]);
+    });
+}
+
+static void bench_transform_vectors(KBench& bench)
+{
+    const int count = 4096;
+    float4x4 m = make_matrices(8)[7] * make_perspective_matrix(16.f / 9.f, degrees_to_radians(60.f), 0.1f, 100.f);
+    std::vector<float4> in(count);
+    std::vector<float4> out(count);
+    for (int i = 0; i < count; ++i)
+        in[i] = float4{0.001f * i, 0.5f, -0.002f * i, 1.f};
+    bench.measure(count, "vectors", [&] {
+        transform_vectors(in.data(), m, out.data(), count);
+        bench_keep(out[0]);
+    });
+}
+
+static void bench_model_view(KBench& bench)
+{
+    // What KWorldState::update composes for every object, in bulk.
+    float4x4 view = make_matrices(3)[2];
+    std::vector<float4x4> out(kBatch);
+    std::vector<float3x3> normals(kBatch);
+    bench.measure(kBatch, "objects", [&] {
+        for (int i = 0; i < kBatch; ++i)
+        {
+            float a = 0.001f * i;
+            float4x4 model = rotation_x_matrix(a) * rotation_y_matrix(2.f * a) * translation_matrix(float3{a, 0.f, -a});
+            out[i] = model * view;
+            normals[i] = float4x4_to_float3x3(transpose(out[i]));
+        }
+        bench_keep(out[0]);
+        bench_keep(normals[0]);
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KCamera and KWorldState, stepped at the simulation rate.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const int kSteps{1000};
+static const float kStepSeconds{1.f / 120.f};
+
+static void bench_camera_update(KBench& bench)
+{
+    KCamera camera;
+    camera.keypress(KKey::kW, true);
+    camera.keypress(KKey::kE, true);
+    camera.keypress(KKey::kLeft, true);
+    camera.keypress(KKey::kUp, true);
+    bench.measure(kSteps, "steps", [&] {
+        for (int i = 0; i < kSteps; ++i)
+            camera.update(kStepSeconds);
+        bench_keep(camera.pos);
+    });
+}
+
+static void bench_world_state_step(KBench& bench)
+{
+    KWorldState world_state;
+    world_state.keypress(KKey::kUp, true);
+    world_state.keypress(KKey::kRight, true);
+    bench.measure(kSteps, "steps", [&] {
+        for (int i = 0; i < kSteps; ++i)
+            world_state.step(kStepSeconds);
+        bench_keep(world_state.obj_pos);
+    });
+}
+
+static void bench_world_state_update(KBench& bench)
+{
+    KWorldState world_state;
+    float4x4 view = rotation_y_matrix(-0.3f) * rotation_x_matrix(-0.1f) * translation_matrix(float3{0.f, 0.f, -2.f});
+    float4x4 inverse_view = translation_matrix(float3{0.f, 0.f, 2.f}) * rotation_x_matrix(0.1f) * rotation_y_matrix(0.3f);
+    double t = 0.0;
+    bench.measure(kSteps, "updates", [&] {
+        for (int i = 0; i < kSteps; ++i)
+        {
+            world_state.update(t, view, inverse_view);
+            t += kStepSeconds;
+        }
+        bench_keep(world_state.obj_mv_matrix);
+    });
+}
+
+void register_mesh_benchmarks(KBench& bench)
+{
+    bench.add("objloader/load_obj/grid16", bench_load_obj_16);
+    bench.add("objloader/load_obj/grid32", bench_load_obj_32);
+    bench.add("objloader/load_obj/grid64", bench_load_obj_64);
+    bench.add("objloader/load_obj/vertices65536", bench_load_obj_vertices);
+    bench.add("math/float4x4_multiply", bench_matrix_multiply);
+    bench.add("math/float4_transform", bench_transform);
+    bench.add("math/multiply_matrices/1024", bench_multiply_matrices);
+    bench.add("math/transform_vectors/4096", bench_transform_vectors);
+    bench.add("math/model_view", bench_model_view);
+    bench.add("camera/update", bench_camera_update);
+    bench.add("worldstate/step", bench_world_state_step);
+    bench.add("worldstate/update", bench_world_state_update);
+}
+
+#pragma warning(pop)
@@ -0,0 +1,14 @@
+# Merges the raw profiles of a Clang training run into the
+# default.profdata that a DX11_PGO=USE build reads.
+#
+# cmake -DLLVM_PROFDATA=<path> -DPGO_DIR=<dir> -P kbenchpgomerge.cmake
+
+file(GLOB raw_profiles ${PGO_DIR}/*.profraw)
+if(NOT raw_profiles)
+    message(FATAL_ERROR "no .profraw files in ${PGO_DIR}")
+endif()
+execute_process(COMMAND ${LLVM_PROFDATA} merge -output=${PGO_DIR}/default.profdata ${raw_profiles}
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "llvm-profdata merge failed")
+endif()
@@ -0,0 +1,286 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "kbench.h"
+#include "kgeometry.h"
+#include "kshapestore.h"
+#include "kscenefile.h"
+#include "kellipsebatch.h"
+#include "kjournal.h"
+#include "kglyphatlas.h"
+#include "ktextbatch.h"
+
+static const uint32_t kWidth{1920};
+static const uint32_t kHeight{1080};
+static const int kShapes{10000};
+
+// Ellipses scattered over the surface, mostly small, as a user would draw.
+static std::vector<KEllipseF> make_ellipses(int count, uint32_t seed,
+                                            uint32_t width = kWidth, uint32_t height = kHeight)
+{
+    std::vector<KEllipseF> ellipses(count);
+    uint32_t state = seed;
+    for (KEllipseF& e : ellipses)
+    {
+        state = state * 1664525u + 1013904223u;
+        e.cx = static_cast<float>((state >> 8) % width);
+        e.cy = static_cast<float>((state >> 16) % height);
+        e.rx = 2.f + (state >> 3) % 30;
+        e.ry = 2.f + (state >> 11) % 30;
+    }
+    return ellipses;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KGeometry and KShapeStore.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Clicks at random points of a drawing of count ellipses. Larger
+// drawings cover a larger canvas, as dense as the 10000 on one screen,
+// so that a pick meets as many ellipses at every size and the numbers
+// show how the index scales rather than how deep the pile is.
+static void bench_select_shape(KBench& bench, int count)
+{
+    float scale = std::sqrt(static_cast<float>(count) / kShapes);
+    uint32_t width = static_cast<uint32_t>(kWidth * scale);
+    uint32_t height = static_cast<uint32_t>(kHeight * scale);
+    KGeometry geometry{width, height};
+    for (const KEllipseF& e : make_ellipses(count, 1, width, height))
+        geometry.insertEllipse(e);
+
+    const int picks = 1024;
+    std::vector<float> points(2 * picks);
+    uint32_t state = 99;
+    for (int i = 0; i < picks; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        points[2 * i] = static_cast<float>((state >> 8) % width);
+        points[2 * i + 1] = static_cast<float>((state >> 16) % height);
+    }
+    bench.measure(picks, "picks", [&] {
+        int hits = 0;
+        for (int i = 0; i < picks; ++i)
+            hits += geometry.selectShape(points[2 * i], points[2 * i + 1]);
+        bench_keep(hits);
+    });
+}
+
+static void bench_select_shape_10k(KBench& bench) { bench_select_shape(bench, kShapes); }
+static void bench_select_shape_100k(KBench& bench) { bench_select_shape(bench, 100000); }
+static void bench_select_shape_1m(KBench& bench) { bench_select_shape(bench, 1000000); }
+
+static void bench_insert_ellipse(KBench& bench)
+{
+    std::vector<KEllipseF> ellipses = make_ellipses(kShapes, 2);
+    KGeometry geometry{kWidth, kHeight};
+    bench.measure(kShapes, "ellipses", [&] {
+        geometry.clear();
+        for (const KEllipseF& e : ellipses)
+            geometry.insertEllipse(e);
+        bench_keep(geometry.shapes_.size());
+    });
+}
+
+// Erases every other shape and puts new ones in their place, which
+// exercises the free list and the compaction of holes.
+static void bench_store_churn(KBench& bench)
+{
+    std::vector<KEllipseF> ellipses = make_ellipses(kShapes, 3);
+    KShapeStore store;
+    std::vector<KShapeHandle> handles;
+    for (const KEllipseF& e : ellipses)
+        handles.push_back(store.insert(e));
+    bench.measure(kShapes, "edits", [&] {
+        for (size_t i = 0; i < handles.size(); i += 2)
+            store.erase(handles[i]);
+        for (size_t i = 0; i < handles.size(); i += 2)
+            handles[i] = store.insert(ellipses[i]);
+        bench_keep(store.size());
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KEllipseBatch.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static void bench_tessellate(KBench& bench)
+{
+    std::vector<KEllipseF> ellipses = make_ellipses(kShapes, 4);
+    std::vector<KTriangleF> fill;
+    std::vector<KTriangleF> stroke;
+    bench.measure(kShapes, "ellipses", [&] {
+        for (const KEllipseF& e : ellipses)
+        {
+            fill.clear();
+            stroke.clear();
+            KEllipseBatch::tessellate(e, fill, stroke);
+        }
+        bench_keep(fill.size());
+    });
+}
+
+// One ellipse moved a frame: the common case when dragging. Smaller
+// chunks rebuild less per edit but take more FillMesh calls a frame;
+// one chunk of every slot rebuilds the whole scene, as a single pair
+// of meshes would.
+static void bench_batch_update_one(KBench& bench, uint32_t chunk_slots)
+{
+    KShapeStore store;
+    std::vector<KShapeHandle> handles;
+    for (const KEllipseF& e : make_ellipses(kShapes, 5))
+        handles.push_back(store.insert(e));
+    KEllipseBatch batch{chunk_slots};
+    batch.update(store);
+    KEllipseF moving = store.get(handles[kShapes / 2]);
+    bench.measure(1.0, "frames", [&] {
+        moving.cx += 1.f;
+        store.set(handles[kShapes / 2], moving);
+        bool changed = batch.update(store);
+        bench_keep(changed);
+    });
+    bench.counter("meshes", 2.0 * static_cast<double>(batch.chunk_count()));
+}
+
+static void bench_batch_update_one_64(KBench& bench) { bench_batch_update_one(bench, 64); }
+static void bench_batch_update_one_256(KBench& bench) { bench_batch_update_one(bench, 256); }
+static void bench_batch_update_one_1024(KBench& bench) { bench_batch_update_one(bench, 1024); }
+static void bench_batch_update_one_all(KBench& bench) { bench_batch_update_one(bench, kShapes); }
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Scene files and the journal.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const int kSceneShapes{100000};
+
+static std::filesystem::path scene_path()
+{
+    return std::filesystem::temp_directory_path() / "kbench_scene.bin";
+}
+
+static void bench_scene_save(KBench& bench)
+{
+    KShapeStore store;
+    for (const KEllipseF& e : make_ellipses(kSceneShapes, 6))
+        store.insert(e);
+    std::filesystem::path path = scene_path();
+    bench.measure(kSceneShapes, "ellipses", [&] {
+        bool saved = save_scene(store, path);
+        bench_keep(saved);
+    });
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+static void bench_scene_load(KBench& bench)
+{
+    KShapeStore store;
+    for (const KEllipseF& e : make_ellipses(kSceneShapes, 7))
+        store.insert(e);
+    std::filesystem::path path = scene_path();
+    if (!save_scene(store, path))
+        return;
+    KShapeStore loaded;
+    bench.measure(kSceneShapes, "ellipses", [&] {
+        bool ok = load_scene(path, loaded);
+        bench_keep(ok);
+    });
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+// Undoes and redoes a history of inserts and moves, which replays from
+// the snapshots the journal keeps along the way.
+static void bench_journal_undo_redo(KBench& bench)
+{
+    const int steps = 1000;
+    KGeometry geometry{kWidth, kHeight};
+    KJournal journal{geometry};
+    std::vector<KEllipseF> ellipses = make_ellipses(steps / 2, 8);
+    for (int i = 0; i < steps / 2; ++i)
+    {
+        journal.insert(ellipses[i]);
+        journal.commit();
+        journal.move(3.f, -2.f);
+        journal.commit();
+    }
+    bench.measure(2.0 * steps, "steps", [&] {
+        while (journal.undo())
+        {
+        }
+        while (journal.redo())
+        {
+        }
+        bench_keep(geometry.shapes_.size());
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Text.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const wchar_t *kOverlay{L"Mode: Select\n"
+                               L"Ellipses: 10000\n"
+                               L"Frame: 16.67 ms\n"
+                               L"Arrows move, +/- scale, Ctrl+Z undo, Ctrl+Y redo\n"};
+
+// Lays the overlay out from scratch each time, as on the first frame.
+static void bench_text_layout(KBench& bench)
+{
+    KGlyphAtlas atlas{2.f};
+    std::wstring text = kOverlay;
+    bench.measure(static_cast<double>(text.size()), "chars", [&] {
+        KTextBatch batch;
+        batch.layout(text, atlas);
+        bench_keep(batch.quads().size());
+    });
+}
+
+// Changes one line, as when the frame time updates.
+static void bench_text_relayout(KBench& bench)
+{
+    KGlyphAtlas atlas{2.f};
+    KTextBatch batch;
+    std::wstring texts[2]{kOverlay, kOverlay};
+    texts[1][40] = L'9';
+    int frame = 0;
+    bench.measure(1.0, "layouts", [&] {
+        bool changed = batch.layout(texts[++frame & 1], atlas);
+        bench_keep(changed);
+    });
+}
+
+static void bench_text_render(KBench& bench)
+{
+    KGlyphAtlas atlas{2.f};
+    KTextBatch batch;
+    batch.layout(kOverlay, atlas);
+    int width = static_cast<int>(batch.width()) + 1;
+    int height = static_cast<int>(batch.height()) + 1;
+    std::vector<uint8_t> coverage(static_cast<size_t>(width) * height);
+    bench.measure(static_cast<double>(batch.quads().size()), "glyphs", [&] {
+        batch.render(atlas, coverage.data(), width, height, width);
+        bench_keep(coverage[0]);
+    });
+}
+
+void register_shape_benchmarks(KBench& bench)
+{
+    bench.add("geometry/selectShape/10000", bench_select_shape_10k);
+    bench.add("geometry/selectShape/100000", bench_select_shape_100k);
+    bench.add("geometry/selectShape/1000000", bench_select_shape_1m);
+    bench.add("geometry/insertEllipse/10000", bench_insert_ellipse);
+    bench.add("shapestore/churn/10000", bench_store_churn);
+    bench.add("ellipsebatch/tessellate/10000", bench_tessellate);
+    bench.add("ellipsebatch/update_one/10000/chunk64", bench_batch_update_one_64);
+    bench.add("ellipsebatch/update_one/10000/chunk256", bench_batch_update_one_256);
+    bench.add("ellipsebatch/update_one/10000/chunk1024", bench_batch_update_one_1024);
+    bench.add("ellipsebatch/update_one/10000/chunk10000", bench_batch_update_one_all);
+    bench.add("scenefile/save/100000", bench_scene_save);
+    bench.add("scenefile/load/100000", bench_scene_load);
+    bench.add("journal/undo_redo/1000", bench_journal_undo_redo);
+    bench.add("text/layout", bench_text_layout);
+    bench.add("text/relayout_line", bench_text_relayout);
+    bench.add("text/render", bench_text_render);
+}
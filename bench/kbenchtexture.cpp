@@ -0,0 +1,69 @@
+#include <cstdint>
+#include <vector>
+#include "kbench.h"
+#include "kbenchimage.h"
+#include "kmipmap.h"
+#include "kbcencoder.h"
+#include "katlas.h"
+
+// Single-threaded throughout, so that the numbers compare across
+// machines with different core counts.
+
+static void bench_mip_chain(KBench& bench, uint32_t size, KMipFilter filter)
+{
+    std::vector<uint8_t> image = make_image(size, size);
+    bench.measure(static_cast<double>(size) * size, "texels", [&] {
+        KMipChain chain = generate_mip_chain(image.data(), size, size, size * 4, filter, 1);
+        bench_keep(chain.data.size());
+    });
+}
+
+static void bench_mip_box(KBench& bench) { bench_mip_chain(bench, 1024, KMipFilter::kBox); }
+static void bench_mip_kaiser(KBench& bench) { bench_mip_chain(bench, 1024, KMipFilter::kKaiser); }
+
+static void bench_encode(KBench& bench, uint32_t size, KBCFormat format)
+{
+    std::vector<uint8_t> image = make_image(size, size);
+    std::vector<uint8_t> blocks((size / 4) * (size / 4) * bc_block_size(format));
+    bench.measure(static_cast<double>(size) * size, "texels", [&] {
+        encode_bc(image.data(), size, size, size * 4, format, blocks.data(), 1);
+        bench_keep(blocks[0]);
+    });
+}
+
+static void bench_encode_bc1(KBench& bench) { bench_encode(bench, 512, KBCFormat::kBC1); }
+static void bench_encode_bc3(KBench& bench) { bench_encode(bench, 512, KBCFormat::kBC3); }
+static void bench_encode_bc7(KBench& bench) { bench_encode(bench, 128, KBCFormat::kBC7); }
+
+static void bench_build_atlas(KBench& bench)
+{
+    // Sprite-sized images of assorted shapes, sharing one texel source.
+    const int count = 512;
+    std::vector<uint8_t> source = make_image(128, 128);
+    std::vector<KAtlasImage> images(count);
+    uint32_t state = 12345;
+    for (KAtlasImage& image : images)
+    {
+        state = state * 1664525u + 1013904223u;
+        image.texels = source.data();
+        image.width = 8 + (state >> 8) % 120;
+        image.height = 8 + (state >> 20) % 120;
+        image.stride = 128 * 4;
+    }
+    KAtlasSettings settings;
+    bench.measure(count, "images", [&] {
+        KAtlas atlas;
+        bool built = build_atlas(images, settings, &atlas);
+        bench_keep(built);
+    });
+}
+
+void register_texture_benchmarks(KBench& bench)
+{
+    bench.add("mipmap/box/1024", bench_mip_box);
+    bench.add("mipmap/kaiser/1024", bench_mip_kaiser);
+    bench.add("bcencoder/bc1/512", bench_encode_bc1);
+    bench.add("bcencoder/bc3/512", bench_encode_bc3);
+    bench.add("bcencoder/bc7/128", bench_encode_bc7);
+    bench.add("atlas/build/512", bench_build_atlas);
+}
@@ -0,0 +1,54 @@
+#include <cstdint>
+#include "kbench.h"
+#include "kclock.h"
+#include "kprofiler.h"
+
+static const int kCalls{1000};
+
+static void bench_monotonic(KBench& bench)
+{
+    bench.measure(kCalls, "reads", [&] {
+        int64_t sum = 0;
+        for (int i = 0; i < kCalls; ++i)
+            sum += monotonic_nanoseconds();
+        bench_keep(sum);
+    });
+}
+
+static void bench_tick(KBench& bench)
+{
+    KClock clock;
+    bench.measure(kCalls, "ticks", [&] {
+        for (int i = 0; i < kCalls; ++i)
+            clock.tick(1.0 / 60.0);
+        bench_keep(clock.dt);
+    });
+}
+
+static void bench_frame_summary(KBench& bench)
+{
+    KFrameStats stats;
+    for (size_t i = 0; i < KFrameStats::kWindow; ++i)
+        stats.add(16000000 + static_cast<int64_t>((i * 7919) % 1000) * 1000);
+    bench.measure(1.0, "summaries", [&] {
+        KFrameSummary s = stats.summary();
+        bench_keep(s);
+    });
+}
+
+static void bench_profile_zone(KBench& bench)
+{
+    KProfiler::set_enabled(true);
+    bench.measure(kCalls, "zones", [&] {
+        for (int i = 0; i < kCalls; ++i)
+            KProfileZone zone{"kbench"};
+    });
+}
+
+void register_time_benchmarks(KBench& bench)
+{
+    bench.add("clock/monotonic_nanoseconds", bench_monotonic);
+    bench.add("clock/tick", bench_tick);
+    bench.add("clock/frame_summary", bench_frame_summary);
+    bench.add("profiler/zone", bench_profile_zone);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdio>
+
+// The checks of the ctest executables next to the benchmarks. Unlike
+// assert() they stay in Release builds, report the expression and its
+// line and let the test carry on, and ktest_result() turns them into
+// the exit code ctest looks at.
+//
+// USAGE:
+//
+// int main()
+// {
+//     KTEST_CHECK(ring.used() == 0);
+//     return ktest_result();
+// }
+
+inline int& ktest_failures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline bool ktest_check(bool passed, const char *expression, const char *file, int line)
+{
+    if (!passed)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++ktest_failures();
+    }
+    return passed;
+}
+
+#define KTEST_CHECK(expression) ktest_check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+inline int ktest_result()
+{
+    if (ktest_failures() != 0)
+        fprintf(stderr, "%d checks failed\n", ktest_failures());
+    return ktest_failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "katlas.h"
+#include "ktest.h"
+
+// build_atlas() on images of random sizes and random texels: every
+// padded slot lies inside its page and overlaps no other, every image
+// is copied exactly, and its padding repeats its edge texels. Then the
+// binary form: write_atlas and read_atlas round-trip, and read_atlas
+// turns down files whose header claims more than they hold.
+
+static const uint32_t kPadding{12};   // Bytes past each source row.
+
+struct Image
+{
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> texels;
+};
+
+static std::vector<Image> make_images(int count, uint32_t max_size, uint32_t seed)
+{
+    std::mt19937 rng{seed};
+    std::vector<Image> images(count);
+    for (Image& image : images)
+    {
+        image.width = 1 + rng() % max_size;
+        image.height = 1 + rng() % max_size;
+        image.texels.resize(static_cast<size_t>(image.width * 4 + kPadding) * image.height);
+        for (uint8_t& texel : image.texels)
+            texel = static_cast<uint8_t>(rng());
+    }
+    return images;
+}
+
+static std::vector<KAtlasImage> atlas_images(const std::vector<Image>& images)
+{
+    std::vector<KAtlasImage> result;
+    for (const Image& image : images)
+        result.push_back({image.texels.data(), image.width, image.height, image.width * 4 + kPadding});
+    return result;
+}
+
+static uint32_t round_up(uint32_t value, uint32_t multiple)
+{
+    return (multiple <= 1) ? value : (value + multiple - 1) / multiple * multiple;
+}
+
+static const uint8_t* page_texel(const KAtlas& atlas, uint32_t page, uint32_t x, uint32_t y)
+{
+    return atlas.page_data(page) + (static_cast<size_t>(y) * atlas.page_width + x) * 4;
+}
+
+static void test_build(int count, uint32_t max_size, const KAtlasSettings& settings, uint32_t seed)
+{
+    std::vector<Image> images = make_images(count, max_size, seed);
+    KAtlas atlas{};
+    if (!KTEST_CHECK(build_atlas(atlas_images(images), settings, &atlas)))
+        return;
+    if (!KTEST_CHECK(atlas.entries.size() == images.size() && atlas.page_count > 0 &&
+                     atlas.page_count <= settings.max_pages &&
+                     atlas.texels.size() == atlas.page_size() * atlas.page_count))
+        return;
+
+    // Which image's padded slot covers each texel of each page.
+    const uint32_t pad = atlas.padding;
+    std::vector<int> owner(static_cast<size_t>(atlas.page_width) * atlas.page_height * atlas.page_count, -1);
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        const Image& image = images[i];
+        const KAtlasEntry& entry = atlas.entries[i];
+        if (!KTEST_CHECK(entry.page < atlas.page_count && entry.width == image.width &&
+                         entry.height == image.height && entry.x >= pad && entry.y >= pad))
+            return;
+
+        uint32_t x0 = entry.x - pad;
+        uint32_t y0 = entry.y - pad;
+        uint32_t w = round_up(image.width + 2 * pad, settings.alignment);
+        uint32_t h = round_up(image.height + 2 * pad, settings.alignment);
+        KTEST_CHECK(x0 % settings.alignment == 0 && y0 % settings.alignment == 0);
+        if (!KTEST_CHECK(x0 + w <= atlas.page_width && y0 + h <= atlas.page_height))
+            return;
+        for (uint32_t y = y0; y < y0 + h; ++y)
+        {
+            for (uint32_t x = x0; x < x0 + w; ++x)
+            {
+                int& slot = owner[(static_cast<size_t>(entry.page) * atlas.page_height + y) * atlas.page_width + x];
+                if (!KTEST_CHECK(slot == -1))
+                {
+                    fprintf(stderr, "  images %d and %zu overlap at (%u, %u) on page %u\n", slot, i, x, y, entry.page);
+                    return;
+                }
+                slot = static_cast<int>(i);
+            }
+        }
+
+        KTEST_CHECK(entry.u0 == static_cast<float>(entry.x) / atlas.page_width &&
+                    entry.v0 == static_cast<float>(entry.y) / atlas.page_height &&
+                    entry.u1 == static_cast<float>(entry.x + entry.width) / atlas.page_width &&
+                    entry.v1 == static_cast<float>(entry.y + entry.height) / atlas.page_height);
+
+        // The image, and around it the texel of the image nearest to
+        // each padding texel.
+        uint32_t stride = image.width * 4 + kPadding;
+        bool exact = true;
+        for (int y = -static_cast<int>(pad); y < static_cast<int>(image.height + pad); ++y)
+        {
+            for (int x = -static_cast<int>(pad); x < static_cast<int>(image.width + pad); ++x)
+            {
+                int sx = std::clamp(x, 0, static_cast<int>(image.width) - 1);
+                int sy = std::clamp(y, 0, static_cast<int>(image.height) - 1);
+                const uint8_t *expected = &image.texels[static_cast<size_t>(sy) * stride + sx * 4];
+                exact &= memcmp(page_texel(atlas, entry.page, entry.x + x, entry.y + y), expected, 4) == 0;
+            }
+        }
+        if (!KTEST_CHECK(exact))
+            fprintf(stderr, "  image %zu (%ux%u) isn't copied or bled exactly\n", i, image.width, image.height);
+    }
+}
+
+static bool same_atlas(const KAtlas& a, const KAtlas& b)
+{
+    return a.page_width == b.page_width && a.page_height == b.page_height &&
+           a.page_count == b.page_count && a.padding == b.padding && a.texels == b.texels &&
+           a.entries.size() == b.entries.size() &&
+           (a.entries.empty() || memcmp(a.entries.data(), b.entries.data(), a.entries.size() * sizeof(KAtlasEntry)) == 0);
+}
+
+// Writes word i of the header.
+static void set_word(std::vector<uint8_t> *mem, size_t i, uint32_t value)
+{
+    memcpy(mem->data() + 4 * i, &value, 4);
+}
+
+static void test_serialization()
+{
+    KAtlasSettings settings;
+    settings.page_width = 128;
+    settings.page_height = 64;
+    std::vector<Image> images = make_images(40, 24, 99);
+    KAtlas atlas{};
+    if (!KTEST_CHECK(build_atlas(atlas_images(images), settings, &atlas) && atlas.page_count > 1))
+        return;
+
+    const std::vector<uint8_t> good = write_atlas(atlas);
+    KAtlas read{};
+    KTEST_CHECK(read_atlas(good.data(), good.size(), &read) && same_atlas(atlas, read));
+
+    KAtlas loaded{};
+    KTEST_CHECK(save_atlas("ktestatlas.katl", atlas));
+    KTEST_CHECK(load_atlas("ktestatlas.katl", &loaded) && same_atlas(atlas, loaded));
+    remove("ktestatlas.katl");
+
+    // No images: no pages and no texels, which still reads back.
+    KAtlas empty{};
+    KTEST_CHECK(build_atlas({}, settings, &empty) && empty.page_count == 0);
+    std::vector<uint8_t> mem = write_atlas(empty);
+    KTEST_CHECK(read_atlas(mem.data(), mem.size(), &read) && same_atlas(empty, read));
+
+    // Cut off in the header, the entries or the texels.
+    size_t entry_end = 28 + atlas.entries.size() * sizeof(KAtlasEntry);
+    for (size_t n : {size_t{0}, size_t{27}, entry_end - 1, good.size() - 1})
+        KTEST_CHECK(!read_atlas(good.data(), n, &read));
+
+    // Counts and sizes that would take more than the file, or whose
+    // products wrap.
+    const uint32_t kWords[][2]{{6, 0xffffffff}, {6, 0x40000000}, {4, 0xffffffff}, {4, 0x40000000},
+                               {2, 0xffffffff}, {3, 0x80000000}, {4, atlas.page_count + 1}};
+    for (const uint32_t *word : kWords)
+    {
+        mem = good;
+        set_word(&mem, word[0], word[1]);
+        KTEST_CHECK(!read_atlas(mem.data(), mem.size(), &read));
+    }
+
+    // An entry on a page past the last, or reaching past its page.
+    const size_t kEntryWords[][2]{{0, 0}, {1, 0}, {3, 0}};
+    for (const size_t *field : kEntryWords)
+    {
+        mem = good;
+        uint32_t value = field[0] == 0 ? atlas.page_count
+                       : field[0] == 1 ? settings.page_width - atlas.entries[0].width + 1
+                                       : settings.page_width + 1;
+        set_word(&mem, 7 + field[0], value);
+        KTEST_CHECK(!read_atlas(mem.data(), mem.size(), &read));
+    }
+
+    // Nothing read since the empty atlas.
+    KTEST_CHECK(same_atlas(empty, read));
+}
+
+// An image that can't fit on an empty page, and more images than
+// max_pages can hold: with their padding, two of these fill a page.
+static void test_full()
+{
+    KAtlasSettings settings;
+    settings.page_width = 64;
+    settings.page_height = 64;
+    settings.max_pages = 2;
+    const uint32_t pad = settings.padding;
+    KAtlas atlas{};
+
+    Image wide{64 - 2 * pad + 1, 1, std::vector<uint8_t>((64 - 2 * pad + 1) * 4 + kPadding)};
+    KTEST_CHECK(!build_atlas(atlas_images({wide}), settings, &atlas));
+
+    Image half{64 - 2 * pad, 24 - 2 * pad, std::vector<uint8_t>(((64 - 2 * pad) * 4 + kPadding) * (24 - 2 * pad))};
+    KTEST_CHECK(build_atlas(atlas_images(std::vector<Image>(4, half)), settings, &atlas) && atlas.page_count == 2);
+    KTEST_CHECK(!build_atlas(atlas_images(std::vector<Image>(5, half)), settings, &atlas));
+}
+
+int main()
+{
+    KAtlasSettings settings;
+    settings.page_width = 256;
+    settings.page_height = 256;
+    test_build(300, 40, settings, 1);
+
+    // Padding that isn't a multiple of the alignment, and no alignment.
+    settings.padding = 3;
+    settings.alignment = 8;
+    test_build(200, 50, settings, 2);
+    settings.padding = 1;
+    settings.alignment = 1;
+    test_build(200, 50, settings, 3);
+    settings.padding = 0;
+    test_build(200, 50, settings, 4);
+
+    test_serialization();
+    test_full();
+    return ktest_result();
+}
@@ -0,0 +1,149 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "kbcencoder.h"
+#include "kbenchimage.h"
+#include "kmipmap.h"
+#include "ktest.h"
+
+// The block encoders held to a quality floor on the benchmarks' image,
+// and the DDS container: what write_dds writes, read_dds reads back
+// bit for bit, and a header that claims more than the file holds is
+// turned down before anything is allocated for it.
+
+// Each floor is a little under what the encoder gets today, over the
+// whole mip chain, so that a regression in either the endpoint fit or
+// the index selection shows up.
+struct Floor
+{
+    KBCFormat format;
+    uint32_t size;
+    double psnr;
+};
+
+static const Floor kFloors[]{
+    {KBCFormat::kBC1, 256, 36.5},
+    {KBCFormat::kBC3, 256, 38.0},
+    {KBCFormat::kBC7, 128, 37.0},
+};
+
+static const char* format_name(KBCFormat format)
+{
+    return format == KBCFormat::kBC1 ? "BC1" : format == KBCFormat::kBC3 ? "BC3" : "BC7";
+}
+
+static KMipChain make_chain(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> image = make_image(width, height);
+    return generate_mip_chain(image.data(), width, height, width * 4, KMipFilter::kBox, 1);
+}
+
+static bool same_image(const KBCImage& a, const KBCImage& b)
+{
+    if (a.format != b.format || a.srgb != b.srgb || a.levels.size() != b.levels.size() || a.data != b.data)
+        return false;
+    for (size_t i = 0; i < a.levels.size(); ++i)
+    {
+        const KBCLevel& x = a.levels[i];
+        const KBCLevel& y = b.levels[i];
+        if (x.width != y.width || x.height != y.height || x.pitch != y.pitch ||
+            x.offset != y.offset || x.size != y.size)
+            return false;
+    }
+    return true;
+}
+
+static void test_psnr(const Floor& floor)
+{
+    KMipChain chain = make_chain(floor.size, floor.size);
+    KBCStats stats{};
+    KBCImage image = encode_bc_chain(chain, floor.format, 1, &stats);
+    if (!KTEST_CHECK(image.levels.size() == chain.levels.size()))
+        return;
+    if (!KTEST_CHECK(stats.psnr >= floor.psnr))
+        fprintf(stderr, "  %s: %.2f dB is under the floor of %.2f dB\n", format_name(floor.format), stats.psnr, floor.psnr);
+    KTEST_CHECK(bc_psnr(chain, image) == stats.psnr);
+}
+
+// Sizes that aren't multiples of 4, down to levels smaller than a block.
+static void test_round_trip(KBCFormat format, bool srgb)
+{
+    KMipChain chain = make_chain(85, 120);
+    KBCImage image = encode_bc_chain(chain, format, 1);
+    image.srgb = srgb;
+
+    std::vector<uint8_t> mem = write_dds(image);
+    KBCImage read{};
+    KTEST_CHECK(read_dds(mem.data(), mem.size(), &read));
+    KTEST_CHECK(same_image(image, read));
+
+    std::string filename = std::string("ktestbcencoder_") + format_name(format) + ".dds";
+    KBCImage loaded{};
+    KTEST_CHECK(save_dds(filename.c_str(), image));
+    KTEST_CHECK(load_dds(filename.c_str(), &loaded));
+    KTEST_CHECK(same_image(image, loaded));
+    remove(filename.c_str());
+}
+
+// Writes word i of the header, counting the magic as word 0.
+static void set_word(std::vector<uint8_t> *mem, size_t i, uint32_t value)
+{
+    memcpy(mem->data() + 4 * i, &value, 4);
+}
+
+static void test_malformed()
+{
+    KMipChain chain = make_chain(16, 16);
+    KBCImage image = encode_bc_chain(chain, KBCFormat::kBC3, 1);
+    const std::vector<uint8_t> good = write_dds(image);
+    KBCImage read{};
+
+    // Cut off anywhere, in the header or in the blocks.
+    for (size_t n : {size_t{0}, size_t{4}, size_t{100}, good.size() - image.data.size(), good.size() - 1})
+        KTEST_CHECK(!read_dds(good.data(), n, &read));
+
+    // A mip count past the 1x1 level reads as the full chain.
+    std::vector<uint8_t> mem = good;
+    set_word(&mem, 7, 0xffffffff);
+    KTEST_CHECK(read_dds(mem.data(), mem.size(), &read) && same_image(image, read));
+
+    // Sizes whose blocks would take more than the file, or more than
+    // size_t, or whose block rows would wrap to a pitch of 0.
+    const uint32_t kSizes[][2]{{17, 16}, {16, 0x10000}, {0xffffffff, 1}, {1, 0xffffffff},
+                               {0xfffffffd, 0xfffffffd}, {0x40000000, 0x40000000}};
+    for (const uint32_t *size : kSizes)
+    {
+        mem = good;
+        set_word(&mem, 3, size[1]);
+        set_word(&mem, 4, size[0]);
+        KTEST_CHECK(!read_dds(mem.data(), mem.size(), &read));
+    }
+
+    // No width, no height, or a format that isn't BC1, BC3 or BC7.
+    const size_t kWords[]{3, 4, 32};
+    for (size_t word : kWords)
+    {
+        mem = good;
+        set_word(&mem, word, 0);
+        KTEST_CHECK(!read_dds(mem.data(), mem.size(), &read));
+    }
+
+    // None of that touched what was read last.
+    KTEST_CHECK(same_image(image, read));
+}
+
+int main()
+{
+    for (const Floor& floor : kFloors)
+        test_psnr(floor);
+    for (KBCFormat format : {KBCFormat::kBC1, KBCFormat::kBC3, KBCFormat::kBC7})
+    {
+        test_round_trip(format, false);
+        test_round_trip(format, true);
+    }
+    test_malformed();
+    return ktest_result();
+}
@@ -0,0 +1,222 @@
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+#include "kconstantring.h"
+#include "ktest.h"
+
+static const uint32_t kBlock{KConstantRing::kAlignment};
+
+// A block the ring handed out.
+struct Block
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+// What the ring should have in use: the 256-byte blocks of the frames
+// not yet retired, and of the frame being recorded.
+class Shadow
+{
+public:
+    explicit Shadow(uint32_t capacity) : owner_(capacity / kBlock, kFree) {}
+
+    // False when the block is out of the ring or overlaps a live one.
+    bool allocate(const Block& block, uint64_t frame)
+    {
+        if (block.offset % kBlock != 0 || block.offset + block.size > owner_.size() * kBlock)
+            return false;
+        for (uint32_t b = block.offset / kBlock; b < (block.offset + block.size) / kBlock; ++b)
+        {
+            if (owner_[b] != kFree)
+                return false;
+            owner_[b] = static_cast<int64_t>(frame);
+        }
+        current_.push_back(block);
+        return true;
+    }
+
+    void end_frame(uint64_t frame)
+    {
+        frames_.push_back(Frame{frame, current_});
+        current_.clear();
+    }
+
+    void retire(uint64_t frame)
+    {
+        while (!frames_.empty() && frames_.front().frame <= frame)
+        {
+            for (const Block& block : frames_.front().blocks)
+                for (uint32_t b = block.offset / kBlock; b < (block.offset + block.size) / kBlock; ++b)
+                    owner_[b] = kFree;
+            frames_.pop_front();
+        }
+    }
+
+    uint32_t live_bytes() const
+    {
+        uint32_t bytes = 0;
+        for (int64_t owner : owner_)
+            bytes += owner != kFree ? kBlock : 0;
+        return bytes;
+    }
+
+    bool empty() const { return frames_.empty() && current_.empty(); }
+    uint64_t frames() const { return frames_.size(); }
+
+private:
+    static constexpr int64_t kFree{-1};
+
+    struct Frame
+    {
+        uint64_t frame;
+        std::vector<Block> blocks;
+    };
+
+    std::vector<int64_t> owner_;
+    std::deque<Frame> frames_;
+    std::vector<Block> current_;
+};
+
+// Allocations, frame ends and retirements in random order, with the GPU
+// anywhere from no frames to many behind, checked after every step
+// against the shadow. Retirements are rare enough that even the largest
+// ring fills up now and then.
+static void test_random(uint32_t capacity, uint32_t seed)
+{
+    std::mt19937 rng{seed};
+    KConstantRing ring{capacity};
+    Shadow shadow{ring.capacity()};
+    uint64_t frame = 0;
+    uint64_t retired = 0;
+    uint64_t wraps = 0;
+    uint64_t full = 0;
+    uint32_t last_offset = 0;
+
+    for (int step = 0; step < 100000; ++step)
+    {
+        uint32_t op = rng() % 10;
+        if (op < 7)
+        {
+            uint32_t size = 1 + rng() % 700;
+            uint32_t offset;
+            if (ring.allocate(size, &offset))
+            {
+                if (!KTEST_CHECK(shadow.allocate(Block{offset, KConstantRing::aligned_size(size)}, frame)))
+                    return;
+                wraps += offset < last_offset;
+                last_offset = offset;
+            }
+            else
+            {
+                ++full;
+            }
+        }
+        else if (op < 9)
+        {
+            ring.end_frame(frame);
+            shadow.end_frame(frame);
+            ++frame;
+        }
+        else if (retired < frame && rng() % 8 == 0)
+        {
+            uint64_t to = retired + rng() % (frame - retired);
+            ring.retire(to);
+            shadow.retire(to);
+            retired = to + 1;
+        }
+
+        // used() also counts the space skipped at the end of the ring.
+        if (!KTEST_CHECK(ring.used() >= shadow.live_bytes() && ring.used() <= ring.capacity()))
+            return;
+        KTEST_CHECK(ring.frames_in_flight() == shadow.frames());
+        if (shadow.empty())
+            KTEST_CHECK(ring.used() == 0);
+    }
+
+    // Both have to happen for the run to have tested anything.
+    KTEST_CHECK(wraps > 0);
+    KTEST_CHECK(full > 0);
+}
+
+// A block that doesn't fit before the end starts over at 0, and the
+// space it skipped stays used until its frame retires.
+static void test_straddle()
+{
+    KConstantRing ring{4 * kBlock};
+    uint32_t offset;
+    KTEST_CHECK(ring.allocate(2 * kBlock, &offset) && offset == 0);
+    KTEST_CHECK(ring.allocate(kBlock, &offset) && offset == 2 * kBlock);
+    ring.end_frame(0);
+    ring.retire(0);
+    KTEST_CHECK(ring.used() == 0);
+
+    KTEST_CHECK(ring.allocate(2 * kBlock, &offset) && offset == 0);
+    KTEST_CHECK(ring.used() == 3 * kBlock);
+    KTEST_CHECK(ring.allocate(kBlock, &offset) && offset == 2 * kBlock);
+    KTEST_CHECK(!ring.allocate(1, &offset));
+    ring.end_frame(1);
+    ring.retire(1);
+    KTEST_CHECK(ring.used() == 0);
+
+    // Bigger than the ring, or nothing at all.
+    KTEST_CHECK(!ring.allocate(4 * kBlock + 1, &offset));
+    KTEST_CHECK(!ring.allocate(0, &offset));
+}
+
+// With two frames in flight and no room left, allocation fails until
+// the oldest retires, and then reuses exactly its space.
+static void test_full()
+{
+    KConstantRing ring{4 * kBlock};
+    uint32_t offset;
+    KTEST_CHECK(ring.allocate(2 * kBlock, &offset) && offset == 0);
+    ring.end_frame(0);
+    KTEST_CHECK(ring.allocate(2 * kBlock, &offset) && offset == 2 * kBlock);
+    ring.end_frame(1);
+    KTEST_CHECK(ring.used() == ring.capacity());
+    KTEST_CHECK(!ring.allocate(1, &offset));
+
+    ring.retire(0);
+    KTEST_CHECK(ring.frames_in_flight() == 1);
+    KTEST_CHECK(ring.allocate(2 * kBlock, &offset) && offset == 0);
+    KTEST_CHECK(!ring.allocate(1, &offset));
+}
+
+// The GPU two frames behind: whatever the ring hands out while a frame
+// is unretired lies outside that frame's blocks, however many times the
+// ring wraps around it.
+static void test_unretired()
+{
+    KConstantRing ring{16 * kBlock};
+    Shadow shadow{ring.capacity()};
+    const uint64_t kLatency = 2;
+    for (uint64_t frame = 0; frame < 64; ++frame)
+    {
+        if (frame >= kLatency)
+        {
+            ring.retire(frame - kLatency);
+            shadow.retire(frame - kLatency);
+        }
+        uint32_t size = kBlock * (1 + frame % 3);
+        uint32_t offset;
+        for (int i = 0; i < 3 && ring.allocate(size, &offset); ++i)
+            KTEST_CHECK(shadow.allocate(Block{offset, size}, frame));
+        ring.end_frame(frame);
+        shadow.end_frame(frame);
+    }
+}
+
+int main()
+{
+    // Rings from a few to many times the largest allocation, some with
+    // capacities that aren't multiples of the alignment.
+    const uint32_t kCapacities[]{5 * kBlock + 100, 4096, 65536 + 100};
+    uint32_t seed = 1;
+    for (uint32_t capacity : kCapacities)
+        test_random(capacity, seed++);
+    test_straddle();
+    test_full();
+    test_unretired();
+    return ktest_result();
+}
@@ -0,0 +1,279 @@
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <vector>
+#include "kgeometry.h"
+#include "kjournal.h"
+#include "ktest.h"
+
+// KJournal against a model that keeps every committed state of the
+// drawing whole: random inserts, reshapes, moves, scales and raises in
+// steps of one or a few edits, undone and redone at random, with the
+// geometry compared to the model after every step. Moves are by whole
+// texels and scales by powers of two, so that folding repeated edits
+// into one record gives exactly what applying them one by one does.
+// Then save() and load() into a fresh geometry, which has to give the
+// same drawing and the same history to undo and redo through.
+
+static const uint32_t kWidth{1920};
+static const uint32_t kHeight{1080};
+
+using Drawing = std::vector<KEllipseF>;     // Back to front.
+
+static bool same(const KEllipseF& a, const KEllipseF& b)
+{
+    return a.cx == b.cx && a.cy == b.cy && a.rx == b.rx && a.ry == b.ry;
+}
+
+static Drawing drawing_of(const KGeometry& geometry)
+{
+    Drawing drawing;
+    const KShapeStore& shapes = geometry.shapes_;
+    for (size_t i = 0; i < shapes.span(); ++i)
+        if (shapes.alive(i))
+            drawing.push_back(shapes.at(i));
+    return drawing;
+}
+
+static bool same(const KGeometry& geometry, const Drawing& drawing)
+{
+    Drawing actual = drawing_of(geometry);
+    if (actual.size() != drawing.size())
+        return false;
+    for (size_t i = 0; i < actual.size(); ++i)
+        if (!same(actual[i], drawing[i]))
+            return false;
+    return true;
+}
+
+// The handle of the n-th shape from the back.
+static KShapeHandle handle_at(const KGeometry& geometry, size_t n)
+{
+    const KShapeStore& shapes = geometry.shapes_;
+    for (size_t i = 0; i < shapes.span(); ++i)
+        if (shapes.alive(i) && n-- == 0)
+            return shapes.handle_of_slot(shapes.slot_at(i));
+    return KShapeHandle{};
+}
+
+class Model
+{
+public:
+    explicit Model(const Drawing& base) : history_{base}, current_{base} {}
+
+    const Drawing& current() const { return current_; }
+    const Drawing& committed(size_t step) const { return history_[step]; }
+    size_t cursor() const { return cursor_; }
+    size_t steps() const { return history_.size() - 1; }
+
+    // The open step's edits; the first after some undos drops the
+    // steps that could have been redone.
+    Drawing& edit()
+    {
+        if (!open_)
+            history_.resize(cursor_ + 1);
+        open_ = true;
+        return current_;
+    }
+
+    void commit()
+    {
+        if (!open_)
+            return;
+        history_.push_back(current_);
+        ++cursor_;
+        open_ = false;
+    }
+
+    bool undo()
+    {
+        commit();
+        if (cursor_ == 0)
+            return false;
+        current_ = history_[--cursor_];
+        return true;
+    }
+
+    bool redo()
+    {
+        commit();
+        if (cursor_ + 1 == history_.size())
+            return false;
+        current_ = history_[++cursor_];
+        return true;
+    }
+
+private:
+    std::vector<Drawing> history_;
+    Drawing current_;
+    size_t cursor_{};
+    bool open_{false};
+};
+
+static KEllipseF random_ellipse(std::mt19937& rng)
+{
+    return KEllipseF{static_cast<float>(rng() % kWidth), static_cast<float>(rng() % kHeight),
+                     static_cast<float>(1 + rng() % 40), static_cast<float>(1 + rng() % 40)};
+}
+
+// Runs count random steps on journal and model, checking after each.
+static bool run(KGeometry& geometry, KJournal& journal, Model& model, std::mt19937& rng, int count)
+{
+    for (int step = 0; step < count; ++step)
+    {
+        uint32_t op = rng() % 16;
+        if (op < 2)
+        {
+            KTEST_CHECK(journal.undo() == model.undo());
+        }
+        else if (op < 4)
+        {
+            KTEST_CHECK(journal.redo() == model.redo());
+        }
+        else
+        {
+            // A step of one to three edits, each on a shape picked at
+            // random, or on a new one.
+            int edits = 1 + rng() % 3;
+            for (int e = 0; e < edits; ++e)
+            {
+                size_t n = model.current().size();
+                if (n == 0 || rng() % 4 == 0)
+                {
+                    KEllipseF ellipse = random_ellipse(rng);
+                    journal.insert(ellipse);
+                    model.edit().push_back(ellipse);
+                    if (rng() % 2 == 0)
+                    {
+                        ellipse = random_ellipse(rng);
+                        journal.reshape(ellipse);
+                        model.edit().back() = ellipse;
+                    }
+                    continue;
+                }
+
+                size_t k = rng() % n;
+                geometry.select(handle_at(geometry, k));
+                uint32_t kind = rng() % 3;
+                // Repeated edits of one kind fold into one record.
+                int repeats = 1 + rng() % 3;
+                for (int r = 0; r < repeats; ++r)
+                {
+                    if (kind == 0)
+                    {
+                        float dx = static_cast<float>(static_cast<int>(rng() % 17) - 8);
+                        float dy = static_cast<float>(static_cast<int>(rng() % 17) - 8);
+                        journal.move(dx, dy);
+                        KEllipseF& m = model.edit()[k];
+                        m.cx += dx;
+                        m.cy += dy;
+                    }
+                    else if (kind == 1)
+                    {
+                        float factor = rng() % 2 ? 2.f : 0.5f;
+                        journal.scale(factor);
+                        KEllipseF& m = model.edit()[k];
+                        m.rx *= factor;
+                        m.ry *= factor;
+                    }
+                    else if (k + 1 < model.current().size())
+                    {
+                        // Raising the top shape records nothing.
+                        journal.raise();
+                        Drawing& drawing = model.edit();
+                        KEllipseF raised = drawing[k];
+                        drawing.erase(drawing.begin() + k);
+                        drawing.push_back(raised);
+                        k = drawing.size() - 1;
+                    }
+                }
+            }
+            journal.commit();
+            model.commit();
+        }
+
+        if (!KTEST_CHECK(same(geometry, model.current())))
+        {
+            fprintf(stderr, "  step %d: %zu shapes, %zu expected\n", step, drawing_of(geometry).size(),
+                    model.current().size());
+            return false;
+        }
+        KTEST_CHECK(journal.step_count() == model.steps());
+    }
+    return true;
+}
+
+// A fresh geometry with base in it, and a journal loaded over it from
+// path, has the drawing and the whole history the model has.
+static void check_load(const std::filesystem::path& path, const Drawing& base, const Model& model)
+{
+    KGeometry geometry{kWidth, kHeight};
+    for (const KEllipseF& e : base)
+        geometry.insertEllipse(e);
+    KJournal journal{geometry};
+    if (!KTEST_CHECK(journal.load(path)))
+        return;
+    if (!KTEST_CHECK(same(geometry, model.current()) && journal.step_count() == model.steps()))
+        return;
+
+    size_t cursor = model.cursor();
+    while (journal.undo())
+        if (!KTEST_CHECK(cursor > 0 && same(geometry, model.committed(--cursor))))
+            return;
+    KTEST_CHECK(cursor == 0);
+    while (journal.redo())
+        if (!KTEST_CHECK(cursor < model.steps() && same(geometry, model.committed(++cursor))))
+            return;
+    KTEST_CHECK(cursor == model.steps());
+}
+
+static void test_random(const Drawing& base, uint32_t seed)
+{
+    std::mt19937 rng{seed};
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "ktestjournal.kjournal";
+
+    KGeometry geometry{kWidth, kHeight};
+    for (const KEllipseF& e : base)
+        geometry.insertEllipse(e);
+    KJournal journal{geometry};
+    journal.rebase();
+    Model model{base};
+
+    // Long enough for many snapshots, which undoing a raise restores from.
+    for (int round = 0; round < 8; ++round)
+    {
+        if (!run(geometry, journal, model, rng, 250))
+            break;
+        if (!KTEST_CHECK(journal.save(path)))
+            break;
+        check_load(path, base, model);
+
+        // Back past a snapshot or two, so that the next round's first
+        // edit drops the steps and the snapshots after it.
+        for (size_t undos = model.cursor() / 3; undos > 0; --undos)
+        {
+            journal.undo();
+            model.undo();
+        }
+        if (!KTEST_CHECK(same(geometry, model.current())))
+            break;
+    }
+    KTEST_CHECK(journal.snapshot_count() > 1);
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+int main()
+{
+    test_random({}, 1);
+
+    // A history rebased over a loaded scene.
+    std::mt19937 rng{7};
+    Drawing base(100);
+    for (KEllipseF& e : base)
+        e = random_ellipse(rng);
+    test_random(base, 2);
+    return ktest_result();
+}
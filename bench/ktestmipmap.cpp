@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "kmipmap.h"
+#include "ktest.h"
+
+// generate_mip_chain() against generate_mip_chain_reference(), which it
+// promises to match to within one unit per channel at every level. The
+// sizes take in a single texel, odd sizes on both sides, one just past a
+// power of two, and a large one that the threaded path splits up.
+
+static const uint32_t kPadding{12};   // Bytes past each source row.
+
+// Noise over a gradient, so that neighbours differ by a lot and by a
+// little, and the alpha channel varies as much as the colours do.
+static std::vector<uint8_t> make_image(uint32_t width, uint32_t height, uint32_t stride, uint32_t seed)
+{
+    std::mt19937 rng{seed};
+    std::vector<uint8_t> texels(static_cast<size_t>(stride) * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint8_t *p = &texels[static_cast<size_t>(y) * stride + x * 4];
+            for (int c = 0; c < 4; ++c)
+                p[c] = static_cast<uint8_t>((x * 255 / width + y * 255 / height) / 2 + rng() % 64);
+        }
+    }
+    return texels;
+}
+
+static const char* filter_name(KMipFilter filter)
+{
+    return filter == KMipFilter::kBox ? "box" : "kaiser";
+}
+
+static void test_chain(uint32_t width, uint32_t height, KMipFilter filter, unsigned nthreads)
+{
+    uint32_t stride = width * 4 + kPadding;
+    std::vector<uint8_t> image = make_image(width, height, stride, width * 7919 + height);
+    KMipChain fast = generate_mip_chain(image.data(), width, height, stride, filter, nthreads);
+    KMipChain reference = generate_mip_chain_reference(image.data(), width, height, stride, filter);
+
+    if (!KTEST_CHECK(fast.levels.size() == reference.levels.size() &&
+                     fast.levels.size() == mip_level_count(width, height)))
+        return;
+
+    for (size_t i = 0; i < fast.levels.size(); ++i)
+    {
+        const KMipLevel& a = fast.levels[i];
+        const KMipLevel& b = reference.levels[i];
+        if (!KTEST_CHECK(a.width == b.width && a.height == b.height))
+            return;
+
+        int worst = 0;
+        for (uint32_t y = 0; y < a.height; ++y)
+        {
+            const uint8_t *row_a = fast.level_data(i) + static_cast<size_t>(y) * a.pitch;
+            const uint8_t *row_b = reference.level_data(i) + static_cast<size_t>(y) * b.pitch;
+            for (uint32_t x = 0; x < a.width * 4; ++x)
+                worst = std::max(worst, std::abs(row_a[x] - row_b[x]));
+        }
+        if (!KTEST_CHECK(worst <= 1))
+        {
+            fprintf(stderr, "  %ux%u %s, %u threads: level %zu (%ux%u) is off by %d\n",
+                    width, height, filter_name(filter), nthreads, i, a.width, a.height, worst);
+        }
+    }
+}
+
+int main()
+{
+    const uint32_t kSizes[][2]{{1, 1}, {3, 5}, {257, 129}, {1024, 768}};
+    const KMipFilter kFilters[]{KMipFilter::kBox, KMipFilter::kKaiser};
+    for (const uint32_t *size : kSizes)
+    {
+        for (KMipFilter filter : kFilters)
+        {
+            test_chain(size[0], size[1], filter, 1);
+            test_chain(size[0], size[1], filter, 4);
+        }
+    }
+    return ktest_result();
+}
@@ -0,0 +1,308 @@
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kprofiler.h"
+#include "ktest.h"
+
+// write_chrome_trace() without a window: zones and thread names with
+// quotes, backslashes and control characters in them are written, read
+// back with a strict JSON parser, and checked against what was
+// recorded: one metadata event naming each thread, one complete event
+// per zone, with the names exactly as given.
+
+// Just enough JSON for the trace: objects, arrays, strings with every
+// escape, numbers and literals. Anything else fails the parse.
+struct Json
+{
+    enum class Kind { Null, Bool, Number, String, Array, Object };
+
+    Kind kind{Kind::Null};
+    double number{};
+    std::string string;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    const Json* find(const char *key) const
+    {
+        for (const auto& member : members)
+            if (member.first == key)
+                return &member.second;
+        return nullptr;
+    }
+};
+
+class JsonParser
+{
+public:
+    explicit JsonParser(const std::string& text) : p_{text.c_str()}, end_{text.c_str() + text.size()} {}
+
+    bool parse(Json *value)
+    {
+        return parse_value(value) && (skip_space(), p_ == end_);
+    }
+
+private:
+    void skip_space()
+    {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t'))
+            ++p_;
+    }
+
+    bool literal(const char *word)
+    {
+        size_t n = strlen(word);
+        if (static_cast<size_t>(end_ - p_) < n || strncmp(p_, word, n) != 0)
+            return false;
+        p_ += n;
+        return true;
+    }
+
+    bool parse_value(Json *value)
+    {
+        skip_space();
+        if (p_ == end_)
+            return false;
+        switch (*p_)
+        {
+        case '{': return parse_object(value);
+        case '[': return parse_array(value);
+        case '"': value->kind = Json::Kind::String; return parse_string(&value->string);
+        case 't': value->kind = Json::Kind::Bool; return literal("true");
+        case 'f': value->kind = Json::Kind::Bool; return literal("false");
+        case 'n': value->kind = Json::Kind::Null; return literal("null");
+        default: return parse_number(value);
+        }
+    }
+
+    bool parse_object(Json *value)
+    {
+        value->kind = Json::Kind::Object;
+        ++p_;
+        skip_space();
+        if (p_ < end_ && *p_ == '}')
+            return ++p_, true;
+        for (;;)
+        {
+            std::pair<std::string, Json> member;
+            skip_space();
+            if (p_ == end_ || *p_ != '"' || !parse_string(&member.first))
+                return false;
+            skip_space();
+            if (p_ == end_ || *p_++ != ':' || !parse_value(&member.second))
+                return false;
+            value->members.push_back(std::move(member));
+            skip_space();
+            if (p_ == end_)
+                return false;
+            char c = *p_++;
+            if (c == '}')
+                return true;
+            if (c != ',')
+                return false;
+        }
+    }
+
+    bool parse_array(Json *value)
+    {
+        value->kind = Json::Kind::Array;
+        ++p_;
+        skip_space();
+        if (p_ < end_ && *p_ == ']')
+            return ++p_, true;
+        for (;;)
+        {
+            value->items.emplace_back();
+            if (!parse_value(&value->items.back()))
+                return false;
+            skip_space();
+            if (p_ == end_)
+                return false;
+            char c = *p_++;
+            if (c == ']')
+                return true;
+            if (c != ',')
+                return false;
+        }
+    }
+
+    // Code points above 0x7f aren't needed here and are refused.
+    bool parse_string(std::string *out)
+    {
+        ++p_;
+        while (p_ < end_)
+        {
+            unsigned char c = static_cast<unsigned char>(*p_++);
+            if (c == '"')
+                return true;
+            if (c < 0x20)
+                return false;
+            if (c != '\\')
+            {
+                out->push_back(static_cast<char>(c));
+                continue;
+            }
+            if (p_ == end_)
+                return false;
+            switch (*p_++)
+            {
+            case '"': out->push_back('"'); break;
+            case '\\': out->push_back('\\'); break;
+            case '/': out->push_back('/'); break;
+            case 'b': out->push_back('\b'); break;
+            case 'f': out->push_back('\f'); break;
+            case 'n': out->push_back('\n'); break;
+            case 'r': out->push_back('\r'); break;
+            case 't': out->push_back('\t'); break;
+            case 'u':
+            {
+                if (end_ - p_ < 4)
+                    return false;
+                char hex[5]{p_[0], p_[1], p_[2], p_[3], 0};
+                char *stop;
+                unsigned long code = strtoul(hex, &stop, 16);
+                if (stop != hex + 4 || code > 0x7f)
+                    return false;
+                out->push_back(static_cast<char>(code));
+                p_ += 4;
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    bool parse_number(Json *value)
+    {
+        value->kind = Json::Kind::Number;
+        const char *start = p_;
+        if (p_ < end_ && *p_ == '-')
+            ++p_;
+        if (p_ == end_ || *p_ < '0' || *p_ > '9')
+            return false;
+        while (p_ < end_ && ((*p_ >= '0' && *p_ <= '9') || *p_ == '.' || *p_ == 'e' || *p_ == 'E' ||
+                             *p_ == '+' || *p_ == '-'))
+            ++p_;
+        std::string digits(start, p_);
+        char *stop;
+        value->number = strtod(digits.c_str(), &stop);
+        return stop == digits.c_str() + digits.size();
+    }
+
+    const char *p_;
+    const char *end_;
+};
+
+static std::string read_file(const std::filesystem::path& path)
+{
+    std::string text;
+    FILE *file = fopen(path.string().c_str(), "rb");
+    if (!file)
+        return text;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, n);
+    fclose(file);
+    return text;
+}
+
+static const char *kMainThread{"Main \"render\" thread\\"};
+static const char *kWorkerThread{"Worker\t1\n"};
+static const char *kZones[]{"Plain", "Quoted \"zone\"", "Back\\slash", "Line\nbreak",
+                            "Control \x01\x1f chars", "Trailing\\"};
+static const int kZonesPerName{3};
+
+static bool is_string(const Json *value, const char *expected)
+{
+    return value && value->kind == Json::Kind::String && value->string == expected;
+}
+
+static bool is_number(const Json *value)
+{
+    return value && value->kind == Json::Kind::Number;
+}
+
+static void test_export()
+{
+    KProfiler::name_thread(kMainThread);
+    int64_t t = monotonic_nanoseconds();
+    for (int i = 0; i < kZonesPerName; ++i)
+        for (const char *name : kZones)
+            KProfiler::record(name, t + i * 1000, t + i * 1000 + 500);
+    std::thread worker{[] {
+        KProfiler::name_thread(kWorkerThread);
+        KProfileZone zone{"Worker \"job\""};
+    }};
+    worker.join();
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "ktestprofiler.json";
+    if (!KTEST_CHECK(KProfiler::write_chrome_trace(path.string().c_str())))
+        return;
+    std::string text = read_file(path);
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+
+    Json trace;
+    if (!KTEST_CHECK(JsonParser{text}.parse(&trace)))
+    {
+        fprintf(stderr, "  not JSON:\n%s\n", text.c_str());
+        return;
+    }
+    const Json *events = trace.find("traceEvents");
+    if (!KTEST_CHECK(trace.kind == Json::Kind::Object && events && events->kind == Json::Kind::Array))
+        return;
+    KTEST_CHECK(is_string(trace.find("displayTimeUnit"), "ms"));
+
+    // Every event has the common fields; thread names come from "M"
+    // events, zones from "X" events with times from the first zone.
+    int thread_names = 0;
+    int zones[sizeof(kZones) / sizeof(kZones[0])]{};
+    int worker_zones = 0;
+    for (const Json& event : events->items)
+    {
+        const Json *ph = event.find("ph");
+        const Json *name = event.find("name");
+        if (!KTEST_CHECK(event.kind == Json::Kind::Object && ph && ph->kind == Json::Kind::String &&
+                         name && name->kind == Json::Kind::String &&
+                         is_number(event.find("pid")) && is_number(event.find("tid"))))
+            return;
+        if (ph->string == "M")
+        {
+            const Json *args = event.find("args");
+            KTEST_CHECK(name->string == "thread_name" && args && args->find("name"));
+            thread_names += is_string(args->find("name"), kMainThread) || is_string(args->find("name"), kWorkerThread);
+            continue;
+        }
+        const Json *ts = event.find("ts");
+        const Json *dur = event.find("dur");
+        if (!KTEST_CHECK(ph->string == "X" && is_number(ts) && is_number(dur) && ts->number >= 0.0 && dur->number >= 0.0))
+            return;
+        for (size_t i = 0; i < sizeof(kZones) / sizeof(kZones[0]); ++i)
+            zones[i] += name->string == kZones[i];
+        worker_zones += name->string == "Worker \"job\"";
+    }
+
+    KTEST_CHECK(thread_names == 2);
+    for (int count : zones)
+        KTEST_CHECK(count == kZonesPerName);
+    KTEST_CHECK(worker_zones == 1);
+}
+
+int main()
+{
+    test_export();
+    return ktest_result();
+}
+
+#pragma warning(pop)
@@ -0,0 +1,285 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "kbitmap.h"
+#include "kpath.h"
+#include "krasterizer.h"
+#include "ktest.h"
+
+// KRasterizer and KPath on shapes whose coverage is known: each is
+// drawn opaque white into a transparent bitmap, so that every pixel's
+// alpha is its coverage and the alphas add up to the area. Then the
+// fill rule, clipping at the bitmap's borders, the {5, 3} dash
+// pattern, and bands drawn by one thread against several.
+
+static const int kWidth{160};
+static const int kHeight{120};
+static const uint32_t kWhite{0xffffffff};
+
+// Each pixel's coverage is rounded to 1/255, so an area can be off by
+// up to half of that for every pixel an edge passes through.
+static const float kPixelError{0.5f / 255.f};
+
+static std::vector<uint8_t> render(const KPath& path, unsigned nthreads = 1)
+{
+    KBitmap bitmap{kWidth, kHeight};
+    bitmap.clear(0);
+    KRasterizer rasterizer{kWidth, kHeight};
+    rasterizer.fill(path, kWhite);
+    rasterizer.render(bitmap, nthreads);
+    std::vector<uint8_t> alpha(static_cast<size_t>(kWidth) * kHeight);
+    for (size_t i = 0; i < alpha.size(); ++i)
+        alpha[i] = static_cast<uint8_t>(bitmap.data()[i] >> 24);
+    return alpha;
+}
+
+static float area(const std::vector<uint8_t>& alpha)
+{
+    double sum = 0.0;
+    for (uint8_t a : alpha)
+        sum += a;
+    return static_cast<float>(sum / 255.0);
+}
+
+static uint8_t at(const std::vector<uint8_t>& alpha, int x, int y)
+{
+    return alpha[static_cast<size_t>(y) * kWidth + x];
+}
+
+// Whether the pixels inside [x0, x1) x [y0, y1) are all inside, and
+// all others outside.
+static bool is_box(const std::vector<uint8_t>& alpha, int x0, int y0, int x1, int y1, uint8_t inside)
+{
+    for (int y = 0; y < kHeight; ++y)
+    {
+        for (int x = 0; x < kWidth; ++x)
+        {
+            bool in = x >= x0 && x < x1 && y >= y0 && y < y1;
+            if (at(alpha, x, y) != (in ? inside : 0))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool near(float actual, float expected, float tolerance)
+{
+    if (std::fabs(actual - expected) <= tolerance)
+        return true;
+    fprintf(stderr, "  area %.3f, expected %.3f\n", actual, expected);
+    return false;
+}
+
+// The area of a closed polygon, by the shoelace formula.
+static float polygon_area(const KPath& path)
+{
+    const std::vector<KPointF>& p = path.points();
+    double sum = 0.0;
+    for (const KPath::Contour& contour : path.contours())
+    {
+        for (int i = 0; i < contour.count; ++i)
+        {
+            KPointF a = p[contour.first + i];
+            KPointF b = p[contour.first + (i + 1) % contour.count];
+            sum += static_cast<double>(a.x) * b.y - static_cast<double>(b.x) * a.y;
+        }
+    }
+    return static_cast<float>(std::fabs(sum) / 2.0);
+}
+
+static void test_rect()
+{
+    // On pixel boundaries every pixel is wholly in or out.
+    KPath path;
+    path.add_rect(10.f, 20.f, 30.f, 15.f);
+    KTEST_CHECK(is_box(render(path), 10, 20, 40, 35, 255));
+
+    // Off them, the area still comes out.
+    path.clear();
+    path.add_rect(10.25f, 20.5f, 30.5f, 15.75f);
+    std::vector<uint8_t> alpha = render(path);
+    KTEST_CHECK(near(area(alpha), 30.5f * 15.75f, kPixelError * 2 * (32 + 17)));
+    KTEST_CHECK(at(alpha, 20, 30) == 255 && at(alpha, 10, 30) == 191 && at(alpha, 20, 20) == 128);
+}
+
+static void test_ellipse()
+{
+    const float kRx{50.f};
+    const float kRy{30.f};
+    KPath path;
+    path.add_ellipse(80.3f, 60.6f, kRx, kRy);
+    std::vector<uint8_t> alpha = render(path);
+    // The flattened polygon to within the rounding of the pixels along
+    // its edge, and the ellipse to within the 0.1 px flattening
+    // tolerance all round.
+    float perimeter = 2.f * 3.14159265f * std::sqrt((kRx * kRx + kRy * kRy) / 2.f);
+    KTEST_CHECK(near(area(alpha), polygon_area(path), kPixelError * 2.f * perimeter));
+    KTEST_CHECK(near(area(alpha), 3.14159265f * kRx * kRy, 0.1f * perimeter));
+    KTEST_CHECK(at(alpha, 80, 60) == 255 && at(alpha, 10, 10) == 0);
+}
+
+static void add_rect_reversed(KPath& path, float x, float y, float width, float height)
+{
+    path.move_to(x, y);
+    path.line_to(x, y + height);
+    path.line_to(x + width, y + height);
+    path.line_to(x + width, y);
+    path.close();
+}
+
+// Non-zero: a contour inside another of the same winding adds nothing,
+// one wound the other way cuts a hole, and overlapping shapes of the
+// same winding saturate rather than add up.
+static void test_winding()
+{
+    KPath path;
+    path.add_rect(20.f, 20.f, 60.f, 40.f);
+    path.add_rect(40.f, 30.f, 20.f, 20.f);
+    KTEST_CHECK(is_box(render(path), 20, 20, 80, 60, 255));
+
+    path.clear();
+    path.add_rect(20.f, 20.f, 60.f, 40.f);
+    add_rect_reversed(path, 40.f, 30.f, 20.f, 20.f);
+    std::vector<uint8_t> alpha = render(path);
+    KTEST_CHECK(area(alpha) == 60.f * 40.f - 20.f * 20.f);
+    KTEST_CHECK(at(alpha, 50, 40) == 0 && at(alpha, 30, 40) == 255 && at(alpha, 70, 40) == 255);
+
+    path.clear();
+    path.add_rect(20.f, 20.f, 40.f, 40.f);
+    path.add_rect(40.f, 30.f, 40.f, 40.f);
+    alpha = render(path);
+    KTEST_CHECK(area(alpha) == 40.f * 40.f * 2.f - 20.f * 30.f);
+    KTEST_CHECK(at(alpha, 50, 40) == 255);
+
+    // Two contours wound in opposite directions, overlapping: the
+    // overlap cancels to nothing.
+    path.clear();
+    path.add_rect(20.f, 20.f, 40.f, 40.f);
+    add_rect_reversed(path, 40.f, 30.f, 40.f, 40.f);
+    alpha = render(path);
+    KTEST_CHECK(at(alpha, 50, 40) == 0 && at(alpha, 30, 40) == 255 && at(alpha, 70, 65) == 255);
+}
+
+// What lies past the left border still counts towards the winding of
+// what lies right of it; what lies past the right border counts for
+// nothing. Rows above and below the bitmap aren't drawn.
+static void test_clipping()
+{
+    KPath path;
+    path.add_rect(-20.f, 10.f, 30.f, 20.f);
+    KTEST_CHECK(is_box(render(path), 0, 10, 10, 30, 255));
+
+    path.clear();
+    path.add_rect(kWidth - 10.f, 10.f, 40.f, 20.f);
+    KTEST_CHECK(is_box(render(path), kWidth - 10, 10, kWidth, 30, 255));
+
+    path.clear();
+    path.add_rect(-100.f, -100.f, kWidth + 200.f, kHeight + 200.f);
+    KTEST_CHECK(is_box(render(path), 0, 0, kWidth, kHeight, 255));
+
+    path.clear();
+    path.add_rect(-50.f, 10.f, 40.f, 20.f);
+    path.add_rect(kWidth + 10.f, 10.f, 40.f, 20.f);
+    KTEST_CHECK(area(render(path)) == 0.f);
+
+    // Triangles whose slanted side crosses the border: of each, the
+    // 20 px wide part on the bitmap, 2000/3 px^2.
+    const KPointF kLeft[]{{-40.f, 10.f}, {20.f, 10.f}, {20.f, 50.f}};
+    path.clear();
+    path.add_polygon(kLeft, 3);
+    std::vector<uint8_t> alpha = render(path);
+    KTEST_CHECK(near(area(alpha), 2000.f / 3.f, kPixelError * 2 * 60));
+
+    const KPointF kRight[]{{kWidth + 40.f, 60.f}, {kWidth - 20.f, 60.f}, {kWidth - 20.f, 100.f}};
+    path.clear();
+    path.add_polygon(kRight, 3);
+    alpha = render(path);
+    KTEST_CHECK(near(area(alpha), 2000.f / 3.f, kPixelError * 2 * 60));
+}
+
+// {5, 3} in stroke widths, along a line on pixel boundaries: dashes of
+// 10 px every 16 px, 2 px thick, with flat ends.
+static void test_dashes()
+{
+    KPath line;
+    line.move_to(8.f, 40.f);
+    line.line_to(8.f + 16.f * 8, 40.f);
+    KPath outline = line.stroke(KStrokeStyle{2.f, {5.f, 3.f}});
+    KTEST_CHECK(outline.contours().size() == 8);
+    std::vector<uint8_t> alpha = render(outline);
+    KTEST_CHECK(area(alpha) == 8 * 10.f * 2.f);
+
+    bool pattern = true;
+    for (int x = 0; x < kWidth; ++x)
+    {
+        bool on = x >= 8 && x < 8 + 16 * 8 && (x - 8) % 16 < 10;
+        for (int y = 0; y < kHeight; ++y)
+            pattern &= at(alpha, x, y) == ((on && (y == 39 || y == 40)) ? 255 : 0);
+    }
+    KTEST_CHECK(pattern);
+
+    // An offset of 4 widths starts 8 px into the pattern: the line
+    // opens with the last 2 px of a dash and ends 8 px into one.
+    outline = line.stroke(KStrokeStyle{2.f, {5.f, 3.f}, 4.f});
+    KTEST_CHECK(outline.contours().size() == 9);
+    alpha = render(outline);
+    KTEST_CHECK(area(alpha) == (2.f + 7 * 10.f + 8.f) * 2.f);
+    pattern = true;
+    for (int x = 0; x < kWidth; ++x)
+    {
+        bool on = x >= 8 && x < 8 + 16 * 8 && (x - 8 + 8) % 16 < 10;
+        pattern &= at(alpha, x, 40) == (on ? 255 : 0);
+    }
+    KTEST_CHECK(pattern);
+}
+
+// Translucent shapes of every kind, overlapping, drawn by one thread and
+// by several: the bands are drawn independently, so the result is the
+// same to the bit.
+static void test_threads()
+{
+    std::mt19937 rng{1};
+    KRasterizer rasterizer{kWidth, kHeight};
+    for (int i = 0; i < 200; ++i)
+    {
+        float x = static_cast<float>(rng() % (kWidth + 40)) - 20.f;
+        float y = static_cast<float>(rng() % (kHeight + 40)) - 20.f;
+        float w = 1.f + static_cast<float>(rng() % 4000) / 100.f;
+        float h = 1.f + static_cast<float>(rng() % 4000) / 100.f;
+        uint32_t a = rng() % 256;
+        uint32_t color = (a << 24) | ((rng() % (a + 1)) << 16) | ((rng() % (a + 1)) << 8) | (rng() % (a + 1));
+        KPath path;
+        if (rng() % 2)
+            path.add_ellipse(x, y, w, h);
+        else
+            path.add_rect(x, y, w, h);
+        if (rng() % 3)
+            rasterizer.fill(path, color);
+        else
+            rasterizer.stroke(path, KStrokeStyle{1.f + static_cast<float>(rng() % 4), {5.f, 3.f}}, color);
+    }
+
+    KBitmap one{kWidth, kHeight};
+    KBitmap many{kWidth, kHeight};
+    rasterizer.render(one, 1);
+    for (unsigned nthreads : {2u, 3u, 8u})
+    {
+        many.clear(0xffffffff);
+        rasterizer.render(many, nthreads);
+        KTEST_CHECK(memcmp(one.data(), many.data(), static_cast<size_t>(kWidth) * kHeight * 4) == 0);
+    }
+}
+
+int main()
+{
+    test_rect();
+    test_ellipse();
+    test_winding();
+    test_clipping();
+    test_dashes();
+    test_threads();
+    return ktest_result();
+}
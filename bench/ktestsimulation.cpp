@@ -0,0 +1,118 @@
+#include <cmath>
+#include <cstdint>
+#include "kclock.h"
+#include "ksimulation.h"
+#include "ktest.h"
+
+// KSimulation on a virtual clock, which only moves when the test says:
+// the number of steps taken, the limit on catching up after a stall,
+// and keys taking effect in the steps they arrived in.
+
+static const double kStep{KSimulation::kStep};
+
+// The state at the last step taken.
+static KSimState latest(KSimulation& simulation, const KClock& clock)
+{
+    return simulation.sample(clock.seconds() + 1.0);
+}
+
+static void test_step_count()
+{
+    KVirtualTime time;
+    KClock clock{time.source()};
+    KSimulation simulation{[&] { return clock.seconds(); }};
+
+    // Frames at 60 Hz take two steps each; at 50 Hz the remainders add
+    // up to a step now and then.
+    for (int frame = 0; frame < 60; ++frame)
+    {
+        time.advance_seconds(1.0 / 60.0);
+        KTEST_CHECK(simulation.advance(clock.seconds()) == 2);
+    }
+    KTEST_CHECK(simulation.step_count() == 120);
+
+    int steps = 0;
+    for (int frame = 0; frame < 50; ++frame)
+    {
+        time.advance_seconds(1.0 / 50.0);
+        steps += simulation.advance(clock.seconds());
+    }
+    KTEST_CHECK(steps == 120 || steps == 119);
+    KTEST_CHECK(std::fabs(latest(simulation, clock).t - static_cast<double>(simulation.step_count()) * kStep) < 1e-9);
+}
+
+static void test_catch_up()
+{
+    KVirtualTime time;
+    KClock clock{time.source()};
+    KSimulation simulation{[&] { return clock.seconds(); }};
+    const int max_steps = static_cast<int>(KSimulation::kMaxCatchUp / kStep);
+
+    // A stall of a second catches up a quarter of it and skips the rest.
+    time.advance_seconds(1.0);
+    KTEST_CHECK(simulation.advance(clock.seconds()) == max_steps);
+    KTEST_CHECK(max_steps == 30);
+
+    // Afterwards the clock runs on from where the simulation is, and
+    // sampling now lands between the last two steps, not a stall behind.
+    time.advance_seconds(1.0 / 60.0);
+    KTEST_CHECK(simulation.advance(clock.seconds()) == 2);
+    KSimState now = simulation.sample(clock.seconds());
+    KSimState last = latest(simulation, clock);
+    KTEST_CHECK(now.t >= last.t - kStep - 1e-9 && now.t <= last.t);
+}
+
+// The camera rises translation_speed * kStep for every step with E down.
+static double steps_risen(const KSimState& from, const KSimState& to)
+{
+    return (to.camera_pos.y - from.camera_pos.y) / (KCamera{}.translation_speed * kStep);
+}
+
+static void test_input_order()
+{
+    KVirtualTime time;
+    KClock clock{time.source()};
+    KSimulation simulation{[&] { return clock.seconds(); }};
+    KSimState start = latest(simulation, clock);
+
+    // Held from the middle of step 12 to the middle of step 24, and all
+    // of it handed over in one batch: the key is down for 12 steps, not
+    // pressed and released at the batch's start.
+    time.advance_seconds(12.5 * kStep);
+    simulation.keypress(KKey::kE, true);
+    time.advance_seconds(12.0 * kStep);
+    simulation.keypress(KKey::kE, false);
+    time.advance_seconds(3.75 * kStep);
+    KTEST_CHECK(simulation.advance(clock.seconds()) == 28);
+    KSimState held = latest(simulation, clock);
+    KTEST_CHECK(std::fabs(steps_risen(start, held) - 12.0) < 1e-3);
+
+    // Pressed and released within one step: it moves for that step.
+    time.advance_seconds(0.25 * kStep);
+    simulation.keypress(KKey::kE, true);
+    time.advance_seconds(0.25 * kStep);
+    simulation.keypress(KKey::kE, false);
+    time.advance_seconds(4.5 * kStep);
+    KTEST_CHECK(simulation.advance(clock.seconds()) == 5);
+    KSimState tapped = latest(simulation, clock);
+    KTEST_CHECK(std::fabs(steps_risen(held, tapped) - 1.0) < 1e-3);
+
+    // Released and pressed again within one step: it stays down.
+    time.advance_seconds(0.5 * kStep);
+    simulation.keypress(KKey::kE, true);
+    time.advance_seconds(1.0 * kStep);
+    simulation.keypress(KKey::kE, false);
+    simulation.keypress(KKey::kE, true);
+    time.advance_seconds(2.5 * kStep);
+    KTEST_CHECK(simulation.advance(clock.seconds()) == 4);
+    KSimState pressed = latest(simulation, clock);
+    KTEST_CHECK(std::fabs(steps_risen(tapped, pressed) - 4.0) < 1e-3);
+}
+
+int main()
+{
+    test_step_count();
+    test_catch_up();
+    test_input_order();
+    return ktest_result();
+}
@@ -0,0 +1,199 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include "kbitmap.h"
+#include "ktiledbitmap.h"
+#include "ktest.h"
+
+// KTiledBitmap against a linear KBitmap of the same size, given the same
+// random fills, blits, blends, pixel writes and clears: every pixel has
+// to match exactly, whether its tile is solid or detailed, and so does
+// every region read() copies out. Rectangles run off all four sides,
+// and canvases that aren't a whole number of tiles have partial tiles
+// on the right and at the bottom.
+
+static const int kTile{KTiledBitmap::kTileSize};
+
+// Premultiplied: no channel above alpha. Alpha is often 0 or 255, the
+// cases blending treats specially.
+static uint32_t random_color(std::mt19937& rng)
+{
+    uint32_t choice = rng() % 4;
+    uint32_t a = choice == 0 ? 0 : choice == 1 ? 255 : rng() % 256;
+    uint32_t r = rng() % (a + 1);
+    uint32_t g = rng() % (a + 1);
+    uint32_t b = rng() % (a + 1);
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Sources are smaller than the canvas, some with a single colour so
+// that whole tiles of the canvas can stay or become uniform.
+static void fill_source(KBitmap& src, std::mt19937& rng)
+{
+    if (rng() % 4 == 0)
+    {
+        src.clear(random_color(rng));
+        return;
+    }
+    for (int y = 0; y < src.height(); ++y)
+        for (int x = 0; x < src.width(); ++x)
+            src.put_pixel(x, y, random_color(rng));
+}
+
+// A rectangle anywhere from fully off the canvas to covering it, most
+// of them partly on it.
+static void random_rect(std::mt19937& rng, int width, int height, int *x, int *y, int *w, int *h)
+{
+    *x = static_cast<int>(rng() % (width + 2 * kTile)) - kTile;
+    *y = static_cast<int>(rng() % (height + 2 * kTile)) - kTile;
+    *w = static_cast<int>(rng() % (rng() % 8 == 0 ? width + 2 * kTile : 2 * kTile + 1));
+    *h = static_cast<int>(rng() % (rng() % 8 == 0 ? height + 2 * kTile : 2 * kTile + 1));
+}
+
+static bool same_pixels(const KTiledBitmap& canvas, const KBitmap& reference)
+{
+    for (int y = 0; y < reference.height(); ++y)
+        for (int x = 0; x < reference.width(); ++x)
+            if (canvas.get_pixel(x, y) != reference.data()[y * reference.width() + x])
+                return false;
+    return true;
+}
+
+// read() of a random region into a bitmap holding a sentinel: what lies
+// on the canvas comes from the reference, the rest keeps the sentinel.
+static bool same_read(const KTiledBitmap& canvas, const KBitmap& reference, std::mt19937& rng)
+{
+    const uint32_t kSentinel{0x12345678};
+    KBitmap dst{2 * kTile, 2 * kTile};
+    dst.clear(kSentinel);
+    int x, y, w, h;
+    random_rect(rng, reference.width(), reference.height(), &x, &y, &w, &h);
+    int dst_x = static_cast<int>(rng() % kTile);
+    int dst_y = static_cast<int>(rng() % kTile);
+    canvas.read(x, y, w, h, dst, dst_x, dst_y);
+
+    for (int j = 0; j < dst.height(); ++j)
+    {
+        for (int i = 0; i < dst.width(); ++i)
+        {
+            int cx = x + i - dst_x;
+            int cy = y + j - dst_y;
+            bool inside = i >= dst_x && i < dst_x + w && j >= dst_y && j < dst_y + h &&
+                          cx >= 0 && cx < reference.width() && cy >= 0 && cy < reference.height();
+            uint32_t expected = inside ? reference.data()[cy * reference.width() + cx] : kSentinel;
+            if (dst.data()[j * dst.width() + i] != expected)
+                return false;
+        }
+    }
+    return true;
+}
+
+static void test_random(int width, int height, uint32_t seed)
+{
+    std::mt19937 rng{seed};
+    KTiledBitmap canvas{width, height, 0xff336699};
+    KBitmap reference{width, height};
+    reference.clear(0xff336699);
+    KBitmap src{kTile + 37, kTile + 11};
+    const size_t kTiles = static_cast<size_t>(canvas.tiles_x()) * canvas.tiles_y();
+
+    for (int step = 0; step < 2000; ++step)
+    {
+        int x, y, w, h;
+        random_rect(rng, width, height, &x, &y, &w, &h);
+        uint32_t op = rng() % 16;
+        if (op < 4)
+        {
+            uint32_t color = random_color(rng);
+            canvas.fill_rect(x, y, w, h, color);
+            reference.fill_rect(x, y, w, h, color);
+        }
+        else if (op < 12)
+        {
+            fill_source(src, rng);
+            int src_x = static_cast<int>(rng() % (src.width() + 16)) - 8;
+            int src_y = static_cast<int>(rng() % (src.height() + 16)) - 8;
+            if (op < 8)
+            {
+                canvas.blit(src, src_x, src_y, w, h, x, y);
+                reference.blit(src, src_x, src_y, w, h, x, y);
+            }
+            else
+            {
+                canvas.blend(src, src_x, src_y, w, h, x, y);
+                reference.blend(src, src_x, src_y, w, h, x, y);
+            }
+        }
+        else if (op < 15)
+        {
+            for (int i = 0; i < 64; ++i)
+            {
+                int px = static_cast<int>(rng() % width);
+                int py = static_cast<int>(rng() % height);
+                // Often the colour the pixel has already, which must not
+                // turn a solid tile into a detailed one.
+                uint32_t color = rng() % 2 ? random_color(rng) : canvas.get_pixel(px, py);
+                canvas.put_pixel(px, py, color);
+                reference.put_pixel(px, py, color);
+            }
+        }
+        else
+        {
+            uint32_t color = random_color(rng);
+            canvas.clear(color);
+            reference.clear(color);
+            KTEST_CHECK(canvas.allocated_tiles() == 0);
+        }
+
+        if (!KTEST_CHECK(same_pixels(canvas, reference)))
+        {
+            fprintf(stderr, "  %dx%d: differs after step %d (op %u)\n", width, height, step, op);
+            return;
+        }
+        KTEST_CHECK(same_read(canvas, reference, rng));
+        KTEST_CHECK(canvas.allocated_tiles() <= kTiles);
+    }
+
+    // A fill over the whole canvas leaves no texels behind.
+    canvas.fill_rect(-1, -1, width + 2, height + 2, 0xff000000);
+    KTEST_CHECK(canvas.allocated_tiles() == 0);
+}
+
+// Tiles stay solid until a write makes them detailed, and for_each_tile
+// reports each as it is stored.
+static void test_solid_tiles()
+{
+    KTiledBitmap canvas{3 * kTile, 2 * kTile};
+    KTEST_CHECK(canvas.allocated_tiles() == 0);
+    canvas.put_pixel(5, 5, 0xffffffff);
+    canvas.fill_rect(kTile, 0, kTile, kTile, 0xff00ff00);
+    KTEST_CHECK(canvas.allocated_tiles() == 0);
+    canvas.fill_rect(kTile, 0, kTile - 1, kTile, 0xffff0000);
+    canvas.put_pixel(2 * kTile + 1, kTile + 1, 0xff0000ff);
+    KTEST_CHECK(canvas.allocated_tiles() == 2);
+
+    int solid = 0;
+    int detailed = 0;
+    canvas.for_each_tile([&](int tx, int ty, const uint32_t *texels, uint32_t color) {
+        if (texels)
+        {
+            ++detailed;
+            KTEST_CHECK(texels[0] == canvas.get_pixel(tx * kTile, ty * kTile));
+        }
+        else
+        {
+            ++solid;
+            KTEST_CHECK(color == canvas.get_pixel(tx * kTile, ty * kTile));
+        }
+    });
+    KTEST_CHECK(solid == 4 && detailed == 2);
+}
+
+int main()
+{
+    test_random(3 * kTile, 2 * kTile, 1);
+    test_random(5 * kTile + 13, 3 * kTile + 7, 2);
+    test_random(kTile - 5, kTile + 1, 3);
+    test_solid_tiles();
+    return ktest_result();
+}
@@ -3,12 +3,13 @@
 set COMMON_COMPILER_FLAGS=/nologo /EHsc /GR- /fp:fast /Oi /W4 /Fm /std:c++17
 set DEBUG_FLAGS=/DDEBUG_BUILD /Od /MTd /Zi
 set PREPROCESSOR_DEFS=/DUNICODE /DNOMINMAX
+set INCLUDE_DIRS=/I..\kcore
 set RELEASE_FLAGS=/O2
-set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %DEBUG_FLAGS% %PREPROCESSOR_DEFS%
+set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %DEBUG_FLAGS% %PREPROCESSOR_DEFS% %INCLUDE_DIRS%
 REM set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %RELEASE_FLAGS%
 set LINKER_FLAGS=/INCREMENTAL:NO /opt:ref
-set SYSTEM_LIBS=kernel32.lib user32.lib gdi32.lib winmm.lib ole32.lib d2d1.lib dxgi.lib d3d11.lib dwrite.lib
-set LOCAL_LIBS=kwindow.lib
-set SRC=kdraw.cpp kd2dsurface.cpp kdrawingengine.cpp kgeometry.cpp ktextoverlay.cpp
+set SYSTEM_LIBS=kernel32.lib user32.lib gdi32.lib winmm.lib ole32.lib d2d1.lib dxgi.lib d3d11.lib
+set LOCAL_LIBS=kwindow.lib ..\kcore\kcore.lib
+set SRC=kdraw.cpp kd2dsurface.cpp kdrawingengine.cpp kellipsebatch.cpp kglyphatlas.cpp kjournal.cpp kpixelfont.cpp ktextbatch.cpp ktextoverlay.cpp
 cl %COMPILER_FLAGS% %SRC% /link %LINKER_FLAGS% %SYSTEM_LIBS% %LOCAL_LIBS%
 echo Done
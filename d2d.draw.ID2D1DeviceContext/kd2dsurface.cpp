@@ -74,13 +74,10 @@ void KD2DSurface::create_device_independent_resources()
 		ARRAYSIZE(dashes),
 		&d2d1_stroke_style_);
     assert(SUCCEEDED(hr));
-
-    create_text_resources();
 }
 
 void KD2DSurface::discard_device_independent_resources()
 {
-    discard_text_resources();
     SafeRelease(&d2d1_stroke_style_);
     SafeRelease(&d2d1_factory_);
 }
@@ -165,34 +162,14 @@ void KD2DSurface::create_device_dependent_resources()
 
 void KD2DSurface::discard_device_dependent_resources()
 {
+    SafeRelease(&d2d1_text_mask_);
+    discard_meshes();
     SafeRelease(&d2d1_bitmap_);
     SafeRelease(&d2d1_device_context_);
     SafeRelease(&dxgi_swap_chain_);
     SafeRelease(&d3d11_device_);
 }
 
-void KD2DSurface::create_text_resources()
-{
-    DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
-                        __uuidof(IDWriteFactory),
-                        reinterpret_cast<IUnknown**>(&dwrite_factory_));
-    dwrite_factory_->CreateTextFormat(L"Verdana",
-                                      NULL,
-                                      DWRITE_FONT_WEIGHT_NORMAL,
-                                      DWRITE_FONT_STYLE_NORMAL,
-                                      DWRITE_FONT_STRETCH_NORMAL,
-                                      10.0f, L"en-us",
-                                      &dwrite_text_format_);
-    dwrite_text_format_->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
-    dwrite_text_format_->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_FAR);
-}
-
-void KD2DSurface::discard_text_resources()
-{
-    SafeRelease(&dwrite_text_format_);
-    SafeRelease(&dwrite_factory_);
-}
-
 void KD2DSurface::create_render_target_resources()
 {
     HRESULT hr = S_OK;
@@ -275,7 +252,7 @@ void KD2DSurface::resize()
     hr = dxgi_swap_chain_->GetDesc1(&scd);
     assert(SUCCEEDED(hr));
     size_ = D2D1::SizeU(scd.Width, scd.Height);
-    geometry_.resize(size_);
+    geometry_.resize(size_.width, size_.height);
     textOverlay.Resize(size_);
 }
 
@@ -291,20 +268,30 @@ void KD2DSurface::draw()
     ///////////////////////////////////////////////////////////////////////////////////////////
     // Draw geometry.
     ///////////////////////////////////////////////////////////////////////////////////////////
-	for (auto ellipseIter = geometry_.ellipse_list_.begin();
-         ellipseIter != geometry_.ellipse_list_.end();
-         ++ellipseIter)
-	{
-        d2d1_brush_->SetColor(D2D1::ColorF(D2D1::ColorF::LightBlue, 0.5f));
-        d2d1_device_context_->FillEllipse(*ellipseIter, d2d1_brush_);
-        d2d1_brush_->SetColor(D2D1::ColorF{D2D1::ColorF::Black, 0.5f});
-        d2d1_device_context_->DrawEllipse(*ellipseIter, d2d1_brush_, 1.f);
-        d2d1_brush_->SetColor(D2D1::ColorF(D2D1::ColorF::LightBlue, 0.5f));
-	}
+    if (batched_)
+    {
+        draw_batched();
+    }
+    else
+    {
+        const KShapeStore& shapes = geometry_.shapes_;
+        for (size_t i = 0; i < shapes.span(); ++i)
+        {
+            if (!shapes.alive(i))
+                continue;
+            D2D1_ELLIPSE ellipse{D2D1_POINT_2F{shapes.cx()[i], shapes.cy()[i]}, shapes.rx()[i], shapes.ry()[i]};
+            d2d1_brush_->SetColor(D2D1::ColorF(D2D1::ColorF::LightBlue, 0.5f));
+            d2d1_device_context_->FillEllipse(ellipse, d2d1_brush_);
+            d2d1_brush_->SetColor(D2D1::ColorF{D2D1::ColorF::Black, 0.5f});
+            d2d1_device_context_->DrawEllipse(ellipse, d2d1_brush_, 1.f);
+            d2d1_brush_->SetColor(D2D1::ColorF(D2D1::ColorF::LightBlue, 0.5f));
+        }
+    }
 	if (geometry_.draw_bounding_box_)
 	{
 		d2d1_brush_->SetColor(D2D1::ColorF{D2D1::ColorF::Gray});
-		d2d1_device_context_->DrawRectangle(geometry_.bounding_box_, d2d1_brush_, 1.f, d2d1_stroke_style_);
+		const KAABB& b = geometry_.bounding_box_;
+		d2d1_device_context_->DrawRectangle(D2D1_RECT_F{b.left, b.top, b.right, b.bottom}, d2d1_brush_, 1.f, d2d1_stroke_style_);
 		d2d1_brush_->SetColor(D2D1::ColorF(D2D1::ColorF::LightPink));
 	}
     ///////////////////////////////////////////////////////////////////////////////////////////
@@ -312,14 +299,128 @@ void KD2DSurface::draw()
     ///////////////////////////////////////////////////////////////////////////////////////////
     // Draw text.
     ///////////////////////////////////////////////////////////////////////////////////////////
-    d2d1_device_context_->DrawText(textOverlay.text.c_str(),
-                                    static_cast<UINT32>(wcslen(textOverlay.text.c_str())),
-                                    dwrite_text_format_,
-                                    &textOverlay.rect,
-                                    d2d1_text_brush_);
+    draw_text();
     ///////////////////////////////////////////////////////////////////////////////////////////
 }
 
+// Draws every shape with two FillMesh calls per chunk of the batch,
+// fills then outlines, from triangles tessellated on the CPU. Only the
+// meshes of the chunks the last edit touched are rebuilt. Meshes can
+// only be drawn aliased, and since all fills go down before all
+// outlines, an outline is never covered by a translucent fill above it.
+void KD2DSurface::draw_batched()
+{
+    static_assert(sizeof(KTriangleF) == sizeof(D2D1_TRIANGLE), "KTriangleF must match D2D1_TRIANGLE");
+
+    ellipse_batch_.update(geometry_.shapes_);
+    size_t chunks = ellipse_batch_.chunk_count();
+    d2d1_fill_meshes_.resize(chunks, nullptr);
+    d2d1_stroke_meshes_.resize(chunks, nullptr);
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        if (!ellipse_batch_.chunk_changed(c) && d2d1_fill_meshes_[c] != nullptr)
+            continue;
+        SafeRelease(&d2d1_stroke_meshes_[c]);
+        SafeRelease(&d2d1_fill_meshes_[c]);
+        HRESULT hr = create_mesh(ellipse_batch_.fills(c), &d2d1_fill_meshes_[c]);
+        assert(SUCCEEDED(hr));
+        hr = create_mesh(ellipse_batch_.strokes(c), &d2d1_stroke_meshes_[c]);
+        assert(SUCCEEDED(hr));
+    }
+
+    d2d1_device_context_->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+    d2d1_brush_->SetColor(D2D1::ColorF(D2D1::ColorF::LightBlue, 0.5f));
+    for (ID2D1Mesh *mesh : d2d1_fill_meshes_)
+        d2d1_device_context_->FillMesh(mesh, d2d1_brush_);
+    d2d1_brush_->SetColor(D2D1::ColorF{D2D1::ColorF::Black, 0.5f});
+    for (ID2D1Mesh *mesh : d2d1_stroke_meshes_)
+        d2d1_device_context_->FillMesh(mesh, d2d1_brush_);
+    d2d1_brush_->SetColor(D2D1::ColorF(D2D1::ColorF::LightBlue, 0.5f));
+    d2d1_device_context_->SetAntialiasMode(D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+}
+
+// Draws the overlay text as one opacity mask, rendered from the glyph
+// atlas only when the text changes, aligned to the bottom-left of the
+// overlay's rectangle. Opacity masks can only be drawn aliased.
+void KD2DSurface::draw_text()
+{
+    HRESULT hr = S_OK;
+
+    if (text_batch_.layout(textOverlay.text, glyph_atlas_) || d2d1_text_mask_ == nullptr)
+    {
+        UINT32 width = static_cast<UINT32>(std::ceil(text_batch_.width()));
+        UINT32 height = static_cast<UINT32>(std::ceil(text_batch_.height()));
+        if (width == 0 || height == 0)
+        {
+            SafeRelease(&d2d1_text_mask_);
+            return;
+        }
+        text_mask_.assign(static_cast<size_t>(width) * height, 0);
+        text_batch_.render(glyph_atlas_, text_mask_.data(), width, height, width);
+
+        D2D1_SIZE_U size = d2d1_text_mask_ ? d2d1_text_mask_->GetPixelSize() : D2D1_SIZE_U{};
+        if (size.width == width && size.height == height)
+        {
+            hr = d2d1_text_mask_->CopyFromMemory(nullptr, text_mask_.data(), width);
+            assert(SUCCEEDED(hr));
+        }
+        else
+        {
+            SafeRelease(&d2d1_text_mask_);
+            D2D1_BITMAP_PROPERTIES1 bp = D2D1::BitmapProperties1(
+                D2D1_BITMAP_OPTIONS_NONE,
+                D2D1::PixelFormat(DXGI_FORMAT_A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+            hr = d2d1_device_context_->CreateBitmap(D2D1::SizeU(width, height),
+                                                    text_mask_.data(),
+                                                    width,
+                                                    &bp,
+                                                    &d2d1_text_mask_);
+            assert(SUCCEEDED(hr));
+        }
+    }
+    if (d2d1_text_mask_ == nullptr)
+    {
+        return;
+    }
+
+    D2D1_SIZE_U size = d2d1_text_mask_->GetPixelSize();
+    D2D1_RECT_F rect = D2D1::RectF(textOverlay.rect.left,
+                                   textOverlay.rect.bottom - size.height,
+                                   textOverlay.rect.left + size.width,
+                                   textOverlay.rect.bottom);
+    d2d1_device_context_->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+    d2d1_device_context_->FillOpacityMask(d2d1_text_mask_, d2d1_text_brush_, &rect);
+    d2d1_device_context_->SetAntialiasMode(D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+}
+
+void KD2DSurface::discard_meshes()
+{
+    for (ID2D1Mesh *&mesh : d2d1_stroke_meshes_)
+        SafeRelease(&mesh);
+    for (ID2D1Mesh *&mesh : d2d1_fill_meshes_)
+        SafeRelease(&mesh);
+    d2d1_stroke_meshes_.clear();
+    d2d1_fill_meshes_.clear();
+}
+
+HRESULT KD2DSurface::create_mesh(const std::vector<KTriangleF> &triangles, ID2D1Mesh **mesh)
+{
+    HRESULT hr = d2d1_device_context_->CreateMesh(mesh);
+    if (FAILED(hr))
+        return hr;
+
+    ID2D1TessellationSink *sink{};
+    hr = (*mesh)->Open(&sink);
+    if (FAILED(hr))
+        return hr;
+    if (!triangles.empty())
+        sink->AddTriangles(reinterpret_cast<const D2D1_TRIANGLE*>(triangles.data()),
+                           static_cast<UINT32>(triangles.size()));
+    hr = sink->Close();
+    SafeRelease(&sink);
+    return hr;
+}
+
 HRESULT KD2DSurface::create_d3d_device(D3D_DRIVER_TYPE const kD3DDriverType,
                                        ID3D11Device1 **d3d11_device,
                                        ID3D11DeviceContext1 **d3d11_device_context)
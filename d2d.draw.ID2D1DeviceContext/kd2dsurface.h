@@ -4,9 +4,11 @@
 #include <d2d1_2.h>
 #include <dxgi1_2.h>
 #include <d3d11_1.h>
-#include <dwrite.h>
 
+#include "kellipsebatch.h"
 #include "kgeometry.h"
+#include "kglyphatlas.h"
+#include "ktextbatch.h"
 #include "ktextoverlay.h"
 
 class KD2DSurface
@@ -25,23 +27,25 @@ public:
     void create_render_target_resources();
     void discard_render_target_resources();
 
-    void create_text_resources();
-    void discard_text_resources();
-
     void resize();
     void render();
     void draw();
+    void draw_batched();
+    void draw_text();
     HRESULT create_d3d_device(D3D_DRIVER_TYPE const kD3DDriveType,
                               ID3D11Device1 **d3d11_device,
                               ID3D11DeviceContext1 **d3d11_device_context);
     bool device_lost_{false};
     bool window_resized_{true};
+    bool batched_{false};       // Draw shapes as meshes rather than one by one.
 
 protected:
     KGeometry &geometry_;
     KTextOverlay &textOverlay;
 
     void initialize_d3d11_debug_layer(ID3D11Device1 **d3d11_device);
+    HRESULT create_mesh(const std::vector<KTriangleF> &triangles, ID2D1Mesh **mesh);
+    void discard_meshes();
     
     ID3D11Device1 *d3d11_device_{};
     ID3D11DeviceContext1* d3d11_device_context_{};
@@ -51,14 +55,19 @@ protected:
     ID2D1Bitmap1 *d2d1_bitmap_{};
     ID2D1SolidColorBrush *d2d1_brush_{};
     ID2D1StrokeStyle *d2d1_stroke_style_{};
+    std::vector<ID2D1Mesh*> d2d1_fill_meshes_;      // One of each per chunk of ellipse_batch_.
+    std::vector<ID2D1Mesh*> d2d1_stroke_meshes_;
+    KEllipseBatch ellipse_batch_;
     
     UINT d3d11_runtime_layers_{D3D11_CREATE_DEVICE_BGRA_SUPPORT};
     
     ///////////////////////////////////////////////////////////////////////////////////////////
     // Text components.
     ///////////////////////////////////////////////////////////////////////////////////////////
-    IDWriteFactory *dwrite_factory_{};
-    IDWriteTextFormat *dwrite_text_format_{};
+    KGlyphAtlas glyph_atlas_;
+    KTextBatch text_batch_;
+    std::vector<uint8_t> text_mask_;
+    ID2D1Bitmap1 *d2d1_text_mask_{};
     ID2D1SolidColorBrush *d2d1_text_brush_{};
     ///////////////////////////////////////////////////////////////////////////////////////////
 
@@ -4,9 +4,13 @@
 
 using namespace std;
 
+static const wchar_t *kSceneFile = L"drawing.kscene";
+static const wchar_t *kJournalFile = L"drawing.kjournal";
+
 KDrawingEngine::KDrawingEngine(uint32_t surface_width, uint32_t surface_height)
     : KWindow{},
-      geometry_{{surface_width, surface_height}},
+      geometry_{surface_width, surface_height},
+      journal_{geometry_},
       textOverlay{{surface_width, surface_height}}
 {
     Initialize(surface_width, surface_height);
@@ -151,6 +155,29 @@ void KDrawingEngine::onKeyDown(WPARAM wparam, LPARAM)
             SetCursorPos(p.x, p.y);
         }
 	}
+    else if (wparam == 0x42) // B
+    {
+        if (surface_)
+            surface_->batched_ = !surface_->batched_;
+    }
+    else if (GetKeyState(VK_CONTROL) < 0)
+    {
+        if (wparam == 0x5A) // Ctrl+Z
+            journal_.undo();
+        else if (wparam == 0x59) // Ctrl+Y
+            journal_.redo();
+        else if (wparam == 0x53 && GetKeyState(VK_SHIFT) < 0) // Ctrl+Shift+S
+            journal_.save(kJournalFile);
+        else if (wparam == 0x4F && GetKeyState(VK_SHIFT) < 0) // Ctrl+Shift+O
+            journal_.load(kJournalFile);
+        else if (wparam == 0x53) // Ctrl+S
+            geometry_.saveScene(kSceneFile);
+        else if (wparam == 0x4F) // Ctrl+O
+        {
+            if (geometry_.loadScene(kSceneFile))
+                journal_.rebase();
+        }
+    }
 }
 
 void KDrawingEngine::onLButtonDown(D2D1_POINT_2L point)
@@ -158,28 +185,25 @@ void KDrawingEngine::onLButtonDown(D2D1_POINT_2L point)
     D2D1_POINT_2F fpoint = left_click_ = D2D1_POINT_2F{static_cast<float>(point.x),
                                                        static_cast<float>(point.y)};
 
+    // Close any step left open by the mouse-wheel.
+    journal_.commit();
+
     if (mode_ == Mode::Draw)
     {
 		if (DragDetect(hwnd_, point))
 		{
 			SetCapture(hwnd_);
-			geometry_.ellipse_iter_ = geometry_.ellipse_list_.insert(geometry_.ellipse_list_.end(),
-                                                                     D2D1_ELLIPSE{fpoint, 0.f, 0.f});
-			geometry_.bounding_box_ = D2D1_RECT_F{fpoint.x, fpoint.y, fpoint.x, fpoint.y};
+			journal_.insert(KEllipseF{fpoint.x, fpoint.y, 0.f, 0.f});
+			geometry_.bounding_box_ = KAABB{fpoint.x, fpoint.y, fpoint.x, fpoint.y};
 			geometry_.draw_bounding_box_ = true;
 		}
     }
     else if (mode_ == Mode::Edit)
     {
-		geometry_.ellipse_iter_ = geometry_.ellipse_list_.end();
-		if (geometry_.selectShape(fpoint))
+		geometry_.clearSelection();
+		if (geometry_.selectShape(fpoint.x, fpoint.y))
 		{
-			// Move selection to end of list, meaning, place it on top
-			// of other ellipses in the scene, and consecuently it
-			// gets drawn last.
-			geometry_.ellipse_list_.splice(geometry_.ellipse_list_.end(),
-                                           geometry_.ellipse_list_,
-                                           geometry_.ellipse_iter_);
+			journal_.raise();
 			prev_point_ = left_click_;
 		}
     }
@@ -187,12 +211,13 @@ void KDrawingEngine::onLButtonDown(D2D1_POINT_2L point)
 
 void KDrawingEngine::onLButtonUp()
 {
-	if (mode_ == Mode::Draw && (geometry_.ellipse_iter_ != geometry_.ellipse_list_.end()))
+	if (mode_ == Mode::Draw && geometry_.hasSelection())
 	{
-		geometry_.ellipse_iter_ = geometry_.ellipse_list_.end();
+		geometry_.clearSelection();
 	}
 
 	geometry_.draw_bounding_box_ = false;
+	journal_.commit();
 
 	ReleaseCapture();
 }
@@ -202,16 +227,16 @@ void KDrawingEngine::onMouseMove(D2D1_POINT_2L point, WPARAM wparam)
 	D2D1_POINT_2F fpoint{static_cast<float>(point.x),
                          static_cast<float>(point.y)};
 
-	if (((DWORD)wparam & MK_LBUTTON) && (geometry_.ellipse_iter_ != geometry_.ellipse_list_.end()))
+	if (((DWORD)wparam & MK_LBUTTON) && geometry_.hasSelection())
 	{
 		if (mode_ == Mode::Draw)
 		{
 			// Construct an ellipse centered in the bounding box
 			// described by the clicked point and current mouse point.
 			D2D1_POINT_2F sz{ (fpoint.x - left_click_.x) * .5f , (fpoint.y - left_click_.y) * .5f };
-			*(geometry_.ellipse_iter_) = D2D1_ELLIPSE{D2D1_POINT_2F{left_click_.x + sz.x, left_click_.y + sz.y}, sz.x, sz.y};
+			journal_.reshape(KEllipseF{left_click_.x + sz.x, left_click_.y + sz.y, sz.x, sz.y});
 
-			geometry_.bounding_box_ = D2D1_RECT_F{ left_click_.x, left_click_.y, fpoint.x, fpoint.y };
+			geometry_.bounding_box_ = KAABB{ left_click_.x, left_click_.y, fpoint.x, fpoint.y };
 			geometry_.draw_bounding_box_ = true;
 		}
 		else if (mode_ == Mode::Edit)
@@ -220,8 +245,7 @@ void KDrawingEngine::onMouseMove(D2D1_POINT_2L point, WPARAM wparam)
 			// save the new position.
 			float dx = fpoint.x - prev_point_.x;
 			float dy = fpoint.y - prev_point_.y;
-			geometry_.ellipse_iter_->point.x += dx;
-			geometry_.ellipse_iter_->point.y += dy;
+			journal_.move(dx, dy);
 
 			prev_point_ = fpoint;
 		}
@@ -229,7 +253,7 @@ void KDrawingEngine::onMouseMove(D2D1_POINT_2L point, WPARAM wparam)
 }
 void KDrawingEngine::onMouseWheelMove(int wheel_data)
 {
-	if (geometry_.ellipse_iter_ != geometry_.ellipse_list_.end())
+	if (geometry_.hasSelection())
 	{
 		// REWRITE: Relocate the magic numbers; 120 is recommended in
 		// Windows documentation; read the page:
@@ -237,13 +261,13 @@ void KDrawingEngine::onMouseWheelMove(int wheel_data)
 		// https://docs.microsoft.com/en-us/windows/win32/learnwin32/other-mouse-operations#mouse-wheel
 		int steps = wheel_data / 120;
 		float scale = 1.f + (float)steps * 0.02f;
-		geometry_.resizeEllipse(*(geometry_.ellipse_iter_), scale);
+		journal_.scale(scale);
 	}
 }
 
 void KDrawingEngine::onMouseLeave()
 {
-	geometry_.ellipse_iter_ = geometry_.ellipse_list_.end();
+	geometry_.clearSelection();
 	geometry_.draw_bounding_box_ = false;
 }
 
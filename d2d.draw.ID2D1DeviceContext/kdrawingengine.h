@@ -2,6 +2,7 @@
 
 #include <memory>
 #include "kd2dsurface.h"
+#include "kjournal.h"
 
 enum class Mode{Draw, Edit};
 
@@ -26,6 +27,7 @@ private:
     
     std::unique_ptr<KD2DSurface> surface_{};
 	KGeometry	  geometry_;
+    KJournal      journal_;
     KTextOverlay  textOverlay;
 	D2D1_POINT_2F left_click_;
 	D2D1_POINT_2F prev_point_;
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "kellipsebatch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KELLIPSEBATCH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Unit circles for every segment count the tessellator uses.
+struct UnitCircles
+{
+    std::vector<float> cos[KEllipseBatch::kMaxSegments / 4 + 1];
+    std::vector<float> sin[KEllipseBatch::kMaxSegments / 4 + 1];
+
+    UnitCircles()
+    {
+        const double kTwoPi = 6.283185307179586;
+        for (int n = KEllipseBatch::kMinSegments; n <= KEllipseBatch::kMaxSegments; n += 4)
+        {
+            cos[n / 4].resize(n);
+            sin[n / 4].resize(n);
+            for (int i = 0; i < n; ++i)
+            {
+                cos[n / 4][i] = static_cast<float>(std::cos(kTwoPi * i / n));
+                sin[n / 4][i] = static_cast<float>(std::sin(kTwoPi * i / n));
+            }
+        }
+    }
+};
+
+static const UnitCircles& unit_circles()
+{
+    static const UnitCircles circles;
+    return circles;
+}
+
+// Writes the n vertices of an ellipse, n a multiple of four.
+static void ring(float cx, float cy, float rx, float ry, int n, float *xs, float *ys)
+{
+    const UnitCircles& circles = unit_circles();
+    const float *c = circles.cos[n / 4].data();
+    const float *s = circles.sin[n / 4].data();
+#if defined(KELLIPSEBATCH_SSE2)
+    __m128 vcx = _mm_set1_ps(cx);
+    __m128 vcy = _mm_set1_ps(cy);
+    __m128 vrx = _mm_set1_ps(rx);
+    __m128 vry = _mm_set1_ps(ry);
+    for (int i = 0; i < n; i += 4)
+    {
+        _mm_storeu_ps(xs + i, _mm_add_ps(vcx, _mm_mul_ps(vrx, _mm_loadu_ps(c + i))));
+        _mm_storeu_ps(ys + i, _mm_add_ps(vcy, _mm_mul_ps(vry, _mm_loadu_ps(s + i))));
+    }
+#else
+    for (int i = 0; i < n; ++i)
+    {
+        xs[i] = cx + rx * c[i];
+        ys[i] = cy + ry * s[i];
+    }
+#endif
+}
+
+int KEllipseBatch::segment_count(float rx, float ry)
+{
+    const double kPi = 3.141592653589793;
+    float r = std::max(std::fabs(rx), std::fabs(ry)) + 0.5f * kStrokeWidth;
+    if (r <= kTolerance)
+        return kMinSegments;
+    // The chord of a segment spanning angle a sags r(1 - cos(a/2)).
+    int n = static_cast<int>(std::ceil(kPi / std::acos(1.0 - kTolerance / r)));
+    n = (n + 3) & ~3;
+    return std::clamp(n, static_cast<int>(kMinSegments), static_cast<int>(kMaxSegments));
+}
+
+void KEllipseBatch::tessellate(const KEllipseF& ellipse,
+                               std::vector<KTriangleF>& fill,
+                               std::vector<KTriangleF>& stroke)
+{
+    float rx = std::fabs(ellipse.rx);
+    float ry = std::fabs(ellipse.ry);
+    float half = 0.5f * kStrokeWidth;
+    int n = segment_count(rx, ry);
+
+    float xs[3][kMaxSegments];
+    float ys[3][kMaxSegments];
+    ring(ellipse.cx, ellipse.cy, rx, ry, n, xs[0], ys[0]);
+    ring(ellipse.cx, ellipse.cy, rx + half, ry + half, n, xs[1], ys[1]);
+    ring(ellipse.cx, ellipse.cy, std::max(rx - half, 0.f), std::max(ry - half, 0.f), n, xs[2], ys[2]);
+
+    fill.resize(n - 2);
+    const float *fx = xs[0];
+    const float *fy = ys[0];
+    for (int i = 1; i + 1 < n; ++i)
+        fill[i - 1] = KTriangleF{fx[0], fy[0], fx[i], fy[i], fx[i + 1], fy[i + 1]};
+
+    stroke.resize(2 * n);
+    const float *ox = xs[1];
+    const float *oy = ys[1];
+    const float *ix = xs[2];
+    const float *iy = ys[2];
+    for (int i = 0; i < n; ++i)
+    {
+        int j = i + 1 == n ? 0 : i + 1;
+        stroke[2 * i] = KTriangleF{ox[i], oy[i], ox[j], oy[j], ix[i], iy[i]};
+        stroke[2 * i + 1] = KTriangleF{ix[i], iy[i], ox[j], oy[j], ix[j], iy[j]};
+    }
+}
+
+static bool same(const KEllipseF& a, const KEllipseF& b)
+{
+    return a.cx == b.cx && a.cy == b.cy && a.rx == b.rx && a.ry == b.ry;
+}
+
+KEllipseBatch::KEllipseBatch(uint32_t chunk_slots)
+    : chunk_slots_{std::max(chunk_slots, 1u)}
+{
+}
+
+bool KEllipseBatch::update(const KShapeStore& shapes)
+{
+    retessellated_ = 0;
+    rebuilt_ = 0;
+    for (Chunk& chunk : chunks_)
+        chunk.changed = false;
+    if (shapes.revision() == revision_)
+        return false;
+    revision_ = shapes.revision();
+
+    // A NaN centre never compares equal, so new slots are tessellated.
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    if (cache_.size() < shapes.slot_count())
+    {
+        cache_.resize(shapes.slot_count(), Cached{KEllipseF{nan, nan, 0.f, 0.f}, false, {}, {}});
+        chunks_.resize((cache_.size() + chunk_slots_ - 1) / chunk_slots_, Chunk{false, {}, {}});
+    }
+
+    seen_.assign(cache_.size(), 0);
+    for (size_t i = 0; i < shapes.span(); ++i)
+    {
+        if (!shapes.alive(i))
+            continue;
+        KEllipseF ellipse = shapes.at(i);
+        uint32_t slot = shapes.slot_at(i);
+        Cached& cached = cache_[slot];
+        seen_[slot] = 1;
+        if (!cached.live || !same(cached.ellipse, ellipse))
+        {
+            tessellate(ellipse, cached.fill, cached.stroke);
+            cached.ellipse = ellipse;
+            cached.live = true;
+            chunks_[slot / chunk_slots_].changed = true;
+            ++retessellated_;
+        }
+    }
+
+    // Shapes erased since the last update leave their chunks too.
+    for (size_t slot = 0; slot < cache_.size(); ++slot)
+    {
+        if (cache_[slot].live && !seen_[slot])
+        {
+            cache_[slot].live = false;
+            chunks_[slot / chunk_slots_].changed = true;
+        }
+    }
+
+    for (size_t chunk = 0; chunk < chunks_.size(); ++chunk)
+        if (chunks_[chunk].changed)
+            rebuild(chunk);
+    return rebuilt_ > 0;
+}
+
+void KEllipseBatch::rebuild(size_t chunk)
+{
+    size_t begin = chunk * chunk_slots_;
+    size_t end = std::min(begin + chunk_slots_, cache_.size());
+    size_t fill_count = 0;
+    size_t stroke_count = 0;
+    for (size_t slot = begin; slot < end; ++slot)
+    {
+        if (!cache_[slot].live)
+            continue;
+        fill_count += cache_[slot].fill.size();
+        stroke_count += cache_[slot].stroke.size();
+    }
+
+    Chunk& out = chunks_[chunk];
+    out.fills.resize(fill_count);
+    out.strokes.resize(stroke_count);
+    KTriangleF *fill_out = out.fills.data();
+    KTriangleF *stroke_out = out.strokes.data();
+    for (size_t slot = begin; slot < end; ++slot)
+    {
+        const Cached& cached = cache_[slot];
+        if (!cached.live)
+            continue;
+        fill_out = std::copy(cached.fill.begin(), cached.fill.end(), fill_out);
+        stroke_out = std::copy(cached.stroke.begin(), cached.stroke.end(), stroke_out);
+    }
+    ++rebuilt_;
+}
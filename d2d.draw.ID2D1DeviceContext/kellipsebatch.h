@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "kshapestore.h"
+
+// CPU tessellation of every ellipse in a KShapeStore into triangle
+// lists, the fills and the 1 px outlines, so that the whole scene can
+// be drawn as a few meshes rather than two calls per shape. Each
+// shape's triangles are cached by slot and redone only when the shape
+// changes; update() does nothing at all while the store's revision
+// hasn't moved.
+//
+// The lists are split into chunks of chunk_slots() slots each, and an
+// edit rebuilds only the chunks of the slots it touched, so that
+// dragging one shape re-uploads one chunk instead of the scene. Within
+// and across chunks the triangles are in slot order, not back to
+// front: all fills share one translucent colour and all outlines
+// another, drawn fills first, and blending n layers of one colour
+// comes out the same in any order. bring_to_front() rebuilds nothing.
+//
+// Ellipses get as many segments as keep the chord within kTolerance of
+// the curve, a multiple of four so that vertices are computed four at a
+// time with SSE2. Fills are fans; outlines are rings from r - 0.5 to
+// r + 0.5, without antialiasing of their own.
+//
+// USAGE:
+//
+// KEllipseBatch batch;
+// batch.update(store);
+// for (size_t c = 0; c < batch.chunk_count(); ++c)
+//     if (batch.chunk_changed(c))
+//         upload(c, batch.fills(c), batch.strokes(c));
+// draw(fill_meshes);
+// draw(stroke_meshes);
+
+// Laid out as D2D1_TRIANGLE.
+struct KTriangleF
+{
+    float x0, y0;
+    float x1, y1;
+    float x2, y2;
+};
+
+class KEllipseBatch
+{
+public:
+    static constexpr float kTolerance{0.25f};
+    static constexpr float kStrokeWidth{1.f};
+    static const int kMinSegments{8};
+    static const int kMaxSegments{512};
+    static const uint32_t kChunkSlots{256};
+
+    explicit KEllipseBatch(uint32_t chunk_slots = kChunkSlots);
+
+    // Brings the triangle lists up to date with shapes; returns whether
+    // any chunk changed.
+    bool update(const KShapeStore& shapes);
+
+    uint32_t chunk_slots() const;
+    size_t chunk_count() const;
+    bool chunk_changed(size_t chunk) const;     // By the last update().
+    const std::vector<KTriangleF>& fills(size_t chunk) const;
+    const std::vector<KTriangleF>& strokes(size_t chunk) const;
+
+    // Shapes tessellated afresh, and chunks rebuilt, by the last
+    // update(), for statistics.
+    size_t retessellated() const;
+    size_t rebuilt() const;
+
+    static int segment_count(float rx, float ry);
+    static void tessellate(const KEllipseF& ellipse,
+                           std::vector<KTriangleF>& fill,
+                           std::vector<KTriangleF>& stroke);
+
+private:
+    struct Cached
+    {
+        KEllipseF ellipse;
+        bool live;
+        std::vector<KTriangleF> fill;
+        std::vector<KTriangleF> stroke;
+    };
+
+    struct Chunk
+    {
+        bool changed;
+        std::vector<KTriangleF> fills;
+        std::vector<KTriangleF> strokes;
+    };
+
+    void rebuild(size_t chunk);
+
+    uint32_t chunk_slots_;
+    std::vector<Cached> cache_;
+    std::vector<uint8_t> seen_;     // Slots live in the store, this update().
+    std::vector<Chunk> chunks_;
+    uint64_t revision_{UINT64_MAX};
+    size_t retessellated_{};
+    size_t rebuilt_{};
+};
+
+inline uint32_t KEllipseBatch::chunk_slots() const { return chunk_slots_; }
+
+inline size_t KEllipseBatch::chunk_count() const { return chunks_.size(); }
+
+inline bool KEllipseBatch::chunk_changed(size_t chunk) const { return chunks_[chunk].changed; }
+
+inline const std::vector<KTriangleF>& KEllipseBatch::fills(size_t chunk) const { return chunks_[chunk].fills; }
+
+inline const std::vector<KTriangleF>& KEllipseBatch::strokes(size_t chunk) const { return chunks_[chunk].strokes; }
+
+inline size_t KEllipseBatch::retessellated() const { return retessellated_; }
+
+inline size_t KEllipseBatch::rebuilt() const { return rebuilt_; }
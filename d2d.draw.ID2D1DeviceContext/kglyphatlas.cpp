@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "kglyphatlas.h"
+#include "kpixelfont.h"
+
+static const uint32_t kFirstCodepoint = 32;
+static const uint32_t kLastCodepoint = 126;
+
+KGlyphAtlas::KGlyphAtlas(float scale)
+    : scale_{scale},
+      glyphs_(kLastCodepoint - kFirstCodepoint + 1),
+      present_(kLastCodepoint - kFirstCodepoint + 1, false)
+{
+    assert(scale > 0.f);
+}
+
+float KGlyphAtlas::ascent() const
+{
+    return std::ceil(kPixelFontAscent * scale_);
+}
+
+float KGlyphAtlas::line_height() const
+{
+    return std::ceil(kPixelFontLineHeight * scale_);
+}
+
+const KGlyph& KGlyphAtlas::glyph(uint32_t codepoint)
+{
+    if (codepoint < kFirstCodepoint || codepoint > kLastCodepoint)
+        codepoint = '?';
+    uint32_t index = codepoint - kFirstCodepoint;
+    if (!present_[index])
+        add(index);
+    return glyphs_[index];
+}
+
+// Overlap of the texel span [t, t + 1) with each of a row or column of
+// font pixels, scale texels wide each.
+static void overlaps(int t, float scale, int pixels, float *weights)
+{
+    for (int p = 0; p < pixels; ++p)
+    {
+        float lo = std::max(static_cast<float>(t), p * scale);
+        float hi = std::min(static_cast<float>(t + 1), (p + 1) * scale);
+        weights[p] = std::max(hi - lo, 0.f);
+    }
+}
+
+void KGlyphAtlas::add(uint32_t index)
+{
+    int width = static_cast<int>(std::ceil(kPixelFontWidth * scale_));
+    int height = static_cast<int>(std::ceil(kPixelFontHeight * scale_));
+    assert(width + kPadding <= kWidth);
+
+    if (shelf_x_ + width + kPadding > kWidth)
+    {
+        shelf_y_ += shelf_height_;
+        shelf_x_ = 0;
+        shelf_height_ = 0;
+    }
+    shelf_height_ = std::max(shelf_height_, height + kPadding);
+    if (shelf_y_ + shelf_height_ > height_)
+    {
+        height_ = std::max(2 * height_, shelf_y_ + shelf_height_);
+        texels_.resize(static_cast<size_t>(kWidth) * height_, 0);
+    }
+
+    KGlyph& glyph = glyphs_[index];
+    glyph.x = static_cast<uint16_t>(shelf_x_);
+    glyph.y = static_cast<uint16_t>(shelf_y_);
+    glyph.width = static_cast<uint16_t>(width);
+    glyph.height = static_cast<uint16_t>(height);
+    glyph.bearing_y = -ascent();
+    glyph.advance = std::round(kPixelFontAdvance * scale_);
+    shelf_x_ += width + kPadding;
+
+    const uint8_t *rows = pixel_font_glyph(index + kFirstCodepoint);
+    float wx[kPixelFontWidth];
+    float wy[kPixelFontHeight];
+    for (int y = 0; y < height; ++y)
+    {
+        overlaps(y, scale_, kPixelFontHeight, wy);
+        uint8_t *out = texels_.data() + static_cast<size_t>(glyph.y + y) * kWidth + glyph.x;
+        for (int x = 0; x < width; ++x)
+        {
+            overlaps(x, scale_, kPixelFontWidth, wx);
+            float area = 0.f;
+            for (int py = 0; py < kPixelFontHeight; ++py)
+            {
+                if (wy[py] == 0.f)
+                    continue;
+                for (int px = 0; px < kPixelFontWidth; ++px)
+                    if (rows[py] & (0x10 >> px))
+                        area += wx[px] * wy[py];
+            }
+            out[x] = static_cast<uint8_t>(std::min(area, 1.f) * 255.f + 0.5f);
+        }
+    }
+    present_[index] = true;
+    ++revision_;
+}
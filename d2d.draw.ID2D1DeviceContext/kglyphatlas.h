@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 8-bit coverage atlas of glyphs from the built-in pixel font, each
+// rasterized once, on first use, at the atlas's scale. Scaling treats
+// every font pixel as a square and gives each atlas texel the area of
+// it those squares cover, so fractional scales come out antialiased and
+// whole ones stay sharp. Glyphs are packed on shelves across a fixed
+// width, and the atlas grows downward as shelves fill.
+//
+// USAGE:
+//
+// KGlyphAtlas atlas{1.5f};
+// const KGlyph& g = atlas.glyph(L'A');
+// copy(atlas.texels() + g.y * atlas.width() + g.x, g.width, g.height);
+// pen_x += g.advance;
+
+struct KGlyph
+{
+    uint16_t x, y;              // Top-left texel in the atlas.
+    uint16_t width, height;
+    float bearing_y;            // From the baseline to the top, negative up.
+    float advance;
+};
+
+class KGlyphAtlas
+{
+public:
+    static const int kWidth{256};
+    static const int kPadding{1};
+
+    explicit KGlyphAtlas(float scale = 1.f);
+
+    const KGlyph& glyph(uint32_t codepoint);
+
+    float scale() const;
+    float ascent() const;
+    float line_height() const;
+
+    const uint8_t *texels() const;
+    int width() const;
+    int height() const;
+    // Goes up whenever a glyph is added, for re-uploading a copy.
+    uint64_t revision() const;
+
+private:
+    void add(uint32_t index);
+
+    float scale_{1.f};
+    std::vector<uint8_t> texels_;
+    int height_{};
+    int shelf_x_{};
+    int shelf_y_{};
+    int shelf_height_{};
+    std::vector<KGlyph> glyphs_;        // By codepoint - 32.
+    std::vector<bool> present_;
+    uint64_t revision_{};
+};
+
+inline float KGlyphAtlas::scale() const { return scale_; }
+
+inline const uint8_t *KGlyphAtlas::texels() const { return texels_.data(); }
+
+inline int KGlyphAtlas::width() const { return kWidth; }
+
+inline int KGlyphAtlas::height() const { return height_; }
+
+inline uint64_t KGlyphAtlas::revision() const { return revision_; }
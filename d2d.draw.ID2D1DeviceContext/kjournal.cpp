@@ -0,0 +1,483 @@
+#include "kjournal.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+static const uint32_t kJournalMagic = 0x4c4e4a4b;      // "KJNL"
+static const uint32_t kJournalVersion = 2;
+static const size_t kJournalHeaderWords = 6;
+
+static KEllipseF toEllipse(const float *e)
+{
+    return KEllipseF{e[0], e[1], e[2], e[3]};
+}
+
+KJournal::KJournal(KGeometry& geometry) : geometry_{geometry}
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Edits.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void KJournal::insert(const KEllipseF& ellipse)
+{
+    begin_edit();
+    Record record{Type::Insert, static_cast<uint32_t>(handles_.size()),
+                  {ellipse.cx, ellipse.cy, ellipse.rx, ellipse.ry}, {}};
+    apply(record);
+    records_.push_back(record);
+    ++applied_;
+}
+
+void KJournal::reshape(const KEllipseF& ellipse)
+{
+    Record *record = open_record();
+    if (!geometry_.hasSelection() || !record || record->type != Type::Insert || record->id != selected_id())
+    {
+        return;
+    }
+    record->delta[0] = ellipse.cx;
+    record->delta[1] = ellipse.cy;
+    record->delta[2] = ellipse.rx;
+    record->delta[3] = ellipse.ry;
+    geometry_.setEllipse(handles_[record->id], ellipse);
+}
+
+void KJournal::move(float dx, float dy)
+{
+    if (!geometry_.hasSelection())
+    {
+        return;
+    }
+    uint32_t id = selected_id();
+    begin_edit();
+    Record *record = open_record();
+    if (record && record->type == Type::Move && record->id == id)
+    {
+        // Fold into the last move, and apply the folded delta to the
+        // ellipse it started from, so that replay gives the same result.
+        record->delta[0] += dx;
+        record->delta[1] += dy;
+        const KEllipseF& e = record->before;
+        geometry_.setEllipse(handles_[id], KEllipseF{e.cx + record->delta[0], e.cy + record->delta[1], e.rx, e.ry});
+        return;
+    }
+    Record fresh{Type::Move, id, {dx, dy, 0.f, 0.f}, {}};
+    apply(fresh);
+    records_.push_back(fresh);
+    ++applied_;
+}
+
+void KJournal::scale(float factor)
+{
+    if (!geometry_.hasSelection())
+    {
+        return;
+    }
+    uint32_t id = selected_id();
+    begin_edit();
+    Record *record = open_record();
+    if (record && record->type == Type::Scale && record->id == id)
+    {
+        record->delta[0] *= factor;
+        const KEllipseF& e = record->before;
+        geometry_.setEllipse(handles_[id], KEllipseF{e.cx, e.cy, e.rx * record->delta[0], e.ry * record->delta[0]});
+        return;
+    }
+    Record fresh{Type::Scale, id, {factor, 0.f, 0.f, 0.f}, {}};
+    apply(fresh);
+    records_.push_back(fresh);
+    ++applied_;
+}
+
+void KJournal::raise()
+{
+    if (!geometry_.hasSelection())
+    {
+        return;
+    }
+    const KShapeStore& shapes = geometry_.shapes_;
+    if (shapes.depth(geometry_.selection()) + 1 == shapes.span())
+    {
+        return;     // Already on top.
+    }
+    begin_edit();
+    Record record{Type::Raise, selected_id(), {}, {}};
+    apply(record);
+    records_.push_back(record);
+    ++applied_;
+}
+
+uint32_t KJournal::selected_id() const
+{
+    return ids_[geometry_.shapes_.slot(geometry_.selection())];
+}
+
+KJournal::Record *KJournal::open_record()
+{
+    size_t committed = cursor_ > 0 ? steps_[cursor_ - 1] : 0;
+    return applied_ > committed ? &records_[applied_ - 1] : nullptr;
+}
+
+// Opening a step after some undos drops the steps that could have been
+// redone, with the snapshots taken in them.
+void KJournal::begin_edit()
+{
+    if (open_record() || records_.size() == applied_)
+    {
+        return;
+    }
+    size_t next_id = handles_.size();
+    for (size_t i = applied_; i < records_.size(); ++i)
+    {
+        if (records_[i].type == Type::Insert)
+            next_id = std::min(next_id, static_cast<size_t>(records_[i].id));
+    }
+    handles_.resize(next_id);
+    records_.resize(applied_);
+    steps_.resize(cursor_);
+    while (!snapshots_.empty() && snapshots_.back().records > applied_)
+        snapshots_.pop_back();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// History.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void KJournal::commit()
+{
+    if (!open_record())
+    {
+        return;
+    }
+    steps_.push_back(applied_);
+    ++cursor_;
+    maybe_snapshot();
+}
+
+bool KJournal::undo()
+{
+    commit();
+    if (cursor_ == 0)
+    {
+        return false;
+    }
+    size_t begin = cursor_ > 1 ? steps_[cursor_ - 2] : 0;
+    size_t end = steps_[cursor_ - 1];
+    bool raised = std::any_of(records_.begin() + begin, records_.begin() + end,
+                              [](const Record& r) { return r.type == Type::Raise; });
+    if (raised)
+    {
+        restore(begin);
+    }
+    else
+    {
+        for (size_t i = end; i-- > begin;)
+            revert(records_[i]);
+    }
+    applied_ = begin;
+    --cursor_;
+    geometry_.clearSelection();
+    return true;
+}
+
+bool KJournal::redo()
+{
+    commit();
+    if (cursor_ == steps_.size())
+    {
+        return false;
+    }
+    for (size_t i = applied_; i < steps_[cursor_]; ++i)
+        apply(records_[i]);
+    applied_ = steps_[cursor_];
+    ++cursor_;
+    geometry_.clearSelection();
+    return true;
+}
+
+void KJournal::clear()
+{
+    geometry_.clear();
+    records_.clear();
+    steps_.clear();
+    snapshots_.clear();
+    handles_.clear();
+    ids_.clear();
+    base_ = 0;
+    applied_ = 0;
+    cursor_ = 0;
+}
+
+// The base ellipses get the first ids, in drawing order, and a snapshot
+// at the start of the history for restore() to begin from.
+void KJournal::rebase()
+{
+    records_.clear();
+    steps_.clear();
+    snapshots_.clear();
+    handles_.clear();
+    ids_.clear();
+    applied_ = 0;
+    cursor_ = 0;
+
+    const KShapeStore& shapes = geometry_.shapes_;
+    uint32_t id = 0;
+    for (size_t i = 0; i < shapes.span(); ++i)
+    {
+        if (shapes.alive(i))
+            bind(id++, shapes.handle_of_slot(shapes.slot_at(i)));
+    }
+    base_ = id;
+    if (base_ > 0)
+        take_snapshot();
+}
+
+void KJournal::bind(uint32_t id, KShapeHandle handle)
+{
+    if (id >= handles_.size())
+        handles_.resize(id + 1);
+    handles_[id] = handle;
+    uint32_t slot = geometry_.shapes_.slot(handle);
+    if (slot >= ids_.size())
+        ids_.resize(slot + 1);
+    ids_[slot] = id;
+}
+
+void KJournal::apply(Record& record)
+{
+    switch (record.type)
+    {
+    case Type::Insert:
+        geometry_.insertEllipse(toEllipse(record.delta));
+        bind(record.id, geometry_.selection());
+        break;
+    case Type::Move:
+    {
+        KEllipseF e = record.before = geometry_.shapes_.get(handles_[record.id]);
+        geometry_.setEllipse(handles_[record.id], KEllipseF{e.cx + record.delta[0], e.cy + record.delta[1], e.rx, e.ry});
+        break;
+    }
+    case Type::Scale:
+    {
+        KEllipseF e = record.before = geometry_.shapes_.get(handles_[record.id]);
+        geometry_.setEllipse(handles_[record.id], KEllipseF{e.cx, e.cy, e.rx * record.delta[0], e.ry * record.delta[0]});
+        break;
+    }
+    case Type::Raise:
+        geometry_.select(handles_[record.id]);
+        geometry_.bringToFront();
+        break;
+    }
+}
+
+void KJournal::revert(const Record& record)
+{
+    switch (record.type)
+    {
+    case Type::Insert:
+        geometry_.eraseEllipse(handles_[record.id]);
+        handles_[record.id] = KShapeHandle{};
+        break;
+    case Type::Move:
+    case Type::Scale:
+        geometry_.setEllipse(handles_[record.id], record.before);
+        break;
+    case Type::Raise:
+        assert(false);      // Undone through restore().
+        break;
+    }
+}
+
+// Rebuilds the geometry as it was after the first records records, from
+// the nearest snapshot at or before that point.
+void KJournal::restore(size_t records)
+{
+    geometry_.clear();
+    std::fill(handles_.begin(), handles_.end(), KShapeHandle{});
+    ids_.clear();
+
+    size_t from = 0;
+    auto it = std::upper_bound(snapshots_.begin(), snapshots_.end(), records,
+                               [](size_t n, const Snapshot& s) { return n < s.records; });
+    if (it != snapshots_.begin())
+    {
+        const Snapshot& snapshot = *(it - 1);
+        for (size_t i = 0; i < snapshot.ids.size(); ++i)
+        {
+            geometry_.insertEllipse(snapshot.ellipses[i]);
+            bind(snapshot.ids[i], geometry_.selection());
+        }
+        from = snapshot.records;
+    }
+    for (size_t i = from; i < records; ++i)
+        apply(records_[i]);
+}
+
+// Snapshots are spaced at least as many records apart as there are
+// shapes, so that they never take more memory than the records do.
+void KJournal::maybe_snapshot()
+{
+    size_t last = snapshots_.empty() ? 0 : snapshots_.back().records;
+    if (applied_ - last >= std::max(kSnapshotInterval, geometry_.shapes_.size()))
+        take_snapshot();
+}
+
+void KJournal::take_snapshot()
+{
+    const KShapeStore& shapes = geometry_.shapes_;
+
+    Snapshot snapshot{applied_, {}, {}};
+    snapshot.ids.reserve(shapes.size());
+    snapshot.ellipses.reserve(shapes.size());
+    for (size_t i = 0; i < shapes.span(); ++i)
+    {
+        if (!shapes.alive(i))
+            continue;
+        snapshot.ids.push_back(ids_[shapes.slot_at(i)]);
+        snapshot.ellipses.push_back(shapes.at(i));
+    }
+    snapshots_.push_back(std::move(snapshot));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Files.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Payload floats of each record type.
+static size_t delta_count(uint8_t type)
+{
+    static const size_t kCounts[]{4, 2, 1, 0};
+    return kCounts[type];
+}
+
+// A header of kJournalHeaderWords words: magic, version, record count,
+// step count, the steps applied and the base ellipse count; then each step's end as a word; then
+// the records, a type byte and an id word each, and the type's deltas.
+bool KJournal::save(const std::filesystem::path& filename)
+{
+    commit();
+
+    uint32_t header[kJournalHeaderWords]{kJournalMagic,
+                                         kJournalVersion,
+                                         static_cast<uint32_t>(records_.size()),
+                                         static_cast<uint32_t>(steps_.size()),
+                                         static_cast<uint32_t>(cursor_),
+                                         static_cast<uint32_t>(base_)};
+    std::vector<uint8_t> mem(sizeof(header));
+    memcpy(mem.data(), header, sizeof(header));
+    auto put = [&mem](const void *p, size_t n) {
+        const uint8_t *bytes = static_cast<const uint8_t*>(p);
+        mem.insert(mem.end(), bytes, bytes + n);
+    };
+    for (size_t step : steps_)
+    {
+        uint32_t end = static_cast<uint32_t>(step);
+        put(&end, sizeof(end));
+    }
+    for (const Record& record : records_)
+    {
+        uint8_t type = static_cast<uint8_t>(record.type);
+        put(&type, sizeof(type));
+        put(&record.id, sizeof(record.id));
+        put(record.delta, delta_count(type) * sizeof(float));
+    }
+
+#if defined(_WIN32)
+    FILE *fp = _wfopen(filename.c_str(), L"wb");
+#else
+    FILE *fp = fopen(filename.c_str(), "wb");
+#endif
+    if (!fp)
+        return false;
+    bool ok = fwrite(mem.data(), 1, mem.size(), fp) == mem.size();
+    return (fclose(fp) == 0) && ok;
+}
+
+bool KJournal::load(const std::filesystem::path& filename)
+{
+    std::error_code ec;
+    uintmax_t nbytes = std::filesystem::file_size(filename, ec);
+    if (ec)
+        return false;
+#if defined(_WIN32)
+    FILE *fp = _wfopen(filename.c_str(), L"rb");
+#else
+    FILE *fp = fopen(filename.c_str(), "rb");
+#endif
+    if (!fp)
+        return false;
+    std::vector<uint8_t> mem(static_cast<size_t>(nbytes));
+    bool ok = fread(mem.data(), 1, mem.size(), fp) == mem.size();
+    fclose(fp);
+    if (!ok)
+        return false;
+
+    // Parse and check everything before touching the geometry, so that
+    // a bad file leaves it as it was and replay can't go wrong.
+    size_t at = 0;
+    auto get = [&](void *p, size_t n) {
+        if (mem.size() - at < n)
+            return false;
+        memcpy(p, mem.data() + at, n);
+        at += n;
+        return true;
+    };
+    uint32_t header[kJournalHeaderWords];
+    if (!get(header, sizeof(header)) || header[0] != kJournalMagic || header[1] != kJournalVersion)
+        return false;
+    if (header[4] > header[3] || (header[5] > 0 && header[5] != geometry_.shapes_.size()))
+        return false;
+
+    std::vector<size_t> steps(header[3]);
+    size_t previous = 0;
+    for (size_t& step : steps)
+    {
+        uint32_t end;
+        if (!get(&end, sizeof(end)) || end <= previous || end > header[2])
+            return false;
+        step = previous = end;
+    }
+    if (previous != header[2])
+        return false;
+
+    std::vector<Record> records(header[2]);
+    uint32_t inserted = header[5];
+    for (Record& record : records)
+    {
+        uint8_t type;
+        record = Record{};
+        if (!get(&type, sizeof(type)) || type > static_cast<uint8_t>(Type::Raise) ||
+            !get(&record.id, sizeof(record.id)) ||
+            !get(record.delta, delta_count(type) * sizeof(float)))
+            return false;
+        record.type = static_cast<Type>(type);
+        if (record.type == Type::Insert ? record.id != inserted++ : record.id >= inserted)
+            return false;
+    }
+
+    if (header[5] > 0)
+        rebase();
+    else
+        clear();
+    records_ = std::move(records);
+    steps_ = std::move(steps);
+    for (size_t step = 0; step < header[4]; ++step)
+    {
+        for (size_t i = applied_; i < steps_[step]; ++i)
+            apply(records_[i]);
+        applied_ = steps_[step];
+        ++cursor_;
+        maybe_snapshot();
+    }
+    geometry_.clearSelection();
+    return true;
+}
+
+#pragma warning(pop)
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "kgeometry.h"
+
+// Undo/redo history of the edits made to a KGeometry. Edits go through
+// the journal, which applies them and records each as a small delta:
+// an insert with its ellipse, a move by dx/dy, a scale by a factor, or
+// a raise to the top. Everything between two commit() calls is one
+// step, undone and redone as a whole; repeated moves or scales of one
+// ellipse within a step fold into a single record, so a mouse drag
+// costs one record rather than one per mouse message.
+//
+// Undoing a step reverts its records in reverse from the ellipses they
+// replaced, O(1) per record. A raise can't be reverted in place, so a
+// step holding one is undone by restoring the nearest snapshot before
+// it and replaying forward. Snapshots hold just each shape's ellipse
+// and id in drawing order, and are taken no more often than once per
+// max(kSnapshotInterval, shape count) records, which keeps both their
+// memory and the replay cost in proportion to the records.
+//
+// Files hold only the records, so their size follows the edits, not
+// the scene; load() replays them onto an empty geometry, which needs
+// no window and so also serves headless tests. A journal begun by
+// rebase() over a loaded scene replays onto that scene, loaded again.
+//
+// USAGE:
+//
+// KJournal journal{geometry};
+// journal.insert(KEllipseF{x, y, 0.f, 0.f});
+// journal.reshape(KEllipseF{x, y, rx, ry});
+// journal.commit();
+// journal.undo();
+// journal.save(L"drawing.kjournal");
+
+class KJournal
+{
+public:
+    static constexpr size_t kSnapshotInterval{64};
+
+    explicit KJournal(KGeometry& geometry);
+
+    // Edits of the selected ellipse, applied to the geometry at once;
+    // insert() adds an ellipse and selects it, and reshape() may only
+    // change an ellipse inserted in the open step.
+    void insert(const KEllipseF& ellipse);
+    void reshape(const KEllipseF& ellipse);
+    void move(float dx, float dy);
+    void scale(float factor);
+    void raise();
+
+    // Closes the open step, if any; undo() and redo() close it too.
+    void commit();
+    bool undo();
+    bool redo();
+
+    // Forgets the history and empties the geometry.
+    void clear();
+    // Forgets the history, and starts a new one from the geometry's
+    // ellipses as they are, e.g. after a scene has been loaded.
+    void rebase();
+
+    bool save(const std::filesystem::path& filename);
+    // Replaces the geometry with the saved one, with its history. A
+    // rebased journal needs its base scene in the geometry already.
+    bool load(const std::filesystem::path& filename);
+
+    size_t record_count() const;
+    size_t step_count() const;
+    size_t snapshot_count() const;
+
+private:
+    enum class Type : uint8_t
+    {
+        Insert,
+        Move,
+        Scale,
+        Raise,
+    };
+
+    struct Record
+    {
+        Type type;
+        uint32_t id;        // The n-th ellipse inserted.
+        float delta[4];     // Insert: cx, cy, rx, ry. Move: dx, dy. Scale: factor.
+        KEllipseF before;   // Set when applied, to revert to.
+    };
+
+    struct Snapshot
+    {
+        size_t records;     // Applied when it was taken.
+        std::vector<uint32_t> ids;
+        std::vector<KEllipseF> ellipses;
+    };
+
+    uint32_t selected_id() const;
+    Record *open_record();
+    void begin_edit();
+    void bind(uint32_t id, KShapeHandle handle);
+    void apply(Record& record);
+    void revert(const Record& record);
+    void restore(size_t records);
+    void maybe_snapshot();
+    void take_snapshot();
+
+    KGeometry& geometry_;
+    std::vector<Record> records_;
+    std::vector<size_t> steps_;             // Record count at the end of each step.
+    std::vector<Snapshot> snapshots_;
+    std::vector<KShapeHandle> handles_;     // By id; invalid while not inserted.
+    std::vector<uint32_t> ids_;             // By store slot.
+    size_t base_{};                         // Ellipses the history starts from.
+    size_t applied_{};                      // Records, including the open step.
+    size_t cursor_{};                       // Committed steps applied.
+};
+
+inline size_t KJournal::record_count() const { return records_.size(); }
+
+inline size_t KJournal::step_count() const { return steps_.size(); }
+
+inline size_t KJournal::snapshot_count() const { return snapshots_.size(); }
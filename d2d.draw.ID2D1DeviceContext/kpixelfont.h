@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// A 5x9 pixel font covering printable ASCII, built in so that text can
+// be drawn without a font file or a platform text API, e.g. headless.
+// Glyphs sit in a 6-pixel advance with the baseline under row 6.
+//
+// USAGE:
+//
+// const uint8_t *rows = pixel_font_glyph(L'A');
+// for (int y = 0; y < kPixelFontHeight; ++y)
+//     for (int x = 0; x < kPixelFontWidth; ++x)
+//         if (rows[y] & (0x10 >> x))
+//             plot(x, y);
+
+static const int kPixelFontWidth = 5;
+static const int kPixelFontHeight = 9;
+static const int kPixelFontAscent = 7;
+static const int kPixelFontAdvance = 6;
+static const int kPixelFontLineHeight = 11;
+
+// The rows of a glyph, top to bottom; '?' stands in for anything
+// outside printable ASCII.
+const uint8_t *pixel_font_glyph(uint32_t codepoint);
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include "ktextbatch.h"
+
+bool KTextBatch::layout(const std::wstring& text, KGlyphAtlas& atlas)
+{
+    shaped_lines_ = 0;
+    if (atlas.scale() != scale_)
+    {
+        lines_.clear();
+        scale_ = atlas.scale();
+    }
+    else if (text == text_)
+    {
+        return false;
+    }
+    text_ = text;
+
+    // A trailing newline ends the last line rather than starting one.
+    size_t line_count = 0;
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+        size_t end = std::min(text.find(L'\n', begin), text.size());
+        if (line_count == lines_.size())
+            lines_.push_back(Line{});
+        Line& line = lines_[line_count++];
+        if (line.text.compare(0, line.text.size(), text, begin, end - begin) != 0)
+        {
+            line.text.assign(text, begin, end - begin);
+            line.quads.clear();
+            float pen = 0.f;
+            for (wchar_t c : line.text)
+            {
+                const KGlyph& g = atlas.glyph(static_cast<uint32_t>(c));
+                if (c != L' ')
+                {
+                    line.quads.push_back(KGlyphQuad{pen, 0.f, pen + g.width, static_cast<float>(g.height),
+                                                    static_cast<float>(g.x), static_cast<float>(g.y),
+                                                    static_cast<float>(g.x + g.width), static_cast<float>(g.y + g.height)});
+                }
+                pen += g.advance;
+            }
+            line.width = pen;
+            ++shaped_lines_;
+        }
+        begin = end + 1;
+    }
+    lines_.resize(line_count);
+
+    quads_.clear();
+    width_ = 0.f;
+    float line_height = atlas.line_height();
+    for (size_t i = 0; i < lines_.size(); ++i)
+    {
+        float y = i * line_height;
+        for (KGlyphQuad q : lines_[i].quads)
+        {
+            q.y0 += y;
+            q.y1 += y;
+            quads_.push_back(q);
+        }
+        width_ = std::max(width_, lines_[i].width);
+    }
+    height_ = lines_.size() * line_height;
+    return true;
+}
+
+void KTextBatch::render(const KGlyphAtlas& atlas, uint8_t *coverage, int width, int height, int stride) const
+{
+    for (const KGlyphQuad& q : quads_)
+    {
+        int x0 = static_cast<int>(q.x0);
+        int y0 = static_cast<int>(q.y0);
+        int u0 = static_cast<int>(q.u0);
+        int v0 = static_cast<int>(q.v0);
+        int w = std::min(static_cast<int>(q.x1) - x0, width - x0);
+        int h = std::min(static_cast<int>(q.y1) - y0, height - y0);
+        for (int y = 0; y < h; ++y)
+        {
+            const uint8_t *in = atlas.texels() + static_cast<size_t>(v0 + y) * atlas.width() + u0;
+            uint8_t *out = coverage + static_cast<size_t>(y0 + y) * stride + x0;
+            for (int x = 0; x < w; ++x)
+                out[x] = std::max(out[x], in[x]);
+        }
+    }
+}
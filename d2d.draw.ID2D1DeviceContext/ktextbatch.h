@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "kglyphatlas.h"
+
+// Text laid out into quads over a KGlyphAtlas, one per visible glyph,
+// ready to be drawn in a single batch. layout() does nothing when the
+// string hasn't changed, and otherwise keeps the quads of every line
+// that is the same as before, so an overlay in which one line changes
+// now and then costs a string compare per frame.
+//
+// USAGE:
+//
+// KTextBatch batch;
+// if (batch.layout(text, atlas))
+//     batch.render(atlas, mask.data(), mask_width, mask_height, mask_width);
+// draw_mask(mask);
+
+// In texels: x and y from the top-left of the text block, u and v in the
+// atlas.
+struct KGlyphQuad
+{
+    float x0, y0, x1, y1;
+    float u0, v0, u1, v1;
+};
+
+class KTextBatch
+{
+public:
+    // Returns whether the quads changed.
+    bool layout(const std::wstring& text, KGlyphAtlas& atlas);
+
+    const std::vector<KGlyphQuad>& quads() const;
+    float width() const;
+    float height() const;
+
+    // Draws the quads, taking the larger coverage where they overlap,
+    // into an 8-bit image that the caller has cleared.
+    void render(const KGlyphAtlas& atlas, uint8_t *coverage, int width, int height, int stride) const;
+
+    // Lines laid out afresh by the last layout(), for statistics.
+    size_t shaped_lines() const;
+
+private:
+    struct Line
+    {
+        std::wstring text;
+        std::vector<KGlyphQuad> quads;  // With y from the line's top.
+        float width{};
+    };
+
+    std::wstring text_;
+    std::vector<Line> lines_;
+    std::vector<KGlyphQuad> quads_;
+    float width_{};
+    float height_{};
+    float scale_{};
+    size_t shaped_lines_{};
+};
+
+inline const std::vector<KGlyphQuad>& KTextBatch::quads() const { return quads_; }
+
+inline float KTextBatch::width() const { return width_; }
+
+inline float KTextBatch::height() const { return height_; }
+
+inline size_t KTextBatch::shaped_lines() const { return shaped_lines_; }
@@ -17,8 +17,14 @@ KTextOverlay::~KTextOverlay()
 {
 }
 
+// The text only changes with the mode, so it is left alone otherwise.
 void KTextOverlay::Update()
 {
+    if (!text.empty() && modeText == shownModeText)
+    {
+        return;
+    }
+    shownModeText = modeText;
     text = L"Current mode: " + modeText + L"\n" + kMsgText;
 }
 
@@ -24,13 +24,17 @@ private:
     std::wstring kMsgText{L"Press M to toggle DRAW/EDIT mode.\n"
                           L"Left-click + drag mouse to draw ellipse in DRAW mode.\n"
                           L"Left-click + drag mouse to move ellipse in EDIT mode.\n"
-                          L"Roll mouse-wheel to resize an ellipse in EDIT mode.\n"};
+                          L"Roll mouse-wheel to resize an ellipse in EDIT mode.\n"
+                          L"Press B to toggle batched rendering.\n"
+                          L"Press Ctrl+Z/Ctrl+Y to undo/redo, Ctrl+S/Ctrl+O to save/load.\n"
+                          L"Add Shift to save/load the undo history instead.\n"};
     ///////////////////////////////////////////////////////////////////////////////////////////
 
     ///////////////////////////////////////////////////////////////////////////////////////////
     // Text layout variables.
     ///////////////////////////////////////////////////////////////////////////////////////////
     const float kSeparator{10.f};
+    std::wstring shownModeText{};
     float boxWidth{1.f};
     float boxHeight{1.f};
     D2D1_POINT_2F boxTopLeftPoint{0.f, 0.f};
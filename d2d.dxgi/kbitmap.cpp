@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstdint>
 #include "kbitmap.h"
 
 KBitmap::KBitmap(int width, int height) : width_{width}, height_{height}
@@ -17,3 +19,101 @@ void KBitmap::draw(KScene& scene)
 {
     put_pixel(static_cast<int>(scene.x_), static_cast<int>(scene.y_), 0x00000000);    
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Dirty-rectangle tracking.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static int64_t area(const KRect& r)
+{
+    return static_cast<int64_t>(r.width) * r.height;
+}
+
+static KRect bounding_rect(const KRect& a, const KRect& b)
+{
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.width, b.x + b.width);
+    int y1 = std::max(a.y + a.height, b.y + b.height);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+static bool contains(const KRect& outer, const KRect& inner)
+{
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+void KBitmap::mark_dirty(int x, int y, int width, int height)
+{
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + width, width_);
+    int y1 = std::min(y + height, height_);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    KRect rect{x0, y0, x1 - x0, y1 - y0};
+
+    for (const KRect& r : dirty_)
+        if (contains(r, rect))
+            return;
+
+    // Absorb every rectangle that the new one covers or that it can be
+    // merged with for at most a quarter more area than the two cover
+    // separately; repeat, since a merge can reach further rectangles.
+    for (bool merged = true; merged;)
+    {
+        merged = false;
+        for (size_t i = 0; i < dirty_.size(); ++i)
+        {
+            KRect bounds = bounding_rect(dirty_[i], rect);
+            if (4 * area(bounds) <= 5 * (area(dirty_[i]) + area(rect)))
+            {
+                rect = bounds;
+                dirty_[i] = dirty_.back();
+                dirty_.pop_back();
+                merged = true;
+                break;
+            }
+        }
+    }
+    dirty_.push_back(rect);
+
+    // Over budget: merge the pair that wastes the least area.
+    while (dirty_.size() > static_cast<size_t>(kMaxDirtyRects))
+    {
+        size_t best_i = 0;
+        size_t best_j = 1;
+        int64_t best_waste = INT64_MAX;
+        for (size_t i = 0; i < dirty_.size(); ++i)
+        {
+            for (size_t j = i + 1; j < dirty_.size(); ++j)
+            {
+                int64_t waste = area(bounding_rect(dirty_[i], dirty_[j])) - area(dirty_[i]) - area(dirty_[j]);
+                if (waste < best_waste)
+                {
+                    best_waste = waste;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        dirty_[best_i] = bounding_rect(dirty_[best_i], dirty_[best_j]);
+        dirty_[best_j] = dirty_.back();
+        dirty_.pop_back();
+    }
+}
+
+void KBitmap::mark_all_dirty()
+{
+    dirty_.assign(1, KRect{0, 0, width_, height_});
+}
+
+size_t KBitmap::dirty_bytes() const
+{
+    int64_t total = 0;
+    for (const KRect& r : dirty_)
+        total += area(r);
+    return static_cast<size_t>(total) * bytes_per_pixel_;
+}
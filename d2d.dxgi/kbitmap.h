@@ -1,7 +1,16 @@
 #pragma once
 
+#include <vector>
 #include "kscene.h"
 
+struct KRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
 class KBitmap
 {
 public:
@@ -18,6 +27,17 @@ public:
     int size();
     uint32_t* data();
     void draw(KScene& scene);
+
+    // Every drawing operation records the area it touched, so that the
+    // surface can upload only what changed since the last upload.
+    // Nearby rectangles are coalesced and the list never grows past
+    // kMaxDirtyRects; merging may over-cover, but never under-covers.
+    static const int kMaxDirtyRects{16};
+    void mark_dirty(int x, int y, int width, int height);
+    void mark_all_dirty();
+    void clear_dirty();
+    const std::vector<KRect>& dirty_rects() const;
+    size_t dirty_bytes() const;
     
 private:
     int width_{100};
@@ -26,6 +46,7 @@ private:
     int stride_{};
     int size_{};
     uint32_t *mem_{};
+    std::vector<KRect> dirty_;
 };
 
 inline int KBitmap::width() { return width_; }
@@ -38,9 +59,14 @@ inline int KBitmap::size() { return size_; }
 
 inline uint32_t* KBitmap::data() { return mem_; }
 
+inline const std::vector<KRect>& KBitmap::dirty_rects() const { return dirty_; }
+
+inline void KBitmap::clear_dirty() { dirty_.clear(); }
+
 inline void KBitmap::put_pixel(int x, int y, uint32_t color)
 {
     mem_[y * width_ + x] = color;
+    mark_dirty(x, y, 1, 1);
 }
 
 inline void KBitmap::clear(uint32_t color)
@@ -52,4 +78,5 @@ inline void KBitmap::clear(uint32_t color)
             mem_[y * width_ + x] = color;
         }
     }
+    mark_all_dirty();
 }
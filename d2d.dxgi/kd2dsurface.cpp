@@ -130,11 +130,32 @@ void KD2DSurface::create_device_dependent_resources()
                                           &d2d1_device_context_);
     assert(SUCCEEDED(hr));
     SafeRelease(&d2d1_device);
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Create the canvas-bitmap that mirrors kbitmap. Flip-model back
+    // buffers don't keep what was drawn into them two frames ago, so
+    // partial uploads go into the canvas, which does, and the canvas is
+    // drawn to the back buffer every frame.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    D2D1_BITMAP_PROPERTIES1 d2d1_canvas_bitmap_prop = D2D1::BitmapProperties1(
+        D2D1_BITMAP_OPTIONS_NONE,
+        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE),
+        96.0f,
+        96.0f);
+    hr = d2d1_device_context_->CreateBitmap(D2D1::SizeU(kbitmap.width(), kbitmap.height()),
+                                            kbitmap.data(),
+                                            kbitmap.stride(),
+                                            &d2d1_canvas_bitmap_prop,
+                                            &d2d1_canvas_bitmap_);
+    assert(SUCCEEDED(hr));
+    kbitmap.clear_dirty();      // The new canvas starts out with all of it.
 }
 
 void KD2DSurface::discard_device_dependent_resources()
 {
     SafeRelease(&d2d1_dxgi_bitmap_);
+    SafeRelease(&d2d1_canvas_bitmap_);
     SafeRelease(&d2d1_device_context_);
     SafeRelease(&dxgi_swap_chain_);
     SafeRelease(&d3d11_device_);
@@ -174,15 +195,43 @@ void KD2DSurface::render()
     kbitmap.draw(scene);
 
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Copy the bitmap contents from memory to the target-bitmap.
+    // Copy the parts of the bitmap that changed since the last frame
+    // from memory to the canvas-bitmap.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    for (const KRect& r : kbitmap.dirty_rects())
+    {
+        D2D1_RECT_U dirty_rect = D2D1::RectU(r.x, r.y, r.x + r.width, r.y + r.height);
+        hr = d2d1_canvas_bitmap_->CopyFromMemory(&dirty_rect,
+                                                 kbitmap.data() + r.y * kbitmap.width() + r.x,
+                                                 kbitmap.stride());
+        assert(SUCCEEDED(hr));
+    }
+    kbitmap.clear_dirty();
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Draw the canvas-bitmap to the target-bitmap; a GPU copy.
     ///////////////////////////////////////////////////////////////////////////////////////////
-    D2D1_POINT_2U dest_point = D2D1::Point2U((surface_width_  - kbitmap.width()) / 2,
-                                             (surface_height_ - kbitmap.height()) / 2);
-    D2D1_RECT_U dest_rect = D2D1::RectU(dest_point.x,
+    D2D1_POINT_2F dest_point = D2D1::Point2F(static_cast<float>((surface_width_  - kbitmap.width()) / 2),
+                                             static_cast<float>((surface_height_ - kbitmap.height()) / 2));
+    D2D1_RECT_F dest_rect = D2D1::RectF(dest_point.x,
                                         dest_point.y,
                                         dest_point.x + kbitmap.width(),
                                         dest_point.y + kbitmap.height());
-    hr = d2d1_dxgi_bitmap_->CopyFromMemory(&dest_rect, kbitmap.data(), kbitmap.stride());
+    d2d1_device_context_->BeginDraw();
+    d2d1_device_context_->DrawBitmap(d2d1_canvas_bitmap_,
+                                     &dest_rect,
+                                     1.0f,
+                                     D2D1_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
+                                     nullptr,
+                                     nullptr);
+    hr = d2d1_device_context_->EndDraw();
+    if (hr == D2DERR_RECREATE_TARGET)
+    {
+        discard_device_dependent_resources();
+        device_lost_ = true;
+        return;
+    }
     assert(SUCCEEDED(hr));
     ///////////////////////////////////////////////////////////////////////////////////////////
 
@@ -41,6 +41,7 @@ protected:
     ID2D1Factory2 *d2d1_factory_{};
     ID2D1DeviceContext *d2d1_device_context_{};
     ID2D1Bitmap1 *d2d1_dxgi_bitmap_{};
+    ID2D1Bitmap1 *d2d1_canvas_bitmap_{};
     IDXGISwapChain1 *dxgi_swap_chain_{};
 
     UINT d3d11_runtime_layers_{D3D11_CREATE_DEVICE_BGRA_SUPPORT};
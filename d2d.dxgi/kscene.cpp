@@ -1,14 +1,13 @@
+#include "kbounce.h"
 #include "kscene.h"
 
-KScene::KScene(int width, int height) :
+KScene::KScene(int width, int height, uint32_t seed) :
     width_{width},
     height_{height},
     x_{static_cast<float>(width) / 2.f},
     y_{static_cast<float>(height) / 2.f},
-    rng{rdev()},
-    rdist{std::uniform_int_distribution<int>(1, 9)}
+    seed_{seed}
 {
-    
 }
 
 KScene::~KScene()
@@ -17,40 +16,22 @@ KScene::~KScene()
 
 void KScene::update()
 {
+    const float width = static_cast<float>(width_);
+    const float height = static_cast<float>(height_);
+    ++step_;
     x_ += dx_;
     y_ += dy_;
 
-    if (x_ >= static_cast<float>(width_) || x_ <= 0.f)
+    // A hit comes once in a hundred steps or so, which keeps the branch
+    // well predicted and the draw off the common path.
+    bool hit_x = bounces(x_, width);
+    bool hit_y = bounces(y_, height);
+    if (hit_x | hit_y)
     {
-        x_ = std::clamp<float>(x_, 0.f, static_cast<float>(width_) -1.f);
-        float switch_direction = signbit(dx_) ? 1.f : -1.f;
-        dx_ = switch_direction * cosine_of_random_deflection_angle_delta() * speed_;
+        uint32_t h = bounce_draw(0, bounce_key(seed_, step_));
+        if (hit_x)
+            reflect(x_, dx_, width, kDeflectionCos[deflection_x(h)], speed_);
+        if (hit_y)
+            reflect(y_, dy_, height, kDeflectionSin[deflection_y(h)], speed_);
     }
-
-    if (y_ >= static_cast<float>(height_) || y_ <= 0.f)
-    {
-        y_ = std::clamp<float>(y_, 0.f, static_cast<float>(height_) - 1.f);
-        float switch_direction = signbit(dy_) ? 1.f : -1.f;
-        dy_ = switch_direction * sine_of_random_deflection_angle_delta() * speed_;
-    }
-}
-
-// cos(k * 1/10 * pi/2), where k in [1, 9].
-// k != 10 to ensure we don't return a zero.
-inline float KScene::cosine_of_random_deflection_angle_delta()
-{
-    static const float half_pi = 3.141592f / 2;
-    static const float delta = half_pi / 10.0f;
-    int k = rdist(rng);
-    return cosf(static_cast<float>(k) * delta);
-}
-
-// sin(k * 1/10 * pi/2), where k in [1, 9].
-// k != 10 to ensure we don't return a zero.
-inline float KScene::sine_of_random_deflection_angle_delta()
-{
-    static const float half_pi = 3.141592f / 2;
-    static const float delta = half_pi / 10.0f;
-    int k = rdist(rng);
-    return sinf(static_cast<float>(k) * delta);
 }
@@ -1,15 +1,15 @@
 #pragma once
 
-#include <random>
+#include <cstdint>
 
+// A point bouncing around a box, as described in kbounce.h. Runs are
+// reproducible: the same seed gives the same motion.
 class KScene
 {
 public:
-    KScene(int width, int height);
+    KScene(int width, int height, uint32_t seed = 1);
     ~KScene();
     void update();
-    float cosine_of_random_deflection_angle_delta();
-    float sine_of_random_deflection_angle_delta();
 
     float x_{};
     float y_{};
@@ -20,8 +20,6 @@ private:
     float dx_{1.f};
     float dy_{1.f};
     float speed_{1.f};
-
-    std::random_device rdev{};
-    std::mt19937 rng;
-    std::uniform_int_distribution<int> rdist;
+    uint32_t seed_{1};
+    uint64_t step_{};
  };
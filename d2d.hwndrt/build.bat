@@ -3,12 +3,13 @@
 set COMMON_COMPILER_FLAGS=/nologo /EHa- /GR- /fp:fast /Oi /W4 /Fm /std:c++17
 set DEBUG_FLAGS=/DDEBUG_BUILD /Od /MTd /Zi
 set PREPROCESSOR_DEFS=/DUNICODE /DNOMINMAX
+set INCLUDE_DIRS=/I..\kcore
 set RELEASE_FLAGS=/O2
-set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %DEBUG_FLAGS% %PREPROCESSOR_DEFS%
+set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %DEBUG_FLAGS% %PREPROCESSOR_DEFS% %INCLUDE_DIRS%
 REM set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %RELEASE_FLAGS%
 set LINKER_FLAGS=/INCREMENTAL:NO /opt:ref
 set SYSTEM_LIBS=kernel32.lib user32.lib gdi32.lib winmm.lib ole32.lib d2d1.lib dwrite.lib
-set LOCAL_LIBS=kwindow.lib
-set SRC=kdraw.cpp kd2dsurface.cpp kdrawingengine.cpp kbitmap.cpp kscene.cpp kclock.cpp
+set LOCAL_LIBS=kwindow.lib ..\kcore\kcore.lib
+set SRC=kdraw.cpp kd2dsurface.cpp kdrawingengine.cpp ktiledbitmap.cpp kpath.cpp krasterizer.cpp
 cl %COMPILER_FLAGS% %SRC% /link %LINKER_FLAGS% %SYSTEM_LIBS% %LOCAL_LIBS%
 echo Done
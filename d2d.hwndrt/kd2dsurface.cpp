@@ -1,5 +1,6 @@
 #include <cassert>
 #include <cmath>
+#include <cwchar>
 #include <random>
 #include <algorithm>
 #include "kd2dsurface.h"
@@ -8,7 +9,7 @@ KD2DSurface::KD2DSurface(HWND hwnd, int width, int height)
     : hwnd_{hwnd},
       surface_size_{static_cast<uint32_t>(width), static_cast<uint32_t>(height)},
       kbitmap_{128, 128},
-      scene_{128, 128}
+      scene_{128, 128, 2048}
 {
     create_device_independent_resources();
     create_device_dependent_resources();
@@ -76,6 +77,7 @@ void KD2DSurface::create_render_target_resources()
                                bp,
                                &d2d1_bitmap_);
     assert(SUCCEEDED(hr));
+    kbitmap_.clear_dirty();     // The new bitmap starts out with all of it.
 }
 
 void KD2DSurface::discard_render_target_resources()
@@ -149,11 +151,8 @@ void KD2DSurface::discard_text_resources()
 void KD2DSurface::render()
 {
     static double text_update_interval{};
-    double dt{};
-    double elapsed_time = clock_.time(&dt);
-    elapsed_time /= 1E6;
-    dt /= 1E6;
-    double fps = 1.f / dt;
+    double dt = clock_.tick();
+    double elapsed_time = clock_.t;
     text_update_interval += dt;
     
     HRESULT hr = S_OK;
@@ -161,11 +160,18 @@ void KD2DSurface::render()
     kbitmap_.draw(scene_);
 
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Copy the bitmap contents from memory to the Direct2D bitmap.
+    // Copy the parts of the bitmap that changed since the last frame
+    // from memory to the Direct2D bitmap, which keeps the rest.
     ///////////////////////////////////////////////////////////////////////////////////////////
-    D2D1_RECT_U dest_rect = D2D1::RectU(0, 0, kbitmap_.width(), kbitmap_.height());
-    hr = d2d1_bitmap_->CopyFromMemory(&dest_rect, kbitmap_.data(), kbitmap_.stride());
-    assert(SUCCEEDED(hr));
+    for (const KRect& r : kbitmap_.dirty_rects())
+    {
+        D2D1_RECT_U dest_rect = D2D1::RectU(r.x, r.y, r.x + r.width, r.y + r.height);
+        hr = d2d1_bitmap_->CopyFromMemory(&dest_rect,
+                                          kbitmap_.data() + r.y * kbitmap_.width() + r.x,
+                                          kbitmap_.stride());
+        assert(SUCCEEDED(hr));
+    }
+    kbitmap_.clear_dirty();
     ///////////////////////////////////////////////////////////////////////////////////////////
 
     ///////////////////////////////////////////////////////////////////////////////////////////
@@ -192,11 +198,16 @@ void KD2DSurface::render()
     ///////////////////////////////////////////////////////////////////////////////////////////
     // Compose the text.
     ///////////////////////////////////////////////////////////////////////////////////////////
-    static std::wstring text2{L"FPS = " + std::to_wstring(fps)};
-    if (text_update_interval > 1.f)
+    static std::wstring text2{};
+    if (text_update_interval > 1.f || text2.empty())
     {
         text_update_interval = 0.f;
-        text2 = L"FPS = " + std::to_wstring(fps);
+        KFrameSummary frames = clock_.frame_stats().summary();
+        wchar_t line[128];
+        swprintf(line, 128, L"FPS = %.0f, frame min/avg/p99 = %.2f/%.2f/%.2f ms",
+                 frames.avg_ms > 0.0 ? 1000.0 / frames.avg_ms : 0.0,
+                 frames.min_ms, frames.avg_ms, frames.p99_ms);
+        text2 = line;
     }
     std::wstring text1{L"Elapsed time: " + std::to_wstring(elapsed_time) + L" s\n"};
     std::wstring text{text1 + text2};
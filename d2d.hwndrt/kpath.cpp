@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cmath>
+#include "kpath.h"
+
+static const float kPi = 3.14159265f;
+
+void KPath::move_to(float x, float y)
+{
+    contours_.push_back(Contour{static_cast<int>(points_.size()), 1, false});
+    points_.push_back(KPointF{x, y});
+}
+
+void KPath::line_to(float x, float y)
+{
+    if (contours_.empty() || contours_.back().closed)
+    {
+        move_to(x, y);
+        return;
+    }
+    points_.push_back(KPointF{x, y});
+    ++contours_.back().count;
+}
+
+void KPath::close()
+{
+    if (!contours_.empty())
+        contours_.back().closed = true;
+}
+
+void KPath::clear()
+{
+    points_.clear();
+    contours_.clear();
+}
+
+void KPath::add_rect(float x, float y, float width, float height)
+{
+    move_to(x, y);
+    line_to(x + width, y);
+    line_to(x + width, y + height);
+    line_to(x, y + height);
+    close();
+}
+
+void KPath::add_ellipse(float cx, float cy, float rx, float ry, float tolerance)
+{
+    float r = std::max(rx, ry);
+    if (r <= 0.f)
+        return;
+
+    // A chord spanning angle a strays r * (1 - cos(a / 2)) from the arc.
+    int n = 8;
+    if (tolerance < r)
+    {
+        float max_angle = 2.f * std::acos(1.f - tolerance / r);
+        n = std::clamp(static_cast<int>(std::ceil(2.f * kPi / max_angle)), 8, 4096);
+    }
+    move_to(cx + rx, cy);
+    for (int i = 1; i < n; ++i)
+    {
+        float a = 2.f * kPi * i / n;
+        line_to(cx + rx * std::cos(a), cy + ry * std::sin(a));
+    }
+    close();
+}
+
+void KPath::add_polygon(const KPointF *points, int count)
+{
+    if (count <= 0)
+        return;
+    move_to(points[0].x, points[0].y);
+    for (int i = 1; i < count; ++i)
+        line_to(points[i].x, points[i].y);
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Stroking.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// The stroke of a polyline is one contour running up its left side
+// and back down its right, or for a closed polyline a ring of two
+// contours wound opposite ways. Each side is the segments' offset
+// lines, joined on the outside of a turn by a bevel and on the inside
+// where the offset lines meet, so that no part of the stroke is covered
+// twice along its edges.
+
+struct Segment
+{
+    KPointF p;
+    KPointF q;
+    KPointF d;      // Unit direction.
+    float length;
+};
+
+static float cross(KPointF a, KPointF b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static float dot(KPointF a, KPointF b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+static KPointF offset_point(KPointF p, KPointF d, float offset)
+{
+    return KPointF{p.x - d.y * offset, p.y + d.x * offset};
+}
+
+// Appends the join at p between segments a and b to the side that lies
+// offset to the left of the path (right if negative).
+static void add_join(std::vector<KPointF>& side, const Segment& a, const Segment& b, float offset)
+{
+    float turn = cross(a.d, b.d);
+    float cosine = dot(a.d, b.d);
+    KPointF p = b.p;
+    if (std::fabs(turn) <= 1e-6f && cosine > 0.f)
+    {
+        side.push_back(offset_point(p, b.d, offset));
+        return;
+    }
+
+    bool inner = (turn > 0.f) == (offset > 0.f);
+    if (inner && cosine > -0.999f)
+    {
+        // The offset lines cross hw * tan(angle / 2) from p, which has
+        // to lie on both segments.
+        float reach = std::fabs(offset * turn / (1.f + cosine));
+        if (reach <= std::min(a.length, b.length))
+        {
+            float k = offset / (1.f + cosine);
+            side.push_back(KPointF{p.x - (a.d.y + b.d.y) * k, p.y + (a.d.x + b.d.x) * k});
+            return;
+        }
+    }
+    side.push_back(offset_point(p, a.d, offset));
+    if (inner)
+        side.push_back(p);
+    side.push_back(offset_point(p, b.d, offset));
+}
+
+static void stroke_side(std::vector<KPointF>& side, const std::vector<Segment>& segments, bool closed, float offset)
+{
+    side.clear();
+    size_t count = segments.size();
+    if (!closed)
+        side.push_back(offset_point(segments[0].p, segments[0].d, offset));
+    for (size_t i = closed ? 0 : 1; i < count; ++i)
+        add_join(side, segments[(i + count - 1) % count], segments[i], offset);
+    if (!closed)
+        side.push_back(offset_point(segments[count - 1].q, segments[count - 1].d, offset));
+}
+
+static void stroke_polyline(KPath& outline, const std::vector<KPointF>& points, bool closed, float half_width)
+{
+    std::vector<Segment> segments;
+    for (size_t i = 0; i + 1 < points.size(); ++i)
+    {
+        KPointF p = points[i];
+        KPointF q = points[i + 1];
+        float length = std::hypot(q.x - p.x, q.y - p.y);
+        if (length > 1e-6f)
+            segments.push_back(Segment{p, q, KPointF{(q.x - p.x) / length, (q.y - p.y) / length}, length});
+    }
+    if (segments.empty())
+        return;
+
+    std::vector<KPointF> left;
+    std::vector<KPointF> right;
+    stroke_side(left, segments, closed, half_width);
+    stroke_side(right, segments, closed, -half_width);
+    std::reverse(right.begin(), right.end());
+    if (closed)
+    {
+        outline.add_polygon(left.data(), static_cast<int>(left.size()));
+        outline.add_polygon(right.data(), static_cast<int>(right.size()));
+    }
+    else
+    {
+        left.insert(left.end(), right.begin(), right.end());
+        outline.add_polygon(left.data(), static_cast<int>(left.size()));
+    }
+}
+
+static KPointF lerp(KPointF a, KPointF b, float t)
+{
+    return KPointF{a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+}
+
+// Splits a polyline into the dashes that are on.
+static void dash_polyline(KPath& outline, const std::vector<KPointF>& points,
+                          const std::vector<float>& pattern, float total, float offset, float half_width)
+{
+    size_t index = 0;
+    float phase = std::fmod(offset, total);
+    if (phase < 0.f)
+        phase += total;
+    while (phase >= pattern[index])
+    {
+        phase -= pattern[index];
+        index = (index + 1) % pattern.size();
+    }
+    float remaining = pattern[index] - phase;
+    bool on = (index % 2 == 0);
+
+    std::vector<KPointF> dash;
+    if (on)
+        dash.push_back(points[0]);
+    for (size_t i = 0; i + 1 < points.size(); ++i)
+    {
+        KPointF a = points[i];
+        KPointF b = points[i + 1];
+        float length = std::hypot(b.x - a.x, b.y - a.y);
+        float pos = 0.f;
+        while (length - pos > remaining)
+        {
+            pos += remaining;
+            KPointF p = lerp(a, b, pos / length);
+            if (on)
+            {
+                dash.push_back(p);
+                stroke_polyline(outline, dash, false, half_width);
+                dash.clear();
+            }
+            else
+            {
+                dash.assign(1, p);
+            }
+            on = !on;
+            index = (index + 1) % pattern.size();
+            remaining = pattern[index];
+        }
+        remaining -= length - pos;
+        if (on)
+            dash.push_back(b);
+    }
+    if (on)
+        stroke_polyline(outline, dash, false, half_width);
+}
+
+KPath KPath::stroke(const KStrokeStyle& style) const
+{
+    KPath outline;
+    float half_width = style.width / 2.f;
+    if (half_width <= 0.f)
+        return outline;
+
+    std::vector<float> pattern;
+    float total = 0.f;
+    for (float dash : style.dashes)
+    {
+        pattern.push_back(std::max(dash, 0.f) * style.width);
+        total += pattern.back();
+    }
+
+    std::vector<KPointF> polyline;
+    for (const Contour& contour : contours_)
+    {
+        polyline.assign(points_.begin() + contour.first, points_.begin() + contour.first + contour.count);
+        if (contour.closed)
+            polyline.push_back(polyline.front());
+        if (total > 0.f)
+        {
+            dash_polyline(outline, polyline, pattern, total, style.dash_offset * style.width, half_width);
+        }
+        else
+        {
+            stroke_polyline(outline, polyline, contour.closed, half_width);
+        }
+    }
+    return outline;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+struct KPointF
+{
+    float x;
+    float y;
+};
+
+// Dash lengths are in multiples of the stroke width, as with
+// D2D1_DASH_STYLE_CUSTOM, so {5, 3} is the dash pattern the D2D samples
+// draw their bounding boxes with. No dashes draws a solid line. Caps are
+// flat and joins beveled.
+struct KStrokeStyle
+{
+    float width{1.f};
+    std::vector<float> dashes;
+    float dash_offset{0.f};
+};
+
+// A path of straight-line contours, the input to KRasterizer. Curves
+// are flattened into line segments as they're added, to within
+// tolerance pixels of the true curve. Filling treats every contour as
+// closed; stroking draws the closing segment only for contours ended
+// with close().
+//
+// USAGE:
+//
+// KPath path;
+// path.add_ellipse(64.f, 64.f, 40.f, 20.f);
+// path.move_to(10.f, 10.f);
+// path.line_to(100.f, 30.f);
+// path.line_to(50.f, 90.f);
+// path.close();
+// KPath outline = path.stroke(KStrokeStyle{2.f, {5.f, 3.f}});
+
+class KPath
+{
+public:
+    struct Contour
+    {
+        int first;
+        int count;
+        bool closed;
+    };
+
+    void move_to(float x, float y);
+    void line_to(float x, float y);
+    void close();
+    void clear();
+
+    void add_rect(float x, float y, float width, float height);
+    void add_ellipse(float cx, float cy, float rx, float ry, float tolerance = 0.1f);
+    void add_polygon(const KPointF *points, int count);
+
+    // The outline of the stroke, as a path to be filled.
+    KPath stroke(const KStrokeStyle& style) const;
+
+    const std::vector<KPointF>& points() const;
+    const std::vector<Contour>& contours() const;
+
+private:
+    std::vector<KPointF> points_;
+    std::vector<Contour> contours_;
+};
+
+inline const std::vector<KPointF>& KPath::points() const { return points_; }
+
+inline const std::vector<KPath::Contour>& KPath::contours() const { return contours_; }
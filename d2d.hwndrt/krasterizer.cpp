@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "krasterizer.h"
+#include "kparallel.h"
+#include "kraster.h"
+
+// Accumulation cells hold area in 16.16 fixed point, so that the
+// running sum is exact whatever order it is added up in.
+static const float kOne = 65536.f;
+
+static inline void add_area(int32_t *cell, float area)
+{
+    *cell += static_cast<int32_t>(std::lround(area * kOne));
+}
+
+KRasterizer::KRasterizer(int width, int height) : width_{width}, height_{height}
+{
+}
+
+void KRasterizer::reset()
+{
+    edges_.clear();
+    shapes_.clear();
+}
+
+void KRasterizer::fill(const KPath& path, uint32_t color)
+{
+    Shape shape{color, edges_.size(), 0, 0, 0, 0, 0};
+    const std::vector<KPointF>& points = path.points();
+    for (const KPath::Contour& contour : path.contours())
+    {
+        for (int i = 0; i < contour.count; ++i)
+        {
+            KPointF a = points[contour.first + i];
+            KPointF b = points[contour.first + (i + 1) % contour.count];
+            add_edge(a, b);
+        }
+    }
+    shape.edge_count = edges_.size() - shape.first_edge;
+    if (shape.edge_count == 0)
+        return;
+
+    float min_x = static_cast<float>(width_);
+    float min_y = static_cast<float>(height_);
+    float max_x = 0.f;
+    float max_y = 0.f;
+    for (size_t i = shape.first_edge; i < edges_.size(); ++i)
+    {
+        const Edge& e = edges_[i];
+        min_x = std::min({min_x, e.x0, e.x1});
+        max_x = std::max({max_x, e.x0, e.x1});
+        min_y = std::min({min_y, e.y0, e.y1});
+        max_y = std::max({max_y, e.y0, e.y1});
+    }
+    shape.x0 = static_cast<int>(min_x);
+    shape.x1 = std::min(static_cast<int>(std::ceil(max_x)) + 1, width_);
+    shape.y0 = std::max(static_cast<int>(std::floor(min_y)), 0);
+    shape.y1 = std::min(static_cast<int>(std::ceil(max_y)), height_);
+    if (shape.x0 >= shape.x1 || shape.y0 >= shape.y1)
+    {
+        edges_.resize(shape.first_edge);
+        return;
+    }
+    shapes_.push_back(shape);
+}
+
+void KRasterizer::stroke(const KPath& path, const KStrokeStyle& style, uint32_t color)
+{
+    fill(path.stroke(style), color);
+}
+
+// Clips an edge to the bitmap's left and right borders. The part beyond
+// the left border still changes the winding of everything to its right,
+// so it is kept, flattened onto x = 0; the part beyond the right border
+// affects nothing visible and is flattened onto x = width.
+void KRasterizer::add_edge(KPointF a, KPointF b)
+{
+    if (a.y == b.y)
+        return;     // Horizontal edges cover no area.
+
+    float right = static_cast<float>(width_);
+    KPointF pieces[4] = {a};
+    int n = 1;
+    float t[2];
+    int crossings = 0;
+    for (float border : {0.f, right})
+    {
+        if ((a.x < border) != (b.x < border) && a.x != b.x)
+            t[crossings++] = (border - a.x) / (b.x - a.x);
+    }
+    if (crossings == 2 && t[0] > t[1])
+        std::swap(t[0], t[1]);
+    for (int i = 0; i < crossings; ++i)
+        pieces[n++] = KPointF{a.x + (b.x - a.x) * t[i], a.y + (b.y - a.y) * t[i]};
+    pieces[n++] = b;
+
+    for (int i = 0; i + 1 < n; ++i)
+    {
+        KPointF p = pieces[i];
+        KPointF q = pieces[i + 1];
+        edges_.push_back(Edge{std::clamp(p.x, 0.f, right), p.y, std::clamp(q.x, 0.f, right), q.y});
+    }
+}
+
+// Adds the area an edge covers, within rows [band_y0, band_y1), to the
+// band's accumulation buffer. Each row of the buffer is stride cells,
+// wide enough for edges at x = width to spill two cells right.
+static void accumulate_edge(int32_t *acc, int stride, int band_y0, int band_y1, float width,
+                            float x0, float y0, float x1, float y1)
+{
+    float dir = 1.f;
+    if (y0 > y1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1.f;
+    }
+    float top = std::max(y0, static_cast<float>(band_y0));
+    float bottom = std::min(y1, static_cast<float>(band_y1));
+    if (top >= bottom)
+        return;
+
+    float dxdy = (x1 - x0) / (y1 - y0);
+    float x = x0 + (top - y0) * dxdy;
+    int row_end = static_cast<int>(std::ceil(bottom));
+    for (int y = static_cast<int>(top); y < row_end; ++y)
+    {
+        int32_t *line = acc + (y - band_y0) * stride;
+        float dy = std::min(static_cast<float>(y + 1), bottom) - std::max(static_cast<float>(y), top);
+        float x_next = x + dxdy * dy;
+        float d = dy * dir;
+        float left = std::clamp(std::min(x, x_next), 0.f, width);
+        float right = std::clamp(std::max(x, x_next), 0.f, width);
+        float left_floor = std::floor(left);
+        int xl = static_cast<int>(left_floor);
+        int xr = static_cast<int>(std::ceil(right));
+
+        if (xr <= xl + 1)
+        {
+            // Within one pixel: split d by where the edge crosses it.
+            float mid = 0.5f * (left + right) - left_floor;
+            add_area(line + xl, d - d * mid);
+            add_area(line + xl + 1, d * mid);
+        }
+        else
+        {
+            // Across several: a triangle in the first and last pixel, an
+            // equal share of d in each one between.
+            float s = 1.f / (right - left);
+            float fl = left - left_floor;
+            float a0 = 0.5f * s * (1.f - fl) * (1.f - fl);
+            float fr = right - static_cast<float>(xr) + 1.f;
+            float am = 0.5f * s * fr * fr;
+            add_area(line + xl, d * a0);
+            if (xr == xl + 2)
+            {
+                add_area(line + xl + 1, d * (1.f - a0 - am));
+            }
+            else
+            {
+                float a1 = s * (1.5f - fl);
+                add_area(line + xl + 1, d * (a1 - a0));
+                for (int xi = xl + 2; xi < xr - 1; ++xi)
+                    add_area(line + xi, d * s);
+                float a2 = a1 + static_cast<float>(xr - xl - 3) * s;
+                add_area(line + xr - 1, d * (1.f - a2 - am));
+            }
+            add_area(line + xr, d * am);
+        }
+        x = x_next;
+    }
+}
+
+void KRasterizer::render_band(KBitmap& bitmap, int band, int32_t *acc, uint8_t *coverage) const
+{
+    int stride = width_ + 2;
+    int band_y0 = band * kBandHeight;
+    int band_y1 = std::min(band_y0 + kBandHeight, height_);
+    float width = static_cast<float>(width_);
+    for (const Shape& shape : shapes_)
+    {
+        int y0 = std::max(shape.y0, band_y0);
+        int y1 = std::min(shape.y1, band_y1);
+        if (y0 >= y1)
+            continue;
+
+        for (size_t i = shape.first_edge; i < shape.first_edge + shape.edge_count; ++i)
+        {
+            const Edge& e = edges_[i];
+            accumulate_edge(acc, stride, band_y0, band_y1, width, e.x0, e.y0, e.x1, e.y1);
+        }
+
+        // Edges may have spilled up to two cells past the shape's right
+        // bound; those cells hold nothing visible and are just cleared.
+        int n = shape.x1 - shape.x0;
+        int spill_end = std::min(shape.x1 + 2, stride);
+        for (int y = y0; y < y1; ++y)
+        {
+            int32_t *line = acc + (y - band_y0) * stride;
+            coverage_row(line + shape.x0, coverage, n);
+            std::fill(line + shape.x1, line + spill_end, 0);
+            blend_solid_row(bitmap.data() + y * width_ + shape.x0, coverage, shape.color, n);
+        }
+    }
+}
+
+void KRasterizer::render(KBitmap& bitmap, unsigned nthreads) const
+{
+    assert(bitmap.width() == width_ && bitmap.height() == height_);
+    if (shapes_.empty())
+        return;
+
+    // Dirty tracking isn't thread-safe, so mark the union of the shapes
+    // up front rather than from the bands.
+    int x0 = width_;
+    int y0 = height_;
+    int x1 = 0;
+    int y1 = 0;
+    for (const Shape& shape : shapes_)
+    {
+        x0 = std::min(x0, shape.x0);
+        y0 = std::min(y0, shape.y0);
+        x1 = std::max(x1, shape.x1);
+        y1 = std::max(y1, shape.y1);
+    }
+    bitmap.mark_dirty(x0, y0, x1 - x0, y1 - y0);
+
+    uint32_t bands = static_cast<uint32_t>((height_ + kBandHeight - 1) / kBandHeight);
+    size_t work_per_band = static_cast<size_t>(kBandHeight) * width_;
+    parallel_for(bands, work_per_band, nthreads, [&](uint32_t begin, uint32_t end) {
+        std::vector<int32_t> acc(static_cast<size_t>(kBandHeight) * (width_ + 2), 0);
+        std::vector<uint8_t> coverage(width_);
+        for (uint32_t band = begin; band < end; ++band)
+            render_band(bitmap, static_cast<int>(band), acc.data(), coverage.data());
+    });
+}
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstring>
+#include "ktiledbitmap.h"
+#include "kraster.h"
+
+static const int kTilePixels = KTiledBitmap::kTileSize * KTiledBitmap::kTileSize;
+
+KTiledBitmap::KTiledBitmap(int width, int height, uint32_t color)
+    : width_{width},
+      height_{height},
+      tiles_x_{(width + kTileSize - 1) / kTileSize},
+      tiles_y_{(height + kTileSize - 1) / kTileSize}
+{
+    tiles_.assign(static_cast<size_t>(tiles_x_) * tiles_y_, Tile{nullptr, color});
+}
+
+KTiledBitmap::~KTiledBitmap()
+{
+    for (Tile& tile : tiles_)
+        delete [] tile.texels;
+    for (uint32_t *texels : free_texels_)
+        delete [] texels;
+}
+
+size_t KTiledBitmap::memory_used() const
+{
+    return (allocated_ + free_texels_.size()) * kTilePixels * sizeof(uint32_t) +
+           tiles_.size() * sizeof(Tile);
+}
+
+// Gives a solid tile its own texels, filled with its color.
+uint32_t* KTiledBitmap::make_detailed(Tile& tile)
+{
+    if (tile.texels)
+        return tile.texels;
+    if (!free_texels_.empty())
+    {
+        tile.texels = free_texels_.back();
+        free_texels_.pop_back();
+    }
+    else
+    {
+        tile.texels = new uint32_t[kTilePixels];
+    }
+    ++allocated_;
+    fill_row(tile.texels, kTilePixels, tile.color);
+    return tile.texels;
+}
+
+// Keeps released blocks for reuse, so that painting over and over the
+// same area doesn't churn the heap.
+void KTiledBitmap::make_solid(Tile& tile, uint32_t color)
+{
+    if (tile.texels)
+    {
+        free_texels_.push_back(tile.texels);
+        tile.texels = nullptr;
+        --allocated_;
+    }
+    tile.color = color;
+}
+
+template <typename F>
+void KTiledBitmap::for_each_overlap(int x, int y, int width, int height, F fn) const
+{
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + width, width_);
+    int y1 = std::min(y + height, height_);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    for (int ty = y0 / kTileSize; ty <= (y1 - 1) / kTileSize; ++ty)
+    {
+        int oy = ty * kTileSize;
+        for (int tx = x0 / kTileSize; tx <= (x1 - 1) / kTileSize; ++tx)
+        {
+            int ox = tx * kTileSize;
+            fn(static_cast<size_t>(ty) * tiles_x_ + tx, ox, oy,
+               std::max(x0, ox), std::max(y0, oy),
+               std::min(x1, ox + kTileSize), std::min(y1, oy + kTileSize));
+        }
+    }
+}
+
+void KTiledBitmap::put_pixel(int x, int y, uint32_t color)
+{
+    Tile& tile = tile_at(x, y);
+    if (!tile.texels && tile.color == color)
+        return;
+    make_detailed(tile)[(y % kTileSize) * kTileSize + (x % kTileSize)] = color;
+}
+
+void KTiledBitmap::clear(uint32_t color)
+{
+    for (Tile& tile : tiles_)
+        make_solid(tile, color);
+}
+
+void KTiledBitmap::fill_rect(int x, int y, int width, int height, uint32_t color)
+{
+    for_each_overlap(x, y, width, height, [&](size_t index, int ox, int oy, int x0, int y0, int x1, int y1) {
+        Tile& tile = tiles_[index];
+        // A tile that is covered whole, or already solid in the same
+        // color, needs no texels. The tiles on the right and at the
+        // bottom are covered by covering their part of the canvas.
+        bool covers_tile = (x0 == ox && y0 == oy &&
+                            x1 == std::min(ox + kTileSize, width_) && y1 == std::min(oy + kTileSize, height_));
+        if (covers_tile || (!tile.texels && tile.color == color))
+        {
+            make_solid(tile, color);
+            return;
+        }
+        uint32_t *texels = make_detailed(tile);
+        for (int row = y0; row < y1; ++row)
+            fill_row(texels + (row - oy) * kTileSize + (x0 - ox), x1 - x0, color);
+    });
+}
+
+void KTiledBitmap::blit(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y)
+{
+    // Clip against the source first; the destination is clipped per tile.
+    int left = std::max(0, -src_x);
+    int top = std::max(0, -src_y);
+    width = std::min(width - left, src.width() - (src_x + left));
+    height = std::min(height - top, src.height() - (src_y + top));
+    src_x += left;
+    src_y += top;
+    dst_x += left;
+    dst_y += top;
+
+    const uint32_t *pixels = src.data();
+    for_each_overlap(dst_x, dst_y, width, height, [&](size_t index, int ox, int oy, int x0, int y0, int x1, int y1) {
+        Tile& tile = tiles_[index];
+        uint32_t *texels = make_detailed(tile);
+        for (int row = y0; row < y1; ++row)
+            memcpy(texels + (row - oy) * kTileSize + (x0 - ox),
+                   pixels + (src_y + row - dst_y) * src.width() + (src_x + x0 - dst_x),
+                   static_cast<size_t>(x1 - x0) * sizeof(uint32_t));
+    });
+}
+
+void KTiledBitmap::blend(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y)
+{
+    int left = std::max(0, -src_x);
+    int top = std::max(0, -src_y);
+    width = std::min(width - left, src.width() - (src_x + left));
+    height = std::min(height - top, src.height() - (src_y + top));
+    src_x += left;
+    src_y += top;
+    dst_x += left;
+    dst_y += top;
+
+    const uint32_t *pixels = src.data();
+    for_each_overlap(dst_x, dst_y, width, height, [&](size_t index, int ox, int oy, int x0, int y0, int x1, int y1) {
+        Tile& tile = tiles_[index];
+        uint32_t *texels = make_detailed(tile);
+        for (int row = y0; row < y1; ++row)
+            blend_row(texels + (row - oy) * kTileSize + (x0 - ox),
+                      pixels + (src_y + row - dst_y) * src.width() + (src_x + x0 - dst_x),
+                      x1 - x0);
+    });
+}
+
+void KTiledBitmap::read(int x, int y, int width, int height, KBitmap& dst, int dst_x, int dst_y) const
+{
+    // Clip against the destination; the canvas is clipped per tile.
+    int left = std::max(0, -dst_x);
+    int top = std::max(0, -dst_y);
+    width = std::min(width - left, dst.width() - (dst_x + left));
+    height = std::min(height - top, dst.height() - (dst_y + top));
+    x += left;
+    y += top;
+    dst_x += left;
+    dst_y += top;
+    if (width <= 0 || height <= 0)
+        return;
+
+    uint32_t *pixels = dst.data();
+    for_each_overlap(x, y, width, height, [&](size_t index, int ox, int oy, int x0, int y0, int x1, int y1) {
+        const Tile& tile = tiles_[index];
+        for (int row = y0; row < y1; ++row)
+        {
+            uint32_t *out = pixels + (dst_y + row - y) * dst.width() + (dst_x + x0 - x);
+            if (tile.texels)
+                memcpy(out,
+                       tile.texels + (row - oy) * kTileSize + (x0 - ox),
+                       static_cast<size_t>(x1 - x0) * sizeof(uint32_t));
+            else
+                fill_row(out, x1 - x0, tile.color);
+        }
+    });
+    dst.mark_dirty(dst_x, dst_y, width, height);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "kbitmap.h"
+
+// A canvas split into 64x64 tiles, each stored row-major in its own
+// 16 KB block. A tile that has only ever been filled with one color
+// keeps just that color; texels are allocated on the first write that
+// makes it non-uniform, and freed again when a fill covers it whole.
+// Memory therefore follows the detailed area rather than the canvas
+// size, which makes 32k x 32k canvases practical, and a small
+// rectangle touches a few compact blocks instead of one cache line in
+// each of many distant rows.
+//
+// Pixels are 0xaarrggbb, premultiplied, as in KBitmap. Rectangles are
+// clipped to the canvas.
+//
+// USAGE:
+//
+// KTiledBitmap canvas{32768, 32768};
+// canvas.fill_rect(100, 100, 5000, 20, 0xff000000);
+// canvas.blend(brush, 0, 0, brush.width(), brush.height(), x, y);
+// canvas.read(view_x, view_y, view.width(), view.height(), view, 0, 0);
+
+class KTiledBitmap
+{
+public:
+    static const int kTileSize{64};
+
+    KTiledBitmap(int width, int height, uint32_t color = 0xffffffff);
+    ~KTiledBitmap();
+    KTiledBitmap(const KTiledBitmap&) = delete;
+    KTiledBitmap& operator=(const KTiledBitmap&) = delete;
+
+    int width() const;
+    int height() const;
+    int tiles_x() const;
+    int tiles_y() const;
+    size_t allocated_tiles() const;
+    size_t memory_used() const;
+
+    void put_pixel(int x, int y, uint32_t color);
+    uint32_t get_pixel(int x, int y) const;
+
+    // Resets every tile to a solid color and releases all texels.
+    void clear(uint32_t color);
+    void fill_rect(int x, int y, int width, int height, uint32_t color);
+    void blit(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y);
+    void blend(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y);
+
+    // Copies a region of the canvas into a linear bitmap, e.g. the part
+    // that is on screen, ready for upload.
+    void read(int x, int y, int width, int height, KBitmap& dst, int dst_x, int dst_y) const;
+
+    // Calls fn(tile_x, tile_y, texels, color) for every tile in
+    // row-major tile order. texels is null for a solid tile, whose
+    // pixels all equal color; otherwise it points at kTileSize rows of
+    // kTileSize pixels.
+    template <typename F>
+    void for_each_tile(F fn) const;
+
+private:
+    struct Tile
+    {
+        uint32_t *texels;
+        uint32_t color;
+    };
+
+    Tile& tile_at(int x, int y);
+    const Tile& tile_at(int x, int y) const;
+    uint32_t* make_detailed(Tile& tile);
+    void make_solid(Tile& tile, uint32_t color);
+
+    // Calls fn(tile_index, tile_origin_x, tile_origin_y, x0, y0, x1, y1)
+    // for every tile overlapping the clipped rectangle, with the overlap
+    // in canvas coordinates.
+    template <typename F>
+    void for_each_overlap(int x, int y, int width, int height, F fn) const;
+
+    int width_{};
+    int height_{};
+    int tiles_x_{};
+    int tiles_y_{};
+    std::vector<Tile> tiles_;
+    std::vector<uint32_t*> free_texels_;
+    size_t allocated_{};
+};
+
+inline int KTiledBitmap::width() const { return width_; }
+
+inline int KTiledBitmap::height() const { return height_; }
+
+inline int KTiledBitmap::tiles_x() const { return tiles_x_; }
+
+inline int KTiledBitmap::tiles_y() const { return tiles_y_; }
+
+inline size_t KTiledBitmap::allocated_tiles() const { return allocated_; }
+
+inline KTiledBitmap::Tile& KTiledBitmap::tile_at(int x, int y)
+{
+    return tiles_[(y / kTileSize) * tiles_x_ + (x / kTileSize)];
+}
+
+inline const KTiledBitmap::Tile& KTiledBitmap::tile_at(int x, int y) const
+{
+    return tiles_[(y / kTileSize) * tiles_x_ + (x / kTileSize)];
+}
+
+inline uint32_t KTiledBitmap::get_pixel(int x, int y) const
+{
+    const Tile& tile = tile_at(x, y);
+    if (!tile.texels)
+        return tile.color;
+    return tile.texels[(y % kTileSize) * kTileSize + (x % kTileSize)];
+}
+
+template <typename F>
+void KTiledBitmap::for_each_tile(F fn) const
+{
+    for (int ty = 0; ty < tiles_y_; ++ty)
+    {
+        for (int tx = 0; tx < tiles_x_; ++tx)
+        {
+            const Tile& tile = tiles_[ty * tiles_x_ + tx];
+            fn(tx, ty, static_cast<const uint32_t*>(tile.texels), tile.color);
+        }
+    }
+}
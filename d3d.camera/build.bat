@@ -3,13 +3,14 @@
 set COMMON_COMPILER_FLAGS=/nologo /EHa- /GR- /fp:fast /Oi /W4 /Fm /std:c++17
 set DEBUG_FLAGS=/DDEBUG_BUILD /Od /MTd /Zi
 set PREPROCESSOR_DEFS=/DUNICODE /DNOMINMAX
+set INCLUDE_DIRS=/I..\kcore
 set RELEASE_FLAGS=/O2
-set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %DEBUG_FLAGS% %PREPROCESSOR_DEFS%
+set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %DEBUG_FLAGS% %PREPROCESSOR_DEFS% %INCLUDE_DIRS%
 REM set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %RELEASE_FLAGS%
 set LINKER_FLAGS=/INCREMENTAL:NO /opt:ref
 set SYSTEM_LIBS=user32.lib gdi32.lib winmm.lib ole32.lib d2d1.lib dxgi.lib d3d11.lib d3dcompiler.lib
-set LOCAL_LIBS=kwindow.lib
-set SRC=kworld.cpp kd3dsurface.cpp krenderingengine.cpp kworldstate.cpp kclock.cpp kcamera.cpp
+set LOCAL_LIBS=kwindow.lib ..\kcore\kcore.lib
+set SRC=kworld.cpp kd3dsurface.cpp krenderingengine.cpp kworldstate.cpp kcamera.cpp
 cl %COMPILER_FLAGS% %SRC% /link %LINKER_FLAGS% %SYSTEM_LIBS% %LOCAL_LIBS%
 
 echo Done
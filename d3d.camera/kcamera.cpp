@@ -1,3 +1,4 @@
+#include <windows.h>
 #include "kmath.h"
 #include "kclock.h"
 #include "kcamera.h"
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <windows.h>
 #include "kmath.h"
 #include "kclock.h"
 #include "kworldstate.h"
@@ -48,17 +48,7 @@ void KRenderingEngine::run()
     clock.reset();
     while (running)
     {
-        float dt{};
-        {
-            double prev_t = clock.t;
-            LARGE_INTEGER ticks;
-            QueryPerformanceCounter(&ticks);
-            clock.t = static_cast<double>(ticks.QuadPart - clock.origin_) / static_cast<double>(clock.frequency_);
-            dt = static_cast<float>(clock.t - prev_t);
-            if (dt > (1.0f / 60.0f))
-                dt = (1.0f / 60.0f);
-        }
-        clock.dt = dt;
+        clock.tick(1.0 / 60.0);
     
         MSG msg{};
         while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
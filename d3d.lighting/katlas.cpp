@@ -0,0 +1,319 @@
+#include "katlas.h"
+#include "kparallel.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+static uint32_t round_up(uint32_t value, uint32_t multiple)
+{
+    return (multiple <= 1) ? value : (value + multiple - 1) / multiple * multiple;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Skyline packer.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+KSkylinePacker::KSkylinePacker(uint32_t width, uint32_t height)
+    : width_{width}, height_{height}
+{
+    skyline_.push_back({0, 0, width});
+}
+
+// The lowest y at which a rectangle whose left edge sits on the given
+// node clears every skyline segment below it.
+bool KSkylinePacker::fit(size_t node, uint32_t width, uint32_t height, uint32_t *y) const
+{
+    uint32_t x = skyline_[node].x;
+    if (x + width > width_)
+        return false;
+
+    uint32_t top = 0;
+    uint32_t remaining = width;
+    for (size_t i = node; remaining > 0; ++i)
+    {
+        assert(i < skyline_.size());
+        top = std::max(top, skyline_[i].y);
+        if (top + height > height_)
+            return false;
+        remaining -= std::min(remaining, skyline_[i].width);
+    }
+    *y = top;
+    return true;
+}
+
+bool KSkylinePacker::insert(uint32_t width, uint32_t height, uint32_t *x, uint32_t *y)
+{
+    size_t best_node = skyline_.size();
+    uint32_t best_top = UINT32_MAX;
+    uint32_t best_x = UINT32_MAX;
+    uint32_t best_y = 0;
+    for (size_t i = 0; i < skyline_.size(); ++i)
+    {
+        uint32_t fit_y;
+        if (!fit(i, width, height, &fit_y))
+            continue;
+        uint32_t top = fit_y + height;
+        if (top < best_top || (top == best_top && skyline_[i].x < best_x))
+        {
+            best_node = i;
+            best_top = top;
+            best_x = skyline_[i].x;
+            best_y = fit_y;
+        }
+    }
+    if (best_node == skyline_.size())
+        return false;
+
+    // Raise the skyline over the new rectangle and trim the segments
+    // it now shadows.
+    Node raised{best_x, best_top, width};
+    skyline_.insert(skyline_.begin() + best_node, raised);
+    for (size_t i = best_node + 1; i < skyline_.size();)
+    {
+        Node& prev = skyline_[i - 1];
+        Node& node = skyline_[i];
+        uint32_t prev_right = prev.x + prev.width;
+        if (node.x >= prev_right)
+            break;
+        uint32_t shrink = prev_right - node.x;
+        if (node.width <= shrink)
+        {
+            skyline_.erase(skyline_.begin() + i);
+            continue;
+        }
+        node.x += shrink;
+        node.width -= shrink;
+        break;
+    }
+    for (size_t i = 0; i + 1 < skyline_.size();)
+    {
+        if (skyline_[i].y == skyline_[i + 1].y)
+        {
+            skyline_[i].width += skyline_[i + 1].width;
+            skyline_.erase(skyline_.begin() + i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    used_area_ += static_cast<uint64_t>(width) * height;
+    *x = best_x;
+    *y = best_y;
+    return true;
+}
+
+float KSkylinePacker::occupancy() const
+{
+    return static_cast<float>(static_cast<double>(used_area_) / (static_cast<double>(width_) * height_));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Atlas construction.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Copies the image into its slot and replicates its edge texels out
+// across the padding.
+static void blit_with_bleed(const KAtlasImage& image, const KAtlasEntry& entry, uint32_t padding, KAtlas *atlas)
+{
+    uint8_t *page = atlas->page_data(entry.page);
+    size_t page_pitch = static_cast<size_t>(atlas->page_width) * 4;
+    int w = static_cast<int>(image.width);
+    int h = static_cast<int>(image.height);
+    int pad = static_cast<int>(padding);
+
+    for (int py = -pad; py < h + pad; ++py)
+    {
+        const uint8_t *src = image.texels + static_cast<size_t>(std::clamp(py, 0, h - 1)) * image.stride;
+        uint8_t *dst = page + (entry.y + py) * page_pitch + (entry.x - pad) * 4;
+        for (int px = -pad; px < 0; ++px, dst += 4)
+            memcpy(dst, src, 4);
+        memcpy(dst, src, static_cast<size_t>(w) * 4);
+        dst += static_cast<size_t>(w) * 4;
+        for (int px = 0; px < pad; ++px, dst += 4)
+            memcpy(dst, src + (w - 1) * 4, 4);
+    }
+}
+
+bool build_atlas(const std::vector<KAtlasImage>& images, const KAtlasSettings& settings, KAtlas *atlas)
+{
+    assert(atlas != nullptr);
+    uint32_t padding = round_up(settings.padding, settings.alignment);
+
+    // Placing tall images first keeps the skyline flat.
+    std::vector<uint32_t> order(images.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (images[a].height != images[b].height)
+            return images[a].height > images[b].height;
+        return images[a].width > images[b].width;
+    });
+
+    KAtlas result{};
+    result.page_width = settings.page_width;
+    result.page_height = settings.page_height;
+    result.padding = padding;
+    result.entries.resize(images.size());
+
+    std::vector<KSkylinePacker> pages;
+    for (uint32_t i : order)
+    {
+        const KAtlasImage& image = images[i];
+        assert(image.width > 0 && image.height > 0);
+        uint32_t w = round_up(image.width + 2 * padding, settings.alignment);
+        uint32_t h = round_up(image.height + 2 * padding, settings.alignment);
+        if (w > settings.page_width || h > settings.page_height)
+            return false;
+
+        uint32_t x = 0, y = 0;
+        uint32_t page = 0;
+        while (page < pages.size() && !pages[page].insert(w, h, &x, &y))
+            ++page;
+        if (page == pages.size())
+        {
+            if (pages.size() == settings.max_pages)
+                return false;
+            pages.emplace_back(settings.page_width, settings.page_height);
+            bool inserted = pages.back().insert(w, h, &x, &y);
+            assert(inserted);
+            (void)inserted;
+        }
+
+        KAtlasEntry& entry = result.entries[i];
+        entry.page = page;
+        entry.x = x + padding;
+        entry.y = y + padding;
+        entry.width = image.width;
+        entry.height = image.height;
+        entry.u0 = static_cast<float>(entry.x) / settings.page_width;
+        entry.v0 = static_cast<float>(entry.y) / settings.page_height;
+        entry.u1 = static_cast<float>(entry.x + entry.width) / settings.page_width;
+        entry.v1 = static_cast<float>(entry.y + entry.height) / settings.page_height;
+    }
+
+    result.page_count = static_cast<uint32_t>(pages.size());
+    result.texels.assign(result.page_size() * result.page_count, 0);
+
+    // Slots never overlap, so images can be copied in any order.
+    size_t average_texels = images.empty() ? 0 : result.texels.size() / 4 / images.size();
+    parallel_for(static_cast<uint32_t>(images.size()), average_texels, 0, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+            blit_with_bleed(images[i], result.entries[i], padding, &result);
+    });
+
+    *atlas = std::move(result);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Serialization.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const uint32_t kAtlasMagic = 0x4c54414b;     // "KATL"
+static const uint32_t kAtlasVersion = 1;
+static const size_t kAtlasHeaderWords = 7;
+
+std::vector<uint8_t> write_atlas(const KAtlas& atlas)
+{
+    uint32_t header[kAtlasHeaderWords]{kAtlasMagic,
+                                       kAtlasVersion,
+                                       atlas.page_width,
+                                       atlas.page_height,
+                                       atlas.page_count,
+                                       atlas.padding,
+                                       static_cast<uint32_t>(atlas.entries.size())};
+    size_t entry_bytes = atlas.entries.size() * sizeof(KAtlasEntry);
+    std::vector<uint8_t> mem(sizeof(header) + entry_bytes + atlas.texels.size());
+    uint8_t *out = mem.data();
+    memcpy(out, header, sizeof(header));
+    out += sizeof(header);
+    if (entry_bytes)
+        memcpy(out, atlas.entries.data(), entry_bytes);
+    out += entry_bytes;
+    if (!atlas.texels.empty())
+        memcpy(out, atlas.texels.data(), atlas.texels.size());
+    return mem;
+}
+
+bool read_atlas(const uint8_t *mem, size_t nbytes, KAtlas *atlas)
+{
+    uint32_t header[kAtlasHeaderWords];
+    if (nbytes < sizeof(header))
+        return false;
+    memcpy(header, mem, sizeof(header));
+    if (header[0] != kAtlasMagic || header[1] != kAtlasVersion)
+        return false;
+
+    KAtlas result{};
+    result.page_width = header[2];
+    result.page_height = header[3];
+    result.page_count = header[4];
+    result.padding = header[5];
+
+    // The sizes in the header are checked against the file before
+    // anything is allocated for them, with every product kept under
+    // the bytes that are left so that none of them can wrap. An atlas
+    // of no pages has no texels, whatever its page size.
+    size_t available = nbytes - sizeof(header);
+    if (header[6] > available / sizeof(KAtlasEntry))
+        return false;
+    size_t entry_bytes = static_cast<size_t>(header[6]) * sizeof(KAtlasEntry);
+    available -= entry_bytes;
+    size_t texel_bytes = 4;
+    for (uint32_t factor : {result.page_count, result.page_width, result.page_height})
+    {
+        if (factor != 0 && texel_bytes > available / factor)
+            return false;
+        texel_bytes *= factor;
+    }
+
+    const uint8_t *in = mem + sizeof(header);
+    result.entries.resize(header[6]);
+    if (entry_bytes)
+        memcpy(result.entries.data(), in, entry_bytes);
+    for (auto& entry : result.entries)
+    {
+        if (entry.page >= result.page_count ||
+            static_cast<uint64_t>(entry.x) + entry.width > result.page_width ||
+            static_cast<uint64_t>(entry.y) + entry.height > result.page_height)
+            return false;
+    }
+    result.texels.assign(in + entry_bytes, in + entry_bytes + texel_bytes);
+
+    *atlas = std::move(result);
+    return true;
+}
+
+bool save_atlas(const char *filename, const KAtlas& atlas)
+{
+    std::vector<uint8_t> mem = write_atlas(atlas);
+    FILE *fp = fopen(filename, "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(mem.data(), 1, mem.size(), fp) == mem.size();
+    fclose(fp);
+    return ok;
+}
+
+bool load_atlas(const char *filename, KAtlas *atlas)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return false;
+    fseek(fp, 0, SEEK_END);
+    long nbytes = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    std::vector<uint8_t> mem(nbytes > 0 ? static_cast<size_t>(nbytes) : 0);
+    bool ok = fread(mem.data(), 1, mem.size(), fp) == mem.size();
+    fclose(fp);
+    return ok && read_atlas(mem.data(), mem.size(), atlas);
+}
+
+#pragma warning(pop)
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Packs many small 32-bit images into a few large pages of equal size,
+// laid out to be the slices of one texture array, so that they can be
+// drawn with one texture binding; uploading the pages is left to the
+// renderer that draws them. Each image is surrounded by padding filled
+// with copies of its edge texels, which keeps bilinear and mip
+// filtering from bleeding neighbours into it, and every placement is
+// aligned so that 4x4 compression blocks never straddle two images.
+//
+// USAGE:
+//
+// KAtlas atlas{};
+// build_atlas(images, KAtlasSettings{}, &atlas);
+// atlas.entries[i] tells where images[i] went: page (array slice),
+// texel rect and normalized UV rect.
+
+struct KAtlasImage
+{
+    const uint8_t *texels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;    // Bytes per row.
+};
+
+struct KAtlasEntry
+{
+    uint32_t page;
+    uint32_t x;         // Texel rect of the image itself, without padding.
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    float u0;
+    float v0;
+    float u1;
+    float v1;
+};
+
+struct KAtlasSettings
+{
+    uint32_t page_width{2048};
+    uint32_t page_height{2048};
+    uint32_t padding{4};    // Texels of bleed on each side.
+    uint32_t alignment{4};  // Placements and padded sizes are multiples of this.
+    uint32_t max_pages{64};
+};
+
+struct KAtlas
+{
+    uint32_t page_width{};
+    uint32_t page_height{};
+    uint32_t page_count{};
+    uint32_t padding{};
+    std::vector<KAtlasEntry> entries;
+    std::vector<uint8_t> texels;    // page_count pages, 4 bytes per texel, tightly packed.
+
+    size_t page_size() const { return static_cast<size_t>(page_width) * page_height * 4; }
+    const uint8_t* page_data(uint32_t page) const { return texels.data() + page * page_size(); }
+    uint8_t* page_data(uint32_t page) { return texels.data() + page * page_size(); }
+};
+
+// Skyline bin packer with the bottom-left rule: each rectangle goes
+// where its top edge ends up lowest, ties broken by the leftmost spot.
+class KSkylinePacker
+{
+public:
+    KSkylinePacker(uint32_t width, uint32_t height);
+    bool insert(uint32_t width, uint32_t height, uint32_t *x, uint32_t *y);
+    float occupancy() const;
+
+private:
+    struct Node
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    bool fit(size_t node, uint32_t width, uint32_t height, uint32_t *y) const;
+
+    uint32_t width_{};
+    uint32_t height_{};
+    uint64_t used_area_{};
+    std::vector<Node> skyline_;
+};
+
+// Returns false if an image doesn't fit on an empty page or the atlas
+// would need more than settings.max_pages pages.
+bool build_atlas(const std::vector<KAtlasImage>& images, const KAtlasSettings& settings, KAtlas *atlas);
+
+// Binary form: a fixed header, the entries, then the page texels.
+std::vector<uint8_t> write_atlas(const KAtlas& atlas);
+bool read_atlas(const uint8_t *mem, size_t nbytes, KAtlas *atlas);
+bool save_atlas(const char *filename, const KAtlas& atlas);
+bool load_atlas(const char *filename, KAtlas *atlas);
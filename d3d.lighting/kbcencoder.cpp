@@ -0,0 +1,870 @@
+#include "kbcencoder.h"
+#include "kparallel.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KBC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// A 4x4 block unpacked to floats in [0, 255], one array per channel, so
+// that four texels of a channel sit in one SSE register.
+struct KBlock
+{
+    alignas(16) float c[4][16];
+};
+
+static void load_block(const uint8_t *src, uint32_t width, uint32_t height, uint32_t stride,
+                       uint32_t bx, uint32_t by, KBlock *block)
+{
+    for (uint32_t j = 0; j < 4; ++j)
+    {
+        const uint8_t *row = src + static_cast<size_t>(std::min(by * 4 + j, height - 1)) * stride;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const uint8_t *texel = row + 4 * std::min(bx * 4 + i, width - 1);
+            for (int c = 0; c < 4; ++c)
+                block->c[c][j * 4 + i] = texel[c];
+        }
+    }
+}
+
+// Picks the nearest palette entry for every texel, measured over the
+// channels [first, first + count), and returns the summed squared
+// error.
+static float fit_indices(const KBlock& block, const float (*palette)[4], int npalette,
+                         int first, int count, uint8_t index[16])
+{
+    float total = 0.0f;
+#if defined(KBC_SSE2)
+    for (int g = 0; g < 16; g += 4)
+    {
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i best_index = _mm_setzero_si128();
+        for (int p = 0; p < npalette; ++p)
+        {
+            __m128 d = _mm_setzero_ps();
+            for (int c = first; c < first + count; ++c)
+            {
+                __m128 e = _mm_sub_ps(_mm_load_ps(&block.c[c][g]), _mm_set1_ps(palette[p][c]));
+                d = _mm_add_ps(d, _mm_mul_ps(e, e));
+            }
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+            best = _mm_min_ps(d, best);
+            best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)),
+                                      _mm_andnot_si128(closer, best_index));
+        }
+        alignas(16) int32_t bi[4];
+        alignas(16) float be[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(bi), best_index);
+        _mm_store_ps(be, best);
+        for (int k = 0; k < 4; ++k)
+        {
+            index[g + k] = static_cast<uint8_t>(bi[k]);
+            total += be[k];
+        }
+    }
+#else
+    for (int t = 0; t < 16; ++t)
+    {
+        float best = FLT_MAX;
+        for (int p = 0; p < npalette; ++p)
+        {
+            float d = 0.0f;
+            for (int c = first; c < first + count; ++c)
+            {
+                float e = block.c[c][t] - palette[p][c];
+                d += e * e;
+            }
+            if (d < best)
+            {
+                best = d;
+                index[t] = static_cast<uint8_t>(p);
+            }
+        }
+        total += best;
+    }
+#endif
+    return total;
+}
+
+// Mean and dominant direction of the block over the first nchannels
+// channels, by power iteration on the covariance matrix. The axis is
+// zero when the block is a solid color.
+static void principal_axis(const KBlock& block, int nchannels, float mean[4], float axis[4])
+{
+    float lo[4]{};
+    float hi[4]{};
+    for (int c = 0; c < 4; ++c)
+    {
+        mean[c] = 0.0f;
+        axis[c] = 0.0f;
+        lo[c] = FLT_MAX;
+        hi[c] = -FLT_MAX;
+    }
+    for (int c = 0; c < nchannels; ++c)
+    {
+        for (int t = 0; t < 16; ++t)
+        {
+            mean[c] += block.c[c][t];
+            lo[c] = std::min(lo[c], block.c[c][t]);
+            hi[c] = std::max(hi[c], block.c[c][t]);
+        }
+        mean[c] /= 16.0f;
+    }
+
+    float cov[4][4]{};
+    for (int t = 0; t < 16; ++t)
+        for (int i = 0; i < nchannels; ++i)
+            for (int j = i; j < nchannels; ++j)
+                cov[i][j] += (block.c[i][t] - mean[i]) * (block.c[j][t] - mean[j]);
+    for (int i = 0; i < nchannels; ++i)
+        for (int j = 0; j < i; ++j)
+            cov[i][j] = cov[j][i];
+
+    float v[4]{};
+    for (int c = 0; c < nchannels; ++c)
+        v[c] = hi[c] - lo[c];
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float w[4]{};
+        float scale = 0.0f;
+        for (int i = 0; i < nchannels; ++i)
+        {
+            for (int j = 0; j < nchannels; ++j)
+                w[i] += cov[i][j] * v[j];
+            scale = std::max(scale, fabsf(w[i]));
+        }
+        if (scale < 1e-6f)
+            return;
+        for (int i = 0; i < nchannels; ++i)
+            v[i] = w[i] / scale;
+    }
+    for (int c = 0; c < nchannels; ++c)
+        axis[c] = v[c];
+}
+
+// The texels with the smallest and largest projection on the axis.
+static void extreme_texels(const KBlock& block, int nchannels, const float mean[4], const float axis[4],
+                           float e0[4], float e1[4])
+{
+    int tmin = 0;
+    int tmax = 0;
+    float dmin = FLT_MAX;
+    float dmax = -FLT_MAX;
+    for (int t = 0; t < 16; ++t)
+    {
+        float d = 0.0f;
+        for (int c = 0; c < nchannels; ++c)
+            d += (block.c[c][t] - mean[c]) * axis[c];
+        if (d < dmin) { dmin = d; tmin = t; }
+        if (d > dmax) { dmax = d; tmax = t; }
+    }
+    for (int c = 0; c < 4; ++c)
+    {
+        e0[c] = block.c[c][tmax];
+        e1[c] = block.c[c][tmin];
+    }
+}
+
+// Least-squares endpoints for fixed indices, where texel t is modeled
+// as (1 - w[t]) * e0 + w[t] * e1. Returns false if the system is
+// singular, i.e. every texel uses the same weight.
+static bool refine_endpoints(const KBlock& block, int nchannels, const uint8_t index[16],
+                             const float *weights, float e0[4], float e1[4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4]{};
+    float bx[4]{};
+    for (int t = 0; t < 16; ++t)
+    {
+        float b = weights[index[t]];
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < nchannels; ++c)
+        {
+            ax[c] += a * block.c[c][t];
+            bx[c] += b * block.c[c][t];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return false;
+    for (int c = 0; c < nchannels; ++c)
+    {
+        e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+        e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// BC1 color blocks, also used as the color half of BC3.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static uint16_t pack_565(const float c[4])
+{
+    int r = static_cast<int>(std::clamp(c[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(std::clamp(c[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(std::clamp(c[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t v, float c[4])
+{
+    int r = v >> 11;
+    int g = (v >> 5) & 63;
+    int b = v & 31;
+    c[0] = static_cast<float>((r << 3) | (r >> 2));
+    c[1] = static_cast<float>((g << 2) | (g >> 4));
+    c[2] = static_cast<float>((b << 3) | (b >> 2));
+    c[3] = 255.0f;
+}
+
+// Palette order as stored: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1.
+static const float kBC1Weights[4]{0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+static void bc1_palette(uint16_t c0, uint16_t c1, bool four_color, float palette[4][4])
+{
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    for (int c = 0; c < 4; ++c)
+    {
+        if (four_color)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        else
+        {
+            palette[2][c] = 0.5f * (palette[0][c] + palette[1][c]);
+            palette[3][c] = 0.0f;
+        }
+    }
+}
+
+static float try_bc1_endpoints(const KBlock& block, const float e0[4], const float e1[4],
+                               uint16_t *q0, uint16_t *q1, uint8_t index[16])
+{
+    *q0 = pack_565(e0);
+    *q1 = pack_565(e1);
+    float palette[4][4];
+    bc1_palette(*q0, *q1, true, palette);
+    return fit_indices(block, palette, 4, 0, 3, index);
+}
+
+static void encode_color_block(const KBlock& block, uint8_t out[8])
+{
+    float mean[4], axis[4], e0[4], e1[4];
+    principal_axis(block, 3, mean, axis);
+    extreme_texels(block, 3, mean, axis, e0, e1);
+
+    uint16_t q0, q1;
+    uint8_t index[16];
+    float error = try_bc1_endpoints(block, e0, e1, &q0, &q1, index);
+
+    for (int iteration = 0; iteration < 2 && error > 0.0f; ++iteration)
+    {
+        if (!refine_endpoints(block, 3, index, kBC1Weights, e0, e1))
+            break;
+        uint16_t r0, r1;
+        uint8_t refined[16];
+        float refined_error = try_bc1_endpoints(block, e0, e1, &r0, &r1, refined);
+        if (refined_error >= error)
+            break;
+        error = refined_error;
+        q0 = r0;
+        q1 = r1;
+        std::copy(refined, refined + 16, index);
+    }
+
+    // The decoder selects four-color mode from q0 > q1.
+    if (q0 < q1)
+    {
+        static const uint8_t kSwap[4]{1, 0, 3, 2};
+        std::swap(q0, q1);
+        for (int t = 0; t < 16; ++t)
+            index[t] = kSwap[index[t]];
+    }
+    else if (q0 == q1)
+    {
+        std::fill(index, index + 16, static_cast<uint8_t>(0));
+    }
+
+    uint32_t bits = 0;
+    for (int t = 0; t < 16; ++t)
+        bits |= static_cast<uint32_t>(index[t]) << (2 * t);
+    out[0] = static_cast<uint8_t>(q0);
+    out[1] = static_cast<uint8_t>(q0 >> 8);
+    out[2] = static_cast<uint8_t>(q1);
+    out[3] = static_cast<uint8_t>(q1 >> 8);
+    memcpy(out + 4, &bits, 4);
+}
+
+static void decode_color_block(const uint8_t in[8], bool force_four_color, uint8_t texels[16][4])
+{
+    uint16_t q0 = static_cast<uint16_t>(in[0] | (in[1] << 8));
+    uint16_t q1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+    uint32_t bits;
+    memcpy(&bits, in + 4, 4);
+    float palette[4][4];
+    bool four_color = force_four_color || q0 > q1;
+    bc1_palette(q0, q1, four_color, palette);
+    if (!four_color)
+        palette[3][3] = 0.0f;
+    for (int t = 0; t < 16; ++t)
+        for (int c = 0; c < 4; ++c)
+            texels[t][c] = static_cast<uint8_t>(palette[(bits >> (2 * t)) & 3][c] + 0.5f);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// BC4-style alpha blocks, the alpha half of BC3.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static void bc4_palette(int a0, int a1, float palette[8][4])
+{
+    float values[8];
+    values[0] = static_cast<float>(a0);
+    values[1] = static_cast<float>(a1);
+    if (a0 > a1)
+    {
+        for (int i = 1; i < 7; ++i)
+            values[i + 1] = floorf(((7 - i) * a0 + i * a1) / 7.0f + 0.5f);
+    }
+    else
+    {
+        for (int i = 1; i < 5; ++i)
+            values[i + 1] = floorf(((5 - i) * a0 + i * a1) / 5.0f + 0.5f);
+        values[6] = 0.0f;
+        values[7] = 255.0f;
+    }
+    for (int i = 0; i < 8; ++i)
+        palette[i][3] = values[i];
+}
+
+static void encode_alpha_block(const KBlock& block, uint8_t out[8])
+{
+    float lo = 255.0f;
+    float hi = 0.0f;
+    for (int t = 0; t < 16; ++t)
+    {
+        lo = std::min(lo, block.c[3][t]);
+        hi = std::max(hi, block.c[3][t]);
+    }
+    int a0 = static_cast<int>(hi + 0.5f);
+    int a1 = static_cast<int>(lo + 0.5f);
+
+    uint8_t index[16]{};
+    if (a0 != a1)
+    {
+        float palette[8][4]{};
+        bc4_palette(a0, a1, palette);
+        fit_indices(block, palette, 8, 3, 1, index);
+    }
+
+    uint64_t bits = 0;
+    for (int t = 0; t < 16; ++t)
+        bits |= static_cast<uint64_t>(index[t]) << (3 * t);
+    out[0] = static_cast<uint8_t>(a0);
+    out[1] = static_cast<uint8_t>(a1);
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+static void decode_alpha_block(const uint8_t in[8], uint8_t texels[16][4])
+{
+    float palette[8][4]{};
+    bc4_palette(in[0], in[1], palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+        bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+    for (int t = 0; t < 16; ++t)
+        texels[t][3] = static_cast<uint8_t>(palette[(bits >> (3 * t)) & 7][3]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// BC7 mode 6 blocks.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const int kBC7Weights4[16]{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct KBitWriter
+{
+    uint8_t *out;
+    uint32_t pos{};
+
+    void put(uint32_t value, int nbits)
+    {
+        for (int i = 0; i < nbits; ++i, ++pos)
+            if ((value >> i) & 1)
+                out[pos >> 3] |= static_cast<uint8_t>(1 << (pos & 7));
+    }
+};
+
+struct KBitReader
+{
+    const uint8_t *in;
+    uint32_t pos{};
+
+    uint32_t get(int nbits)
+    {
+        uint32_t value = 0;
+        for (int i = 0; i < nbits; ++i, ++pos)
+            value |= static_cast<uint32_t>((in[pos >> 3] >> (pos & 7)) & 1) << i;
+        return value;
+    }
+};
+
+// Endpoints are 7 bits per channel plus one p-bit shared by the
+// channels of that endpoint.
+static void quantize_bc7_endpoint(const float e[4], int pbit, int q[4])
+{
+    for (int c = 0; c < 4; ++c)
+        q[c] = std::clamp(static_cast<int>(floorf((e[c] - pbit) * 0.5f + 0.5f)), 0, 127);
+}
+
+static void bc7_palette(const int q0[4], int p0, const int q1[4], int p1, float palette[16][4])
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        int v0 = (q0[c] << 1) | p0;
+        int v1 = (q1[c] << 1) | p1;
+        for (int i = 0; i < 16; ++i)
+            palette[i][c] = static_cast<float>(((64 - kBC7Weights4[i]) * v0 + kBC7Weights4[i] * v1 + 32) >> 6);
+    }
+}
+
+struct KBC7Mode6
+{
+    int q0[4];
+    int q1[4];
+    int p0;
+    int p1;
+    uint8_t index[16];
+    float error;
+};
+
+static void try_bc7_endpoints(const KBlock& block, const float e0[4], const float e1[4], KBC7Mode6 *best)
+{
+    for (int p0 = 0; p0 < 2; ++p0)
+    {
+        for (int p1 = 0; p1 < 2; ++p1)
+        {
+            KBC7Mode6 candidate{};
+            candidate.p0 = p0;
+            candidate.p1 = p1;
+            quantize_bc7_endpoint(e0, p0, candidate.q0);
+            quantize_bc7_endpoint(e1, p1, candidate.q1);
+            float palette[16][4];
+            bc7_palette(candidate.q0, p0, candidate.q1, p1, palette);
+            candidate.error = fit_indices(block, palette, 16, 0, 4, candidate.index);
+            if (candidate.error < best->error)
+                *best = candidate;
+        }
+    }
+}
+
+static void encode_bc7_block(const KBlock& block, uint8_t out[16])
+{
+    static float weights[16];
+    static bool weights_ready = [] {
+        for (int i = 0; i < 16; ++i)
+            weights[i] = kBC7Weights4[i] / 64.0f;
+        return true;
+    }();
+    (void)weights_ready;
+
+    float mean[4], axis[4], e0[4], e1[4];
+    principal_axis(block, 4, mean, axis);
+    extreme_texels(block, 4, mean, axis, e0, e1);
+
+    KBC7Mode6 best{};
+    best.error = FLT_MAX;
+    try_bc7_endpoints(block, e0, e1, &best);
+
+    for (int iteration = 0; iteration < 2 && best.error > 0.0f; ++iteration)
+    {
+        float before = best.error;
+        if (!refine_endpoints(block, 4, best.index, weights, e0, e1))
+            break;
+        try_bc7_endpoints(block, e0, e1, &best);
+        if (best.error >= before)
+            break;
+    }
+
+    // The anchor texel's index has an implicit zero top bit.
+    if (best.index[0] & 8)
+    {
+        for (int c = 0; c < 4; ++c)
+            std::swap(best.q0[c], best.q1[c]);
+        std::swap(best.p0, best.p1);
+        for (int t = 0; t < 16; ++t)
+            best.index[t] = static_cast<uint8_t>(15 - best.index[t]);
+    }
+
+    memset(out, 0, 16);
+    KBitWriter writer{out};
+    writer.put(1 << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.put(best.q0[c], 7);
+        writer.put(best.q1[c], 7);
+    }
+    writer.put(best.p0, 1);
+    writer.put(best.p1, 1);
+    writer.put(best.index[0], 3);
+    for (int t = 1; t < 16; ++t)
+        writer.put(best.index[t], 4);
+}
+
+static void decode_bc7_block(const uint8_t in[16], uint8_t texels[16][4])
+{
+    KBitReader reader{in};
+    if (reader.get(7) != (1 << 6))
+    {
+        // Only mode 6 is ever written; flag anything else in magenta.
+        for (int t = 0; t < 16; ++t)
+        {
+            texels[t][0] = 255;
+            texels[t][1] = 0;
+            texels[t][2] = 255;
+            texels[t][3] = 255;
+        }
+        return;
+    }
+    int q0[4], q1[4];
+    for (int c = 0; c < 4; ++c)
+    {
+        q0[c] = static_cast<int>(reader.get(7));
+        q1[c] = static_cast<int>(reader.get(7));
+    }
+    int p0 = static_cast<int>(reader.get(1));
+    int p1 = static_cast<int>(reader.get(1));
+    float palette[16][4];
+    bc7_palette(q0, p0, q1, p1, palette);
+    for (int t = 0; t < 16; ++t)
+    {
+        uint32_t i = reader.get(t == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c)
+            texels[t][c] = static_cast<uint8_t>(palette[i][c]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Images.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+size_t bc_block_size(KBCFormat format)
+{
+    return (format == KBCFormat::kBC1) ? 8 : 16;
+}
+
+uint32_t bc_dxgi_format(KBCFormat format, bool srgb)
+{
+    // DXGI_FORMAT values, spelled out so this file builds without the
+    // DirectX headers.
+    switch (format)
+    {
+    case KBCFormat::kBC1: return srgb ? 72 : 71;
+    case KBCFormat::kBC3: return srgb ? 78 : 77;
+    case KBCFormat::kBC7: return srgb ? 99 : 98;
+    }
+    return 0;
+}
+
+void encode_bc(const uint8_t *src, uint32_t width, uint32_t height, uint32_t stride,
+               KBCFormat format, uint8_t *dst, unsigned nthreads)
+{
+    assert(src != nullptr && dst != nullptr && width > 0 && height > 0);
+    uint32_t blocks_x = (width + 3) / 4;
+    uint32_t blocks_y = (height + 3) / 4;
+    size_t block_size = bc_block_size(format);
+
+    // Rough per-block cost, in texel-palette comparisons.
+    size_t work = (format == KBCFormat::kBC7) ? 16 * 16 * 12 : 16 * 8 * 4;
+    parallel_for(blocks_y, blocks_x * work, nthreads, [&](uint32_t begin, uint32_t end) {
+        KBlock block;
+        for (uint32_t by = begin; by < end; ++by)
+        {
+            uint8_t *out = dst + static_cast<size_t>(by) * blocks_x * block_size;
+            for (uint32_t bx = 0; bx < blocks_x; ++bx, out += block_size)
+            {
+                load_block(src, width, height, stride, bx, by, &block);
+                switch (format)
+                {
+                case KBCFormat::kBC1:
+                    encode_color_block(block, out);
+                    break;
+                case KBCFormat::kBC3:
+                    encode_alpha_block(block, out);
+                    encode_color_block(block, out + 8);
+                    break;
+                case KBCFormat::kBC7:
+                    encode_bc7_block(block, out);
+                    break;
+                }
+            }
+        }
+    });
+}
+
+void decode_bc(const uint8_t *src, uint32_t width, uint32_t height,
+               KBCFormat format, uint8_t *dst, uint32_t stride)
+{
+    uint32_t blocks_x = (width + 3) / 4;
+    uint32_t blocks_y = (height + 3) / 4;
+    size_t block_size = bc_block_size(format);
+    for (uint32_t by = 0; by < blocks_y; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocks_x; ++bx)
+        {
+            const uint8_t *in = src + (static_cast<size_t>(by) * blocks_x + bx) * block_size;
+            uint8_t texels[16][4];
+            switch (format)
+            {
+            case KBCFormat::kBC1:
+                decode_color_block(in, false, texels);
+                break;
+            case KBCFormat::kBC3:
+                decode_color_block(in + 8, true, texels);
+                decode_alpha_block(in, texels);
+                break;
+            case KBCFormat::kBC7:
+                decode_bc7_block(in, texels);
+                break;
+            }
+            for (uint32_t j = 0; j < 4 && by * 4 + j < height; ++j)
+                for (uint32_t i = 0; i < 4 && bx * 4 + i < width; ++i)
+                    memcpy(dst + static_cast<size_t>(by * 4 + j) * stride + 4 * (bx * 4 + i), texels[j * 4 + i], 4);
+        }
+    }
+}
+
+static void allocate_levels(KBCImage *image, const std::vector<std::pair<uint32_t, uint32_t>>& sizes)
+{
+    size_t block_size = bc_block_size(image->format);
+    size_t offset = 0;
+    image->levels.clear();
+    for (auto& size : sizes)
+    {
+        KBCLevel level{};
+        level.width = size.first;
+        level.height = size.second;
+        level.pitch = static_cast<uint32_t>(((static_cast<size_t>(size.first) + 3) / 4) * block_size);
+        level.offset = offset;
+        level.size = static_cast<size_t>(level.pitch) * ((static_cast<size_t>(size.second) + 3) / 4);
+        image->levels.push_back(level);
+        offset += level.size;
+    }
+    image->data.assign(offset, 0);
+}
+
+KBCImage encode_bc_chain(const KMipChain& chain, KBCFormat format, unsigned nthreads, KBCStats *stats)
+{
+    KBCImage image{};
+    image.format = format;
+
+    std::vector<std::pair<uint32_t, uint32_t>> sizes;
+    for (auto& level : chain.levels)
+        sizes.push_back({level.width, level.height});
+    allocate_levels(&image, sizes);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t texels = 0;
+    for (size_t i = 0; i < chain.levels.size(); ++i)
+    {
+        const KMipLevel& level = chain.levels[i];
+        encode_bc(chain.level_data(i), level.width, level.height, level.pitch, format,
+                  image.data.data() + image.levels[i].offset, nthreads);
+        texels += static_cast<size_t>(level.width) * level.height;
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    if (stats)
+    {
+        stats->seconds = std::chrono::duration<double>(stop - start).count();
+        stats->mtexels_per_second = (stats->seconds > 0.0) ? texels / stats->seconds * 1e-6 : 0.0;
+        stats->psnr = bc_psnr(chain, image);
+    }
+    return image;
+}
+
+double bc_psnr(const KMipChain& chain, const KBCImage& image)
+{
+    assert(chain.levels.size() == image.levels.size());
+    int nchannels = (image.format == KBCFormat::kBC1) ? 3 : 4;
+    double squared_error = 0.0;
+    size_t samples = 0;
+    std::vector<uint8_t> decoded;
+    for (size_t i = 0; i < chain.levels.size(); ++i)
+    {
+        const KMipLevel& level = chain.levels[i];
+        decoded.resize(static_cast<size_t>(level.width) * level.height * 4);
+        decode_bc(image.level_data(i), level.width, level.height, image.format, decoded.data(), level.width * 4);
+        const uint8_t *original = chain.level_data(i);
+        for (uint32_t y = 0; y < level.height; ++y)
+        {
+            for (uint32_t x = 0; x < level.width; ++x)
+            {
+                for (int c = 0; c < nchannels; ++c)
+                {
+                    double e = static_cast<double>(original[static_cast<size_t>(y) * level.pitch + 4 * x + c]) -
+                               static_cast<double>(decoded[(static_cast<size_t>(y) * level.width + x) * 4 + c]);
+                    squared_error += e * e;
+                }
+            }
+        }
+        samples += static_cast<size_t>(level.width) * level.height * nchannels;
+    }
+    if (squared_error == 0.0)
+        return std::numeric_limits<double>::infinity();
+    return 10.0 * log10(255.0 * 255.0 * samples / squared_error);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// DDS container.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Field layout of DDS_HEADER and DDS_HEADER_DXT10, as 32-bit words
+// after the "DDS " magic.
+static const uint32_t kDDSMagic = 0x20534444;           // "DDS "
+static const uint32_t kDDSFourCCDX10 = 0x30315844;      // "DX10"
+static const size_t kDDSHeaderWords = 31;
+static const size_t kDDSDX10Words = 5;
+static const size_t kDDSPrefixBytes = 4 * (1 + kDDSHeaderWords + kDDSDX10Words);
+
+std::vector<uint8_t> write_dds(const KBCImage& image)
+{
+    assert(!image.levels.empty());
+    uint32_t words[1 + kDDSHeaderWords + kDDSDX10Words]{};
+    uint32_t *header = words + 1;
+    uint32_t *dx10 = header + kDDSHeaderWords;
+
+    words[0] = kDDSMagic;
+    header[0] = 124;                                        // dwSize
+    header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+    header[2] = image.levels[0].height;
+    header[3] = image.levels[0].width;
+    header[4] = static_cast<uint32_t>(image.levels[0].size);
+    header[6] = static_cast<uint32_t>(image.levels.size());
+    header[18] = 32;                                        // ddspf.dwSize
+    header[19] = 0x4;                                       // ddspf.dwFlags = DDPF_FOURCC
+    header[20] = kDDSFourCCDX10;
+    header[26] = 0x1000 | 0x400000 | 0x8;                   // TEXTURE | MIPMAP | COMPLEX
+    dx10[0] = bc_dxgi_format(image.format, image.srgb);
+    dx10[1] = 3;                                            // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    dx10[3] = 1;                                            // arraySize
+
+    std::vector<uint8_t> mem(kDDSPrefixBytes + image.data.size());
+    memcpy(mem.data(), words, kDDSPrefixBytes);
+    memcpy(mem.data() + kDDSPrefixBytes, image.data.data(), image.data.size());
+    return mem;
+}
+
+bool read_dds(const uint8_t *mem, size_t nbytes, KBCImage *image)
+{
+    if (nbytes < kDDSPrefixBytes)
+        return false;
+    uint32_t words[1 + kDDSHeaderWords + kDDSDX10Words];
+    memcpy(words, mem, kDDSPrefixBytes);
+    const uint32_t *header = words + 1;
+    const uint32_t *dx10 = header + kDDSHeaderWords;
+    if (words[0] != kDDSMagic || header[0] != 124 || header[20] != kDDSFourCCDX10)
+        return false;
+
+    KBCImage result{};
+    bool known = false;
+    for (KBCFormat format : {KBCFormat::kBC1, KBCFormat::kBC3, KBCFormat::kBC7})
+    {
+        for (bool srgb : {false, true})
+        {
+            if (bc_dxgi_format(format, srgb) == dx10[0])
+            {
+                result.format = format;
+                result.srgb = srgb;
+                known = true;
+            }
+        }
+    }
+    if (!known || header[2] == 0 || header[3] == 0)
+        return false;
+
+    // The header is checked against the file before anything is
+    // allocated: a chain can't be longer than the one down to 1x1, a
+    // row of blocks has to fit KBCLevel::pitch, and the levels have to
+    // add up to no more than the bytes after the header.
+    uint32_t width = header[3];
+    uint32_t height = header[2];
+    uint32_t max_levels = 1;
+    for (uint32_t extent = std::max(width, height); extent > 1; extent /= 2)
+        ++max_levels;
+    uint32_t nlevels = std::min(std::max(1u, header[6]), max_levels);
+
+    size_t block_size = bc_block_size(result.format);
+    size_t available = nbytes - kDDSPrefixBytes;
+    size_t total = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> sizes;
+    for (uint32_t i = 0; i < nlevels; ++i)
+    {
+        size_t columns = (static_cast<size_t>(width) + 3) / 4;
+        size_t rows = (static_cast<size_t>(height) + 3) / 4;
+        if (columns > std::numeric_limits<uint32_t>::max() / block_size)
+            return false;
+        size_t pitch = columns * block_size;
+        if (rows > available / pitch)
+            return false;
+        size_t size = pitch * rows;
+        if (size > available - total)
+            return false;
+        total += size;
+        sizes.push_back({width, height});
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+    allocate_levels(&result, sizes);
+    assert(result.data.size() == total);
+    memcpy(result.data.data(), mem + kDDSPrefixBytes, result.data.size());
+
+    *image = std::move(result);
+    return true;
+}
+
+bool save_dds(const char *filename, const KBCImage& image)
+{
+    std::vector<uint8_t> mem = write_dds(image);
+    FILE *fp = fopen(filename, "wb");
+    if (!fp)
+        return false;
+    bool ok = fwrite(mem.data(), 1, mem.size(), fp) == mem.size();
+    fclose(fp);
+    return ok;
+}
+
+bool load_dds(const char *filename, KBCImage *image)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return false;
+    fseek(fp, 0, SEEK_END);
+    long nbytes = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    std::vector<uint8_t> mem(nbytes > 0 ? static_cast<size_t>(nbytes) : 0);
+    bool ok = fread(mem.data(), 1, mem.size(), fp) == mem.size();
+    fclose(fp);
+    return ok && read_dds(mem.data(), mem.size(), image);
+}
+
+#pragma warning(pop)
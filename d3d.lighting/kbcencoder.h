@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kmipmap.h"
+
+// CPU encoder for block-compressed textures. Every 4x4 block of
+// 32-bit texels becomes one 8-byte (BC1) or 16-byte (BC3, BC7) block,
+// a 4x to 8x saving over R8G8B8A8 in both VRAM and upload bandwidth.
+//
+// BC1 and BC3 are the fast modes: the color endpoints come from the
+// principal axis of the block and are refined once by least squares.
+// BC1 is always encoded opaque (four-color mode). BC7 is the quality
+// mode and is encoded with mode 6 only (one subset, RGBA endpoints
+// with p-bits, 4-bit indices), which handles smooth color and alpha
+// well without a partition search.
+//
+// Channel order is preserved; the caller picks the DXGI format that
+// matches its texel layout. Blocks that overhang the right or bottom
+// edge repeat the edge texels.
+//
+// USAGE:
+//
+// KBCStats stats{};
+// KBCImage bc = encode_bc_chain(mip_chain, KBCFormat::kBC7, 0, &stats);
+// save_dds("texture.dds", bc);
+
+enum class KBCFormat
+{
+    kBC1,
+    kBC3,
+    kBC7
+};
+
+struct KBCLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;     // Bytes per row of blocks.
+    size_t offset;      // Byte offset of the level in KBCImage::data.
+    size_t size;
+};
+
+struct KBCImage
+{
+    KBCFormat format{KBCFormat::kBC1};
+    bool srgb{true};
+    std::vector<KBCLevel> levels;
+    std::vector<uint8_t> data;
+
+    const uint8_t* level_data(size_t level) const { return data.data() + levels[level].offset; }
+};
+
+struct KBCStats
+{
+    double psnr;                // Over all levels; alpha counts only for BC3 and BC7.
+    double seconds;             // Encode time, excluding the PSNR pass.
+    double mtexels_per_second;
+};
+
+size_t bc_block_size(KBCFormat format);
+uint32_t bc_dxgi_format(KBCFormat format, bool srgb);
+
+// src holds width x height texels, 4 bytes each, rows stride bytes
+// apart. dst receives ceil(width/4) * ceil(height/4) blocks, row by
+// row. Block rows are spread over nthreads workers (0 picks the
+// hardware concurrency).
+void encode_bc(const uint8_t *src, uint32_t width, uint32_t height, uint32_t stride,
+               KBCFormat format, uint8_t *dst, unsigned nthreads = 0);
+void decode_bc(const uint8_t *src, uint32_t width, uint32_t height,
+               KBCFormat format, uint8_t *dst, uint32_t stride);
+
+KBCImage encode_bc_chain(const KMipChain& chain, KBCFormat format,
+                         unsigned nthreads = 0, KBCStats *stats = nullptr);
+double bc_psnr(const KMipChain& chain, const KBCImage& image);
+
+// DDS with a DX10 header is the container, so that the cached blobs
+// can be inspected with stock tools. The memory variants are what the
+// file variants are built on.
+std::vector<uint8_t> write_dds(const KBCImage& image);
+bool read_dds(const uint8_t *mem, size_t nbytes, KBCImage *image);
+bool save_dds(const char *filename, const KBCImage& image);
+bool load_dds(const char *filename, KBCImage *image);
@@ -0,0 +1,178 @@
+#include "kcommandbuffer.h"
+
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+void KCommandBuffer::reset()
+{
+    draws_.clear();
+}
+
+void KCommandBuffer::draw(const KDraw& draw)
+{
+    draws_.push_back(draw);
+}
+
+// Non-negative floats order like their bit patterns, so the top 28 of
+// the 31 bits below the sign order the depths, to within a few parts in
+// a million. Anything behind the eye sorts as 0.
+static uint64_t depth_bits(float depth)
+{
+    if (!(depth > 0.f))
+        return 0;
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 3;
+}
+
+uint64_t KCommandBuffer::sort_key(const KDraw& draw)
+{
+    const KDrawState& s = draw.state;
+    assert(s[KStateSlot::kVertexShader] < (1 << 8));
+    assert(s[KStateSlot::kPixelShader] < (1 << 8));
+    assert(s[KStateSlot::kInputLayout] < (1 << 8));
+    assert(s[KStateSlot::kTexture] < (1 << 12));
+    return static_cast<uint64_t>(s[KStateSlot::kVertexShader]) << 56 |
+           static_cast<uint64_t>(s[KStateSlot::kPixelShader]) << 48 |
+           static_cast<uint64_t>(s[KStateSlot::kInputLayout]) << 40 |
+           static_cast<uint64_t>(s[KStateSlot::kTexture]) << 28 |
+           depth_bits(draw.depth);
+}
+
+// Least significant digit first, a byte at a time, which keeps draws
+// with equal keys in the order they were recorded. All eight histograms
+// come from one pass over the keys, and a byte that is the same in every
+// key, such as the high bits of ids that are all small, costs no pass.
+void KCommandBuffer::sort()
+{
+    size_t n = draws_.size();
+    items_.resize(n);
+    scratch_.resize(n);
+
+    uint32_t counts[8][256]{};
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t key = sort_key(draws_[i]);
+        items_[i] = Item{key, static_cast<uint32_t>(i)};
+        for (int b = 0; b < 8; ++b)
+            ++counts[b][(key >> (8 * b)) & 0xff];
+    }
+
+    for (int b = 0; b < 8; ++b)
+    {
+        uint32_t *count = counts[b];
+        if (count[(items_[0].key >> (8 * b)) & 0xff] == n)
+            continue;
+
+        uint32_t offset = 0;
+        for (int d = 0; d < 256; ++d)
+        {
+            uint32_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            const Item& item = items_[i];
+            scratch_[count[(item.key >> (8 * b)) & 0xff]++] = item;
+        }
+        std::swap(items_, scratch_);
+    }
+}
+
+void KCommandBuffer::submit(KRenderDevice& device, KDrawOrder order)
+{
+    if (draws_.empty())
+        return;
+
+    if (order == KDrawOrder::kSorted)
+    {
+        sort();
+    }
+    else
+    {
+        items_.resize(draws_.size());
+        for (size_t i = 0; i < draws_.size(); ++i)
+            items_[i] = Item{0, static_cast<uint32_t>(i)};
+    }
+
+    KDrawState bound{};
+    KConstantRange bound_vs_constants{};
+    KConstantRange bound_ps_constants{};
+    for (const Item& item : items_)
+    {
+        const KDraw& draw = draws_[item.draw];
+        for (int slot = 0; slot < kStateSlotCount; ++slot)
+        {
+            KStateSlot s = static_cast<KStateSlot>(slot);
+            uint16_t id = draw.state.ids[slot];
+            if (id == 0)
+                continue;
+            if (s == KStateSlot::kVSConstants || s == KStateSlot::kPSConstants)
+            {
+                bool vs = s == KStateSlot::kVSConstants;
+                const KConstantRange& range = vs ? draw.vs_constants : draw.ps_constants;
+                KConstantRange& bound_range = vs ? bound_vs_constants : bound_ps_constants;
+                if (id != bound.ids[slot] || range != bound_range)
+                {
+                    device.bind_constants(s, id, range);
+                    bound.ids[slot] = id;
+                    bound_range = range;
+                }
+            }
+            else if (id != bound.ids[slot])
+            {
+                device.bind(s, id);
+                bound.ids[slot] = id;
+            }
+        }
+        device.draw_indexed(draw.index_count, draw.start_index, draw.base_vertex);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KRecordingDevice.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void KRecordingDevice::bind(KStateSlot slot, uint16_t id)
+{
+    bound_[slot] = id;
+    ++binds_[static_cast<int>(slot)];
+}
+
+void KRecordingDevice::bind_constants(KStateSlot slot, uint16_t id, KConstantRange range)
+{
+    bound_[slot] = id;
+    (slot == KStateSlot::kVSConstants ? vs_constants_ : ps_constants_) = range;
+    ++binds_[static_cast<int>(slot)];
+}
+
+void KRecordingDevice::draw_indexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+    KDraw draw{};
+    draw.state = bound_;
+    draw.vs_constants = vs_constants_;
+    draw.ps_constants = ps_constants_;
+    draw.index_count = index_count;
+    draw.start_index = start_index;
+    draw.base_vertex = base_vertex;
+    draws_.push_back(draw);
+}
+
+void KRecordingDevice::reset()
+{
+    bound_ = KDrawState{};
+    vs_constants_ = KConstantRange{};
+    ps_constants_ = KConstantRange{};
+    memset(binds_, 0, sizeof(binds_));
+    draws_.clear();
+}
+
+uint64_t KRecordingDevice::total_binds() const
+{
+    uint64_t total = 0;
+    for (uint64_t n : binds_)
+        total += n;
+    return total;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Records the draws of a pass, sorts them by the state they need and
+// replays them to a KRenderDevice, which only hears about the state that
+// changed since the previous draw. Draws that share shaders, an input
+// layout and a texture end up next to each other, front to back within
+// such a run, and the device binds each of those once per run instead
+// of once per draw.
+//
+// The layer knows nothing of D3D. Every piece of state is a slot, and
+// every resource a small id in that slot that the device maps to its own
+// object; id 0 leaves the slot as the previous draws left it. Constant
+// buffers are bound with a range, so that draws can each have their own
+// window into one large buffer. Sorting reorders draws, so it only suits
+// draws whose order doesn't matter: opaque geometry under a depth test.
+//
+// KRecordingDevice counts the binds instead of making them, so the
+// effect of sorting can be measured without a GPU.
+//
+// USAGE:
+//
+// commands.reset();
+// KDraw draw{};
+// draw.state[KStateSlot::kVertexShader] = kBlinnPhong;
+// ...
+// draw.depth = -mv_matrix.m[3][2];
+// draw.index_count = nindex;
+// commands.draw(draw);
+// commands.submit(device);
+
+enum class KStateSlot
+{
+    kVertexShader,
+    kPixelShader,
+    kInputLayout,
+    kTexture,
+    kSampler,
+    kVertexBuffer,
+    kIndexBuffer,
+    kVSConstants,
+    kPSConstants,
+    kRasterizerState,
+    kDepthStencilState,
+    kTopology,
+    kCount
+};
+
+constexpr int kStateSlotCount{static_cast<int>(KStateSlot::kCount)};
+
+struct KDrawState
+{
+    uint16_t ids[kStateSlotCount];
+
+    uint16_t& operator[](KStateSlot slot) { return ids[static_cast<int>(slot)]; }
+    uint16_t operator[](KStateSlot slot) const { return ids[static_cast<int>(slot)]; }
+};
+
+// A window into a constant buffer, in bytes, both multiples of 256;
+// a size of 0 is the whole buffer.
+struct KConstantRange
+{
+    uint32_t offset;
+    uint32_t size;
+
+    bool operator==(const KConstantRange& other) const { return offset == other.offset && size == other.size; }
+    bool operator!=(const KConstantRange& other) const { return !(*this == other); }
+};
+
+struct KDraw
+{
+    KDrawState state;
+    KConstantRange vs_constants;    // Of the buffers in the constants slots.
+    KConstantRange ps_constants;
+    float depth;                    // Distance from the eye; nearer draws go first.
+    uint32_t index_count;
+    uint32_t start_index;
+    int32_t base_vertex;
+};
+
+class KRenderDevice
+{
+public:
+    virtual ~KRenderDevice() = default;
+    virtual void bind(KStateSlot slot, uint16_t id) = 0;
+    // For the constants slots instead of bind().
+    virtual void bind_constants(KStateSlot slot, uint16_t id, KConstantRange range) = 0;
+    virtual void draw_indexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex) = 0;
+};
+
+enum class KDrawOrder
+{
+    kSorted,
+    kRecorded   // As recorded, for comparison; binds are still elided.
+};
+
+class KCommandBuffer
+{
+public:
+    // Forgets the recorded draws and keeps the memory.
+    void reset();
+    void draw(const KDraw& draw);
+    // Replays the recorded draws; every pass starts with nothing known
+    // to be bound, so each slot a draw uses is bound at least once.
+    void submit(KRenderDevice& device, KDrawOrder order = KDrawOrder::kSorted);
+
+    size_t size() const { return draws_.size(); }
+
+    // From the most significant bits down: vertex shader (8 bits), pixel
+    // shader (8), input layout (8), texture (12) and depth (28). The ids
+    // in those slots must fit their fields.
+    static uint64_t sort_key(const KDraw& draw);
+
+private:
+    struct Item
+    {
+        uint64_t key;
+        uint32_t draw;
+    };
+
+    void sort();
+
+    std::vector<KDraw> draws_;
+    std::vector<Item> items_;
+    std::vector<Item> scratch_;
+};
+
+// Keeps the state a real device would have bound, counts the binds per
+// slot and records every draw with the state it was drawn with.
+class KRecordingDevice : public KRenderDevice
+{
+public:
+    void bind(KStateSlot slot, uint16_t id) override;
+    void bind_constants(KStateSlot slot, uint16_t id, KConstantRange range) override;
+    void draw_indexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex) override;
+
+    void reset();
+    uint64_t binds(KStateSlot slot) const { return binds_[static_cast<int>(slot)]; }
+    uint64_t total_binds() const;
+    const std::vector<KDraw>& draws() const { return draws_; }
+
+private:
+    KDrawState bound_{};
+    KConstantRange vs_constants_{};
+    KConstantRange ps_constants_{};
+    uint64_t binds_[kStateSlotCount]{};
+    std::vector<KDraw> draws_;
+};
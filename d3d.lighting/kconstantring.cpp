@@ -0,0 +1,52 @@
+#include "kconstantring.h"
+
+#include <cassert>
+
+KConstantRing::KConstantRing(uint32_t capacity) : capacity_{capacity & ~(kAlignment - 1)}
+{
+    assert(capacity_ > 0);
+}
+
+bool KConstantRing::allocate(uint32_t size, uint32_t *offset)
+{
+    size = aligned_size(size);
+    if (size == 0 || size > capacity_)
+        return false;
+
+    // Blocks are never split across the end of the ring.
+    uint32_t skipped = (head_ + size > capacity_) ? capacity_ - head_ : 0;
+    if (used_ + skipped + size > capacity_)
+        return false;
+
+    *offset = skipped ? 0 : head_;
+    head_ = *offset + size;
+    if (head_ == capacity_)
+        head_ = 0;
+    used_ += skipped + size;
+    frame_bytes_ += skipped + size;
+    return true;
+}
+
+void KConstantRing::end_frame(uint64_t frame)
+{
+    assert(frames_.empty() || frames_.back().frame < frame);
+    frames_.push_back(Frame{frame, frame_bytes_});
+    frame_bytes_ = 0;
+}
+
+void KConstantRing::retire(uint64_t frame)
+{
+    while (!frames_.empty() && frames_.front().frame <= frame)
+    {
+        used_ -= frames_.front().bytes;
+        frames_.pop_front();
+    }
+}
+
+void KConstantRing::reset()
+{
+    head_ = 0;
+    used_ = 0;
+    frame_bytes_ = 0;
+    frames_.clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Hands out space for per-draw constants from one large buffer, used as
+// a ring, instead of mapping a buffer of its own with WRITE_DISCARD for
+// every draw. Every block is a multiple of 256 bytes at a multiple of
+// 256, which is what VSSetConstantBuffers1() takes as a window into a
+// constant buffer.
+//
+// The GPU reads a frame's constants a frame or two after they were
+// written. A frame's space therefore stays in use from the moment it is
+// allocated until retire() is told the GPU has finished that frame, which
+// the D3D side learns from a query it ends with the frame. Until then the
+// ring never hands the space out again, so the buffer can be mapped with
+// NO_OVERWRITE. A block that doesn't fit before the end of the ring
+// starts over at 0 and the space skipped counts as used by its frame.
+//
+// This is only the bookkeeping; it touches no memory.
+//
+// USAGE:
+//
+// ring.retire(completed_frame);
+// uint32_t offset;
+// if (ring.allocate(sizeof(Constants), &offset))
+//     memcpy(mapped + offset, &constants, sizeof(Constants));
+// ...
+// ring.end_frame(frame);
+
+class KConstantRing
+{
+public:
+    static constexpr uint32_t kAlignment{256};
+
+    // capacity is rounded down to a multiple of kAlignment.
+    explicit KConstantRing(uint32_t capacity);
+
+    // False when the blocks of unretired frames leave no room; nothing
+    // is allocated then.
+    bool allocate(uint32_t size, uint32_t *offset);
+    // What has been allocated since the last end_frame() belongs to frame.
+    // Frames must increase.
+    void end_frame(uint64_t frame);
+    // Frees the blocks of every ended frame up to and including frame.
+    void retire(uint64_t frame);
+    // Frees everything, as after the device is lost.
+    void reset();
+
+    uint32_t capacity() const { return capacity_; }
+    uint32_t used() const { return used_; }
+    uint64_t frames_in_flight() const { return frames_.size(); }
+
+    static uint32_t aligned_size(uint32_t size) { return (size + kAlignment - 1) & ~(kAlignment - 1); }
+
+private:
+    struct Frame
+    {
+        uint64_t frame;
+        uint32_t bytes;
+    };
+
+    uint32_t capacity_{};
+    uint32_t head_{};           // Where the next block goes, unless it has to wrap.
+    uint32_t used_{};           // Bytes from the oldest unretired block up to head_.
+    uint32_t frame_bytes_{};    // Of used_, what the frame being recorded took.
+    std::deque<Frame> frames_;
+};
@@ -0,0 +1,101 @@
+#include "kd3drenderdevice.h"
+
+#include <cassert>
+
+void KD3DRenderDevice::reset(ID3D11DeviceContext1 *context)
+{
+    context_ = context;
+    for (auto& slot : entries_)
+        for (Entry& entry : slot)
+            entry = Entry{};
+}
+
+void KD3DRenderDevice::set(KStateSlot slot, uint16_t id, IUnknown *object, UINT extra)
+{
+    assert(id != 0 && id < kMaxIds);
+    entries_[static_cast<int>(slot)][id] = Entry{object, extra};
+}
+
+void KD3DRenderDevice::bind(KStateSlot slot, uint16_t id)
+{
+    if (slot == KStateSlot::kTopology)
+    {
+        context_->IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(id));
+        return;
+    }
+
+    assert(id < kMaxIds);
+    const Entry& entry = entries_[static_cast<int>(slot)][id];
+    switch (slot)
+    {
+    case KStateSlot::kVertexShader:
+        context_->VSSetShader(static_cast<ID3D11VertexShader*>(entry.object), nullptr, 0);
+        break;
+    case KStateSlot::kPixelShader:
+        context_->PSSetShader(static_cast<ID3D11PixelShader*>(entry.object), nullptr, 0);
+        break;
+    case KStateSlot::kInputLayout:
+        context_->IASetInputLayout(static_cast<ID3D11InputLayout*>(entry.object));
+        break;
+    case KStateSlot::kTexture:
+    {
+        ID3D11ShaderResourceView *view = static_cast<ID3D11ShaderResourceView*>(entry.object);
+        context_->PSSetShaderResources(0, 1, &view);
+        break;
+    }
+    case KStateSlot::kSampler:
+    {
+        ID3D11SamplerState *sampler = static_cast<ID3D11SamplerState*>(entry.object);
+        context_->PSSetSamplers(0, 1, &sampler);
+        break;
+    }
+    case KStateSlot::kVertexBuffer:
+    {
+        ID3D11Buffer *buffer = static_cast<ID3D11Buffer*>(entry.object);
+        UINT offset = 0;
+        context_->IASetVertexBuffers(0, 1, &buffer, &entry.extra, &offset);
+        break;
+    }
+    case KStateSlot::kIndexBuffer:
+        context_->IASetIndexBuffer(static_cast<ID3D11Buffer*>(entry.object),
+                                   static_cast<DXGI_FORMAT>(entry.extra), 0);
+        break;
+    case KStateSlot::kRasterizerState:
+        context_->RSSetState(static_cast<ID3D11RasterizerState*>(entry.object));
+        break;
+    case KStateSlot::kDepthStencilState:
+        context_->OMSetDepthStencilState(static_cast<ID3D11DepthStencilState*>(entry.object), 0);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+}
+
+void KD3DRenderDevice::bind_constants(KStateSlot slot, uint16_t id, KConstantRange range)
+{
+    assert(id < kMaxIds);
+    assert(slot == KStateSlot::kVSConstants || slot == KStateSlot::kPSConstants);
+    ID3D11Buffer *buffer = static_cast<ID3D11Buffer*>(entries_[static_cast<int>(slot)][id].object);
+    if (range.size == 0)
+    {
+        if (slot == KStateSlot::kVSConstants)
+            context_->VSSetConstantBuffers(0, 1, &buffer);
+        else
+            context_->PSSetConstantBuffers(0, 1, &buffer);
+        return;
+    }
+
+    // In shader constants of 16 bytes.
+    UINT first_constant = range.offset / 16;
+    UINT num_constants = range.size / 16;
+    if (slot == KStateSlot::kVSConstants)
+        context_->VSSetConstantBuffers1(0, 1, &buffer, &first_constant, &num_constants);
+    else
+        context_->PSSetConstantBuffers1(0, 1, &buffer, &first_constant, &num_constants);
+}
+
+void KD3DRenderDevice::draw_indexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+    context_->DrawIndexed(index_count, start_index, base_vertex);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <d3d11_1.h>
+
+#include "kcommandbuffer.h"
+
+// The KRenderDevice that binds to a D3D11 context. Each slot has a small
+// table from ids to the objects the owner created; the device holds no
+// references to them. Topology ids are D3D11_PRIMITIVE_TOPOLOGY values
+// and need no table.
+//
+// USAGE:
+//
+// device.reset(d3d11_device_context);
+// device.set(KStateSlot::kVertexShader, kBlinnPhong, blinnphong_vertex_shader);
+// device.set(KStateSlot::kVertexBuffer, kMesh, vertex_buffer, stride);
+// device.set(KStateSlot::kIndexBuffer, kMesh, index_buffer, DXGI_FORMAT_R16_UINT);
+// commands.submit(device);
+
+class KD3DRenderDevice : public KRenderDevice
+{
+public:
+    static constexpr int kMaxIds{16};
+
+    // Forgets every object; the context takes effect from the next bind.
+    void reset(ID3D11DeviceContext1 *context);
+    // extra is the stride of a vertex buffer and the DXGI_FORMAT of an
+    // index buffer.
+    void set(KStateSlot slot, uint16_t id, IUnknown *object, UINT extra = 0);
+
+    void bind(KStateSlot slot, uint16_t id) override;
+    // Binds a range with VSSetConstantBuffers1() and
+    // PSSetConstantBuffers1(), which need a D3D11.1 device that reports
+    // ConstantBufferOffsetting.
+    void bind_constants(KStateSlot slot, uint16_t id, KConstantRange range) override;
+    void draw_indexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex) override;
+
+private:
+    struct Entry
+    {
+        IUnknown *object;
+        UINT extra;
+    };
+
+    ID3D11DeviceContext1 *context_{};
+    Entry entries_[kStateSlotCount][kMaxIds]{};
+};
@@ -1,8 +1,15 @@
 #include <string>
+#include <vector>
+#include <chrono>
 #include <cassert>
+#include <cstdio>
 #include "kmath.h"
 #include "kd3dsurface.h"
 #include "kobjloader.h"
+#include "kmipmap.h"
+#include "kbcencoder.h"
+#include "ktexturecache.h"
+#include "kprofiler.h"
 
 KD3DSurface::KD3DSurface(HWND hwnd, int width, int height)
     : hwnd_{hwnd}, surface_width_{width}, surface_height_{height}
@@ -10,12 +17,21 @@ KD3DSurface::KD3DSurface(HWND hwnd, int width, int height)
     create_device_independent_resources();
     create_device_dependent_resources();
     create_render_target_resources();
+    start_loading();
 }
 
 KD3DSurface::~KD3DSurface()
 {
+    jobs_.wait(assets_job_);
     discard_device_dependent_resources();
     discard_device_independent_resources();
+
+    free_obj(mesh_);
+    for (auto& shader : shaders_)
+    {
+        SafeRelease(&shader.blob);
+        SafeRelease(&shader.errors);
+    }
 }
 
 void KD3DSurface::enable_d3d_debugging(ID3D11Device1 **d3d11_device)
@@ -120,16 +136,17 @@ void KD3DSurface::create_device_dependent_resources()
     dxgi_factory->Release();
 
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Create rest of the Direct3D device-dependent resources.
+    // Create rest of the Direct3D device-dependent resources. Geometry,
+    // shaders and the texture come from poll_resources() once their
+    // data has loaded; after a device loss that is right away.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    build_geometry();
-    initialize_shaders();
     create_constant_buffers();
     create_sampler_state();
-    create_texture();
+    create_placeholder_texture();
     create_rasterizer_state();
     create_depth_stencil_state();
+    poll_resources();
 }
 
 void KD3DSurface::discard_device_dependent_resources()
@@ -137,6 +154,11 @@ void KD3DSurface::discard_device_dependent_resources()
     SafeRelease(&d3d11_depth_stencil_state_);
     SafeRelease(&rasterizer_state_);
 
+    SafeRelease(&texture_view_);
+    SafeRelease(&texture_);
+    SafeRelease(&sampler_state_);
+    texture_ready_ = false;
+
     SafeRelease(&lights_vertex_shader_);
     SafeRelease(&blinnphong_vertex_shader_);
     SafeRelease(&lights_pixel_shader_);
@@ -144,13 +166,15 @@ void KD3DSurface::discard_device_dependent_resources()
 
     SafeRelease(&lights_input_layout_);
     SafeRelease(&blinnphong_input_layout_);
+    shaders_ready_ = false;
 
-    SafeRelease(&lights_constbuf_);
-    SafeRelease(&blinnphong_constbuf_);
-    SafeRelease(&blinnphong_ps_constbuf_);
+    SafeRelease(&constant_ring_buffer_);
+    for (auto& fence : frame_fences_)
+        SafeRelease(&fence);
 
     SafeRelease(&index_buffer_);
     SafeRelease(&vertex_buffer_);
+    geometry_ready_ = false;
 
     SafeRelease(&d3d11_frame_buffer_view_);
     SafeRelease(&d3d11_depth_buffer_view_);
@@ -286,10 +310,10 @@ void KD3DSurface::build_geometry()
     // assert(SUCCEEDED(hr));
 
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Read in OBJ data.
+    // Upload the OBJ data parsed by the mesh job.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    KOBJBlob objb = load_obj("3dmodel.obj");
+    const KOBJBlob& objb = mesh_;
     stride_ = sizeof(VertexData);
     nvertex_ = objb.numVertices;
     offset_ = 0;
@@ -314,8 +338,6 @@ void KD3DSurface::build_geometry()
     
     hr = d3d11_device_->CreateBuffer(&ibd, &isd, &index_buffer_);
     assert(SUCCEEDED(hr));
-    
-    free_obj(objb);
 
     ///////////////////////////////////////////////////////////////////////////////////////////
 }
@@ -323,52 +345,92 @@ void KD3DSurface::build_geometry()
 void KD3DSurface::create_constant_buffers()
 {
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Create the constant buffer for lights-vertex-shader.
+    // Create the constant buffer ring that the constants of every draw
+    // are allocated from, and a query to fence each frame in flight.
     ///////////////////////////////////////////////////////////////////////////////////////////
-    {
-        D3D11_BUFFER_DESC cbd{};
-        cbd.ByteWidth      = sizeof(KLightsConstBufDataStruct) + 0xf & 0xfffffff0; // Enforce multiple-of-16.
-        cbd.Usage          = D3D11_USAGE_DYNAMIC;
-        cbd.BindFlags      = D3D11_BIND_CONSTANT_BUFFER;
-        cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-        HRESULT hr = d3d11_device_->CreateBuffer(&cbd, nullptr, &lights_constbuf_);
-        assert(SUCCEEDED(hr));
-    }
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options{};
+    HRESULT hr = d3d11_device_->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+    assert(SUCCEEDED(hr));
+    assert(options.ConstantBufferOffsetting);
+    map_no_overwrite_ = options.MapNoOverwriteOnDynamicConstantBuffer != FALSE;
 
-    ///////////////////////////////////////////////////////////////////////////////////////////
-    // Create the constant buffer for Blinn-Phong-vertex_shader.
-    ///////////////////////////////////////////////////////////////////////////////////////////
-    {
-        D3D11_BUFFER_DESC cbd{};
-        cbd.ByteWidth      = sizeof(KBlinnPhongConstBufDataStruct) + 0xf & 0xfffffff0; // Enforce multiple-of-16.
-        cbd.Usage          = D3D11_USAGE_DYNAMIC;
-        cbd.BindFlags      = D3D11_BIND_CONSTANT_BUFFER;
-        cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    D3D11_BUFFER_DESC cbd{};
+    cbd.ByteWidth      = kConstantRingBytes;
+    cbd.Usage          = D3D11_USAGE_DYNAMIC;
+    cbd.BindFlags      = D3D11_BIND_CONSTANT_BUFFER;
+    cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    hr = d3d11_device_->CreateBuffer(&cbd, nullptr, &constant_ring_buffer_);
+    assert(SUCCEEDED(hr));
 
-        HRESULT hr = d3d11_device_->CreateBuffer(&cbd, nullptr, &blinnphong_constbuf_);
+    D3D11_QUERY_DESC qd{};
+    qd.Query = D3D11_QUERY_EVENT;
+    for (auto& fence : frame_fences_)
+    {
+        hr = d3d11_device_->CreateQuery(&qd, &fence);
         assert(SUCCEEDED(hr));
     }
 
-    ///////////////////////////////////////////////////////////////////////////////////////////
-    // Create the constant buffer for the Blinn-Phong-pixel-shader.
-    ///////////////////////////////////////////////////////////////////////////////////////////
+    constant_ring_.reset();
+    frame_ = 0;
+    retired_frames_ = 0;
+}
+
+// Frees the constants of the frames the GPU has finished with. With
+// wait_for_oldest, first waits until the oldest frame in flight is done.
+void KD3DSurface::retire_frames(bool wait_for_oldest)
+{
+    while (retired_frames_ < frame_)
     {
-        D3D11_BUFFER_DESC cbd{};
-        cbd.ByteWidth      = sizeof(KBlinnPhongPSConstBufDataStruct) + 0xf & 0xfffffff0; // Enforce multiple-of-16.
-        cbd.Usage          = D3D11_USAGE_DYNAMIC;
-        cbd.BindFlags      = D3D11_BIND_CONSTANT_BUFFER;
-        cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        ID3D11Query *fence = frame_fences_[retired_frames_ % kFramesInFlight];
+        HRESULT hr = d3d11_device_context_->GetData(fence, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        while (hr == S_FALSE && wait_for_oldest)
+        {
+            Sleep(0);
+            hr = d3d11_device_context_->GetData(fence, nullptr, 0, 0);
+        }
+        if (hr != S_OK)
+            break;
+        constant_ring_.retire(retired_frames_);
+        ++retired_frames_;
+        wait_for_oldest = false;
+    }
+}
 
-        HRESULT hr = d3d11_device_->CreateBuffer(&cbd, nullptr, &blinnphong_ps_constbuf_);
+// Where to write size bytes of a draw's constants in the mapped ring,
+// and the range to bind them with; nullptr if they can't fit at all.
+void *KD3DSurface::allocate_constants(uint32_t size, KConstantRange *range)
+{
+    uint32_t offset;
+    while (!constant_ring_.allocate(size, &offset))
+    {
+        // The frames still on the GPU hold the rest of the ring. Unless
+        // this one frame wants more than the ring holds, wait for them.
+        if (!map_no_overwrite_ || retired_frames_ == frame_)
+        {
+            assert(false);
+            return nullptr;
+        }
+        uint64_t retired = retired_frames_;
+        d3d11_device_context_->Unmap(constant_ring_buffer_, 0);
+        retire_frames(true);
+        D3D11_MAPPED_SUBRESOURCE ms{};
+        HRESULT hr = d3d11_device_context_->Map(constant_ring_buffer_, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &ms);
         assert(SUCCEEDED(hr));
+        mapped_constants_ = static_cast<uint8_t*>(ms.pData);
+        if (retired_frames_ == retired)
+            return nullptr;     // The device was lost while waiting.
     }
+    range->offset = offset;
+    range->size = KConstantRing::aligned_size(size);
+    return mapped_constants_ + offset;
 }
 
 void KD3DSurface::create_sampler_state()
 {
     D3D11_SAMPLER_DESC sd{};
-    sd.Filter         = D3D11_FILTER_MIN_MAG_MIP_POINT;
+    sd.Filter         = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
     sd.AddressU       = D3D11_TEXTURE_ADDRESS_BORDER;
     sd.AddressV       = D3D11_TEXTURE_ADDRESS_BORDER;
     sd.AddressW       = D3D11_TEXTURE_ADDRESS_BORDER;
@@ -377,27 +439,139 @@ void KD3DSurface::create_sampler_state()
     sd.BorderColor[2] = 1.0f;
     sd.BorderColor[3] = 1.0f;
     sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sd.MinLOD         = 0.0f;
+    sd.MaxLOD         = D3D11_FLOAT32_MAX;
 
     d3d11_device_->CreateSamplerState(&sd, &sampler_state_);
 }
 
+std::shared_ptr<const KTexturePayload> KD3DSurface::load_texture()
+{
+    KPROFILE_ZONE("load_texture");
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Look the processed texture up by content hash; on a warm restart
+    // this skips the decode, mip filter and encoder.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    KTextureParams params{};
+    params.compress = compress_textures_;
+    params.compression = texture_compression_;
+
+    uint64_t key{};
+    bool keyed = hash_texture_source(img_filename_, params, &key);
+    std::shared_ptr<const KTexturePayload> payload;
+    if (keyed)
+        payload = texture_cache_.find(key);
+    if (!payload)
+    {
+        KTexturePayload processed = process_texture(params);
+        payload = keyed ? texture_cache_.insert(key, std::move(processed))
+                        : std::make_shared<const KTexturePayload>(std::move(processed));
+    }
+    return payload;
+}
+
 void KD3DSurface::create_texture()
+{
+    const KTexturePayload *payload = texture_payload_.get();
+    bitmap_width_ = payload->width();
+    bitmap_height_ = payload->height();
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Create a D3D 2D texture and texture-view from the payload.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    
+    D3D11_TEXTURE2D_DESC texd{};
+    texd.Width              = bitmap_width_;
+    texd.Height             = bitmap_height_;
+    texd.MipLevels          = static_cast<UINT>(payload->levels.size());
+    texd.ArraySize          = 1;
+    texd.Format             = static_cast<DXGI_FORMAT>(payload->dxgi_format);
+    texd.SampleDesc.Count   = 1;
+    texd.Usage              = D3D11_USAGE_IMMUTABLE;
+    texd.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> texsd(payload->levels.size());
+    for (size_t i = 0; i < payload->levels.size(); ++i)
+    {
+        texsd[i].pSysMem = payload->level_data(i);
+        texsd[i].SysMemPitch = payload->levels[i].pitch;
+    }
+
+    d3d11_device_->CreateTexture2D(&texd, texsd.data(), &texture_);
+    d3d11_device_->CreateShaderResourceView(texture_, nullptr, &texture_view_);
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+}
+
+void KD3DSurface::create_placeholder_texture()
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // A single white texel stands in until the real texture has loaded.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    static const uint32_t kWhite = 0xffffffff;
+
+    D3D11_TEXTURE2D_DESC texd{};
+    texd.Width              = 1;
+    texd.Height             = 1;
+    texd.MipLevels          = 1;
+    texd.ArraySize          = 1;
+    texd.Format             = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    texd.SampleDesc.Count   = 1;
+    texd.Usage              = D3D11_USAGE_IMMUTABLE;
+    texd.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
+
+    D3D11_SUBRESOURCE_DATA texsd{&kWhite, sizeof(kWhite), 0};
+
+    d3d11_device_->CreateTexture2D(&texd, &texsd, &texture_);
+    d3d11_device_->CreateShaderResourceView(texture_, nullptr, &texture_view_);
+}
+
+KTexturePayload KD3DSurface::process_texture(const KTextureParams& params)
 {
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Create a WIC bitmap, obtain a lock, and retrieve a pointer to
-    // the bitmap memory.
+    // Decode the image through WIC, obtain a lock, and retrieve a
+    // pointer to the bitmap memory.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
+    KPROFILE_ZONE("WIC decode");
+
     HRESULT hr = S_OK;
-    hr = wic_factory_->CreateBitmapFromSource(wic_converter_,
+    IWICBitmapDecoder *decoder{};
+    hr = wic_factory_->CreateDecoderFromFilename(img_filename_.c_str(),
+                                                 nullptr,
+                                                 GENERIC_READ,
+                                                 WICDecodeMetadataCacheOnDemand,
+                                                 &decoder);
+    assert(SUCCEEDED(hr));
+    IWICBitmapFrameDecode *frame{};
+    hr = decoder->GetFrame(0, &frame);
+    assert(SUCCEEDED(hr));
+    IWICFormatConverter *converter{};
+    hr = wic_factory_->CreateFormatConverter(&converter);
+    assert(SUCCEEDED(hr));
+    hr = converter->Initialize(frame,
+                               GUID_WICPixelFormat32bppPBGRA,
+                               WICBitmapDitherTypeNone,
+                               nullptr,
+                               0.0f,
+                               WICBitmapPaletteTypeCustom);
+    assert(SUCCEEDED(hr));
+    UINT width{}, height{};
+    converter->GetSize(&width, &height);
+
+    IWICBitmap *bitmap{};
+    hr = wic_factory_->CreateBitmapFromSource(converter,
                                               WICBitmapCacheOnLoad,
-                                              &wic_bitmap_);
+                                              &bitmap);
     assert(SUCCEEDED(hr));
     WICRect lockedRect{0, 0,
-                       static_cast<INT>(bitmap_width_),
-                       static_cast<INT>(bitmap_height_)};
+                       static_cast<INT>(width),
+                       static_cast<INT>(height)};
     IWICBitmapLock *lock{};
-    hr = wic_bitmap_->Lock(&lockedRect, WICBitmapLockWrite, &lock);
+    hr = bitmap->Lock(&lockedRect, WICBitmapLockRead, &lock);
     assert(SUCCEEDED(hr));
 
     UINT stride{};
@@ -410,33 +584,40 @@ void KD3DSurface::create_texture()
     assert(SUCCEEDED(hr));
 
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Create a D3D 2D texture and texture-view from the bitmap.
+    // Filter the mip chain on the CPU, then release the WIC objects;
+    // the chain holds its own copy of level 0.
     ///////////////////////////////////////////////////////////////////////////////////////////
-    
-    D3D11_TEXTURE2D_DESC texd{};
-    texd.Width              = bitmap_width_;
-    texd.Height             = bitmap_height_;
-    texd.MipLevels          = 1;
-    texd.ArraySize          = 1;
-    texd.Format             = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-    texd.SampleDesc.Count   = 1;
-    texd.Usage              = D3D11_USAGE_IMMUTABLE;
-    texd.BindFlags          = D3D11_BIND_SHADER_RESOURCE;
 
-    D3D11_SUBRESOURCE_DATA texsd{};
-    texsd.pSysMem = mem;
-    texsd.SysMemPitch = stride;
+    KMipChain mip_chain = [&] {
+        KPROFILE_ZONE("generate_mip_chain");
+        return generate_mip_chain(mem, width, height, stride, params.filter);
+    }();
 
-    d3d11_device_->CreateTexture2D(&texd, &texsd, &texture_);
-    d3d11_device_->CreateShaderResourceView(texture_, nullptr, &texture_view_);
+    lock->Release();
+    bitmap->Release();
+    converter->Release();
+    frame->Release();
+    decoder->Release();
 
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Release the lock on the bitmap abstraction.
+    // Block-compress the chain. D3D11 requires the top level of a BC
+    // texture to be a multiple of 4 in both dimensions; other sizes are
+    // uploaded uncompressed.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    lock->Release();
+    bool compress = params.compress && (width % 4 == 0) && (height % 4 == 0);
+    if (!compress)
+        return make_texture_payload(std::move(mip_chain), DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
 
-    ///////////////////////////////////////////////////////////////////////////////////////////
+    KBCStats stats{};
+    KBCImage bc_image = encode_bc_chain(mip_chain, params.compression, 0, &stats);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "BC encode: %.2f dB PSNR, %.1f ms, %.1f Mtexels/s\n",
+             stats.psnr, stats.seconds * 1e3, stats.mtexels_per_second);
+    OutputDebugStringA(msg);
+
+    return make_texture_payload(std::move(bc_image));
 }
 
 void KD3DSurface::create_wic_resources()
@@ -452,33 +633,11 @@ void KD3DSurface::create_wic_resources()
                           CLSCTX_INPROC_SERVER,
                           IID_PPV_ARGS(&wic_factory_));
     assert(SUCCEEDED(hr));
-
-    IWICBitmapDecoder *decoder{};
-    hr = wic_factory_->CreateDecoderFromFilename(img_filename_.c_str(),
-                                                 nullptr,
-                                                 GENERIC_READ,
-                                                 WICDecodeMetadataCacheOnDemand,
-                                                 &decoder);
-    assert(SUCCEEDED(hr));
-    IWICBitmapFrameDecode *frame{};
-    hr = decoder->GetFrame(0, &frame);
-    assert(SUCCEEDED(hr));
-    hr = wic_factory_->CreateFormatConverter(&wic_converter_);
-    assert(SUCCEEDED(hr));
-    hr = wic_converter_->Initialize(frame,
-                                    GUID_WICPixelFormat32bppPBGRA,
-                                    WICBitmapDitherTypeNone,
-                                    nullptr,
-                                    0.0f,
-                                    WICBitmapPaletteTypeCustom);
-    assert(SUCCEEDED(hr));
-    wic_converter_->GetSize(&bitmap_width_, &bitmap_height_);
 }
 
 void KD3DSurface::discard_wic_resources()
 {
-    wic_converter_->Release();
-    wic_factory_->Release();
+    SafeRelease(&wic_factory_);
 }
 
 void KD3DSurface::create_rasterizer_state()
@@ -499,27 +658,37 @@ void KD3DSurface::create_depth_stencil_state()
     d3d11_device_->CreateDepthStencilState(&dsd, &d3d11_depth_stencil_state_);
 }
 
-void KD3DSurface::render(KClock& clock)
+void KD3DSurface::render(const KSimState& state)
 {
     HRESULT hr = S_OK;
     
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    camera_.update(clock);
+    poll_resources();
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    camera_.pos = state.camera_pos;
+    camera_.yaw = state.camera_yaw;
+    camera_.pitch = state.camera_pitch;
 
     view_matrix_ = translation_matrix(-camera_.pos) * rotation_y_matrix(-camera_.yaw) * rotation_x_matrix(-camera_.pitch);
     inverse_view_matrix_ = rotation_x_matrix(camera_.pitch) * rotation_y_matrix(camera_.yaw) * translation_matrix(camera_.pos);
 
     camera_.fwd = {-view_matrix_.m[2][0], -view_matrix_.m[2][1], -view_matrix_.m[2][2]};
 
-    // model_matrix_ = rotation_x_matrix(-0.2f * static_cast<float>(K_PI * clock.t)) *
-    //                 rotation_y_matrix( 0.1f * static_cast<float>(K_PI * clock.t));
+    // model_matrix_ = rotation_x_matrix(-0.2f * static_cast<float>(K_PI * state.t)) *
+    //                 rotation_y_matrix( 0.1f * static_cast<float>(K_PI * state.t));
 
     // mvp_matrix_ = model_matrix_ * view_matrix_ * perspective_matrix_;
         
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    world_state_.update(clock, view_matrix_, inverse_view_matrix_);
+    {
+        KPROFILE_ZONE("KWorldState::update");
+        world_state_.obj_pos = state.obj_pos;
+        world_state_.update(state.t, view_matrix_, inverse_view_matrix_);
+    }
 
     ///////////////////////////////////////////////////////////////////////////////////////////
 
@@ -535,90 +704,163 @@ void KD3DSurface::render(KClock& clock)
                                   0.0f, 1.0f
     };
     d3d11_device_context_->RSSetViewports(1, &d3d11_viewport);
-    d3d11_device_context_->RSSetState(rasterizer_state_);
+    d3d11_device_context_->OMSetRenderTargets(1, &d3d11_frame_buffer_view_, d3d11_depth_buffer_view_);
 
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    d3d11_device_context_->OMSetDepthStencilState(d3d11_depth_stencil_state_, 0);
-    d3d11_device_context_->OMSetRenderTargets(1, &d3d11_frame_buffer_view_, d3d11_depth_buffer_view_);
+    if (geometry_ready_ && shaders_ready_)
+    {
+        KPROFILE_ZONE("draw_scene");
+        draw_scene();
+    }
 
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    d3d11_device_context_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    d3d11_device_context_->IASetVertexBuffers(0, 1, &vertex_buffer_, &stride_, &offset_);
-    d3d11_device_context_->IASetIndexBuffer(index_buffer_, DXGI_FORMAT_R16_UINT, 0);
+    {
+        KPROFILE_ZONE("Present");
+        hr = dxgi_swap_chain_->Present(1, 0);
+    }
+    if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
+    {
+        device_lost_ = true;
+        return;
+    }
+    assert(SUCCEEDED(hr));
+
+    if (!first_frame_presented_)
+    {
+        first_frame_presented_ = true;
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time_;
+        char msg[64];
+        snprintf(msg, sizeof(msg), "First frame after %.1f ms\n", elapsed.count());
+        OutputDebugStringA(msg);
+    }
 
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Draw geometry that represent the lights in the scene.
+}
+
+// The objects can change under the ids from one frame to the next, as
+// shaders are recompiled, the texture finishes loading or the device is
+// recreated, so they are handed to render_device_ every frame.
+void KD3DSurface::set_render_device_objects()
+{
+    render_device_.reset(d3d11_device_context_);
+    render_device_.set(KStateSlot::kVertexShader, kLights, lights_vertex_shader_);
+    render_device_.set(KStateSlot::kPixelShader, kLights, lights_pixel_shader_);
+    render_device_.set(KStateSlot::kInputLayout, kLights, lights_input_layout_);
+    render_device_.set(KStateSlot::kVertexShader, kBlinnPhong, blinnphong_vertex_shader_);
+    render_device_.set(KStateSlot::kPixelShader, kBlinnPhong, blinnphong_pixel_shader_);
+    render_device_.set(KStateSlot::kInputLayout, kBlinnPhong, blinnphong_input_layout_);
+    render_device_.set(KStateSlot::kVSConstants, kShared, constant_ring_buffer_);
+    render_device_.set(KStateSlot::kPSConstants, kShared, constant_ring_buffer_);
+    render_device_.set(KStateSlot::kTexture, kShared, texture_view_);
+    render_device_.set(KStateSlot::kSampler, kShared, sampler_state_);
+    render_device_.set(KStateSlot::kVertexBuffer, kShared, vertex_buffer_, stride_);
+    render_device_.set(KStateSlot::kIndexBuffer, kShared, index_buffer_, DXGI_FORMAT_R16_UINT);
+    render_device_.set(KStateSlot::kRasterizerState, kShared, rasterizer_state_);
+    render_device_.set(KStateSlot::kDepthStencilState, kShared, d3d11_depth_stencil_state_);
+}
+
+void KD3DSurface::draw_scene()
+{
+    set_render_device_objects();
+    commands_.reset();
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Map the constant ring for the frame's constants.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    d3d11_device_context_->IASetInputLayout(lights_input_layout_);
-    d3d11_device_context_->VSSetShader(lights_vertex_shader_, nullptr, 0);
-    d3d11_device_context_->PSSetShader(lights_pixel_shader_, nullptr, 0);
-    d3d11_device_context_->VSSetConstantBuffers(0, 1, &lights_constbuf_);
+    if (map_no_overwrite_)
+        retire_frames(frame_ - retired_frames_ >= kFramesInFlight);
+    else
+        constant_ring_.reset();     // Each discard gives the frame a buffer of its own.
 
     {
+        KPROFILE_ZONE("Map constant ring");
+        D3D11_MAP map = (map_no_overwrite_ && frame_ > 0) ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
         D3D11_MAPPED_SUBRESOURCE ms{};
-        d3d11_device_context_->Map(lights_constbuf_, 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
-        KLightsConstBufDataStruct *constants = reinterpret_cast<KLightsConstBufDataStruct*>(ms.pData);
-        constants->mvp_matrix = world_state_.light_mv_matrix * perspective_matrix_;
-        constants->color = world_state_.light_color;
-        d3d11_device_context_->Unmap(lights_constbuf_, 0);
+        HRESULT hr = d3d11_device_context_->Map(constant_ring_buffer_, 0, map, 0, &ms);
+        assert(SUCCEEDED(hr));
+        mapped_constants_ = static_cast<uint8_t*>(ms.pData);
     }
 
-    d3d11_device_context_->DrawIndexed(nindex_, 0, 0);
-    
+    KDraw mesh{};
+    mesh.state[KStateSlot::kTopology] = static_cast<uint16_t>(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    mesh.state[KStateSlot::kVertexBuffer] = kShared;
+    mesh.state[KStateSlot::kIndexBuffer] = kShared;
+    mesh.state[KStateSlot::kRasterizerState] = kShared;
+    mesh.state[KStateSlot::kDepthStencilState] = kShared;
+    mesh.index_count = nindex_;
+
     ///////////////////////////////////////////////////////////////////////////////////////////
-    // Draw rest of the scene-geometry.
+    // Draw geometry that represent the lights in the scene.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    d3d11_device_context_->IASetInputLayout(blinnphong_input_layout_);
-    d3d11_device_context_->VSSetShader(blinnphong_vertex_shader_, nullptr, 0);
-    d3d11_device_context_->VSSetConstantBuffers(0, 1, &blinnphong_constbuf_);
-    d3d11_device_context_->PSSetShader(blinnphong_pixel_shader_, nullptr, 0);
-    d3d11_device_context_->PSSetConstantBuffers(0, 1, &blinnphong_ps_constbuf_);
-    d3d11_device_context_->PSSetShaderResources(0, 1, &texture_view_);
-    d3d11_device_context_->PSSetSamplers(0, 1, &sampler_state_);
+    KDraw lights = mesh;
+    lights.state[KStateSlot::kVertexShader] = kLights;
+    lights.state[KStateSlot::kPixelShader] = kLights;
+    lights.state[KStateSlot::kInputLayout] = kLights;
+    lights.state[KStateSlot::kVSConstants] = kShared;
+    lights.depth = -world_state_.light_mv_matrix.m[3][2];
 
-    // PS const buf
     {
-        D3D11_MAPPED_SUBRESOURCE msps{};
-
-        d3d11_device_context_->Map(blinnphong_ps_constbuf_, 0, D3D11_MAP_WRITE_DISCARD, 0, &msps);
-        KBlinnPhongPSConstBufDataStruct *constants = reinterpret_cast<KBlinnPhongPSConstBufDataStruct*>(msps.pData);
-        constants->dir_light.eye_dir = normalize(float4{1.f, 1.f, 1.f, 0.f});
-        constants->dir_light.color = float4{0.7f, 0.8f, 0.2f, 1.f};
-        constants->point_light.eye_pos = world_state_.light_pos_eye;
-        constants->point_light.color = world_state_.light_color;
-        d3d11_device_context_->Unmap(blinnphong_ps_constbuf_, 0);
+        KPROFILE_ZONE("Write lights constants");
+        void *block = allocate_constants(sizeof(KLightsConstBufDataStruct), &lights.vs_constants);
+        if (block != nullptr)
+        {
+            KLightsConstBufDataStruct *constants = static_cast<KLightsConstBufDataStruct*>(block);
+            constants->mvp_matrix = world_state_.light_mv_matrix * perspective_matrix_;
+            constants->color = world_state_.light_color;
+            commands_.draw(lights);
+        }
     }
+    
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Draw rest of the scene-geometry.
+    ///////////////////////////////////////////////////////////////////////////////////////////
 
-    // VS const buf
-    {
-
-        D3D11_MAPPED_SUBRESOURCE msvs{};
+    KDraw object = mesh;
+    object.state[KStateSlot::kVertexShader] = kBlinnPhong;
+    object.state[KStateSlot::kPixelShader] = kBlinnPhong;
+    object.state[KStateSlot::kInputLayout] = kBlinnPhong;
+    object.state[KStateSlot::kVSConstants] = kShared;
+    object.state[KStateSlot::kPSConstants] = kShared;
+    object.state[KStateSlot::kTexture] = kShared;
+    object.state[KStateSlot::kSampler] = kShared;
+    object.depth = -world_state_.obj_mv_matrix.m[3][2];
 
-        d3d11_device_context_->Map(blinnphong_constbuf_, 0, D3D11_MAP_WRITE_DISCARD, 0, &msvs);
-        KBlinnPhongConstBufDataStruct *constants = reinterpret_cast<KBlinnPhongConstBufDataStruct*>(msvs.pData);
-        constants->mvp_matrix = world_state_.obj_mv_matrix * perspective_matrix_;
-        constants->mv_matrix = world_state_.obj_mv_matrix;
-        constants->normal_matrix = world_state_.obj_normal_matrix;
-        d3d11_device_context_->Unmap(blinnphong_constbuf_, 0);
+    {
+        KPROFILE_ZONE("Write scene constants");
+        void *vs_block = allocate_constants(sizeof(KBlinnPhongConstBufDataStruct), &object.vs_constants);
+        void *ps_block = allocate_constants(sizeof(KBlinnPhongPSConstBufDataStruct), &object.ps_constants);
+        if (vs_block != nullptr && ps_block != nullptr)
+        {
+            KBlinnPhongConstBufDataStruct *vs_constants = static_cast<KBlinnPhongConstBufDataStruct*>(vs_block);
+            vs_constants->mvp_matrix = world_state_.obj_mv_matrix * perspective_matrix_;
+            vs_constants->mv_matrix = world_state_.obj_mv_matrix;
+            vs_constants->normal_matrix = world_state_.obj_normal_matrix;
+
+            KBlinnPhongPSConstBufDataStruct *ps_constants = static_cast<KBlinnPhongPSConstBufDataStruct*>(ps_block);
+            ps_constants->dir_light.eye_dir = normalize(float4{1.f, 1.f, 1.f, 0.f});
+            ps_constants->dir_light.color = float4{0.7f, 0.8f, 0.2f, 1.f};
+            ps_constants->point_light.eye_pos = world_state_.light_pos_eye;
+            ps_constants->point_light.color = world_state_.light_color;
+            commands_.draw(object);
+        }
     }
 
-    d3d11_device_context_->DrawIndexed(nindex_, 0, 0);
-
-    ///////////////////////////////////////////////////////////////////////////////////////////
+    d3d11_device_context_->Unmap(constant_ring_buffer_, 0);
+    mapped_constants_ = nullptr;
 
-    hr = dxgi_swap_chain_->Present(1, 0);
-    if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
     {
-        device_lost_ = true;
-        return;
+        KPROFILE_ZONE("Submit draws");
+        commands_.submit(render_device_);
     }
-    assert(SUCCEEDED(hr));
 
-    ///////////////////////////////////////////////////////////////////////////////////////////}
+    // The frame's constants are free again once the GPU gets past this.
+    d3d11_device_context_->End(frame_fences_[frame_ % kFramesInFlight]);
+    constant_ring_.end_frame(frame_);
+    ++frame_;
 }
 
 void KD3DSurface::resize()
@@ -671,26 +913,16 @@ HRESULT KD3DSurface::create_d3d_device(D3D_DRIVER_TYPE const kD3DDriverType,
 
 void KD3DSurface::initialize_shaders()
 {
-    ID3DBlob *vs_blob{};
-    ID3DBlob *ps_blob{};
+    for (auto& shader : shaders_)
+        assert(shader_compiler_succeeded(shader.hr, shader.errors));
 
     ///////////////////////////////////////////////////////////////////////////////////////////
     // Create shaders for rendering geometry that represent the lights in the scene.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    create_shader<ID3D11VertexShader>(L"lights.hlsl",
-                                      "vs_main",
-                                      "vs_5_0",
-                                      d3d11_shader_compile_options_,
-                                      &vs_blob,
-                                      &lights_vertex_shader_);
-
-    create_shader<ID3D11PixelShader>(L"lights.hlsl",
-                                     "ps_main",
-                                     "ps_5_0",
-                                     d3d11_shader_compile_options_,
-                                     &ps_blob,
-                                     &lights_pixel_shader_);
+    ID3DBlob *vs_blob = shaders_[kLightsVS].blob;
+    create_shader<ID3D11VertexShader>(vs_blob, &lights_vertex_shader_);
+    create_shader<ID3D11PixelShader>(shaders_[kLightsPS].blob, &lights_pixel_shader_);
 
     {
         D3D11_INPUT_ELEMENT_DESC kInputElementDesc[] = {
@@ -704,26 +936,13 @@ void KD3DSurface::initialize_shaders()
         assert(SUCCEEDED(hr));
     }
 
-    SafeRelease(&ps_blob);
-    SafeRelease(&vs_blob);
-
     ///////////////////////////////////////////////////////////////////////////////////////////
     // Create shaders for rendering geometry lit by the lights.
     ///////////////////////////////////////////////////////////////////////////////////////////
 
-    create_shader<ID3D11VertexShader>(L"blinnphong.hlsl",
-                                      "vs_main",
-                                      "vs_5_0",
-                                      d3d11_shader_compile_options_,
-                                      &vs_blob,
-                                      &blinnphong_vertex_shader_);
-
-    create_shader<ID3D11PixelShader>(L"blinnphong.hlsl",
-                                     "ps_main",
-                                     "ps_5_0",
-                                     d3d11_shader_compile_options_,
-                                     &ps_blob,
-                                     &blinnphong_pixel_shader_);
+    vs_blob = shaders_[kBlinnPhongVS].blob;
+    create_shader<ID3D11VertexShader>(vs_blob, &blinnphong_vertex_shader_);
+    create_shader<ID3D11PixelShader>(shaders_[kBlinnPhongPS].blob, &blinnphong_pixel_shader_);
 
     {
         D3D11_INPUT_ELEMENT_DESC kInputElementDesc[] = {
@@ -735,10 +954,95 @@ void KD3DSurface::initialize_shaders()
                                                       ARRAYSIZE(kInputElementDesc),
                                                       vs_blob->GetBufferPointer(),
                                                       vs_blob->GetBufferSize(),
-                                                      &lights_input_layout_);
+                                                      &blinnphong_input_layout_);
         assert(SUCCEEDED(hr));
     }
+}
+
+void KD3DSurface::compile_shader(int shader)
+{
+    struct KShaderSource
+    {
+        const wchar_t *filename;
+        const char *entry_point;
+        const char *target;
+    };
+    static const KShaderSource kShaderSources[kShaderCount]{
+        {L"lights.hlsl", "vs_main", "vs_5_0"},
+        {L"lights.hlsl", "ps_main", "ps_5_0"},
+        {L"blinnphong.hlsl", "vs_main", "vs_5_0"},
+        {L"blinnphong.hlsl", "ps_main", "ps_5_0"}
+    };
+
+    KPROFILE_ZONE("compile_shader");
+    const KShaderSource& source = kShaderSources[shader];
+    KCompiledShader& compiled = shaders_[shader];
+    compiled.hr = D3DCompileFromFile(source.filename,
+                                     nullptr,
+                                     nullptr,
+                                     source.entry_point,
+                                     source.target,
+                                     d3d11_shader_compile_options_,
+                                     0,
+                                     &compiled.blob,
+                                     &compiled.errors);
+}
+
+void KD3DSurface::start_loading()
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Parse the mesh, decode the texture and compile the shaders in
+    // parallel. The last job runs once all the others have finished.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    mesh_job_ = jobs_.submit([this] {
+        KPROFILE_ZONE("load_obj");
+        mesh_ = load_obj("3dmodel.obj");
+    });
+    texture_job_ = jobs_.submit([this] { texture_payload_ = load_texture(); });
+    for (int i = 0; i < kShaderCount; ++i)
+        shader_jobs_[i] = jobs_.submit([this, i] { compile_shader(i); });
+
+    std::vector<KJobHandle> assets{mesh_job_, texture_job_};
+    assets.insert(assets.end(), std::begin(shader_jobs_), std::end(shader_jobs_));
+    assets_job_ = jobs_.submit([this] {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time_;
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Assets loaded after %.1f ms\n", elapsed.count());
+        OutputDebugStringA(msg);
+    }, assets);
+}
+
+void KD3DSurface::poll_resources()
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Create the D3D resources of whatever has finished loading. Never
+    // blocks; unfinished jobs are looked at again next frame.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    if (!geometry_ready_ && mesh_job_ && jobs_.done(mesh_job_))
+    {
+        build_geometry();
+        geometry_ready_ = true;
+    }
 
-    SafeRelease(&ps_blob);
-    SafeRelease(&vs_blob);
+    if (!shaders_ready_ && shader_jobs_[0])
+    {
+        bool compiled = true;
+        for (auto& job : shader_jobs_)
+            compiled = compiled && jobs_.done(job);
+        if (compiled)
+        {
+            initialize_shaders();
+            shaders_ready_ = true;
+        }
+    }
+
+    if (!texture_ready_ && texture_job_ && jobs_.done(texture_job_))
+    {
+        SafeRelease(&texture_view_);
+        SafeRelease(&texture_);
+        create_texture();
+        texture_ready_ = true;
+    }
 }
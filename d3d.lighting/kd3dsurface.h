@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <wincodec.h>
@@ -8,9 +10,16 @@
 #include <dxgi1_2.h>
 #include <d3d11_1.h>
 
-#include "kclock.h"
+#include "ksimulation.h"
 #include "kworldstate.h"
 #include "kcamera.h"
+#include "kbcencoder.h"
+#include "ktexturecache.h"
+#include "kjobsystem.h"
+#include "kobjloader.h"
+#include "kcommandbuffer.h"
+#include "kd3drenderdevice.h"
+#include "kconstantring.h"
 
 class KD3DSurface
 {
@@ -27,27 +36,33 @@ public:
     void initialize_shaders();
 
     template <typename T>
-    void create_shader(std::wstring filename,
-                       std::string entry_point,
-                       std::string target,
-                       UINT compile_options,
-                       ID3DBlob** blob,
-                       T **d3d11_shader);
+    void create_shader(ID3DBlob *blob, T **d3d11_shader);
 
     bool shader_compiler_succeeded(HRESULT hr, ID3DBlob *shader_compiler_error_blob);
     
     void create_input_layout();
     void build_geometry();
     void create_constant_buffers();
+    void retire_frames(bool wait_for_oldest);
+    void *allocate_constants(uint32_t size, KConstantRange *range);
     void create_sampler_state();
     void create_texture();
+    void create_placeholder_texture();
+    std::shared_ptr<const KTexturePayload> load_texture();
+    KTexturePayload process_texture(const KTextureParams& params);
     void create_rasterizer_state();
     void create_depth_stencil_state();
 
     void create_wic_resources();
     void discard_wic_resources();
 
-    void render(KClock& clock);
+    void start_loading();
+    void poll_resources();
+    void compile_shader(int shader);
+
+    void render(const KSimState& state);
+    void set_render_device_objects();
+    void draw_scene();
     void resize();
     HRESULT create_d3d_device(D3D_DRIVER_TYPE const kD3DDriverType,
                               ID3D11Device1 **d3d11_device,
@@ -78,11 +93,44 @@ protected:
 
     ID3D11Buffer *vertex_buffer_{};
     ID3D11Buffer *index_buffer_{};
-    ID3D11Buffer *lights_constbuf_{};
-    ID3D11Buffer *blinnphong_constbuf_{};
-    ID3D11Buffer *blinnphong_ps_constbuf_{};
 
     ID3D11RasterizerState *rasterizer_state_{};
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // draw_scene() records the frame's draws into commands_, which
+    // replays them through render_device_ and binds only the state that
+    // changed between draws. Draws name the objects above by these ids,
+    // whatever the slot; objects of which there is one are kShared.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    enum KDrawId : uint16_t
+    {
+        kShared = 1,
+        kLights = 1,
+        kBlinnPhong = 2
+    };
+
+    KCommandBuffer commands_{};
+    KD3DRenderDevice render_device_{};
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Every draw's constants go to a block of their own in one dynamic
+    // buffer, mapped once a frame with NO_OVERWRITE, and are bound with
+    // VSSetConstantBuffers1() and an offset. An event query ends each
+    // frame; once it signals, constant_ring_ hands out that frame's
+    // blocks again. At most kFramesInFlight frames are queued on the GPU.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    static constexpr uint32_t kConstantRingBytes{1 << 20};
+    static constexpr int kFramesInFlight{3};
+
+    ID3D11Buffer *constant_ring_buffer_{};
+    ID3D11Query *frame_fences_[kFramesInFlight]{};
+    KConstantRing constant_ring_{kConstantRingBytes};
+    uint8_t *mapped_constants_{};
+    bool map_no_overwrite_{false};  // Else every frame's map discards the ring.
+    uint64_t frame_{};              // The frame being recorded.
+    uint64_t retired_frames_{};     // Frames before this one are done on the GPU.
     
     UINT stride_{};
     UINT offset_{};
@@ -131,11 +179,52 @@ protected:
     ID3D11ShaderResourceView *texture_view_{};
     
     IWICImagingFactory2 *wic_factory_{};
-    IWICFormatConverter *wic_converter_{};
-    IWICBitmap *wic_bitmap_{};
     std::wstring img_filename_{L"texture.jpg"};
     unsigned bitmap_width_{};
     unsigned bitmap_height_{};
+    bool compress_textures_{true};
+    KBCFormat texture_compression_{KBCFormat::kBC7};
+    KTextureCache texture_cache_{"texcache", 64 << 20};
+
+    ///////////////////////////////////////////////////////////////////////////////////////////
+    // Assets load in the background. Jobs fill in the CPU-side data and
+    // poll_resources() turns what has finished into D3D resources on the
+    // render thread; until then a placeholder texture is bound and the
+    // scene isn't drawn. The CPU-side data outlives the device, so
+    // device-lost recovery doesn't load anything again.
+    ///////////////////////////////////////////////////////////////////////////////////////////
+
+    enum KShader
+    {
+        kLightsVS,
+        kLightsPS,
+        kBlinnPhongVS,
+        kBlinnPhongPS,
+        kShaderCount
+    };
+
+    struct KCompiledShader
+    {
+        HRESULT hr;
+        ID3DBlob *blob;
+        ID3DBlob *errors;
+    };
+
+    KJobSystem jobs_{};
+    KJobHandle mesh_job_{};
+    KJobHandle texture_job_{};
+    KJobHandle shader_jobs_[kShaderCount]{};
+    KJobHandle assets_job_{};
+
+    KOBJBlob mesh_{};
+    std::shared_ptr<const KTexturePayload> texture_payload_{};
+    KCompiledShader shaders_[kShaderCount]{};
+
+    bool geometry_ready_{false};
+    bool shaders_ready_{false};
+    bool texture_ready_{false};
+    bool first_frame_presented_{false};
+    std::chrono::steady_clock::time_point start_time_{std::chrono::steady_clock::now()};
 
     UINT d3d11_runtime_layers_{D3D11_CREATE_DEVICE_BGRA_SUPPORT};
     UINT d3d11_shader_compile_options_{0};
@@ -147,41 +236,24 @@ protected:
 };
 
 template <typename T>
-void KD3DSurface::create_shader(std::wstring filename,
-                                std::string entry_point,
-                                std::string target,
-                                UINT compile_options,
-                                ID3DBlob** blob,
-                                T **d3d11_shader)
+void KD3DSurface::create_shader(ID3DBlob *blob, T **d3d11_shader)
 {
-    ID3DBlob *compiler_error_blob = nullptr;
-    HRESULT hr = D3DCompileFromFile(filename.c_str(),
-                                    nullptr,
-                                    nullptr,
-                                    entry_point.c_str(),
-                                    target.c_str(),
-                                    compile_options,
-                                    0,
-                                    blob,
-                                    &compiler_error_blob);
-    assert(shader_compiler_succeeded(hr, compiler_error_blob));
-
     if constexpr (std::is_same<T, ID3D11VertexShader>::value)
     {
-        hr = d3d11_device_->CreateVertexShader((*blob)->GetBufferPointer(),
-                                               (*blob)->GetBufferSize(),
-                                               nullptr,
-                                               d3d11_shader);
+        HRESULT hr = d3d11_device_->CreateVertexShader(blob->GetBufferPointer(),
+                                                       blob->GetBufferSize(),
+                                                       nullptr,
+                                                       d3d11_shader);
         assert(SUCCEEDED(hr));
         return;
     }
 
     if constexpr (std::is_same<T, ID3D11PixelShader>::value)
     {
-        hr = d3d11_device_->CreatePixelShader((*blob)->GetBufferPointer(),
-                                              (*blob)->GetBufferSize(),
-                                              nullptr,
-                                              d3d11_shader);
+        HRESULT hr = d3d11_device_->CreatePixelShader(blob->GetBufferPointer(),
+                                                      blob->GetBufferSize(),
+                                                      nullptr,
+                                                      d3d11_shader);
         assert(SUCCEEDED(hr));
         return;
     }
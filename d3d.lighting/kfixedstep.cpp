@@ -0,0 +1,36 @@
+#include <cassert>
+#include <cmath>
+#include "kfixedstep.h"
+
+KFixedStep::KFixedStep(double step, int max_steps)
+    : step_{step},
+      max_steps_{max_steps}
+{
+    assert(step > 0.0 && max_steps > 0);
+}
+
+int KFixedStep::advance(double elapsed)
+{
+    if (elapsed > 0.0)
+        accumulator_ += elapsed;
+    int steps = 0;
+    while (accumulator_ >= step_ && steps < max_steps_)
+    {
+        accumulator_ -= step_;
+        ++steps;
+    }
+    if (accumulator_ >= step_)
+    {
+        // Keep the fraction of a step, so alpha() stays continuous.
+        double kept = std::fmod(accumulator_, step_);
+        dropped_ += accumulator_ - kept;
+        accumulator_ = kept;
+    }
+    return steps;
+}
+
+void KFixedStep::reset()
+{
+    accumulator_ = 0.0;
+    dropped_ = 0.0;
+}
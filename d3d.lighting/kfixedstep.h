@@ -0,0 +1,47 @@
+#pragma once
+
+// Turns elapsed real time into a whole number of fixed simulation
+// steps. Time accumulates, and each call to advance() returns how many
+// steps of step() seconds are now due, keeping the remainder for later.
+// alpha() is the remainder as a fraction of a step, which is how far
+// the present lies between the last two simulated states.
+//
+// Because the step never changes, a simulation driven this way does
+// the same thing at any frame rate. If time runs far ahead of the
+// simulation, as after a breakpoint or a stall, at most max_steps are
+// returned and the excess is dropped, so that catching up cannot take
+// longer than the time it is catching up on.
+//
+// USAGE:
+//
+// KFixedStep stepper{1.0 / 60.0};
+// int n = stepper.advance(elapsed);
+// for (int i = 0; i < n; ++i)
+//     simulate(stepper.step());
+// draw(interpolate(previous, current, stepper.alpha()));
+
+class KFixedStep
+{
+public:
+    explicit KFixedStep(double step, int max_steps = 8);
+
+    int advance(double elapsed);
+    void reset();
+
+    double step() const;
+    float alpha() const;
+    // Time dropped so far by the max_steps limit.
+    double dropped() const;
+
+private:
+    double step_{1.0 / 60.0};
+    int max_steps_{8};
+    double accumulator_{};
+    double dropped_{};
+};
+
+inline double KFixedStep::step() const { return step_; }
+
+inline float KFixedStep::alpha() const { return static_cast<float>(accumulator_ / step_); }
+
+inline double KFixedStep::dropped() const { return dropped_; }
@@ -0,0 +1,186 @@
+#include "kjobsystem.h"
+#include "kprofiler.h"
+
+#include <algorithm>
+#include <cassert>
+
+struct KJob
+{
+    std::function<void()> fn;
+    std::atomic<size_t> pending{0};     // Unfinished dependencies, plus one while being submitted.
+    std::atomic<bool> finished{false};
+    std::mutex mutex;                   // Guards dependents against a concurrent finish.
+    std::vector<KJobHandle> dependents;
+};
+
+// Which system and deque the current thread works for; -1 on threads
+// outside the pool.
+static thread_local const KJobSystem *t_system = nullptr;
+static thread_local int t_queue = -1;
+
+KJobSystem::KJobSystem(unsigned nthreads)
+{
+    if (nthreads == 0)
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < nthreads; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < nthreads; ++i)
+        workers_.emplace_back(&KJobSystem::worker_main, this, static_cast<int>(i));
+}
+
+KJobSystem::~KJobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock{sleep_mutex_};
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+KJobHandle KJobSystem::submit(std::function<void()> fn, std::initializer_list<KJobHandle> dependencies)
+{
+    return submit(std::move(fn), dependencies.begin(), dependencies.end());
+}
+
+KJobHandle KJobSystem::submit(std::function<void()> fn, const std::vector<KJobHandle>& dependencies)
+{
+    return submit(std::move(fn), dependencies.begin(), dependencies.end());
+}
+
+template <typename It>
+KJobHandle KJobSystem::submit(std::function<void()> fn, It first, It last)
+{
+    auto job = std::make_shared<KJob>();
+    job->fn = std::move(fn);
+
+    // The extra count keeps the job from being queued by a dependency
+    // that finishes while the rest are still being registered.
+    job->pending = 1 + static_cast<size_t>(std::distance(first, last));
+    for (It it = first; it != last; ++it)
+    {
+        const KJobHandle& dependency = *it;
+        bool already_finished = true;
+        if (dependency)
+        {
+            std::lock_guard<std::mutex> lock{dependency->mutex};
+            already_finished = dependency->finished;
+            if (!already_finished)
+                dependency->dependents.push_back(job);
+        }
+        if (already_finished)
+            --job->pending;
+    }
+    if (--job->pending == 0)
+        enqueue(job);
+    return job;
+}
+
+bool KJobSystem::done(const KJobHandle& job) const
+{
+    return !job || job->finished.load(std::memory_order_acquire);
+}
+
+void KJobSystem::wait(const KJobHandle& job)
+{
+    int self = (t_system == this) ? t_queue : -1;
+    while (!done(job))
+    {
+        if (KJobHandle next = take(self))
+            run(next);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void KJobSystem::enqueue(KJobHandle job)
+{
+    int index = (t_system == this) ? t_queue : -1;
+    if (index < 0)
+        index = static_cast<int>(next_queue_++ % queues_.size());
+
+    // Counting under the sleep mutex closes the window between a worker
+    // finding nothing to do and going to sleep. The count goes up
+    // before the push so that a thief can never drive it below zero.
+    {
+        std::lock_guard<std::mutex> lock{sleep_mutex_};
+        ++queued_;
+    }
+    {
+        Queue& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        queue.jobs.push_back(std::move(job));
+    }
+    wake_.notify_one();
+}
+
+KJobHandle KJobSystem::take(int self)
+{
+    KJobHandle job;
+    if (self >= 0)
+    {
+        Queue& queue = *queues_[self];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+    }
+
+    size_t n = queues_.size();
+    size_t start = (self >= 0) ? static_cast<size_t>(self) + 1 : 0;
+    for (size_t i = 0; !job && i < n; ++i)
+    {
+        size_t victim = (start + i) % n;
+        if (static_cast<int>(victim) == self)
+            continue;
+        Queue& queue = *queues_[victim];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        if (!queue.jobs.empty())
+        {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+    }
+
+    if (job)
+        --queued_;
+    return job;
+}
+
+void KJobSystem::run(const KJobHandle& job)
+{
+    job->fn();
+    job->fn = nullptr;      // Release whatever the job captured.
+
+    std::vector<KJobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock{job->mutex};
+        job->finished.store(true, std::memory_order_release);
+        dependents.swap(job->dependents);
+    }
+    for (auto& dependent : dependents)
+        if (--dependent->pending == 0)
+            enqueue(std::move(dependent));
+}
+
+void KJobSystem::worker_main(int index)
+{
+    t_system = this;
+    t_queue = index;
+    KPROFILE_THREAD("Job worker");
+    for (;;)
+    {
+        if (KJobHandle job = take(index))
+        {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock{sleep_mutex_};
+        wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ == 0)
+            return;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed pool of worker threads that run small jobs.
+//
+// Every worker owns a deque. Jobs submitted from a worker go to the
+// back of its own deque and it pops from the back, so freshly spawned
+// work runs while its data is still in cache. An idle worker steals
+// from the front of another worker's deque, which holds the oldest and
+// usually largest jobs. Jobs submitted from other threads are spread
+// round-robin over the deques.
+//
+// A job may list jobs it depends on. It carries a counter of unfinished
+// dependencies and is queued only when that counter drops to zero, so
+// a waiting job never occupies a worker.
+//
+// USAGE:
+//
+// KJobSystem jobs{};
+// KJobHandle a = jobs.submit([&]{ parse(); });
+// KJobHandle b = jobs.submit([&]{ decode(); });
+// KJobHandle c = jobs.submit([&]{ upload(); }, {a, b});
+// if (jobs.done(c)) ...   // Poll from the render loop, or
+// jobs.wait(c);           // help out until c has run.
+
+struct KJob;
+using KJobHandle = std::shared_ptr<KJob>;
+
+class KJobSystem
+{
+public:
+    explicit KJobSystem(unsigned nthreads = 0);
+    ~KJobSystem();
+    KJobSystem(const KJobSystem&) = delete;
+    KJobSystem& operator=(const KJobSystem&) = delete;
+
+    KJobHandle submit(std::function<void()> fn, std::initializer_list<KJobHandle> dependencies = {});
+    KJobHandle submit(std::function<void()> fn, const std::vector<KJobHandle>& dependencies);
+
+    // A null handle counts as done.
+    bool done(const KJobHandle& job) const;
+
+    // Runs queued jobs on the calling thread until the job has finished.
+    void wait(const KJobHandle& job);
+
+    unsigned thread_count() const { return static_cast<unsigned>(workers_.size()); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<KJobHandle> jobs;
+    };
+
+    template <typename It>
+    KJobHandle submit(std::function<void()> fn, It first, It last);
+    void enqueue(KJobHandle job);
+    KJobHandle take(int self);
+    void run(const KJobHandle& job);
+    void worker_main(int index);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<unsigned> next_queue_{0};
+    std::atomic<size_t> queued_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+};
@@ -0,0 +1,382 @@
+#include "kmipmap.h"
+#include "kparallel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KMIP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// sRGB transfer functions and their lookup tables.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static float srgb_to_linear(float c)
+{
+    return (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_srgb(float c)
+{
+    return (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t quantize(float c)
+{
+    c = std::clamp(c, 0.0f, 1.0f);
+    return static_cast<uint8_t>(c * 255.0f + 0.5f);
+}
+
+// The encode table is indexed by linear intensity quantized to 12
+// bits, which keeps it small enough to stay in L1 while landing within
+// one unit of the exact transfer function.
+static const int kLinearLUTBits = 12;
+static const int kLinearLUTSize = 1 << kLinearLUTBits;
+
+struct KSRGBTables
+{
+    KSRGBTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            to_linear[i] = srgb_to_linear(static_cast<float>(i) / 255.0f);
+            alpha[i] = static_cast<float>(i) / 255.0f;
+        }
+        for (int i = 0; i < kLinearLUTSize; ++i)
+            to_srgb[i] = quantize(linear_to_srgb(static_cast<float>(i) / (kLinearLUTSize - 1)));
+    }
+
+    float to_linear[256];
+    float alpha[256];
+    uint8_t to_srgb[kLinearLUTSize];
+};
+
+static const KSRGBTables& srgb_tables()
+{
+    static const KSRGBTables tables;
+    return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Filter taps.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Every destination texel along one axis reads a fixed number of
+// source texels. Unused taps carry a zero weight so that the inner
+// loops never branch on the tap count.
+struct KFilterTaps
+{
+    uint32_t ntaps{};
+    std::vector<uint32_t> index;
+    std::vector<float> weight;
+};
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double y = 0.25 * x * x;
+    for (int k = 1; k < 32; ++k)
+    {
+        term *= y / (static_cast<double>(k) * static_cast<double>(k));
+        sum += term;
+        if (term < 1e-12 * sum)
+            break;
+    }
+    return sum;
+}
+
+static double kaiser_sinc(double t)
+{
+    static const double kRadius = 3.0;
+    static const double kAlpha = 4.0;
+    if (fabs(t) >= kRadius)
+        return 0.0;
+    double sinc = (t == 0.0) ? 1.0 : sin(3.14159265358979323846 * t) / (3.14159265358979323846 * t);
+    double r = t / kRadius;
+    return sinc * bessel_i0(kAlpha * sqrt(1.0 - r * r)) / bessel_i0(kAlpha);
+}
+
+static KFilterTaps build_taps(uint32_t src_size, uint32_t dst_size, KMipFilter filter)
+{
+    KFilterTaps taps{};
+    double scale = static_cast<double>(src_size) / static_cast<double>(dst_size);
+    std::vector<std::vector<std::pair<uint32_t, double>>> lists(dst_size);
+
+    for (uint32_t x = 0; x < dst_size; ++x)
+    {
+        auto& list = lists[x];
+        double lo = x * scale;
+        double hi = (x + 1) * scale;
+
+        if (filter == KMipFilter::kBox)
+        {
+            for (uint32_t j = static_cast<uint32_t>(floor(lo)); j < src_size && j < hi; ++j)
+            {
+                double overlap = std::min<double>(j + 1, hi) - std::max<double>(j, lo);
+                if (overlap > 0.0)
+                    list.push_back({j, overlap / scale});
+            }
+        }
+        else
+        {
+            // Sample a sinc cut off at the destination's Nyquist rate;
+            // taps that fall off the image are clamped to the edge.
+            double center = 0.5 * (lo + hi);
+            int first = static_cast<int>(floor(center - 3.0 * scale));
+            int last = static_cast<int>(ceil(center + 3.0 * scale));
+            double sum = 0.0;
+            for (int j = first; j <= last; ++j)
+            {
+                double w = kaiser_sinc((j + 0.5 - center) / scale);
+                if (w == 0.0)
+                    continue;
+                uint32_t idx = static_cast<uint32_t>(std::clamp<int>(j, 0, static_cast<int>(src_size) - 1));
+                list.push_back({idx, w});
+                sum += w;
+            }
+            for (auto& tap : list)
+                tap.second /= sum;
+        }
+        taps.ntaps = std::max(taps.ntaps, static_cast<uint32_t>(list.size()));
+    }
+
+    taps.index.assign(static_cast<size_t>(dst_size) * taps.ntaps, 0);
+    taps.weight.assign(static_cast<size_t>(dst_size) * taps.ntaps, 0.0f);
+    for (uint32_t x = 0; x < dst_size; ++x)
+    {
+        for (size_t k = 0; k < lists[x].size(); ++k)
+        {
+            taps.index[x * taps.ntaps + k] = lists[x][k].first;
+            taps.weight[x * taps.ntaps + k] = static_cast<float>(lists[x][k].second);
+        }
+    }
+    return taps;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Kernels. Images are linear RGBA float, four floats per texel.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static void decode_row(const uint8_t *src, float *dst, uint32_t width, bool exact)
+{
+    const KSRGBTables& t = srgb_tables();
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        for (int c = 0; c < 3; ++c)
+            dst[4 * x + c] = exact ? srgb_to_linear(src[4 * x + c] / 255.0f) : t.to_linear[src[4 * x + c]];
+        dst[4 * x + 3] = t.alpha[src[4 * x + 3]];
+    }
+}
+
+static void encode_row_exact(const float *src, uint8_t *dst, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        for (int c = 0; c < 3; ++c)
+            dst[4 * x + c] = quantize(linear_to_srgb(std::clamp(src[4 * x + c], 0.0f, 1.0f)));
+        dst[4 * x + 3] = quantize(src[4 * x + 3]);
+    }
+}
+
+static void encode_row_fast(const float *src, uint8_t *dst, uint32_t width)
+{
+    const KSRGBTables& t = srgb_tables();
+    const float kScale = static_cast<float>(kLinearLUTSize - 1);
+#if defined(KMIP_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_setr_ps(kScale, kScale, kScale, 255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    alignas(16) int32_t idx[4];
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + 4 * x), zero), one);
+        _mm_store_si128(reinterpret_cast<__m128i*>(idx),
+                        _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+        dst[4 * x + 0] = t.to_srgb[idx[0]];
+        dst[4 * x + 1] = t.to_srgb[idx[1]];
+        dst[4 * x + 2] = t.to_srgb[idx[2]];
+        dst[4 * x + 3] = static_cast<uint8_t>(idx[3]);
+    }
+#else
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            float v = std::clamp(src[4 * x + c], 0.0f, 1.0f);
+            dst[4 * x + c] = t.to_srgb[static_cast<int>(v * kScale + 0.5f)];
+        }
+        dst[4 * x + 3] = quantize(src[4 * x + 3]);
+    }
+#endif
+}
+
+static void filter_row_horizontal(const float *src, float *dst, uint32_t dst_width,
+                                  const KFilterTaps& taps, bool simd)
+{
+    const uint32_t *index = taps.index.data();
+    const float *weight = taps.weight.data();
+    for (uint32_t x = 0; x < dst_width; ++x, index += taps.ntaps, weight += taps.ntaps)
+    {
+#if defined(KMIP_SSE2)
+        if (simd)
+        {
+            __m128 acc = _mm_setzero_ps();
+            for (uint32_t k = 0; k < taps.ntaps; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + 4 * index[k]), _mm_set1_ps(weight[k])));
+            _mm_storeu_ps(dst + 4 * x, acc);
+            continue;
+        }
+#else
+        (void)simd;
+#endif
+        float acc[4]{};
+        for (uint32_t k = 0; k < taps.ntaps; ++k)
+            for (int c = 0; c < 4; ++c)
+                acc[c] += src[4 * index[k] + c] * weight[k];
+        for (int c = 0; c < 4; ++c)
+            dst[4 * x + c] = acc[c];
+    }
+}
+
+// dst = sum(weight[k] * rows[index[k]]), evaluated over whole rows so
+// the inner loop streams through contiguous memory.
+static void filter_row_vertical(const float *src, size_t src_row_floats, float *dst,
+                                const uint32_t *index, const float *weight, uint32_t ntaps, bool simd)
+{
+    size_t n = src_row_floats;
+    std::fill(dst, dst + n, 0.0f);
+    for (uint32_t k = 0; k < ntaps; ++k)
+    {
+        if (weight[k] == 0.0f)
+            continue;
+        const float *row = src + index[k] * n;
+        size_t i = 0;
+#if defined(KMIP_SSE2)
+        __m128 w = _mm_set1_ps(weight[k]);
+        for (; simd && i + 4 <= n; i += 4)
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(row + i), w)));
+#endif
+        for (; i < n; ++i)
+            dst[i] += row[i] * weight[k];
+    }
+    // Clamp so that sinc ringing doesn't compound level over level.
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = std::clamp(dst[i], 0.0f, 1.0f);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Chain construction.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t mip_level_count(uint32_t width, uint32_t height)
+{
+    uint32_t n = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        ++n;
+    return n;
+}
+
+static KMipChain allocate_chain(uint32_t width, uint32_t height)
+{
+    KMipChain chain{};
+    uint32_t nlevels = mip_level_count(width, height);
+    size_t offset = 0;
+    for (uint32_t i = 0; i < nlevels; ++i)
+    {
+        KMipLevel level{width, height, width * 4, offset};
+        chain.levels.push_back(level);
+        offset += static_cast<size_t>(level.pitch) * height;
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+    chain.data.resize(offset);
+    return chain;
+}
+
+static KMipChain build_chain(const uint8_t *src,
+                             uint32_t width,
+                             uint32_t height,
+                             uint32_t stride,
+                             KMipFilter filter,
+                             unsigned nthreads,
+                             bool exact)
+{
+    assert(src != nullptr && width > 0 && height > 0 && stride >= width * 4);
+
+    KMipChain chain = allocate_chain(width, height);
+    for (uint32_t y = 0; y < height; ++y)
+        std::copy(src + static_cast<size_t>(y) * stride,
+                  src + static_cast<size_t>(y) * stride + width * 4,
+                  chain.level_data(0) + static_cast<size_t>(y) * chain.levels[0].pitch);
+
+    std::vector<float> cur(static_cast<size_t>(width) * height * 4);
+    parallel_for(height, width, nthreads, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; ++y)
+            decode_row(src + static_cast<size_t>(y) * stride, &cur[static_cast<size_t>(y) * width * 4], width, exact);
+    });
+
+    std::vector<float> tmp;
+    std::vector<float> next;
+    for (size_t level = 1; level < chain.levels.size(); ++level)
+    {
+        const KMipLevel& prev_level = chain.levels[level - 1];
+        const KMipLevel& this_level = chain.levels[level];
+        uint32_t sw = prev_level.width;
+        uint32_t sh = prev_level.height;
+        uint32_t dw = this_level.width;
+        uint32_t dh = this_level.height;
+
+        KFilterTaps taps_x = build_taps(sw, dw, filter);
+        KFilterTaps taps_y = build_taps(sh, dh, filter);
+
+        tmp.resize(static_cast<size_t>(dw) * sh * 4);
+        parallel_for(sh, static_cast<size_t>(dw) * taps_x.ntaps, nthreads, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t y = begin; y < end; ++y)
+                filter_row_horizontal(&cur[static_cast<size_t>(y) * sw * 4], &tmp[static_cast<size_t>(y) * dw * 4], dw, taps_x, !exact);
+        });
+
+        next.resize(static_cast<size_t>(dw) * dh * 4);
+        uint8_t *out = chain.level_data(level);
+        parallel_for(dh, static_cast<size_t>(dw) * taps_y.ntaps, nthreads, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t y = begin; y < end; ++y)
+            {
+                float *row = &next[static_cast<size_t>(y) * dw * 4];
+                filter_row_vertical(tmp.data(), static_cast<size_t>(dw) * 4, row,
+                                    &taps_y.index[y * taps_y.ntaps], &taps_y.weight[y * taps_y.ntaps], taps_y.ntaps, !exact);
+                uint8_t *dst = out + static_cast<size_t>(y) * this_level.pitch;
+                if (exact)
+                    encode_row_exact(row, dst, dw);
+                else
+                    encode_row_fast(row, dst, dw);
+            }
+        });
+
+        cur.swap(next);
+    }
+
+    return chain;
+}
+
+KMipChain generate_mip_chain(const uint8_t *src,
+                             uint32_t width,
+                             uint32_t height,
+                             uint32_t stride,
+                             KMipFilter filter,
+                             unsigned nthreads)
+{
+    return build_chain(src, width, height, stride, filter, nthreads, false);
+}
+
+KMipChain generate_mip_chain_reference(const uint8_t *src,
+                                       uint32_t width,
+                                       uint32_t height,
+                                       uint32_t stride,
+                                       KMipFilter filter)
+{
+    return build_chain(src, width, height, stride, filter, 1, true);
+}
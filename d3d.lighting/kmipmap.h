@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Builds a complete mip chain on the CPU from a decoded 32-bit image,
+// ready to be handed to CreateTexture2D as an array of
+// D3D11_SUBRESOURCE_DATA, one entry per level.
+//
+// Texels are 4 bytes. Channels 0, 1 and 2 are sRGB-encoded and are
+// filtered in linear space; channel 3 is alpha and is filtered as is.
+// Level sizes follow the D3D convention: each level is half the size
+// of the previous one, rounded down, and never smaller than 1. Odd
+// sizes are handled by weighting source texels by their exact overlap
+// with the destination footprint, so non-power-of-two images don't
+// shift or lose their edge rows and columns.
+//
+// USAGE:
+//
+// KMipChain chain = generate_mip_chain(mem, width, height, stride);
+// for (size_t i = 0; i < chain.levels.size(); ++i)
+//     subresource[i] = {chain.level_data(i), chain.levels[i].pitch, 0};
+
+enum class KMipFilter
+{
+    kBox,       // Area-weighted box; cheap and never rings.
+    kKaiser     // Kaiser-windowed sinc; sharper, may ring slightly.
+};
+
+struct KMipLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;     // Bytes per row.
+    size_t offset;      // Byte offset of the level in KMipChain::data.
+};
+
+struct KMipChain
+{
+    std::vector<KMipLevel> levels;
+    std::vector<uint8_t> data;
+
+    const uint8_t* level_data(size_t level) const { return data.data() + levels[level].offset; }
+    uint8_t* level_data(size_t level) { return data.data() + levels[level].offset; }
+};
+
+uint32_t mip_level_count(uint32_t width, uint32_t height);
+
+// The fast path: LUT-based sRGB conversions, SSE filtering and rows
+// spread over nthreads workers (0 picks the hardware concurrency).
+KMipChain generate_mip_chain(const uint8_t *src,
+                             uint32_t width,
+                             uint32_t height,
+                             uint32_t stride,
+                             KMipFilter filter = KMipFilter::kBox,
+                             unsigned nthreads = 0);
+
+// Scalar, single-threaded reference with exact sRGB transfer
+// functions. The fast path matches it to within one unit per channel.
+KMipChain generate_mip_chain_reference(const uint8_t *src,
+                                       uint32_t width,
+                                       uint32_t height,
+                                       uint32_t stride,
+                                       KMipFilter filter = KMipFilter::kBox);
@@ -0,0 +1,211 @@
+#include "kprofiler.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// A KProfileEvent that the exporting thread may read while its owner
+// overwrites it; both sides use relaxed atomics.
+struct KProfileSlot
+{
+    std::atomic<const char*> name{};
+    std::atomic<int64_t> begin{};
+    std::atomic<int64_t> end{};
+};
+
+struct KProfileThread
+{
+    uint32_t id{};
+    std::string name;
+    // Count of zones ever recorded; zone i lives in events[i % kRingSize].
+    std::atomic<uint64_t> head{0};
+    KProfileSlot events[KProfiler::kRingSize];
+};
+
+std::atomic<bool> g_enabled{true};
+
+// Buffers outlive their threads, so that a trace written at exit still
+// holds the zones of workers that have finished.
+std::mutex g_registry_mutex;
+std::vector<std::unique_ptr<KProfileThread>> g_registry;
+thread_local KProfileThread *t_thread{};
+
+KFrameStats g_frame_stats;
+int64_t g_last_frame{-1};
+
+KProfileThread& this_thread()
+{
+    if (t_thread == nullptr)
+    {
+        std::lock_guard<std::mutex> lock{g_registry_mutex};
+        g_registry.push_back(std::make_unique<KProfileThread>());
+        t_thread = g_registry.back().get();
+        t_thread->id = static_cast<uint32_t>(g_registry.size());
+        t_thread->name = "Thread " + std::to_string(t_thread->id);
+    }
+    return *t_thread;
+}
+
+}
+
+void KProfiler::set_enabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool KProfiler::enabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void KProfiler::name_thread(const char *name)
+{
+    KProfileThread& thread = this_thread();
+    std::lock_guard<std::mutex> lock{g_registry_mutex};
+    thread.name = name;
+}
+
+void KProfiler::record(const char *name, int64_t begin, int64_t end)
+{
+    KProfileThread& thread = this_thread();
+    uint64_t head = thread.head.load(std::memory_order_relaxed);
+    // Orders the previous store to head before the slot's stores, so
+    // that a reader who sees any of them also sees that head.
+    std::atomic_thread_fence(std::memory_order_release);
+    KProfileSlot& slot = thread.events[head % kRingSize];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    thread.head.store(head + 1, std::memory_order_release);
+}
+
+void KProfiler::frame()
+{
+    int64_t now = monotonic_nanoseconds();
+    if (g_last_frame >= 0)
+    {
+        g_frame_stats.add(now - g_last_frame);
+        if (enabled())
+            record("Frame", g_last_frame, now);
+    }
+    g_last_frame = now;
+}
+
+KFrameSummary KProfiler::frame_summary()
+{
+    return g_frame_stats.summary();
+}
+
+size_t KProfiler::event_count()
+{
+    std::lock_guard<std::mutex> lock{g_registry_mutex};
+    size_t count = 0;
+    for (const auto& thread : g_registry)
+        count += static_cast<size_t>(std::min<uint64_t>(thread->head.load(std::memory_order_acquire), kRingSize));
+    return count;
+}
+
+// Copies out the zones of one thread while it may still be recording,
+// as a seqlock reader would. Once head reads after, the owner may be
+// writing zone after, over zone after - kRingSize; that zone and any
+// older one copied may be torn, and are dropped.
+static void copy_events(const KProfileThread& thread, std::vector<KProfileEvent>& events)
+{
+    const uint64_t ring = KProfiler::kRingSize;
+    uint64_t head = thread.head.load(std::memory_order_acquire);
+    uint64_t first = head > ring ? head - ring : 0;
+    events.clear();
+    for (uint64_t i = first; i < head; ++i)
+    {
+        const KProfileSlot& slot = thread.events[i % ring];
+        events.push_back(KProfileEvent{slot.name.load(std::memory_order_relaxed),
+                                       slot.begin.load(std::memory_order_relaxed),
+                                       slot.end.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = thread.head.load(std::memory_order_relaxed);
+    uint64_t valid = after + 1 > ring ? after + 1 - ring : 0;
+    if (valid > first)
+        events.erase(events.begin(), events.begin() + static_cast<size_t>(std::min(valid - first, head - first)));
+}
+
+// Writes s as a JSON string, quotes included. Zone and thread names
+// are the caller's, so quotes, backslashes and control characters are
+// escaped; other bytes, UTF-8 included, go through as they are.
+static void write_json_string(FILE *file, const char *s)
+{
+    fputc('"', file);
+    for (; *s; ++s)
+    {
+        unsigned char c = static_cast<unsigned char>(*s);
+        switch (c)
+        {
+        case '"':  fputs("\\\"", file); break;
+        case '\\': fputs("\\\\", file); break;
+        case '\n': fputs("\\n", file); break;
+        case '\r': fputs("\\r", file); break;
+        case '\t': fputs("\\t", file); break;
+        default:
+            if (c < 0x20)
+                fprintf(file, "\\u%04x", c);
+            else
+                fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool KProfiler::write_chrome_trace(const char *filename)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock{g_registry_mutex};
+
+    // Timestamps are in microseconds, from the earliest zone.
+    std::vector<std::vector<KProfileEvent>> threads(g_registry.size());
+    int64_t origin = INT64_MAX;
+    for (size_t i = 0; i < g_registry.size(); ++i)
+    {
+        copy_events(*g_registry[i], threads[i]);
+        for (const KProfileEvent& e : threads[i])
+            origin = std::min(origin, e.begin);
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (size_t i = 0; i < g_registry.size(); ++i)
+    {
+        const KProfileThread& thread = *g_registry[i];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",\n", thread.id);
+        write_json_string(file, thread.name.c_str());
+        fprintf(file, "}}");
+        first = false;
+        for (const KProfileEvent& e : threads[i])
+        {
+            fprintf(file, ",\n{\"name\":");
+            write_json_string(file, e.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    thread.id, (e.begin - origin) * 1e-3, (e.end - e.begin) * 1e-3);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool ok = ferror(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    return ok;
+}
+
+#pragma warning(pop)
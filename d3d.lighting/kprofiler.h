@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "kclock.h"
+
+// A CPU profiler of named zones. A zone is a scope timed by
+// KPROFILE_ZONE, whose begin and end times go into a ring buffer owned
+// by the calling thread. Each thread writes only its own buffer, so
+// recording takes no locks; the oldest zones are overwritten once a
+// buffer has wrapped. KPROFILE_FRAME marks the end of a frame, which
+// feeds the frame-time percentiles for an overlay.
+//
+// write_chrome_trace() saves every buffered zone in Chrome's trace
+// event format, for chrome://tracing or https://ui.perfetto.dev. None
+// of it needs a window or a device, so headless runs can profile too.
+//
+// The macros compile to nothing unless KPROFILE is defined, as it is in
+// debug builds. Compiled in, a zone costs two clock reads, and
+// set_enabled(false) cuts that to a flag test.
+//
+// USAGE:
+//
+// KPROFILE_THREAD("Render");
+// while (running)
+// {
+//     {
+//         KPROFILE_ZONE("Present");
+//         swap_chain->Present(1, 0);
+//     }
+//     KPROFILE_FRAME();
+// }
+// KProfiler::write_chrome_trace("profile.json");
+
+struct KProfileEvent
+{
+    const char *name;       // Must outlive the profiler: a literal.
+    int64_t begin;          // monotonic_nanoseconds().
+    int64_t end;
+};
+
+class KProfiler
+{
+public:
+    static constexpr size_t kRingSize{1 << 14}; // Zones kept per thread.
+
+    static void set_enabled(bool enabled);
+    static bool enabled();
+
+    // Names the calling thread in the trace.
+    static void name_thread(const char *name);
+
+    static void record(const char *name, int64_t begin, int64_t end);
+
+    // Ends the calling thread's frame, recording it as a zone and its
+    // length in the frame statistics. Call from one thread only.
+    static void frame();
+    static KFrameSummary frame_summary();
+
+    static size_t event_count();
+    static bool write_chrome_trace(const char *filename);
+};
+
+class KProfileZone
+{
+public:
+    explicit KProfileZone(const char *name)
+        : name_{name},
+          begin_{KProfiler::enabled() ? monotonic_nanoseconds() : -1}
+    {
+    }
+
+    ~KProfileZone()
+    {
+        if (begin_ >= 0)
+            KProfiler::record(name_, begin_, monotonic_nanoseconds());
+    }
+
+    KProfileZone(const KProfileZone&) = delete;
+    KProfileZone& operator=(const KProfileZone&) = delete;
+
+private:
+    const char *name_;
+    int64_t begin_;
+};
+
+#if defined(KPROFILE)
+#define KPROFILE_CONCAT_(a, b) a##b
+#define KPROFILE_CONCAT(a, b) KPROFILE_CONCAT_(a, b)
+#define KPROFILE_ZONE(name) KProfileZone KPROFILE_CONCAT(kprofile_zone_, __LINE__){name}
+#define KPROFILE_FRAME() KProfiler::frame()
+#define KPROFILE_THREAD(name) KProfiler::name_thread(name)
+#else
+#define KPROFILE_ZONE(name) ((void)0)
+#define KPROFILE_FRAME() ((void)0)
+#define KPROFILE_THREAD(name) ((void)0)
+#endif
@@ -1,5 +1,7 @@
+#include <cwchar>
 #include "kwindow.h"
 #include "krenderingengine.h"
+#include "kprofiler.h"
 
 using namespace std;
 
@@ -22,10 +24,16 @@ LRESULT KRenderingEngine::wndproc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lpa
         {
             DestroyWindow(hwnd);
         }
+#if defined(KPROFILE)
+        else if (wparam == VK_F2)
+        {
+            if (keystate)
+                KProfiler::write_chrome_trace("profile.json");
+        }
+#endif
         else if (k_d3d_surface_)
         {
-            // k_d3d_surface_->world_state_.keypress(wparam, keystate);
-            k_d3d_surface_->camera_.keypress(wparam, keystate);
+            simulation_.keypress(key_from_virtual_key(static_cast<uint32_t>(wparam)), keystate);
         }
         break;
     }
@@ -45,21 +53,11 @@ LRESULT KRenderingEngine::wndproc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lpa
 void KRenderingEngine::run()
 {
     static bool running = true;
-    clock.reset();
+    KPROFILE_THREAD("Render");
+    simulation_.start();
+    double title_time = 0.0;
     while (running)
     {
-        float dt{};
-        {
-            double prev_t = clock.t;
-            LARGE_INTEGER ticks;
-            QueryPerformanceCounter(&ticks);
-            clock.t = static_cast<double>(ticks.QuadPart - clock.origin_) / static_cast<double>(clock.frequency_);
-            dt = static_cast<float>(clock.t - prev_t);
-            if (dt > (1.0f / 60.0f))
-                dt = (1.0f / 60.0f);
-        }
-        clock.dt = dt;
-    
         MSG msg{};
         while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
         {
@@ -82,17 +80,26 @@ void KRenderingEngine::run()
             k_d3d_surface_->discard_device_dependent_resources();
             k_d3d_surface_->create_device_dependent_resources();
             k_d3d_surface_->create_render_target_resources();
-            k_d3d_surface_->build_geometry();
-            k_d3d_surface_->initialize_shaders();
-            k_d3d_surface_->create_constant_buffers();
-            k_d3d_surface_->create_sampler_state();
-            k_d3d_surface_->create_texture();
-            k_d3d_surface_->create_rasterizer_state();
-            k_d3d_surface_->create_depth_stencil_state();
             k_d3d_surface_->device_lost_ = false;
         }
 
         if (k_d3d_surface_ == nullptr) continue;
-        k_d3d_surface_->render(clock);
+        k_d3d_surface_->render(simulation_.sample(clock.seconds()));
+        KPROFILE_FRAME();
+
+#if defined(KPROFILE)
+        // The sample has no text on screen, so the frame times go in the
+        // window's title, refreshed once a second.
+        if (clock.seconds() - title_time >= 1.0)
+        {
+            title_time = clock.seconds();
+            KFrameSummary s = KProfiler::frame_summary();
+            wchar_t title[128];
+            swprintf(title, 128, L"frame min/avg/p99 = %.2f/%.2f/%.2f ms (F2 saves profile.json)",
+                     s.min_ms, s.avg_ms, s.p99_ms);
+            SetWindowTextW(hwnd_, title);
+        }
+#endif
     }
+    simulation_.stop();
 }
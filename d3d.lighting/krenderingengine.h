@@ -3,6 +3,7 @@
 #include <memory>
 #include "kd3dsurface.h"
 #include "kclock.h"
+#include "ksimulation.h"
 
 class KRenderingEngine : public KWindow
 {
@@ -14,4 +15,5 @@ public:
 private:
     std::unique_ptr<KD3DSurface> k_d3d_surface_{};
     KClock clock{};
+    KSimulation simulation_{[this] { return clock.seconds(); }};
 };
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include "ksimulation.h"
+#include "kprofiler.h"
+
+static float lerp(float a, float b, float alpha)
+{
+    return a + (b - a) * alpha;
+}
+
+static float3 lerp(float3 a, float3 b, float alpha)
+{
+    return {lerp(a.x, b.x, alpha), lerp(a.y, b.y, alpha), lerp(a.z, b.z, alpha)};
+}
+
+KSimState interpolate(const KSimState& a, const KSimState& b, float alpha)
+{
+    // The camera wraps yaw at a full turn; go the short way round.
+    const float two_pi = 2.0f * static_cast<float>(K_PI);
+    float yaw = a.camera_yaw;
+    if (b.camera_yaw - yaw > static_cast<float>(K_PI))
+        yaw += two_pi;
+    else if (yaw - b.camera_yaw > static_cast<float>(K_PI))
+        yaw -= two_pi;
+
+    KSimState s{};
+    s.t = a.t + (b.t - a.t) * alpha;
+    s.camera_pos = lerp(a.camera_pos, b.camera_pos, alpha);
+    s.camera_yaw = lerp(yaw, b.camera_yaw, alpha);
+    s.camera_pitch = lerp(a.camera_pitch, b.camera_pitch, alpha);
+    s.obj_pos = lerp(a.obj_pos, b.obj_pos, alpha);
+    return s;
+}
+
+KSimulation::KSimulation(std::function<double()> now, double step)
+    : now_{std::move(now)},
+      stepper_{step, std::max(1, static_cast<int>(kMaxCatchUp / step))}
+{
+    origin_ = last_ = now_();
+    previous_ = current_ = capture();
+    handoff_.back() = Snapshot{previous_, current_, origin_};
+    handoff_.publish();
+}
+
+KSimulation::~KSimulation()
+{
+    stop();
+}
+
+void KSimulation::start()
+{
+    assert(!thread_.joinable());
+    running_ = true;
+    thread_ = std::thread{&KSimulation::run, this};
+}
+
+void KSimulation::stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void KSimulation::run()
+{
+    KPROFILE_THREAD("Simulation");
+    while (running_)
+    {
+        advance(now_());
+        // Sleep until the next step is due. Sleeps may overshoot by a
+        // scheduler tick, which the next advance() makes up for.
+        double wait = stepper_.step() * (1.0 - stepper_.alpha());
+        std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+    }
+}
+
+int KSimulation::advance(double now)
+{
+    int n = stepper_.advance(now - last_);
+    last_ = now;
+    for (int i = 0; i < n; ++i)
+        step();
+    if (n > 0)
+    {
+        handoff_.back() = Snapshot{previous_, current_, origin_ + stepper_.dropped()};
+        handoff_.publish();
+    }
+    return n;
+}
+
+void KSimulation::keypress(KKey key, bool keystate)
+{
+    double time = now_();
+    std::lock_guard<std::mutex> lock{input_mutex_};
+    input_.push_back(KeyEvent{time, key, keystate});
+}
+
+void KSimulation::step()
+{
+    KPROFILE_ZONE("KSimulation::step");
+
+    // The keys that arrived before the end of the time this step
+    // simulates, in order; later ones wait for their own step. A key
+    // released after being pressed in the same step is held for the
+    // step and let go after it.
+    const int key_count = static_cast<int>(KKey::kRight) + 1;
+    bool pressed[key_count]{};
+    bool tapped[key_count]{};
+    {
+        uint64_t steps = steps_.load(std::memory_order_relaxed);
+        double end = origin_ + stepper_.dropped() + static_cast<double>(steps + 1) * stepper_.step();
+        std::lock_guard<std::mutex> lock{input_mutex_};
+        size_t n = 0;
+        for (; n < input_.size() && input_[n].time < end; ++n)
+        {
+            const KeyEvent& event = input_[n];
+            int k = static_cast<int>(event.key);
+            if (event.keystate)
+            {
+                pressed[k] = true;
+                tapped[k] = false;
+                camera_.keypress(event.key, true);
+            }
+            else if (pressed[k])
+            {
+                tapped[k] = true;
+            }
+            else
+            {
+                camera_.keypress(event.key, false);
+            }
+        }
+        input_.erase(input_.begin(), input_.begin() + n);
+    }
+
+    float dt = static_cast<float>(stepper_.step());
+    {
+        KPROFILE_ZONE("KCamera::update");
+        camera_.update(dt);
+    }
+    for (int k = 0; k < key_count; ++k)
+        if (tapped[k])
+            camera_.keypress(static_cast<KKey>(k), false);
+    {
+        KPROFILE_ZONE("KWorldState::step");
+        world_state_.step(dt);
+    }
+    steps_.fetch_add(1, std::memory_order_relaxed);
+
+    previous_ = current_;
+    current_ = capture();
+}
+
+KSimState KSimulation::capture() const
+{
+    KSimState s{};
+    s.t = static_cast<double>(steps_.load(std::memory_order_relaxed)) * stepper_.step();
+    s.camera_pos = camera_.pos;
+    s.camera_yaw = camera_.yaw;
+    s.camera_pitch = camera_.pitch;
+    s.obj_pos = world_state_.obj_pos;
+    return s;
+}
+
+KSimState KSimulation::sample(double now)
+{
+    handoff_.update();
+    const Snapshot& snapshot = handoff_.front();
+    double span = snapshot.current.t - snapshot.previous.t;
+    if (span <= 0.0)
+        return snapshot.current;
+    // One step behind, where both neighbouring states are known.
+    double t = now - snapshot.origin - stepper_.step();
+    float alpha = static_cast<float>(std::clamp((t - snapshot.previous.t) / span, 0.0, 1.0));
+    return interpolate(snapshot.previous, snapshot.current, alpha);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "kmath.h"
+#include "kcamera.h"
+#include "kworldstate.h"
+#include "kinput.h"
+#include "kfixedstep.h"
+#include "ktriplebuffer.h"
+
+// What the renderer needs from one step of the simulation.
+struct KSimState
+{
+    double t;           // Simulated seconds: steps taken times the step.
+    float3 camera_pos;
+    float camera_yaw;
+    float camera_pitch;
+    float3 obj_pos;
+};
+
+KSimState interpolate(const KSimState& a, const KSimState& b, float alpha);
+
+// Runs the camera and the world at a fixed step, apart from the frame
+// rate, so that the same input gives the same motion however fast the
+// frames come. Time is read from the now function, in seconds, which
+// may be a real clock or a virtual one.
+//
+// start() runs the simulation on its own thread; headless, the caller
+// can instead drive it with advance(). After each batch of steps the
+// last two states are handed to the render thread through a
+// KTripleBuffer, and sample() interpolates between them, one step
+// behind the present, so motion stays smooth at any frame rate.
+// Key presses may come from any thread. Each is stamped with the time
+// it arrived and takes effect at the start of the step that simulates
+// that moment, so that a batch of catch-up steps replays the keys in
+// order, as they were spread over time, rather than all at its start.
+// A key pressed and released within one step still moves the camera
+// for that step.
+//
+// USAGE:
+//
+// KSimulation simulation{[&] { return clock.seconds(); }};
+// simulation.start();
+// while (running)
+//     surface.render(simulation.sample(clock.seconds()));
+// simulation.stop();
+
+class KSimulation
+{
+public:
+    static constexpr double kStep{1.0 / 120.0};
+    // Longest stall the simulation catches up on; the rest is skipped.
+    static constexpr double kMaxCatchUp{0.25};
+
+    explicit KSimulation(std::function<double()> now, double step = kStep);
+    ~KSimulation();
+    KSimulation(const KSimulation&) = delete;
+    KSimulation& operator=(const KSimulation&) = delete;
+
+    void start();
+    void stop();
+
+    // Takes the steps that are due at time now and returns how many.
+    // Only for the thread driving the simulation.
+    int advance(double now);
+
+    // Reads the time from now, on the calling thread.
+    void keypress(KKey key, bool keystate);
+
+    // The state at time now. Only for the render thread.
+    KSimState sample(double now);
+
+    uint64_t step_count() const;
+
+private:
+    struct Snapshot
+    {
+        KSimState previous;
+        KSimState current;
+        double origin;      // When simulated time 0 was, on the clock.
+    };
+
+    void step();
+    KSimState capture() const;
+    void run();
+
+    std::function<double()> now_;
+    KFixedStep stepper_;
+    double origin_{};
+    double last_{};
+    KCamera camera_{};
+    KWorldState world_state_{};
+    KSimState previous_{};
+    KSimState current_{};
+    std::atomic<uint64_t> steps_{};
+    KTripleBuffer<Snapshot> handoff_;
+
+    struct KeyEvent
+    {
+        double time;
+        KKey key;
+        bool keystate;
+    };
+
+    std::mutex input_mutex_;
+    std::vector<KeyEvent> input_;     // In the order they arrived.
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+inline uint64_t KSimulation::step_count() const { return steps_.load(std::memory_order_relaxed); }
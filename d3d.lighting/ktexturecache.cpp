@@ -0,0 +1,320 @@
+#include "ktexturecache.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+// Bump when the mip filter or the block encoder changes their output,
+// so that stale payloads miss instead of being served.
+static const uint32_t kTextureProcessingVersion = 1;
+
+static const uint32_t kPayloadMagic = 0x5845544b;      // "KTEX"
+static const uint32_t kPayloadVersion = 1;
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Payloads.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+KTexturePayload make_texture_payload(KMipChain&& chain, uint32_t dxgi_format)
+{
+    KTexturePayload payload{};
+    payload.dxgi_format = dxgi_format;
+    for (const KMipLevel& level : chain.levels)
+        payload.levels.push_back({level.width,
+                                  level.height,
+                                  level.pitch,
+                                  level.offset,
+                                  static_cast<size_t>(level.pitch) * level.height});
+    payload.data = std::move(chain.data);
+    return payload;
+}
+
+KTexturePayload make_texture_payload(KBCImage&& image)
+{
+    KTexturePayload payload{};
+    payload.dxgi_format = bc_dxgi_format(image.format, image.srgb);
+    for (const KBCLevel& level : image.levels)
+        payload.levels.push_back({level.width, level.height, level.pitch, level.offset, level.size});
+    payload.data = std::move(image.data);
+    return payload;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Keys.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// 64-bit FNV-1a.
+uint64_t hash_bytes(const uint8_t *mem, size_t nbytes, uint64_t seed)
+{
+    uint64_t hash = seed;
+    for (size_t i = 0; i < nbytes; ++i)
+    {
+        hash ^= mem[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t texture_key(uint64_t source_hash, const KTextureParams& params)
+{
+    uint32_t words[4]{kTextureProcessingVersion,
+                      static_cast<uint32_t>(params.filter),
+                      params.compress ? 1u : 0u,
+                      static_cast<uint32_t>(params.compression)};
+    return hash_bytes(reinterpret_cast<const uint8_t*>(words), sizeof(words), source_hash);
+}
+
+bool hash_texture_source(const std::filesystem::path& filename,
+                         const KTextureParams& params,
+                         uint64_t *key)
+{
+#if defined(_WIN32)
+    FILE *fp = _wfopen(filename.c_str(), L"rb");
+#else
+    FILE *fp = fopen(filename.c_str(), "rb");
+#endif
+    if (!fp)
+        return false;
+
+    uint64_t hash = hash_bytes(nullptr, 0);
+    std::vector<uint8_t> chunk(1 << 16);
+    size_t n;
+    while ((n = fread(chunk.data(), 1, chunk.size(), fp)) > 0)
+        hash = hash_bytes(chunk.data(), n, hash);
+    bool ok = !ferror(fp);
+    fclose(fp);
+
+    *key = texture_key(hash, params);
+    return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Serialization: a header, one record per level, then the level data.
+// The key is stored too, so that a renamed or colliding file is
+// rejected rather than uploaded.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static const size_t kPayloadHeaderWords = 6;
+static const size_t kPayloadLevelWords = 4;
+
+std::vector<uint8_t> write_texture_payload(uint64_t key, const KTexturePayload& payload)
+{
+    uint32_t header[kPayloadHeaderWords]{kPayloadMagic,
+                                         kPayloadVersion,
+                                         static_cast<uint32_t>(key),
+                                         static_cast<uint32_t>(key >> 32),
+                                         payload.dxgi_format,
+                                         static_cast<uint32_t>(payload.levels.size())};
+    std::vector<uint32_t> records;
+    for (const KTextureLevel& level : payload.levels)
+    {
+        records.push_back(level.width);
+        records.push_back(level.height);
+        records.push_back(level.pitch);
+        records.push_back(static_cast<uint32_t>(level.size));
+    }
+
+    size_t record_bytes = records.size() * sizeof(uint32_t);
+    std::vector<uint8_t> mem(sizeof(header) + record_bytes + payload.data.size());
+    uint8_t *out = mem.data();
+    memcpy(out, header, sizeof(header));
+    out += sizeof(header);
+    if (record_bytes)
+        memcpy(out, records.data(), record_bytes);
+    out += record_bytes;
+    if (!payload.data.empty())
+        memcpy(out, payload.data.data(), payload.data.size());
+    return mem;
+}
+
+bool read_texture_payload(const uint8_t *mem, size_t nbytes, uint64_t key, KTexturePayload *payload)
+{
+    uint32_t header[kPayloadHeaderWords];
+    if (nbytes < sizeof(header))
+        return false;
+    memcpy(header, mem, sizeof(header));
+    uint64_t stored_key = header[2] | (static_cast<uint64_t>(header[3]) << 32);
+    if (header[0] != kPayloadMagic || header[1] != kPayloadVersion || stored_key != key)
+        return false;
+
+    size_t record_bytes = static_cast<size_t>(header[5]) * kPayloadLevelWords * sizeof(uint32_t);
+    if (header[5] == 0 || nbytes - sizeof(header) < record_bytes)
+        return false;
+    std::vector<uint32_t> records(header[5] * kPayloadLevelWords);
+    memcpy(records.data(), mem + sizeof(header), record_bytes);
+
+    KTexturePayload result{};
+    result.dxgi_format = header[4];
+    size_t offset = 0;
+    for (size_t i = 0; i < records.size(); i += kPayloadLevelWords)
+    {
+        result.levels.push_back({records[i], records[i + 1], records[i + 2], offset, records[i + 3]});
+        offset += records[i + 3];
+    }
+    if (nbytes - sizeof(header) - record_bytes < offset)
+        return false;
+    const uint8_t *in = mem + sizeof(header) + record_bytes;
+    result.data.assign(in, in + offset);
+
+    *payload = std::move(result);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Cache.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+KTextureCache::KTextureCache(std::filesystem::path directory, size_t memory_budget)
+    : directory_{std::move(directory)}, memory_budget_{memory_budget}
+{
+}
+
+std::filesystem::path KTextureCache::filename(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.ktex", static_cast<unsigned long long>(key));
+    return directory_ / name;
+}
+
+std::shared_ptr<const KTexturePayload> KTextureCache::find(uint64_t key)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto it = entries_.find(key);
+        if (it != entries_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            ++stats_.memory_hits;
+            return it->second.payload;
+        }
+    }
+
+    // Disk reads happen outside the lock so that other threads can keep
+    // hitting memory meanwhile.
+    std::vector<uint8_t> mem;
+    auto path = filename(key);
+    std::error_code ec;
+    uintmax_t nbytes = std::filesystem::file_size(path, ec);
+    bool ok = false;
+    if (!ec)
+    {
+#if defined(_WIN32)
+        FILE *fp = _wfopen(path.c_str(), L"rb");
+#else
+        FILE *fp = fopen(path.c_str(), "rb");
+#endif
+        if (fp)
+        {
+            mem.resize(static_cast<size_t>(nbytes));
+            ok = fread(mem.data(), 1, mem.size(), fp) == mem.size();
+            fclose(fp);
+        }
+    }
+
+    auto payload = std::make_shared<KTexturePayload>();
+    if (!ok || !read_texture_payload(mem.data(), mem.size(), key, payload.get()))
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++stats_.disk_hits;
+    retain(key, payload);
+    return payload;
+}
+
+std::shared_ptr<const KTexturePayload> KTextureCache::insert(uint64_t key, KTexturePayload&& payload)
+{
+    auto shared = std::make_shared<const KTexturePayload>(std::move(payload));
+
+    // Write to a temporary name and rename, so that a crash mid-write
+    // never leaves a truncated payload under the real name.
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    if (!ec)
+    {
+        std::vector<uint8_t> mem = write_texture_payload(key, *shared);
+        auto path = filename(key);
+        auto temp = path;
+        temp += ".tmp";
+#if defined(_WIN32)
+        FILE *fp = _wfopen(temp.c_str(), L"wb");
+#else
+        FILE *fp = fopen(temp.c_str(), "wb");
+#endif
+        if (fp)
+        {
+            bool ok = fwrite(mem.data(), 1, mem.size(), fp) == mem.size();
+            ok = (fclose(fp) == 0) && ok;
+            if (ok)
+                std::filesystem::rename(temp, path, ec);
+            if (!ok || ec)
+                std::filesystem::remove(temp, ec);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    retain(key, shared);
+    return shared;
+}
+
+void KTextureCache::set_memory_budget(size_t memory_budget)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    memory_budget_ = memory_budget;
+    evict();
+}
+
+size_t KTextureCache::memory_used() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return memory_used_;
+}
+
+KTextureCacheStats KTextureCache::stats() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return stats_;
+}
+
+// Called with the lock held.
+void KTextureCache::retain(uint64_t key, std::shared_ptr<const KTexturePayload> payload)
+{
+    auto it = entries_.find(key);
+    if (it != entries_.end())
+    {
+        memory_used_ -= it->second.payload->data.size();
+        it->second.payload = payload;
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+    }
+    else
+    {
+        lru_.push_front(key);
+        entries_.emplace(key, Entry{payload, lru_.begin()});
+    }
+    memory_used_ += payload->data.size();
+    evict();
+}
+
+// Called with the lock held. A payload larger than the whole budget is
+// evicted straight away; the caller's pointer and the disk copy remain.
+void KTextureCache::evict()
+{
+    while (memory_used_ > memory_budget_ && !lru_.empty())
+    {
+        auto it = entries_.find(lru_.back());
+        assert(it != entries_.end());
+        memory_used_ -= it->second.payload->data.size();
+        entries_.erase(it);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+#pragma warning(pop)
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kmipmap.h"
+#include "kbcencoder.h"
+
+// Content-addressed cache of fully processed texture payloads: decoded,
+// mipped and, optionally, block-compressed, i.e. exactly what goes into
+// CreateTexture2D. Payloads are keyed by a hash of the source file's
+// bytes mixed with the processing parameters, so an edited source or a
+// changed setting simply misses, and nothing ever needs invalidating.
+//
+// Lookups try memory first, then the cache directory on disk. Memory
+// holds the most recently used payloads up to a byte budget; older ones
+// are evicted but stay on disk, which is what makes device-lost
+// recovery and warm restarts skip the decode and processing entirely.
+// Payloads are handed out as shared pointers, so eviction never pulls
+// data from under a caller that is still uploading it.
+//
+// find() and insert() may be called from multiple threads.
+//
+// USAGE:
+//
+// uint64_t key{};
+// if (hash_texture_source(L"texture.jpg", params, &key))
+//     payload = cache.find(key);
+// if (!payload)
+//     payload = cache.insert(key, make_texture_payload(std::move(chain), format));
+
+struct KTextureParams
+{
+    KMipFilter filter{KMipFilter::kBox};
+    bool compress{true};
+    KBCFormat compression{KBCFormat::kBC7};
+};
+
+struct KTextureLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;     // Bytes per row; per row of blocks if compressed.
+    size_t offset;      // Byte offset of the level in KTexturePayload::data.
+    size_t size;
+};
+
+struct KTexturePayload
+{
+    uint32_t dxgi_format{};
+    std::vector<KTextureLevel> levels;
+    std::vector<uint8_t> data;
+
+    const uint8_t* level_data(size_t level) const { return data.data() + levels[level].offset; }
+    uint32_t width() const { return levels.empty() ? 0 : levels[0].width; }
+    uint32_t height() const { return levels.empty() ? 0 : levels[0].height; }
+};
+
+struct KTextureCacheStats
+{
+    uint64_t memory_hits;
+    uint64_t disk_hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+KTexturePayload make_texture_payload(KMipChain&& chain, uint32_t dxgi_format);
+KTexturePayload make_texture_payload(KBCImage&& image);
+
+uint64_t hash_bytes(const uint8_t *mem, size_t nbytes, uint64_t seed = 0xcbf29ce484222325ull);
+uint64_t texture_key(uint64_t source_hash, const KTextureParams& params);
+
+// Hashes the file's bytes; reading them is far cheaper than decoding.
+bool hash_texture_source(const std::filesystem::path& filename,
+                         const KTextureParams& params,
+                         uint64_t *key);
+
+std::vector<uint8_t> write_texture_payload(uint64_t key, const KTexturePayload& payload);
+bool read_texture_payload(const uint8_t *mem, size_t nbytes, uint64_t key, KTexturePayload *payload);
+
+class KTextureCache
+{
+public:
+    KTextureCache(std::filesystem::path directory, size_t memory_budget);
+
+    std::shared_ptr<const KTexturePayload> find(uint64_t key);
+    std::shared_ptr<const KTexturePayload> insert(uint64_t key, KTexturePayload&& payload);
+
+    void set_memory_budget(size_t memory_budget);
+    size_t memory_used() const;
+    KTextureCacheStats stats() const;
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const KTexturePayload> payload;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    std::filesystem::path filename(uint64_t key) const;
+    void retain(uint64_t key, std::shared_ptr<const KTexturePayload> payload);
+    void evict();
+
+    std::filesystem::path directory_;
+    size_t memory_budget_{};
+    size_t memory_used_{};
+    KTextureCacheStats stats_{};
+    std::list<uint64_t> lru_;       // Most recently used first.
+    std::unordered_map<uint64_t, Entry> entries_;
+    mutable std::mutex mutex_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the latest value of a T from one writer thread to one reader
+// thread without locks, and without either ever waiting on the other.
+// Of three slots, the writer owns one and the reader owns one. The
+// third sits between them and is swapped atomically: publish() swaps
+// the writer's slot in, and update() swaps the reader's slot for it
+// when it holds something the reader hasn't seen. The reader always
+// sees the most recent value published; values it is too slow to pick
+// up are dropped.
+//
+// USAGE:
+//
+// KTripleBuffer<State> buffer;
+// // Writer:
+// buffer.back() = state;
+// buffer.publish();
+// // Reader:
+// buffer.update();
+// draw(buffer.front());
+
+template <typename T>
+class KTripleBuffer
+{
+public:
+    T& back() { return slots_[back_]; }
+    void publish();
+
+    // Returns whether front() changed.
+    bool update();
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static const int kIndexMask{3};
+    static const int kFresh{4};
+
+    T slots_[3]{};
+    int back_{0};
+    int front_{1};
+    std::atomic<int> middle_{2};
+};
+
+template <typename T>
+void KTripleBuffer<T>::publish()
+{
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndexMask;
+}
+
+template <typename T>
+bool KTripleBuffer<T>::update()
+{
+    if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0)
+        return false;
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+}
@@ -0,0 +1,12 @@
+@echo off
+
+set COMMON_COMPILER_FLAGS=/c /nologo /EHsc /GR- /fp:fast /Oi /W4 /Fm /std:c++17
+set DEBUG_FLAGS=/DDEBUG_BUILD /Od /MTd /Zi
+set PREPROCESSOR_DEFINITIONS=/DUNICODE /DNOMINMAX
+set RELEASE_FLAGS=/O2
+set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %DEBUG_FLAGS% %PREPROCESSOR_DEFINITIONS%
+REM set COMPILER_FLAGS=%COMMON_COMPILER_FLAGS% %RELEASE_FLAGS%
+set SRC=kcpu.cpp kinput.cpp kmath.cpp kcamera.cpp kworldstate.cpp kobjloader.cpp kclock.cpp kbitmap.cpp kraster.cpp kscene.cpp kparticles.cpp kgeometry.cpp kshapestore.cpp kspatialgrid.cpp kscenefile.cpp kmappedfile.cpp
+cl %COMPILER_FLAGS% %SRC%
+lib /OUT:kcore.lib kcpu.obj kinput.obj kmath.obj kcamera.obj kworldstate.obj kobjloader.obj kclock.obj kbitmap.obj kraster.obj kscene.obj kparticles.obj kgeometry.obj kshapestore.obj kspatialgrid.obj kscenefile.obj kmappedfile.obj
+echo Done
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "kbitmap.h"
+#include "kraster.h"
+
+KBitmap::KBitmap(int width, int height) : width_{width}, height_{height}
+{
+    stride_ = width_ * bytes_per_pixel_;
+    size_ = width_ * height_;
+    mem_ = new uint32_t[size_];
+    clear(0xffffffff);
+}
+
+KBitmap::~KBitmap()
+{
+    delete [] mem_;
+}
+
+// The single point leaves a trail; with particles, which would soon
+// cover everything, each frame shows only where they are now.
+void KBitmap::draw(KScene& scene)
+{
+    if (scene.particles_.size() > 0)
+    {
+        clear(0xffffffff);
+        scene.particles_.splat(*this, 0xff000000);
+    }
+    put_pixel(static_cast<int>(scene.x_), static_cast<int>(scene.y_), 0x00000000);    
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Raster operations.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void KBitmap::clear(uint32_t color)
+{
+    // Rows are contiguous, so the whole bitmap is one span.
+    fill_row(mem_, size_, color);
+    mark_all_dirty();
+}
+
+void KBitmap::fill_rect(int x, int y, int width, int height, uint32_t color)
+{
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + width, width_);
+    int y1 = std::min(y + height, height_);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    mark_dirty(x0, y0, x1 - x0, y1 - y0);
+    if (x0 == 0 && x1 == width_)
+    {
+        fill_row(mem_ + y0 * width_, (y1 - y0) * width_, color);
+        return;
+    }
+    for (int row = y0; row < y1; ++row)
+        fill_row(mem_ + row * width_ + x0, x1 - x0, color);
+}
+
+// Trims a source rectangle and its destination position so that both
+// lie inside their bitmaps. Returns false if nothing is left.
+static bool clip_blit(int src_width, int src_height, int dst_width, int dst_height,
+                      int *src_x, int *src_y, int *width, int *height, int *dst_x, int *dst_y)
+{
+    int left = std::max({0, -*src_x, -*dst_x});
+    int top = std::max({0, -*src_y, -*dst_y});
+    *src_x += left;
+    *dst_x += left;
+    *width -= left;
+    *src_y += top;
+    *dst_y += top;
+    *height -= top;
+    *width = std::min({*width, src_width - *src_x, dst_width - *dst_x});
+    *height = std::min({*height, src_height - *src_y, dst_height - *dst_y});
+    return *width > 0 && *height > 0;
+}
+
+void KBitmap::blit(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y)
+{
+    if (!clip_blit(src.width_, src.height_, width_, height_, &src_x, &src_y, &width, &height, &dst_x, &dst_y))
+        return;
+
+    // Walk bottom-up when copying downwards within one bitmap, so that
+    // no source row is overwritten before it has been read.
+    mark_dirty(dst_x, dst_y, width, height);
+    bool reverse = (&src == this) && (dst_y > src_y);
+    for (int i = 0; i < height; ++i)
+    {
+        int row = reverse ? height - 1 - i : i;
+        memmove(mem_ + (dst_y + row) * width_ + dst_x,
+                src.mem_ + (src_y + row) * src.width_ + src_x,
+                static_cast<size_t>(width) * sizeof(uint32_t));
+    }
+}
+
+void KBitmap::blend(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y)
+{
+    if (!clip_blit(src.width_, src.height_, width_, height_, &src_x, &src_y, &width, &height, &dst_x, &dst_y))
+        return;
+    mark_dirty(dst_x, dst_y, width, height);
+    for (int row = 0; row < height; ++row)
+        blend_row(mem_ + (dst_y + row) * width_ + dst_x,
+                  src.mem_ + (src_y + row) * src.width_ + src_x,
+                  width);
+}
+
+void KBitmap::blit_scaled(const KBitmap& src, int dst_x, int dst_y, int dst_width, int dst_height, bool blend)
+{
+    if (dst_width <= 0 || dst_height <= 0)
+        return;
+    int x0 = std::max(dst_x, 0);
+    int y0 = std::max(dst_y, 0);
+    int x1 = std::min(dst_x + dst_width, width_);
+    int y1 = std::min(dst_y + dst_height, height_);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    mark_dirty(x0, y0, x1 - x0, y1 - y0);
+
+    // Source position of destination pixel i, in 16.16 fixed point:
+    // (i + 0.5) * src_size / dst_size - 0.5.
+    int32_t dx = static_cast<int32_t>((static_cast<int64_t>(src.width_) << 16) / dst_width);
+    int32_t dy = static_cast<int32_t>((static_cast<int64_t>(src.height_) << 16) / dst_height);
+    int32_t sx0 = dx / 2 - 0x8000 + (x0 - dst_x) * dx;
+    int32_t sy_max = (src.height_ - 1) << 16;
+
+    std::vector<uint32_t> scratch(blend ? x1 - x0 : 0);
+    for (int row = y0; row < y1; ++row)
+    {
+        int32_t sy = std::clamp(dy / 2 - 0x8000 + (row - dst_y) * dy, 0, sy_max);
+        int iy = sy >> 16;
+        const uint32_t *row0 = src.mem_ + iy * src.width_;
+        const uint32_t *row1 = src.mem_ + std::min(iy + 1, src.height_ - 1) * src.width_;
+        int wy = (sy & 0xffff) >> 8;
+
+        uint32_t *dst = mem_ + row * width_ + x0;
+        uint32_t *out = blend ? scratch.data() : dst;
+        scale_row_bilinear(out, x1 - x0, row0, row1, src.width_, sx0, dx, wy);
+        if (blend)
+            blend_row(dst, out, x1 - x0);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Dirty-rectangle tracking.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static int64_t area(const KRect& r)
+{
+    return static_cast<int64_t>(r.width) * r.height;
+}
+
+static KRect bounding_rect(const KRect& a, const KRect& b)
+{
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.width, b.x + b.width);
+    int y1 = std::max(a.y + a.height, b.y + b.height);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+static bool contains(const KRect& outer, const KRect& inner)
+{
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+void KBitmap::mark_dirty(int x, int y, int width, int height)
+{
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + width, width_);
+    int y1 = std::min(y + height, height_);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    KRect rect{x0, y0, x1 - x0, y1 - y0};
+
+    for (const KRect& r : dirty_)
+        if (contains(r, rect))
+            return;
+
+    // Absorb every rectangle that the new one covers or that it can be
+    // merged with for at most a quarter more area than the two cover
+    // separately; repeat, since a merge can reach further rectangles.
+    for (bool merged = true; merged;)
+    {
+        merged = false;
+        for (size_t i = 0; i < dirty_.size(); ++i)
+        {
+            KRect bounds = bounding_rect(dirty_[i], rect);
+            if (4 * area(bounds) <= 5 * (area(dirty_[i]) + area(rect)))
+            {
+                rect = bounds;
+                dirty_[i] = dirty_.back();
+                dirty_.pop_back();
+                merged = true;
+                break;
+            }
+        }
+    }
+    dirty_.push_back(rect);
+
+    // Over budget: merge the pair that wastes the least area.
+    while (dirty_.size() > static_cast<size_t>(kMaxDirtyRects))
+    {
+        size_t best_i = 0;
+        size_t best_j = 1;
+        int64_t best_waste = INT64_MAX;
+        for (size_t i = 0; i < dirty_.size(); ++i)
+        {
+            for (size_t j = i + 1; j < dirty_.size(); ++j)
+            {
+                int64_t waste = area(bounding_rect(dirty_[i], dirty_[j])) - area(dirty_[i]) - area(dirty_[j]);
+                if (waste < best_waste)
+                {
+                    best_waste = waste;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        dirty_[best_i] = bounding_rect(dirty_[best_i], dirty_[best_j]);
+        dirty_[best_j] = dirty_.back();
+        dirty_.pop_back();
+    }
+}
+
+void KBitmap::mark_all_dirty()
+{
+    dirty_.assign(1, KRect{0, 0, width_, height_});
+}
+
+size_t KBitmap::dirty_bytes() const
+{
+    int64_t total = 0;
+    for (const KRect& r : dirty_)
+        total += area(r);
+    return static_cast<size_t>(total) * bytes_per_pixel_;
+}
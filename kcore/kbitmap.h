@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include "kscene.h"
+
+struct KRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+class KBitmap
+{
+public:
+    KBitmap(int width, int height);
+    ~KBitmap();
+
+    // 32-bit color byte layout: 0xaarrggbb.
+    // Where aa = alpha, rr = red, bb = green, gg = blue.
+    void put_pixel(int x, int y, uint32_t color);
+    void clear(uint32_t color);
+    int width() const;
+    int height() const;
+    int stride() const;
+    int size() const;
+    uint32_t* data();
+    const uint32_t* data() const;
+    void draw(KScene& scene);
+
+    // Raster operations. Rectangles are clipped to both bitmaps, so
+    // any coordinates are safe. Blending is premultiplied-alpha "over":
+    // dst = src + dst * (1 - src_alpha). src may be *this for blit().
+    void fill_rect(int x, int y, int width, int height, uint32_t color);
+    void blit(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y);
+    void blend(const KBitmap& src, int src_x, int src_y, int width, int height, int dst_x, int dst_y);
+
+    // Resamples all of src into the destination rectangle with a
+    // bilinear filter, sampling at pixel centers.
+    void blit_scaled(const KBitmap& src, int dst_x, int dst_y, int dst_width, int dst_height, bool blend = false);
+
+    // Every drawing operation records the area it touched, so that the
+    // surface can upload only what changed since the last upload.
+    // Nearby rectangles are coalesced and the list never grows past
+    // kMaxDirtyRects; merging may over-cover, but never under-covers.
+    static const int kMaxDirtyRects{16};
+    void mark_dirty(int x, int y, int width, int height);
+    void mark_all_dirty();
+    void clear_dirty();
+    const std::vector<KRect>& dirty_rects() const;
+    size_t dirty_bytes() const;
+    
+private:
+    int width_{128};
+    int height_{128};
+    int bytes_per_pixel_{4};
+    int stride_{};
+    int size_{};
+    uint32_t *mem_{};
+    std::vector<KRect> dirty_;
+};
+
+inline int KBitmap::width() const { return width_; }
+
+inline int KBitmap::height() const { return height_; }
+
+inline int KBitmap::stride() const { return stride_; }
+
+inline int KBitmap::size() const { return size_; }
+
+inline uint32_t* KBitmap::data() { return mem_; }
+
+inline const uint32_t* KBitmap::data() const { return mem_; }
+
+inline const std::vector<KRect>& KBitmap::dirty_rects() const { return dirty_; }
+
+inline void KBitmap::clear_dirty() { dirty_.clear(); }
+
+inline void KBitmap::put_pixel(int x, int y, uint32_t color)
+{
+    mem_[y * width_ + x] = color;
+    mark_dirty(x, y, 1, 1);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// The bounce shared by KScene and KParticles. A point that reaches a
+// wall is clamped back inside, and its velocity along that axis turns
+// around with a new size of cos(k * pi/20) for x or sin(k * pi/20) for
+// y, times the speed, where k is drawn from [1, 9]. k is never 0 or 10,
+// so a point never stops along either axis.
+//
+// k comes from bounce_draw(), a hash of a per-step key and the point's
+// index. The hash carries no state between draws, so a run depends
+// only on its seed, whatever the order the points are updated in, and
+// it need only be computed for the rare step on which a point hits.
+//
+// USAGE:
+//
+// x += dx;
+// y += dy;
+// bool hit_x = bounces(x, width);
+// bool hit_y = bounces(y, height);
+// if (hit_x | hit_y)
+// {
+//     uint32_t h = bounce_draw(index, bounce_key(seed, step));
+//     if (hit_x)
+//         reflect(x, dx, width, kDeflectionCos[deflection_x(h)], speed);
+//     if (hit_y)
+//         reflect(y, dy, height, kDeflectionSin[deflection_y(h)], speed);
+// }
+
+// cos(k * pi/20) and sin(k * pi/20) for k in [0, 9]; entry 0 is never
+// drawn.
+constexpr float kDeflectionCos[10] = {
+    1.f, 0.987688363f, 0.95105654f, 0.891006529f, 0.809017003f,
+    0.707106769f, 0.587785244f, 0.453990489f, 0.309017003f, 0.156434461f,
+};
+constexpr float kDeflectionSin[10] = {
+    0.f, 0.156434461f, 0.309017003f, 0.453990489f, 0.587785244f,
+    0.707106769f, 0.809017003f, 0.891006529f, 0.95105654f, 0.987688363f,
+};
+
+// A 32-bit integer hash with good avalanche (lowbias32).
+inline uint32_t bounce_mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+inline uint32_t bounce_key(uint32_t seed, uint64_t step)
+{
+    return bounce_mix(seed ^ bounce_mix(static_cast<uint32_t>(step)));
+}
+
+// One draw per point per step: the low 16 bits choose k for x and the
+// high 16 bits k for y.
+inline uint32_t bounce_draw(uint32_t index, uint32_t key)
+{
+    return bounce_mix(bounce_mix(index) + key);
+}
+
+inline int deflection_x(uint32_t h) { return static_cast<int>(((h & 0xffff) * 9) >> 16) + 1; }
+
+inline int deflection_y(uint32_t h) { return static_cast<int>(((h >> 16) * 9) >> 16) + 1; }
+
+// Whether a point at p has reached a wall at 0 or limit.
+inline bool bounces(float p, float limit)
+{
+    return (p >= limit) | (p <= 0.f);
+}
+
+// Clamps p, which has reached a wall, back into [0, limit - 1] and
+// turns v around with a size of deflection * speed, without branches.
+inline void reflect(float& p, float& v, float limit, float deflection, float speed)
+{
+    p = std::min(std::max(p, 0.f), limit - 1.f);
+    v = std::copysign(deflection * speed, -v);
+}
@@ -1,15 +1,14 @@
 #include "kmath.h"
-#include "kclock.h"
 #include "kcamera.h"
 
 KCamera::KCamera() {}
 
-void KCamera::update(const KClock& clock)
+void KCamera::update(float dt)
 {
     float3 roll_axis = normalize(float3{fwd.x, 0, fwd.z});
     float3 pitch_axis = cross(roll_axis, {0, 1, 0});
     
-    float translation_delta = translation_speed * clock.dt;
+    float translation_delta = translation_speed * dt;
     float3 z_displacement = roll_axis * translation_delta;
     float3 x_displacement = pitch_axis * translation_delta;
 
@@ -26,7 +25,7 @@ void KCamera::update(const KClock& clock)
     if (camera_input[static_cast<int>(CameraMovement::kDown)])
         pos.y -= translation_delta;
 
-    const float rotation_delta = rotation_speed * clock.dt;
+    const float rotation_delta = rotation_speed * dt;
 
     if (camera_input[static_cast<int>(CameraMovement::kYawLeft)])
         yaw += rotation_delta;
@@ -51,28 +50,34 @@ void KCamera::update(const KClock& clock)
         pitch = threshold;
     if (pitch < -threshold)
         pitch = -threshold;
+
+    // The direction the view looks in, for the next step's movement: the
+    // negated third row of the view matrix, which the translation
+    // doesn't touch.
+    float4x4 view_rotation = rotation_y_matrix(-yaw) * rotation_x_matrix(-pitch);
+    fwd = {-view_rotation.m[2][0], -view_rotation.m[2][1], -view_rotation.m[2][2]};
 }
 
-void KCamera::keypress(WPARAM key, bool keystate)
+void KCamera::keypress(KKey key, bool keystate)
 {
-    if (key == 'W')
+    if (key == KKey::kW)
         camera_input[static_cast<int>(CameraMovement::kForward)] = keystate;
-    else if (key == 'A')
+    else if (key == KKey::kA)
         camera_input[static_cast<int>(CameraMovement::kLeft)] = keystate;
-    else if (key == 'S')
+    else if (key == KKey::kS)
         camera_input[static_cast<int>(CameraMovement::kBackward)] = keystate;
-    else if (key == 'D')
+    else if (key == KKey::kD)
         camera_input[static_cast<int>(CameraMovement::kRight)] = keystate;
-    else if (key == 'E')
+    else if (key == KKey::kE)
         camera_input[static_cast<int>(CameraMovement::kUp)] = keystate;
-    else if (key == 'Q')
+    else if (key == KKey::kQ)
         camera_input[static_cast<int>(CameraMovement::kDown)] = keystate;
-    else if (key == VK_UP)
+    else if (key == KKey::kUp)
         camera_input[static_cast<int>(CameraMovement::kPitchUp)] = keystate;
-    else if (key == VK_LEFT)
+    else if (key == KKey::kLeft)
         camera_input[static_cast<int>(CameraMovement::kYawLeft)] = keystate;
-    else if (key == VK_DOWN)
+    else if (key == KKey::kDown)
         camera_input[static_cast<int>(CameraMovement::kPitchDown)] = keystate;
-    else if (key == VK_RIGHT)
+    else if (key == KKey::kRight)
         camera_input[static_cast<int>(CameraMovement::kYawRight)] = keystate;
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "kmath.h"
+#include "kinput.h"
+
 enum class CameraMovement
 {
     kUp,
@@ -18,8 +21,9 @@ enum class CameraMovement
 struct KCamera
 {
     KCamera();
-    void update(const KClock& clock);
-    void keypress(WPARAM key, bool keystate);
+    // Moves by one step of dt seconds, from the keys held down.
+    void update(float dt);
+    void keypress(KKey key, bool keystate);
     
     float3 pos{0, 0, 2};
     float3 fwd{0, 0, -1};
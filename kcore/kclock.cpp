@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "kclock.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(_WIN32)
+
+int64_t monotonic_nanoseconds()
+{
+    static const int64_t frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return static_cast<int64_t>(f.QuadPart);
+    }();
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    // Whole seconds and the remainder apart, since ticks * 1e9 would
+    // overflow after a few minutes of uptime.
+    int64_t t = static_cast<int64_t>(ticks.QuadPart);
+    return (t / frequency) * 1000000000 + (t % frequency) * 1000000000 / frequency;
+}
+
+#else
+
+int64_t monotonic_nanoseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KFrameStats.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void KFrameStats::add(int64_t nanoseconds)
+{
+    frames_[next_] = nanoseconds;
+    next_ = (next_ + 1) % kWindow;
+    count_ = std::min(count_ + 1, kWindow);
+}
+
+void KFrameStats::clear()
+{
+    next_ = 0;
+    count_ = 0;
+}
+
+KFrameSummary KFrameStats::summary() const
+{
+    KFrameSummary s{};
+    if (count_ == 0)
+        return s;
+
+    // The window is small, so sorting a copy on demand is cheaper
+    // overall than keeping it ordered on every add().
+    int64_t sorted[kWindow]{};
+    std::copy(frames_, frames_ + count_, sorted);
+    std::sort(sorted, sorted + count_);
+    int64_t total = 0;
+    for (size_t i = 0; i < count_; ++i)
+        total += sorted[i];
+    size_t p99 = static_cast<size_t>(std::ceil(0.99 * count_)) - 1;
+
+    s.count = count_;
+    s.min_ms = sorted[0] * 1e-6;
+    s.avg_ms = static_cast<double>(total) / count_ * 1e-6;
+    s.p99_ms = sorted[p99] * 1e-6;
+    s.max_ms = sorted[count_ - 1] * 1e-6;
+    return s;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KClock.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+KClock::KClock() : KClock{monotonic_nanoseconds}
+{
+}
+
+KClock::KClock(Source source) : source_{std::move(source)}
+{
+    reset();
+}
+
+void KClock::reset()
+{
+    origin_ = last_tick_ = source_();
+    t = 0.0;
+    dt = 0.f;
+    stats_.clear();
+}
+
+int64_t KClock::nanoseconds() const
+{
+    return source_() - origin_;
+}
+
+double KClock::seconds() const
+{
+    return static_cast<double>(nanoseconds()) * 1e-9;
+}
+
+double KClock::tick(double max_dt)
+{
+    int64_t now = source_();
+    int64_t frame = now - last_tick_;
+    last_tick_ = now;
+    stats_.add(frame);
+
+    double seconds = static_cast<double>(frame) * 1e-9;
+    if (max_dt > 0.0)
+        seconds = std::min(seconds, max_dt);
+    t = static_cast<double>(now - origin_) * 1e-9;
+    dt = static_cast<float>(seconds);
+    return seconds;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// KVirtualTime.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void KVirtualTime::advance_seconds(double seconds)
+{
+    now_ += static_cast<int64_t>(std::llround(seconds * 1e9));
+}
+
+KClock::Source KVirtualTime::source()
+{
+    return [this] { return now_; };
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// KClock measures time in nanoseconds from a monotonic source:
+// QueryPerformanceCounter on Windows, clock_gettime(CLOCK_MONOTONIC)
+// elsewhere. Both read the CPU's invariant time-stamp counter where it
+// has one, already calibrated by the OS. Any other source of
+// nanoseconds can be put in its place, such as a KVirtualTime, which
+// only moves when told to. That makes replays and benchmarks
+// deterministic.
+//
+// tick() is the frame clock. Called once a frame, it sets t to the
+// seconds since reset() and dt to the seconds since the previous tick,
+// optionally clamped. It also records the frame's length in a
+// KFrameStats, which keeps the last kWindow frames for min, average
+// and 99th percentile.
+//
+// USAGE:
+//
+// KClock clock;
+// while (running)
+// {
+//     clock.tick(1.0 / 60.0);
+//     update(clock.t, clock.dt);
+// }
+// KFrameSummary s = clock.frame_stats().summary();
+//
+// KVirtualTime virtual_time;
+// KClock replay{virtual_time.source()};
+// virtual_time.advance_seconds(1.0 / 60.0);
+
+// Nanoseconds since an arbitrary point, never going backwards.
+int64_t monotonic_nanoseconds();
+
+struct KFrameSummary
+{
+    size_t count;
+    double min_ms;
+    double avg_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+class KFrameStats
+{
+public:
+    static constexpr size_t kWindow{240};
+
+    void add(int64_t nanoseconds);
+    void clear();
+    // Over the last kWindow frames at most; all zero with none yet.
+    KFrameSummary summary() const;
+
+private:
+    int64_t frames_[kWindow]{};
+    size_t next_{};
+    size_t count_{};
+};
+
+class KClock
+{
+public:
+    using Source = std::function<int64_t()>;
+
+    KClock();
+    explicit KClock(Source source);
+
+    void reset();
+    int64_t nanoseconds() const;    // Since reset().
+    double seconds() const;
+
+    // Returns dt. max_dt > 0 clamps it, e.g. after a breakpoint.
+    double tick(double max_dt = 0.0);
+    const KFrameStats& frame_stats() const;
+
+    double t{};
+    float dt{};
+
+private:
+    Source source_;
+    int64_t origin_{};
+    int64_t last_tick_{};
+    KFrameStats stats_;
+};
+
+inline const KFrameStats& KClock::frame_stats() const { return stats_; }
+
+// A clock source that stands still until advanced.
+class KVirtualTime
+{
+public:
+    int64_t now() const;
+    void advance(int64_t nanoseconds);
+    void advance_seconds(double seconds);
+    // Refers to this object, which must outlive the clocks using it.
+    KClock::Source source();
+
+private:
+    int64_t now_{};
+};
+
+inline int64_t KVirtualTime::now() const { return now_; }
+
+inline void KVirtualTime::advance(int64_t nanoseconds) { now_ += nanoseconds; }
@@ -0,0 +1,114 @@
+#include "kcpu.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(KCPU_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+static std::atomic<int> g_isa_limit{static_cast<int>(KIsa::kAVX512)};
+
+#if defined(KCPU_X64)
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+    memcpy(regs, r, sizeof(r));
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// The register state the OS saves on a context switch; an instruction
+// set is only usable if its registers are among them.
+static uint64_t xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+static KIsa detect_isa()
+{
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    uint32_t max_leaf = regs[0];
+    cpuid(1, 0, regs);
+    uint32_t ecx1 = regs[2];
+    uint32_t edx1 = regs[3];
+    uint32_t ebx7 = 0;
+    if (max_leaf >= 7)
+    {
+        cpuid(7, 0, regs);
+        ebx7 = regs[1];
+    }
+    auto has = [](uint32_t reg, int bit) { return (reg >> bit) & 1; };
+
+    if (!has(edx1, 26))
+        return KIsa::kScalar;
+    if (!(has(ecx1, 9) && has(ecx1, 19) && has(ecx1, 20)))
+        return KIsa::kSSE2;
+
+    // XMM and YMM state, then the opmask and ZMM state.
+    uint64_t xcr0 = has(ecx1, 27) ? xgetbv0() : 0;
+    bool avx_state = (xcr0 & 0x6) == 0x6;
+    bool avx512_state = (xcr0 & 0xe6) == 0xe6;
+    if (!(avx_state && has(ecx1, 28) && has(ecx1, 12) && has(ebx7, 5) && has(ebx7, 3) && has(ebx7, 8)))
+        return KIsa::kSSE41;
+    if (!(avx512_state && has(ebx7, 16) && has(ebx7, 17) && has(ebx7, 30) && has(ebx7, 31)))
+        return KIsa::kAVX2;
+    return KIsa::kAVX512;
+}
+
+#else
+
+static KIsa detect_isa()
+{
+    return KIsa::kScalar;
+}
+
+#endif
+
+KIsa cpu_isa()
+{
+    static const KIsa detected = detect_isa();
+    int limit = g_isa_limit.load(std::memory_order_relaxed);
+    return static_cast<int>(detected) < limit ? detected : static_cast<KIsa>(limit);
+}
+
+void limit_cpu_isa(KIsa isa)
+{
+    g_isa_limit.store(static_cast<int>(isa), std::memory_order_relaxed);
+}
+
+static const char *kIsaNames[]{"scalar", "sse2", "sse4.1", "avx2", "avx512"};
+
+const char *isa_name(KIsa isa)
+{
+    return kIsaNames[static_cast<int>(isa)];
+}
+
+bool isa_from_name(const char *name, KIsa *isa)
+{
+    for (int i = 0; i < static_cast<int>(sizeof(kIsaNames) / sizeof(kIsaNames[0])); ++i)
+    {
+        if (strcmp(name, kIsaNames[i]) == 0)
+        {
+            *isa = static_cast<KIsa>(i);
+            return true;
+        }
+    }
+    return false;
+}
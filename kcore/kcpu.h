@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+// Which x86 instruction sets the running CPU, and the OS, support, so
+// that one build can use AVX2 and AVX-512 where they exist and still
+// run everywhere else.
+//
+// Hot kernels come in one variant per level below, each compiled for
+// its instruction set with KCPU_TARGET instead of for the whole
+// program, and pick one the first time they are called. The levels
+// follow the x86-64 micro-architecture levels:
+//
+//   kScalar   the portable reference code.
+//   kSSE2     x86-64.
+//   kSSE41    x86-64-v2: adds SSSE3, SSE4.1 and SSE4.2.
+//   kAVX2     x86-64-v3: adds AVX, AVX2 and FMA.
+//   kAVX512   x86-64-v4: adds AVX-512 F, BW, DQ and VL.
+//
+// limit_cpu_isa() caps the level, so that the variants can be compared
+// on one machine; call it before the first kernel runs, since each
+// kernel keeps the variant it picked. Off x86-64, cpu_isa() is kScalar.
+//
+// USAGE:
+//
+// KCPU_TARGET("avx2,fma") static void kernel_avx2(...) { ... }
+//
+// void kernel(...)
+// {
+//     static const KernelFn fn = cpu_isa() >= KIsa::kAVX2 ? kernel_avx2 : kernel_sse2;
+//     fn(...);
+// }
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define KCPU_X64 1
+#endif
+
+// GCC and Clang only emit an instruction set's intrinsics in functions
+// compiled for it; MSVC emits them anywhere.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KCPU_TARGET(isa)
+#else
+#define KCPU_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+enum class KIsa
+{
+    kScalar,
+    kSSE2,
+    kSSE41,
+    kAVX2,
+    kAVX512
+};
+
+// The level in use: the highest supported one, capped by
+// limit_cpu_isa().
+KIsa cpu_isa();
+void limit_cpu_isa(KIsa isa);
+
+// "scalar", "sse2", "sse4.1", "avx2" or "avx512", and back; false for
+// an unknown name.
+const char *isa_name(KIsa isa);
+bool isa_from_name(const char *name, KIsa *isa);
@@ -0,0 +1,221 @@
+#include <cmath>
+#include <vector>
+#include "kgeometry.h"
+#include "kscenefile.h"
+
+KGeometry::KGeometry(uint32_t width, uint32_t height)
+    : width_{width},
+      height_{height}
+{
+    index_.reserve_bounds(KAABB{0.f, 0.f, static_cast<float>(width), static_cast<float>(height)});
+}
+
+void KGeometry::resize(uint32_t width, uint32_t height)
+{
+    width_ = width;
+    height_ = height;
+    index_.reserve_bounds(KAABB{0.f, 0.f, static_cast<float>(width), static_cast<float>(height)});
+}
+
+void KGeometry::update()
+{
+}
+
+bool KGeometry::selectShape(float x, float y)
+{
+    ensureIndex();
+    KShapeHandle hit{};
+    uint32_t hit_depth = 0;
+    // The ellipse is tested against the box the grid holds for it, so
+    // only the ellipses that contain the point are looked up in the
+    // store, for their depth.
+    index_.query(x, y, [&](int slot, const KAABB& box) {
+        if (!insideEllipse(inscribedEllipse(box), x, y))
+        {
+            return;
+        }
+        KShapeHandle handle = shapes_.handle_of_slot(static_cast<uint32_t>(slot));
+        uint32_t depth = shapes_.depth(handle);
+        if (!shapes_.valid(hit) || depth > hit_depth)
+        {
+            hit = handle;
+            hit_depth = depth;
+        }
+    });
+
+    if (!shapes_.valid(hit))
+    {
+        return false;
+    }
+    selected_ = hit;
+    return true;
+}
+
+void KGeometry::clearSelection()
+{
+    selected_ = KShapeHandle{};
+}
+
+void KGeometry::insertEllipse(const KEllipseF& ellipse)
+{
+    ensureIndex();
+    selected_ = shapes_.insert(ellipse);
+    index_.insert(static_cast<int>(shapes_.slot(selected_)), boundingBox(ellipse));
+}
+
+void KGeometry::updateEllipse(const KEllipseF& ellipse)
+{
+    if (!hasSelection())
+    {
+        return;
+    }
+    setEllipse(selected_, ellipse);
+}
+
+void KGeometry::moveEllipse(float dx, float dy)
+{
+    if (!hasSelection())
+    {
+        return;
+    }
+    KEllipseF e = shapes_.get(selected_);
+    updateEllipse(KEllipseF{e.cx + dx, e.cy + dy, e.rx, e.ry});
+}
+
+void KGeometry::resizeEllipse(float scale)
+{
+    if (!hasSelection())
+    {
+        return;
+    }
+    KEllipseF e = shapes_.get(selected_);
+    updateEllipse(KEllipseF{e.cx, e.cy, e.rx * scale, e.ry * scale});
+}
+
+// Places the selection on top of other ellipses in the scene, and
+// consequently it gets drawn last.
+void KGeometry::bringToFront()
+{
+    if (!hasSelection())
+    {
+        return;
+    }
+    shapes_.bring_to_front(selected_);
+}
+
+void KGeometry::select(KShapeHandle handle)
+{
+    selected_ = handle;
+}
+
+void KGeometry::setEllipse(KShapeHandle handle, const KEllipseF& ellipse)
+{
+    ensureIndex();
+    shapes_.set(handle, ellipse);
+    index_.move(static_cast<int>(shapes_.slot(handle)), boundingBox(ellipse));
+}
+
+void KGeometry::eraseEllipse(KShapeHandle handle)
+{
+    ensureIndex();
+    index_.remove(static_cast<int>(shapes_.slot(handle)));
+    shapes_.erase(handle);
+    if (handle == selected_)
+    {
+        selected_ = KShapeHandle{};
+    }
+}
+
+void KGeometry::clear()
+{
+    shapes_.clear();
+    rebuildIndex();
+    selected_ = KShapeHandle{};
+}
+
+bool KGeometry::saveScene(const std::filesystem::path& filename) const
+{
+    return save_scene(shapes_, filename);
+}
+
+bool KGeometry::loadScene(const std::filesystem::path& filename)
+{
+    if (!load_scene(filename, shapes_))
+    {
+        return false;
+    }
+    // Filing millions of ellipses takes far longer than loading them,
+    // so it waits until a click or an edit needs the index.
+    index_stale_ = true;
+    selected_ = KShapeHandle{};
+    return true;
+}
+
+// Files every ellipse afresh. When every slot is in use, as after
+// clear() or a load, that's a single pass over boxes by slot; otherwise
+// the ellipses go in one at a time.
+void KGeometry::rebuildIndex()
+{
+    index_ = KSpatialGrid{};
+    index_.reserve_bounds(KAABB{0.f, 0.f, static_cast<float>(width_), static_cast<float>(height_)});
+    if (shapes_.slot_count() == shapes_.size())
+    {
+        std::vector<KAABB> boxes(shapes_.size());
+        for (size_t i = 0; i < shapes_.span(); ++i)
+        {
+            if (shapes_.alive(i))
+                boxes[shapes_.slot_at(i)] = boundingBox(shapes_.at(i));
+        }
+        index_.assign(boxes.data(), boxes.size());
+    }
+    else
+    {
+        for (size_t i = 0; i < shapes_.span(); ++i)
+        {
+            if (shapes_.alive(i))
+                index_.insert(static_cast<int>(shapes_.slot_at(i)), boundingBox(shapes_.at(i)));
+        }
+    }
+    index_stale_ = false;
+}
+
+void KGeometry::ensureIndex()
+{
+    if (index_stale_)
+    {
+        rebuildIndex();
+    }
+}
+
+bool KGeometry::insideEllipse(const KEllipseF& ellipse, float x, float y)
+{
+	float rx2 = ellipse.rx * ellipse.rx;
+	float ry2 = ellipse.ry * ellipse.ry;
+
+	if (rx2 == 0.f || ry2 == 0.f)
+	{
+		return false;
+	}
+
+	float dx = x - ellipse.cx;
+	float dy = y - ellipse.cy;
+	float d = ((dx * dx) / rx2) + ((dy * dy) / ry2);
+
+	return d <= 1.f;
+}
+
+// Radii go negative while an ellipse is dragged out up or left.
+KAABB KGeometry::boundingBox(const KEllipseF& ellipse)
+{
+    float rx = std::fabs(ellipse.rx);
+    float ry = std::fabs(ellipse.ry);
+    return KAABB{ellipse.cx - rx, ellipse.cy - ry, ellipse.cx + rx, ellipse.cy + ry};
+}
+
+// The ellipse boundingBox() was given back, with positive radii; the
+// center and radii can differ from the stored ones in the last bit.
+KEllipseF KGeometry::inscribedEllipse(const KAABB& box)
+{
+    return KEllipseF{0.5f * (box.left + box.right), 0.5f * (box.top + box.bottom),
+                     0.5f * (box.right - box.left), 0.5f * (box.bottom - box.top)};
+}
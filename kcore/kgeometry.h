@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include "kshapestore.h"
+#include "kspatialgrid.h"
+
+// Ellipses live in a KShapeStore, in drawing order: the top-most
+// ellipse on the drawing surface is the last one drawn. selected_ is
+// the handle of the ellipse that has been selected with a mouse-click
+// on it, or an invalid handle when there is no selection.
+//
+// The bounding box of every ellipse is also filed in a spatial grid,
+// under its store slot, so that a click tests only the few ellipses
+// whose boxes hold the point instead of all of them; of those, the one
+// drawn last is the top-most. Add and change ellipses through the
+// methods below, which keep the grid in step with the store.
+//
+// Coordinates are surface pixels, in plain floats rather than Direct2D
+// types, so that the class builds anywhere; the surface converts.
+
+class KGeometry
+{
+public:
+
+	KGeometry(uint32_t width, uint32_t height);
+    void resize(uint32_t width, uint32_t height);
+    void update();
+
+	bool selectShape(float x, float y);
+    bool hasSelection() const;
+    void clearSelection();
+
+    // These act on the selected ellipse; insertEllipse() selects the
+    // ellipse it adds, on top of the others.
+    void insertEllipse(const KEllipseF& ellipse);
+    void updateEllipse(const KEllipseF& ellipse);
+    void moveEllipse(float dx, float dy);
+    void resizeEllipse(float scale);
+    void bringToFront();
+
+    // These name the ellipse by handle, for replaying recorded edits.
+    KShapeHandle selection() const;
+    void select(KShapeHandle handle);
+    void setEllipse(KShapeHandle handle, const KEllipseF& ellipse);
+    void eraseEllipse(KShapeHandle handle);
+    void clear();
+
+    // Scene files, see kscenefile.h; loading drops the selection.
+    bool saveScene(const std::filesystem::path& filename) const;
+    bool loadScene(const std::filesystem::path& filename);
+
+	KShapeStore shapes_;
+	KAABB bounding_box_{};
+	bool draw_bounding_box_{false};
+
+private:
+
+    static bool insideEllipse(const KEllipseF& ellipse, float x, float y);
+    static KAABB boundingBox(const KEllipseF& ellipse);
+    static KEllipseF inscribedEllipse(const KAABB& box);
+    void rebuildIndex();
+    void ensureIndex();
+    
+    uint32_t width_{1};
+    uint32_t height_{1};
+    KSpatialGrid index_;
+    bool index_stale_{false};   // After a load, until first needed.
+    KShapeHandle selected_{};
+};
+
+inline bool KGeometry::hasSelection() const { return shapes_.valid(selected_); }
+
+inline KShapeHandle KGeometry::selection() const { return selected_; }
@@ -0,0 +1,22 @@
+#include "kinput.h"
+
+KKey key_from_virtual_key(uint32_t virtual_key)
+{
+    // The letters' codes are their upper-case ASCII; the arrows' are
+    // VK_LEFT, VK_UP, VK_RIGHT and VK_DOWN, spelled out so that this
+    // builds without <windows.h>.
+    switch (virtual_key)
+    {
+    case 'W': return KKey::kW;
+    case 'A': return KKey::kA;
+    case 'S': return KKey::kS;
+    case 'D': return KKey::kD;
+    case 'E': return KKey::kE;
+    case 'Q': return KKey::kQ;
+    case 0x25: return KKey::kLeft;
+    case 0x26: return KKey::kUp;
+    case 0x27: return KKey::kRight;
+    case 0x28: return KKey::kDown;
+    default: return KKey::kNone;
+    }
+}
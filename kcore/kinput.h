@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// The keys the simulation responds to, independent of any window
+// system. Each platform's window code translates its own key codes,
+// e.g. Win32 virtual-key codes with key_from_virtual_key(), and passes
+// the result on to KCamera::keypress() and KWorldState::keypress().
+//
+// USAGE:
+//
+// case WM_KEYDOWN:
+//     camera.keypress(key_from_virtual_key(static_cast<uint32_t>(wparam)), true);
+
+enum class KKey
+{
+    kNone,
+    kW,
+    kA,
+    kS,
+    kD,
+    kE,
+    kQ,
+    kUp,
+    kLeft,
+    kDown,
+    kRight
+};
+
+// Win32 virtual-key codes; kNone for any other key.
+KKey key_from_virtual_key(uint32_t virtual_key);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Read-only view of a whole file mapped into memory. Pages are read in
+// by the OS as they are first touched, so opening costs the same
+// whatever the file's size.
+//
+// USAGE:
+//
+// KMappedFile file;
+// if (file.open(L"drawing.kscene"))
+//     parse(file.data(), file.size());
+
+class KMappedFile
+{
+public:
+    KMappedFile() = default;
+    ~KMappedFile();
+    KMappedFile(const KMappedFile&) = delete;
+    KMappedFile& operator=(const KMappedFile&) = delete;
+
+    // Fails on an empty file, which can't be mapped.
+    bool open(const std::filesystem::path& filename);
+    void close();
+
+    const uint8_t *data() const;
+    size_t size() const;
+
+private:
+#if defined(_WIN32)
+    void *file_{};          // HANDLEs, kept opaque to spare users <windows.h>.
+    void *mapping_{};
+#else
+    int fd_{-1};
+#endif
+    const uint8_t *data_{};
+    size_t size_{};
+};
+
+inline const uint8_t *KMappedFile::data() const { return data_; }
+
+inline size_t KMappedFile::size() const { return size_; }
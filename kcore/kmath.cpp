@@ -0,0 +1,249 @@
+#include "kmath.h"
+#include "kcpu.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KMATH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(KCPU_X64)
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Scalar reference.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void multiply_matrices_scalar(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count)
+{
+    float4x4 b_copy = b;
+    for (size_t i = 0; i < count; ++i)
+        out[i] = a[i] * b_copy;
+}
+
+void transform_vectors_scalar(const float4 *in, const float4x4 &m, float4 *out, size_t count)
+{
+    float4x4 m_copy = m;
+    for (size_t i = 0; i < count; ++i)
+        out[i] = in[i] * m_copy;
+}
+
+#if defined(KMATH_SSE2)
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// SIMD.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Column j of a * b is the sum over k of a's column k times b.m[j][k],
+// so each result column is four multiply-adds of whole columns of a
+// with broadcasts of b. A vector times m is likewise the sum over k of
+// its component k times row k of m, which transposing m gives as
+// columns.
+
+static void multiply_matrices_sse2(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count)
+{
+    __m128 bk[4][4];
+    for (int j = 0; j < 4; ++j)
+        for (int k = 0; k < 4; ++k)
+            bk[j][k] = _mm_set1_ps(b.m[j][k]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        __m128 a0 = _mm_loadu_ps(a[i].m[0]);
+        __m128 a1 = _mm_loadu_ps(a[i].m[1]);
+        __m128 a2 = _mm_loadu_ps(a[i].m[2]);
+        __m128 a3 = _mm_loadu_ps(a[i].m[3]);
+        for (int j = 0; j < 4; ++j)
+        {
+            __m128 c = _mm_mul_ps(a0, bk[j][0]);
+            c = _mm_add_ps(c, _mm_mul_ps(a1, bk[j][1]));
+            c = _mm_add_ps(c, _mm_mul_ps(a2, bk[j][2]));
+            c = _mm_add_ps(c, _mm_mul_ps(a3, bk[j][3]));
+            _mm_storeu_ps(out[i].m[j], c);
+        }
+    }
+}
+
+static void transform_vectors_sse2(const float4 *in, const float4x4 &m, float4 *out, size_t count)
+{
+    float4x4 t = transpose(m);
+    __m128 r0 = _mm_loadu_ps(t.m[0]);
+    __m128 r1 = _mm_loadu_ps(t.m[1]);
+    __m128 r2 = _mm_loadu_ps(t.m[2]);
+    __m128 r3 = _mm_loadu_ps(t.m[3]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        __m128 v = _mm_loadu_ps(&in[i].x);
+        __m128 c = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+        c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+        c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+        c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+        _mm_storeu_ps(&out[i].x, c);
+    }
+}
+
+#if defined(KCPU_X64)
+
+// Two result columns per register: the low half of bk[p][k] holds
+// b.m[2p][k] and the high half b.m[2p + 1][k].
+KCPU_TARGET("avx2,fma") static void multiply_matrices_avx2(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count)
+{
+    __m256 bk[2][4];
+    for (int p = 0; p < 2; ++p)
+        for (int k = 0; k < 4; ++k)
+            bk[p][k] = _mm256_set_m128(_mm_set1_ps(b.m[2 * p + 1][k]), _mm_set1_ps(b.m[2 * p][k]));
+    for (size_t i = 0; i < count; ++i)
+    {
+        __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i].m[0]));
+        __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i].m[1]));
+        __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i].m[2]));
+        __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a[i].m[3]));
+        __m256 c[2];
+        for (int p = 0; p < 2; ++p)
+        {
+            c[p] = _mm256_mul_ps(a0, bk[p][0]);
+            c[p] = _mm256_fmadd_ps(a1, bk[p][1], c[p]);
+            c[p] = _mm256_fmadd_ps(a2, bk[p][2], c[p]);
+            c[p] = _mm256_fmadd_ps(a3, bk[p][3], c[p]);
+        }
+        _mm256_storeu_ps(out[i].m[0], c[0]);
+        _mm256_storeu_ps(out[i].m[2], c[1]);
+    }
+}
+
+// Two vectors per register.
+KCPU_TARGET("avx2,fma") static void transform_vectors_avx2(const float4 *in, const float4x4 &m, float4 *out, size_t count)
+{
+    float4x4 t = transpose(m);
+    __m256 r0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(t.m[0]));
+    __m256 r1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(t.m[1]));
+    __m256 r2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(t.m[2]));
+    __m256 r3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(t.m[3]));
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m256 v = _mm256_loadu_ps(&in[i].x);
+        __m256 c = _mm256_mul_ps(_mm256_permute_ps(v, 0x00), r0);
+        c = _mm256_fmadd_ps(_mm256_permute_ps(v, 0x55), r1, c);
+        c = _mm256_fmadd_ps(_mm256_permute_ps(v, 0xaa), r2, c);
+        c = _mm256_fmadd_ps(_mm256_permute_ps(v, 0xff), r3, c);
+        _mm256_storeu_ps(&out[i].x, c);
+    }
+    if (i < count)
+    {
+        __m128 v = _mm_loadu_ps(&in[i].x);
+        __m128 c = _mm_mul_ps(_mm_permute_ps(v, 0x00), _mm256_castps256_ps128(r0));
+        c = _mm_fmadd_ps(_mm_permute_ps(v, 0x55), _mm256_castps256_ps128(r1), c);
+        c = _mm_fmadd_ps(_mm_permute_ps(v, 0xaa), _mm256_castps256_ps128(r2), c);
+        c = _mm_fmadd_ps(_mm_permute_ps(v, 0xff), _mm256_castps256_ps128(r3), c);
+        _mm_storeu_ps(&out[i].x, c);
+    }
+}
+
+// GCC 12's AVX-512 headers trip false uninitialized-variable warnings
+// when AVX-512 is enabled per function rather than for the whole file.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// A whole matrix per register: lanes 4j to 4j + 3 of bk[k] hold b.m[j][k].
+KCPU_TARGET("avx512f") static void multiply_matrices_avx512(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count)
+{
+    __m512 bk[4];
+    for (int k = 0; k < 4; ++k)
+        bk[k] = _mm512_setr_ps(b.m[0][k], b.m[0][k], b.m[0][k], b.m[0][k],
+                               b.m[1][k], b.m[1][k], b.m[1][k], b.m[1][k],
+                               b.m[2][k], b.m[2][k], b.m[2][k], b.m[2][k],
+                               b.m[3][k], b.m[3][k], b.m[3][k], b.m[3][k]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        __m512 c = _mm512_mul_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a[i].m[0])), bk[0]);
+        c = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a[i].m[1])), bk[1], c);
+        c = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a[i].m[2])), bk[2], c);
+        c = _mm512_fmadd_ps(_mm512_broadcast_f32x4(_mm_loadu_ps(a[i].m[3])), bk[3], c);
+        _mm512_storeu_ps(out[i].m[0], c);
+    }
+}
+
+// Four vectors per register; the last one to three go through a mask.
+KCPU_TARGET("avx512f") static void transform_vectors_avx512(const float4 *in, const float4x4 &m, float4 *out, size_t count)
+{
+    float4x4 t = transpose(m);
+    __m512 r0 = _mm512_broadcast_f32x4(_mm_loadu_ps(t.m[0]));
+    __m512 r1 = _mm512_broadcast_f32x4(_mm_loadu_ps(t.m[1]));
+    __m512 r2 = _mm512_broadcast_f32x4(_mm_loadu_ps(t.m[2]));
+    __m512 r3 = _mm512_broadcast_f32x4(_mm_loadu_ps(t.m[3]));
+    for (size_t i = 0; i < count; i += 4)
+    {
+        size_t n = count - i < 4 ? count - i : 4;
+        __mmask16 mask = static_cast<__mmask16>((1u << (4 * n)) - 1);
+        __m512 v = _mm512_maskz_loadu_ps(mask, &in[i].x);
+        __m512 c = _mm512_mul_ps(_mm512_permute_ps(v, 0x00), r0);
+        c = _mm512_fmadd_ps(_mm512_permute_ps(v, 0x55), r1, c);
+        c = _mm512_fmadd_ps(_mm512_permute_ps(v, 0xaa), r2, c);
+        c = _mm512_fmadd_ps(_mm512_permute_ps(v, 0xff), r3, c);
+        _mm512_mask_storeu_ps(&out[i].x, mask, c);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+using MultiplyMatricesFn = void (*)(const float4x4*, const float4x4&, float4x4*, size_t);
+using TransformVectorsFn = void (*)(const float4*, const float4x4&, float4*, size_t);
+
+static MultiplyMatricesFn select_multiply_matrices()
+{
+    switch (cpu_isa())
+    {
+    case KIsa::kScalar: return multiply_matrices_scalar;
+#if defined(KCPU_X64)
+    case KIsa::kAVX2: return multiply_matrices_avx2;
+    case KIsa::kAVX512: return multiply_matrices_avx512;
+#endif
+    default: return multiply_matrices_sse2;
+    }
+}
+
+static TransformVectorsFn select_transform_vectors()
+{
+    switch (cpu_isa())
+    {
+    case KIsa::kScalar: return transform_vectors_scalar;
+#if defined(KCPU_X64)
+    case KIsa::kAVX2: return transform_vectors_avx2;
+    case KIsa::kAVX512: return transform_vectors_avx512;
+#endif
+    default: return transform_vectors_sse2;
+    }
+}
+
+void multiply_matrices(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count)
+{
+    static const MultiplyMatricesFn fn = select_multiply_matrices();
+    fn(a, b, out, count);
+}
+
+void transform_vectors(const float4 *in, const float4x4 &m, float4 *out, size_t count)
+{
+    static const TransformVectorsFn fn = select_transform_vectors();
+    fn(in, m, out, count);
+}
+
+#else
+
+void multiply_matrices(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count)
+{
+    multiply_matrices_scalar(a, b, out, count);
+}
+
+void transform_vectors(const float4 *in, const float4x4 &m, float4 *out, size_t count)
+{
+    transform_vectors_scalar(in, m, out, count);
+}
+
+#endif
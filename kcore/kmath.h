@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 const double K_PI = 3.14159265358979323846;
 
 #pragma warning(push)
@@ -208,3 +209,18 @@ inline float3x3 float4x4_to_float3x3(float4x4 m)
                        m.m[2][0], m.m[2][1], m.m[2][2], 0.0};
     return result;
 }
+
+// Batches, for many objects or vertices at once; out may be the same
+// array as a or in. The SSE2, AVX2 or AVX-512 code is picked at run
+// time (see kcpu.h) and the *_scalar variants are the reference. SSE2
+// adds in the same order as the operators above and matches them
+// exactly; AVX2 and AVX-512 fuse each multiply-add, so their results
+// can differ from the reference in the last bit.
+
+// out[i] = a[i] * b
+void multiply_matrices(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count);
+void multiply_matrices_scalar(const float4x4 *a, const float4x4 &b, float4x4 *out, size_t count);
+
+// out[i] = in[i] * m
+void transform_vectors(const float4 *in, const float4x4 &m, float4 *out, size_t count);
+void transform_vectors_scalar(const float4 *in, const float4x4 &m, float4 *out, size_t count);
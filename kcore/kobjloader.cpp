@@ -7,6 +7,19 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include "kcpu.h"
+
+#if defined(KCPU_X64)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// parseFloatSSE41() reads 16 bytes at a time, so the file is read into
+// a buffer with this many zero bytes after its end.
+static const size_t kParsePadding = 16;
 
 static int parseInt(const char* s, const char** end)
 {
@@ -104,6 +117,86 @@ static float parseFloat(const char* s, const char** end)
         return float(sign * result * pow(10.0, power));
 }
 
+#if defined(KCPU_X64)
+
+static int countTrailingZeros(uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+// parseFloat() for the common case of a plain decimal with at most 15
+// digits in all: those are converted in one register, and the result
+// is the integer they spell divided by the same power of ten as
+// there, so it is bit-identical. Anything else, an exponent or more
+// digits, goes to parseFloat().
+KCPU_TARGET("sse4.1") static float parseFloatSSE41(const char* s, const char** end)
+{
+    while (*s == ' ' || *s == '\t')
+        ++s;
+    const char *start = s;
+    double sign = (*s == '-') ? -1 : 1;
+    if (*s == '-' || *s == '+')
+        ++s;
+
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    uint32_t digit_mask = static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_cmplt_epi8(_mm_xor_si128(digits, _mm_set1_epi8(-128)), _mm_set1_epi8(-128 + 10))));
+
+    // The integer digits, then those of the fraction after the point;
+    // both must end inside the register.
+    int int_digits = countTrailingZeros(~digit_mask);
+    int frac_digits = 0;
+    const char *p = s + int_digits;
+    if (*p == '.')
+    {
+        frac_digits = countTrailingZeros(~(digit_mask >> (int_digits + 1)));
+        p += 1 + frac_digits;
+    }
+    int n = int_digits + frac_digits;
+    if (p - s >= 16 || n > 15 || (*p | ' ') == 'e')
+        return parseFloat(start, end);
+
+    // Move the digits to the top of the register, skipping the point,
+    // with zeros above them. Byte i takes digit i - (16 - n), and those
+    // from the fraction on sit one byte further along.
+    __m128i index = _mm_add_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                 _mm_set1_epi8(static_cast<char>(n - 16)));
+    index = _mm_sub_epi8(index, _mm_cmpgt_epi8(index, _mm_set1_epi8(static_cast<char>(int_digits - 1))));
+    digits = _mm_shuffle_epi8(digits, index);
+
+    // Pairs, fours and eights of digits, then the two eights.
+    __m128i v = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    v = _mm_packus_epi32(v, v);
+    v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    uint64_t value = static_cast<uint64_t>(_mm_cvtsi128_si32(v)) * 100000000 +
+                     static_cast<uint32_t>(_mm_extract_epi32(v, 1));
+
+    static const double powers[] = {1e0, 1e+1, 1e+2, 1e+3, 1e+4, 1e+5, 1e+6, 1e+7, 1e+8, 1e+9, 1e+10, 1e+11, 1e+12, 1e+13, 1e+14, 1e+15};
+    *end = p;
+    return float(sign * static_cast<double>(value) / powers[frac_digits]);
+}
+
+#endif
+
+typedef float (*ParseFloatFn)(const char*, const char**);
+
+static ParseFloatFn selectParseFloat()
+{
+#if defined(KCPU_X64)
+    if (cpu_isa() >= KIsa::kSSE41)
+        return parseFloatSSE41;
+#endif
+    return parseFloat;
+}
+
 static const char* parseFaceElement(const char* s, int& vi, int& vti, int& vni)
 {
     while (*s == ' ' || *s == '\t')
@@ -158,10 +251,10 @@ KOBJBlob load_obj(const char *filename)
         size_t nbytes = ftell(fp);
         fseek(fp, 0, SEEK_SET);
 
-        mem = (char*)malloc(nbytes + 1);
+        mem = (char*)malloc(nbytes + kParsePadding);
         assert(mem);
         fread(mem, 1, nbytes, fp);
-        mem[nbytes] = '\0';
+        memset(mem + nbytes, 0, kParsePadding);
         fclose(fp);
     }
 
@@ -201,6 +294,7 @@ KOBJBlob load_obj(const char *filename)
     uint16_t* outIndexBuffer = NULL;
 
     bool smoothNormals = false;
+    ParseFloatFn parse = selectParseFloat();
 
     const char* s = mem;
     while(*s)
@@ -210,18 +304,18 @@ KOBJBlob load_obj(const char *filename)
             ++s;
             currChar = *s++;
             if(currChar == ' '){
-                *vpIt++ = parseFloat(s, &s);
-                *vpIt++ = parseFloat(s, &s);
-                *vpIt++ = parseFloat(s, &s);
+                *vpIt++ = parse(s, &s);
+                *vpIt++ = parse(s, &s);
+                *vpIt++ = parse(s, &s);
             }
             else if(currChar == 't'){
-                *vtIt++ = parseFloat(s, &s);
-                *vtIt++ = parseFloat(s, &s);
+                *vtIt++ = parse(s, &s);
+                *vtIt++ = parse(s, &s);
             }
             else if(currChar == 'n'){
-                *vnIt++ = parseFloat(s, &s);
-                *vnIt++ = parseFloat(s, &s);
-                *vnIt++ = parseFloat(s, &s);
+                *vnIt++ = parse(s, &s);
+                *vnIt++ = parse(s, &s);
+                *vnIt++ = parse(s, &s);
             }
         }
         else if(currChar == 'f')
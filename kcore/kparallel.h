@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// parallel_for() splits [0, count) into contiguous bands, one per
+// worker, and calls fn(begin, end) for each band; the calling thread
+// takes the first band. work_per_item is a rough cost estimate used to
+// keep small jobs inline, where spawning threads would cost more than
+// the work itself. nthreads == 0 picks the hardware concurrency.
+
+inline unsigned default_thread_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+template <typename F>
+void parallel_for(uint32_t count, size_t work_per_item, unsigned nthreads, F fn)
+{
+    static const size_t kMinWorkPerThread = 1 << 16;
+    if (nthreads == 0)
+        nthreads = default_thread_count();
+    size_t max_threads = std::max<size_t>(1, (count * work_per_item) / kMinWorkPerThread);
+    unsigned n = static_cast<unsigned>(std::min<size_t>({nthreads, max_threads, count}));
+    if (n <= 1)
+    {
+        fn(0u, count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(n - 1);
+    uint32_t band = (count + n - 1) / n;
+    for (unsigned i = 1; i < n; ++i)
+    {
+        uint32_t begin = std::min(count, i * band);
+        uint32_t end = std::min(count, begin + band);
+        workers.emplace_back(fn, begin, end);
+    }
+    fn(0u, std::min(count, band));
+    for (auto& worker : workers)
+        worker.join();
+}
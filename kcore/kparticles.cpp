@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "kbitmap.h"
+#include "kbounce.h"
+#include "kparallel.h"
+#include "kparticles.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KPARTICLES_SSE2 1
+#include <emmintrin.h>
+#endif
+
+KParticles::KParticles(int width, int height, float speed)
+    : width_{width},
+      height_{height},
+      speed_{speed}
+{
+    assert(width > 0 && height > 0 && speed > 0.f);
+}
+
+void KParticles::reset(uint32_t count, uint32_t seed)
+{
+    seed_ = seed;
+    step_ = 0;
+    x_.assign(count, static_cast<float>(width_) / 2.f);
+    y_.assign(count, static_cast<float>(height_) / 2.f);
+    dx_.resize(count);
+    dy_.resize(count);
+    uint32_t key = bounce_key(seed, 0);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t h = bounce_draw(i, key);
+        uint32_t signs = bounce_mix(h);
+        dx_[i] = (signs & 1 ? -1.f : 1.f) * kDeflectionCos[deflection_x(h)] * speed_;
+        dy_[i] = (signs & 2 ? -1.f : 1.f) * kDeflectionSin[deflection_y(h)] * speed_;
+    }
+}
+
+void KParticles::update(unsigned nthreads)
+{
+    uint32_t key = bounce_key(seed_, ++step_);
+    // Bands are multiples of four points, so only the last one has a
+    // scalar tail.
+    uint32_t groups = (size() + 3) / 4;
+    parallel_for(groups, 64, nthreads, [&](uint32_t begin, uint32_t end) {
+        update_range(begin * 4, std::min(end * 4, size()), key);
+    });
+}
+
+void KParticles::update_scalar()
+{
+    uint32_t key = bounce_key(seed_, ++step_);
+    update_range_scalar(0, size(), key);
+}
+
+void KParticles::update_range_scalar(uint32_t begin, uint32_t end, uint32_t key)
+{
+    const float width = static_cast<float>(width_);
+    const float height = static_cast<float>(height_);
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        float x = x_[i] + dx_[i];
+        float y = y_[i] + dy_[i];
+        bool hit_x = bounces(x, width);
+        bool hit_y = bounces(y, height);
+        if (hit_x | hit_y)
+        {
+            uint32_t h = bounce_draw(i, key);
+            if (hit_x)
+                reflect(x, dx_[i], width, kDeflectionCos[deflection_x(h)], speed_);
+            if (hit_y)
+                reflect(y, dy_[i], height, kDeflectionSin[deflection_y(h)], speed_);
+        }
+        x_[i] = x;
+        y_[i] = y;
+    }
+}
+
+#if defined(KPARTICLES_SSE2)
+
+// Low 32 bits of a * b in each lane; SSE2 only multiplies the even
+// lanes.
+static inline __m128i mullo_epi32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i mix_epi32(__m128i x)
+{
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    x = mullo_epi32(x, _mm_set1_epi32(0x7feb352d));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+    x = mullo_epi32(x, _mm_set1_epi32(static_cast<int>(0x846ca68bu)));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    return x;
+}
+
+// table[k] in each lane, for k in [1, 9].
+static inline __m128 lookup_ps(const float *table, __m128i k)
+{
+    __m128 v = _mm_set1_ps(table[1]);
+    for (int j = 2; j < 10; ++j)
+    {
+        __m128 m = _mm_castsi128_ps(_mm_cmpeq_epi32(k, _mm_set1_epi32(j)));
+        v = _mm_or_ps(_mm_and_ps(m, _mm_set1_ps(table[j])), _mm_andnot_ps(m, v));
+    }
+    return v;
+}
+
+// Where mask is set, a new velocity of size |deflection * speed| that
+// points the other way from v; elsewhere v unchanged.
+static inline __m128 bounce_ps(__m128 mask, __m128 v, __m128 deflection, __m128 speed)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    __m128 bounced = _mm_or_ps(_mm_mul_ps(deflection, speed), _mm_andnot_ps(v, sign));
+    return _mm_or_ps(_mm_and_ps(mask, bounced), _mm_andnot_ps(mask, v));
+}
+
+static inline __m128 clamp_ps(__m128 mask, __m128 v, __m128 hi)
+{
+    __m128 clamped = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), hi);
+    return _mm_or_ps(_mm_and_ps(mask, clamped), _mm_andnot_ps(mask, v));
+}
+
+void KParticles::update_range(uint32_t begin, uint32_t end, uint32_t key)
+{
+    const __m128 width = _mm_set1_ps(static_cast<float>(width_));
+    const __m128 height = _mm_set1_ps(static_cast<float>(height_));
+    const __m128 x_max = _mm_set1_ps(static_cast<float>(width_) - 1.f);
+    const __m128 y_max = _mm_set1_ps(static_cast<float>(height_) - 1.f);
+    const __m128 speed = _mm_set1_ps(speed_);
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 dx = _mm_loadu_ps(&dx_[i]);
+        __m128 dy = _mm_loadu_ps(&dy_[i]);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(&x_[i]), dx);
+        __m128 y = _mm_add_ps(_mm_loadu_ps(&y_[i]), dy);
+        __m128 bounce_x = _mm_or_ps(_mm_cmpge_ps(x, width), _mm_cmple_ps(x, zero));
+        __m128 bounce_y = _mm_or_ps(_mm_cmpge_ps(y, height), _mm_cmple_ps(y, zero));
+
+        // A point bounces every few hundred steps, so most groups of
+        // four skip the draw altogether.
+        if (_mm_movemask_ps(_mm_or_ps(bounce_x, bounce_y)) != 0)
+        {
+            __m128i index = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)), _mm_setr_epi32(0, 1, 2, 3));
+            __m128i h = mix_epi32(_mm_add_epi32(mix_epi32(index), _mm_set1_epi32(static_cast<int>(key))));
+            const __m128i low = _mm_set1_epi32(0xffff);
+            __m128i u = _mm_and_si128(h, low);
+            __m128i v = _mm_srli_epi32(h, 16);
+            __m128i kx = _mm_add_epi32(_mm_srli_epi32(_mm_add_epi32(_mm_slli_epi32(u, 3), u), 16), _mm_set1_epi32(1));
+            __m128i ky = _mm_add_epi32(_mm_srli_epi32(_mm_add_epi32(_mm_slli_epi32(v, 3), v), 16), _mm_set1_epi32(1));
+
+            x = clamp_ps(bounce_x, x, x_max);
+            y = clamp_ps(bounce_y, y, y_max);
+            _mm_storeu_ps(&dx_[i], bounce_ps(bounce_x, dx, lookup_ps(kDeflectionCos, kx), speed));
+            _mm_storeu_ps(&dy_[i], bounce_ps(bounce_y, dy, lookup_ps(kDeflectionSin, ky), speed));
+        }
+        _mm_storeu_ps(&x_[i], x);
+        _mm_storeu_ps(&y_[i], y);
+    }
+    update_range_scalar(i, end, key);
+}
+
+#else
+
+void KParticles::update_range(uint32_t begin, uint32_t end, uint32_t key)
+{
+    update_range_scalar(begin, end, key);
+}
+
+#endif
+
+void KParticles::splat(KBitmap& bitmap, uint32_t color) const
+{
+    uint32_t *pixels = bitmap.data();
+    const int width = bitmap.width();
+    const int height = bitmap.height();
+    for (uint32_t i = 0; i < size(); ++i)
+    {
+        int x = static_cast<int>(x_[i]);
+        int y = static_cast<int>(y_[i]);
+        if (x >= 0 && x < width && y >= 0 && y < height)
+            pixels[y * width + x] = color;
+    }
+    bitmap.mark_all_dirty();
+}
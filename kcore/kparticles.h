@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class KBitmap;
+
+// Points bouncing around a box the way KScene's single point does,
+// scaled to millions of them. Each step a point moves by its velocity.
+// On hitting a wall it is clamped back inside, its velocity along that
+// axis turns around, and the new speed along it is cos(k * pi/20) for x
+// or sin(k * pi/20) for y, times the speed, with k drawn from [1, 9].
+//
+// The state is kept as one array per component, so an update streams
+// through four arrays and works on four points per SSE2 instruction.
+// Random draws come from a hash of (seed, step, point index) instead of
+// a generator that carries state from one draw to the next. Every point
+// can therefore draw on its own, in any order and on any thread, and
+// the result depends only on the seed. update() splits the points into
+// bands with parallel_for(); update_scalar() is the portable reference
+// and gives bit-identical results.
+//
+// USAGE:
+//
+// KParticles particles{bitmap.width(), bitmap.height()};
+// particles.reset(1 << 20, seed);
+// particles.update(default_thread_count());
+// bitmap.clear(0xffffffff);
+// particles.splat(bitmap, 0xff000000);
+
+class KParticles
+{
+public:
+    KParticles(int width, int height, float speed = 1.f);
+
+    // Starts count points at the center of the box, each heading in a
+    // random direction.
+    void reset(uint32_t count, uint32_t seed);
+
+    // Advances every point by one step. nthreads == 0 picks the
+    // hardware concurrency.
+    void update(unsigned nthreads = 1);
+    void update_scalar();
+
+    // Writes one pixel of color at each point that lies inside bitmap.
+    void splat(KBitmap& bitmap, uint32_t color) const;
+
+    uint32_t size() const;
+    uint64_t step() const;
+    const float *x() const;
+    const float *y() const;
+    const float *dx() const;
+    const float *dy() const;
+
+private:
+    void update_range(uint32_t begin, uint32_t end, uint32_t key);
+    void update_range_scalar(uint32_t begin, uint32_t end, uint32_t key);
+
+    int width_{100};
+    int height_{100};
+    float speed_{1.f};
+    uint32_t seed_{};
+    uint64_t step_{};
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<float> dx_;
+    std::vector<float> dy_;
+};
+
+inline uint32_t KParticles::size() const { return static_cast<uint32_t>(x_.size()); }
+
+inline uint64_t KParticles::step() const { return step_; }
+
+inline const float *KParticles::x() const { return x_.data(); }
+
+inline const float *KParticles::y() const { return y_.data(); }
+
+inline const float *KParticles::dx() const { return dx_.data(); }
+
+inline const float *KParticles::dy() const { return dy_.data(); }
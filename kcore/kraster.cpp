@@ -0,0 +1,418 @@
+#include "kraster.h"
+#include "kcpu.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KRASTER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(KCPU_X64)
+#include <immintrin.h>
+#endif
+
+// Spans at least this long are filled with non-temporal stores, which
+// skip the cache instead of evicting everything else from it.
+static const int kStreamingFillPixels = 1 << 16;
+
+// x / 255, rounded, exact for x in [0, 65535].
+static inline uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// Scalar reference.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+void fill_row_scalar(uint32_t *dst, int n, uint32_t color)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] = color;
+}
+
+// Premultiplied s over d.
+static inline uint32_t over(uint32_t s, uint32_t d)
+{
+    uint32_t inv_alpha = 255 - (s >> 24);
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32_t c = ((s >> shift) & 0xff) + div255(((d >> shift) & 0xff) * inv_alpha);
+        out |= std::min(c, 255u) << shift;
+    }
+    return out;
+}
+
+void blend_row_scalar(uint32_t *dst, const uint32_t *src, int n)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] = over(src[i], dst[i]);
+}
+
+void blend_solid_row_scalar(uint32_t *dst, const uint8_t *coverage, uint32_t color, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        uint32_t c = coverage[i];
+        if (c == 0)
+            continue;
+        uint32_t s = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+            s |= div255(((color >> shift) & 0xff) * c) << shift;
+        dst[i] = over(s, dst[i]);
+    }
+}
+
+void coverage_row_scalar(int32_t *acc, uint8_t *coverage, int n)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        sum += acc[i];
+        acc[i] = 0;
+        uint32_t c = std::min<uint32_t>(static_cast<uint32_t>(std::abs(sum)), 0x10000);
+        coverage[i] = static_cast<uint8_t>((c * 255 + 0x8000) >> 16);
+    }
+}
+
+void scale_row_bilinear_scalar(uint32_t *dst, int n,
+                               const uint32_t *row0, const uint32_t *row1, int src_width,
+                               int32_t x0, int32_t dx, int wy)
+{
+    int32_t x_max = (src_width - 1) << 16;
+    for (int i = 0; i < n; ++i)
+    {
+        int32_t x = std::clamp(x0 + i * dx, 0, x_max);
+        int ix0 = x >> 16;
+        int ix1 = std::min(ix0 + 1, src_width - 1);
+        uint32_t wx = (x & 0xffff) >> 8;
+
+        uint32_t out = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t a = (((row0[ix0] >> shift) & 0xff) * (256 - wy) + ((row1[ix0] >> shift) & 0xff) * wy) >> 8;
+            uint32_t b = (((row0[ix1] >> shift) & 0xff) * (256 - wy) + ((row1[ix1] >> shift) & 0xff) * wy) >> 8;
+            out |= ((a * (256 - wx) + b * wx) >> 8) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+#if defined(KRASTER_SSE2)
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// SIMD.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// Premultiplied "over" on 16-bit lanes holding two pixels.
+static inline __m128i blend_epi16(__m128i s, __m128i d)
+{
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i x = _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), alpha));
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    return x;
+}
+
+static void fill_row_sse2(uint32_t *dst, int n, uint32_t color)
+{
+    int i = 0;
+    __m128i c = _mm_set1_epi32(static_cast<int>(color));
+    if (n >= kStreamingFillPixels)
+    {
+        while (i < n && (reinterpret_cast<uintptr_t>(dst + i) & 15))
+            dst[i++] = color;
+        for (; i + 4 <= n; i += 4)
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), c);
+        _mm_sfence();
+    }
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), c);
+    for (; i < n; ++i)
+        dst[i] = color;
+}
+
+static void blend_row_sse2(uint32_t *dst, const uint32_t *src, int n)
+{
+    int i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000));
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff)
+            continue;   // Fully transparent.
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alpha_mask), alpha_mask)) == 0xffff)
+        {
+            _mm_storeu_si128(p, s);     // Fully opaque.
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(p);
+        __m128i lo = blend_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blend_epi16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(p, _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+    blend_row_scalar(dst + i, src + i, n - i);
+}
+
+#if defined(KCPU_X64)
+
+KCPU_TARGET("avx2") static inline __m256i blend_epi16(__m256i s, __m256i d)
+{
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i x = _mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), alpha));
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    x = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+    return x;
+}
+
+KCPU_TARGET("avx2") static void fill_row_avx2(uint32_t *dst, int n, uint32_t color)
+{
+    int i = 0;
+    __m256i c = _mm256_set1_epi32(static_cast<int>(color));
+    if (n >= kStreamingFillPixels)
+    {
+        while (i < n && (reinterpret_cast<uintptr_t>(dst + i) & 31))
+            dst[i++] = color;
+        for (; i + 8 <= n; i += 8)
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), c);
+        _mm_sfence();
+    }
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), c);
+    for (; i < n; ++i)
+        dst[i] = color;
+}
+
+KCPU_TARGET("avx2") static void blend_row_avx2(uint32_t *dst, const uint32_t *src, int n)
+{
+    int i = 0;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) == -1)
+            continue;
+        __m256i* p = reinterpret_cast<__m256i*>(dst + i);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alpha_mask), alpha_mask)) == -1)
+        {
+            _mm256_storeu_si256(p, s);
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256(p);
+        __m256i lo = blend_epi16(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero));
+        __m256i hi = blend_epi16(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero));
+        _mm256_storeu_si256(p, _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+    }
+    blend_row_scalar(dst + i, src + i, n - i);
+}
+
+// The tail is one masked store instead of a scalar loop.
+KCPU_TARGET("avx512f") static void fill_row_avx512(uint32_t *dst, int n, uint32_t color)
+{
+    int i = 0;
+    __m512i c = _mm512_set1_epi32(static_cast<int>(color));
+    if (n >= kStreamingFillPixels)
+    {
+        while (i < n && (reinterpret_cast<uintptr_t>(dst + i) & 63))
+            dst[i++] = color;
+        for (; i + 16 <= n; i += 16)
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), c);
+        _mm_sfence();
+    }
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_si512(dst + i, c);
+    if (i < n)
+        _mm512_mask_storeu_epi32(dst + i, static_cast<__mmask16>((1u << (n - i)) - 1), c);
+}
+
+#endif
+
+using FillRowFn = void (*)(uint32_t*, int, uint32_t);
+using BlendRowFn = void (*)(uint32_t*, const uint32_t*, int);
+
+static FillRowFn select_fill_row()
+{
+    switch (cpu_isa())
+    {
+    case KIsa::kScalar: return fill_row_scalar;
+#if defined(KCPU_X64)
+    case KIsa::kAVX2: return fill_row_avx2;
+    case KIsa::kAVX512: return fill_row_avx512;
+#endif
+    default: return fill_row_sse2;
+    }
+}
+
+// AVX-512 would add nothing here: most spans are either transparent or
+// opaque, and those cost a load and a store at any width.
+static BlendRowFn select_blend_row()
+{
+    switch (cpu_isa())
+    {
+    case KIsa::kScalar: return blend_row_scalar;
+#if defined(KCPU_X64)
+    case KIsa::kAVX2:
+    case KIsa::kAVX512: return blend_row_avx2;
+#endif
+    default: return blend_row_sse2;
+    }
+}
+
+void fill_row(uint32_t *dst, int n, uint32_t color)
+{
+    static const FillRowFn fn = select_fill_row();
+    fn(dst, n, color);
+}
+
+void blend_row(uint32_t *dst, const uint32_t *src, int n)
+{
+    static const BlendRowFn fn = select_blend_row();
+    fn(dst, src, n);
+}
+
+void blend_solid_row(uint32_t *dst, const uint8_t *coverage, uint32_t color, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i solid = _mm_set1_epi32(static_cast<int>(color));
+    const __m128i color16 = _mm_unpacklo_epi8(solid, zero);
+    bool opaque = (color >> 24) == 0xff;
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        uint32_t mask;
+        memcpy(&mask, coverage + i, sizeof(mask));
+        if (mask == 0)
+            continue;   // Outside the shape.
+        __m128i* p = reinterpret_cast<__m128i*>(dst + i);
+        if (mask == 0xffffffff && opaque)
+        {
+            _mm_storeu_si128(p, solid);     // Inside an opaque shape.
+            continue;
+        }
+
+        // Spread each pixel's coverage over its four channels, then
+        // scale the color by it, two pixels per register.
+        __m128i m = _mm_cvtsi32_si128(static_cast<int>(mask));
+        m = _mm_unpacklo_epi8(m, m);
+        m = _mm_unpacklo_epi16(m, m);
+        __m128i s_lo = _mm_mullo_epi16(color16, _mm_unpacklo_epi8(m, zero));
+        __m128i s_hi = _mm_mullo_epi16(color16, _mm_unpackhi_epi8(m, zero));
+        s_lo = _mm_add_epi16(s_lo, _mm_set1_epi16(128));
+        s_hi = _mm_add_epi16(s_hi, _mm_set1_epi16(128));
+        s_lo = _mm_srli_epi16(_mm_add_epi16(s_lo, _mm_srli_epi16(s_lo, 8)), 8);
+        s_hi = _mm_srli_epi16(_mm_add_epi16(s_hi, _mm_srli_epi16(s_hi, 8)), 8);
+
+        __m128i d = _mm_loadu_si128(p);
+        __m128i lo = blend_epi16(s_lo, _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blend_epi16(s_hi, _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(p, _mm_adds_epu8(_mm_packus_epi16(s_lo, s_hi), _mm_packus_epi16(lo, hi)));
+    }
+    blend_solid_row_scalar(dst + i, coverage + i, color, n - i);
+}
+
+void coverage_row(int32_t *acc, uint8_t *coverage, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(0x10000);
+    __m128i carry = zero;
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        // Prefix sum within the register, plus the sum of everything
+        // before it. Integer adds, so the order doesn't change the result.
+        __m128i* p = reinterpret_cast<__m128i*>(acc + i);
+        __m128i v = _mm_loadu_si128(p);
+        _mm_storeu_si128(p, zero);
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m128i sign = _mm_srai_epi32(v, 31);
+        __m128i a = _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+        __m128i over_one = _mm_cmpgt_epi32(a, one);
+        a = _mm_or_si128(_mm_and_si128(over_one, one), _mm_andnot_si128(over_one, a));
+        a = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(a, 8), a), _mm_set1_epi32(0x8000)), 16);
+        a = _mm_packus_epi16(_mm_packs_epi32(a, zero), zero);
+        uint32_t bytes = static_cast<uint32_t>(_mm_cvtsi128_si32(a));
+        memcpy(coverage + i, &bytes, sizeof(bytes));
+    }
+    if (i < n)
+    {
+        // Fold the running sum into the first leftover cell.
+        acc[i] += _mm_cvtsi128_si32(carry);
+        coverage_row_scalar(acc + i, coverage + i, n - i);
+    }
+}
+
+void scale_row_bilinear(uint32_t *dst, int n,
+                        const uint32_t *row0, const uint32_t *row1, int src_width,
+                        int32_t x0, int32_t dx, int wy)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w0 = _mm_set1_epi16(static_cast<short>(256 - wy));
+    const __m128i w1 = _mm_set1_epi16(static_cast<short>(wy));
+    int32_t x_max = (src_width - 1) << 16;
+    for (int i = 0; i < n; ++i)
+    {
+        int32_t x = std::clamp(x0 + i * dx, 0, x_max);
+        int ix0 = x >> 16;
+        int ix1 = std::min(ix0 + 1, src_width - 1);
+        short wx = static_cast<short>((x & 0xffff) >> 8);
+
+        // Lanes 0-3 hold the left column, lanes 4-7 the right one.
+        __m128i top = _mm_unpacklo_epi32(_mm_cvtsi32_si128(static_cast<int>(row0[ix0])),
+                                         _mm_cvtsi32_si128(static_cast<int>(row0[ix1])));
+        __m128i bottom = _mm_unpacklo_epi32(_mm_cvtsi32_si128(static_cast<int>(row1[ix0])),
+                                            _mm_cvtsi32_si128(static_cast<int>(row1[ix1])));
+        __m128i v = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(top, zero), w0),
+                                  _mm_mullo_epi16(_mm_unpacklo_epi8(bottom, zero), w1));
+        v = _mm_srli_epi16(v, 8);
+
+        __m128i wh = _mm_set_epi16(wx, wx, wx, wx,
+                                   static_cast<short>(256 - wx), static_cast<short>(256 - wx),
+                                   static_cast<short>(256 - wx), static_cast<short>(256 - wx));
+        __m128i h = _mm_mullo_epi16(v, wh);
+        h = _mm_srli_epi16(_mm_add_epi16(h, _mm_srli_si128(h, 8)), 8);
+        dst[i] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(h, zero)));
+    }
+}
+
+#else
+
+void fill_row(uint32_t *dst, int n, uint32_t color)
+{
+    fill_row_scalar(dst, n, color);
+}
+
+void blend_row(uint32_t *dst, const uint32_t *src, int n)
+{
+    blend_row_scalar(dst, src, n);
+}
+
+void blend_solid_row(uint32_t *dst, const uint8_t *coverage, uint32_t color, int n)
+{
+    blend_solid_row_scalar(dst, coverage, color, n);
+}
+
+void coverage_row(int32_t *acc, uint8_t *coverage, int n)
+{
+    coverage_row_scalar(acc, coverage, n);
+}
+
+void scale_row_bilinear(uint32_t *dst, int n,
+                        const uint32_t *row0, const uint32_t *row1, int src_width,
+                        int32_t x0, int32_t dx, int wy)
+{
+    scale_row_bilinear_scalar(dst, n, row0, row1, src_width, x0, dx, wy);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// Row kernels behind KBitmap's raster operations. Pixels are 32-bit
+// 0xaarrggbb with premultiplied alpha. Each kernel works on one span
+// of n pixels and knows nothing about clipping, which the callers in
+// KBitmap and KRasterizer do once per rectangle or shape.
+//
+// The SIMD variants use SSE2; fill_row() and blend_row() also have
+// AVX2 and AVX-512 code, picked at run time (see kcpu.h). The *_scalar
+// variants are the portable reference. All compute the same integer
+// arithmetic, so their results are bit-identical.
+
+// dst[i] = color.
+void fill_row(uint32_t *dst, int n, uint32_t color);
+void fill_row_scalar(uint32_t *dst, int n, uint32_t color);
+
+// dst[i] = src[i] + dst[i] * (255 - src_alpha[i]) / 255, per channel.
+void blend_row(uint32_t *dst, const uint32_t *src, int n);
+void blend_row_scalar(uint32_t *dst, const uint32_t *src, int n);
+
+// dst[i] = color * coverage[i] / 255 over dst[i]: a solid color
+// drawn through an 8-bit coverage mask.
+void blend_solid_row(uint32_t *dst, const uint8_t *coverage, uint32_t color, int n);
+void blend_solid_row_scalar(uint32_t *dst, const uint8_t *coverage, uint32_t color, int n);
+
+// Turns one row of KRasterizer's accumulation buffer into coverage:
+// coverage[i] = 255 * min(|acc[0] + ... + acc[i]|, 1), with the cells
+// in 16.16 fixed point. Zeroes acc[0, n) on the way, ready for the next
+// shape.
+void coverage_row(int32_t *acc, uint8_t *coverage, int n);
+void coverage_row_scalar(int32_t *acc, uint8_t *coverage, int n);
+
+// Bilinear resampling of one destination row. row0 and row1 are the
+// source rows above and below the sample point and are src_width
+// pixels long; wy is the vertical weight of row1 in [0, 256]. Pixel i
+// samples x = x0 + i * dx, in 16.16 fixed point, clamped to the row.
+void scale_row_bilinear(uint32_t *dst, int n,
+                        const uint32_t *row0, const uint32_t *row1, int src_width,
+                        int32_t x0, int32_t dx, int wy);
+void scale_row_bilinear_scalar(uint32_t *dst, int n,
+                               const uint32_t *row0, const uint32_t *row1, int src_width,
+                               int32_t x0, int32_t dx, int wy);
@@ -0,0 +1,43 @@
+#include "kbounce.h"
+#include "kparallel.h"
+#include "kscene.h"
+
+KScene::KScene(int width, int height, uint32_t particle_count, uint32_t seed) :
+    x_{static_cast<float>(width) / 2.f},
+    y_{static_cast<float>(height) / 2.f},
+    particles_{width, height},
+    width_{width},
+    height_{height},
+    seed_{seed}
+{
+    particles_.reset(particle_count, bounce_mix(seed));
+}
+
+KScene::~KScene()
+{
+}
+
+void KScene::update()
+{
+    const float width = static_cast<float>(width_);
+    const float height = static_cast<float>(height_);
+    ++step_;
+    x_ += dx_;
+    y_ += dy_;
+
+    // A hit comes once in a hundred steps or so, which keeps the branch
+    // well predicted and the draw off the common path.
+    bool hit_x = bounces(x_, width);
+    bool hit_y = bounces(y_, height);
+    if (hit_x | hit_y)
+    {
+        uint32_t h = bounce_draw(0, bounce_key(seed_, step_));
+        if (hit_x)
+            reflect(x_, dx_, width, kDeflectionCos[deflection_x(h)], speed_);
+        if (hit_y)
+            reflect(y_, dy_, height, kDeflectionSin[deflection_y(h)], speed_);
+    }
+
+    if (particles_.size() > 0)
+        particles_.update(default_thread_count());
+}
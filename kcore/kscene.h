@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include "kparticles.h"
+
+// A point bouncing around a box, as described in kbounce.h, with
+// particle_count more bouncing alongside it. Runs are reproducible: the
+// same seed gives the same motion.
+class KScene
+{
+public:
+    KScene(int width, int height, uint32_t particle_count = 0, uint32_t seed = 1);
+    ~KScene();
+    void update();
+
+    float x_{};
+    float y_{};
+    KParticles particles_;
+
+private:
+    int width_{100};
+    int height_{100};
+    float dx_{1.f};
+    float dy_{1.f};
+    float speed_{1.f};
+    uint32_t seed_{1};
+    uint64_t step_{};
+ };
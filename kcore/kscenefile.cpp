@@ -0,0 +1,106 @@
+#include "kscenefile.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996) // Disable warning that fopen() is unsafe.
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <vector>
+#include "kmappedfile.h"
+
+static const uint32_t kSceneMagic = 0x4e43534b;        // "KSCN"
+static const uint32_t kSceneVersion = 1;
+static const uint64_t kSceneAlignment = 64;
+
+static_assert(sizeof(KSceneHeader) == 64, "KSceneHeader must stay 64 bytes");
+
+static uint64_t align_up(uint64_t n)
+{
+    return (n + kSceneAlignment - 1) & ~(kSceneAlignment - 1);
+}
+
+bool save_scene(const KShapeStore& shapes, const std::filesystem::path& filename)
+{
+    KSceneHeader header{};
+    header.magic = kSceneMagic;
+    header.version = kSceneVersion;
+    header.count = shapes.size();
+    uint64_t field_bytes = align_up(header.count * sizeof(float));
+    for (int f = 0; f < 4; ++f)
+        header.offsets[f] = sizeof(KSceneHeader) + f * field_bytes;
+
+    // Holes are squeezed out on the way; without any, the store's arrays
+    // are written as they are.
+    const float *fields[4]{shapes.cx(), shapes.cy(), shapes.rx(), shapes.ry()};
+    std::vector<float> packed;
+    if (shapes.span() != shapes.size())
+    {
+        packed.resize(4 * shapes.size());
+        for (int f = 0; f < 4; ++f)
+        {
+            float *out = packed.data() + f * shapes.size();
+            for (size_t i = 0; i < shapes.span(); ++i)
+                if (shapes.alive(i))
+                    *out++ = fields[f][i];
+            fields[f] = packed.data() + f * shapes.size();
+        }
+    }
+
+    // Write to a temporary name and rename, so that a crash mid-write
+    // never leaves a truncated scene under the real name.
+    auto temp = filename;
+    temp += ".tmp";
+#if defined(_WIN32)
+    FILE *fp = _wfopen(temp.c_str(), L"wb");
+#else
+    FILE *fp = fopen(temp.c_str(), "wb");
+#endif
+    if (!fp)
+        return false;
+    static const uint8_t kZeros[kSceneAlignment]{};
+    size_t padding = static_cast<size_t>(field_bytes - header.count * sizeof(float));
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (int f = 0; f < 4 && ok; ++f)
+    {
+        ok = fwrite(fields[f], sizeof(float), static_cast<size_t>(header.count), fp) == header.count &&
+             fwrite(kZeros, 1, padding, fp) == padding;
+    }
+    ok = (fclose(fp) == 0) && ok;
+
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(temp, filename, ec);
+    if (!ok || ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool load_scene(const std::filesystem::path& filename, KShapeStore& shapes)
+{
+    KMappedFile file;
+    if (!file.open(filename) || file.size() < sizeof(KSceneHeader))
+        return false;
+
+    KSceneHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != kSceneMagic || header.version != kSceneVersion || header.count > UINT32_MAX)
+        return false;
+    uint64_t field_bytes = header.count * sizeof(float);
+    for (uint64_t offset : header.offsets)
+    {
+        if (offset % sizeof(float) != 0 || offset > file.size() || file.size() - offset < field_bytes)
+            return false;
+    }
+
+    // The mapping is aligned to a page and the offsets to a float, so the
+    // arrays can be read in place.
+    auto field = [&](int f) { return reinterpret_cast<const float*>(file.data() + header.offsets[f]); };
+    shapes.assign(field(0), field(1), field(2), field(3), static_cast<size_t>(header.count));
+    return true;
+}
+
+#pragma warning(pop)
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include "kshapestore.h"
+
+// Binary scene files: the ellipses of a KShapeStore in back-to-front
+// order, so that the z-order is the order of the records. The records
+// are packed one array per field, the same layout as the store, which
+// lets load_scene() map the file and fill each of the store's arrays
+// with a single copy, without parsing record by record.
+//
+// Layout, little-endian:
+//
+//   KSceneHeader                      64 bytes
+//   float cx[count], padded to a multiple of 64 bytes
+//   float cy[count], ...
+//   float rx[count], ...
+//   float ry[count], ...
+//
+// USAGE:
+//
+// save_scene(geometry.shapes_, L"drawing.kscene");
+// load_scene(L"drawing.kscene", geometry.shapes_);
+
+struct KSceneHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+    uint64_t offsets[4];    // Of the cx, cy, rx and ry arrays, from the start.
+    uint64_t reserved[2];
+};
+
+bool save_scene(const KShapeStore& shapes, const std::filesystem::path& filename);
+
+// Replaces the contents of shapes, which keeps them unchanged on failure.
+// Handles from before the load don't carry over.
+bool load_scene(const std::filesystem::path& filename, KShapeStore& shapes);
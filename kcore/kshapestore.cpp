@@ -0,0 +1,139 @@
+#include <cassert>
+#include "kshapestore.h"
+
+KShapeHandle KShapeStore::insert(const KEllipseF& ellipse)
+{
+    uint32_t slot;
+    if (!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(slots_.size());
+        slots_.push_back(Slot{kHole, 0});
+    }
+    slots_[slot].position = append(slot, ellipse);
+    ++size_;
+    ++revision_;
+    return KShapeHandle{slot, slots_[slot].generation};
+}
+
+void KShapeStore::erase(KShapeHandle handle)
+{
+    assert(valid(handle));
+    Slot& slot = slots_[handle.index];
+    leave_hole(slot.position);
+    slot.position = kHole;
+    ++slot.generation;
+    free_slots_.push_back(handle.index);
+    --size_;
+    ++revision_;
+    compact();
+}
+
+void KShapeStore::set(KShapeHandle handle, const KEllipseF& ellipse)
+{
+    assert(valid(handle));
+    uint32_t i = slots_[handle.index].position;
+    cx_[i] = ellipse.cx;
+    cy_[i] = ellipse.cy;
+    rx_[i] = ellipse.rx;
+    ry_[i] = ellipse.ry;
+    ++revision_;
+}
+
+void KShapeStore::bring_to_front(KShapeHandle handle)
+{
+    assert(valid(handle));
+    Slot& slot = slots_[handle.index];
+    if (slot.position + 1 == owner_.size())
+        return;     // Already on top.
+    KEllipseF ellipse = at(slot.position);
+    leave_hole(slot.position);
+    slot.position = append(handle.index, ellipse);
+    ++revision_;
+    compact();
+}
+
+// Forgets every shape. Handles from before are not told apart from
+// new ones, so callers must drop theirs; the revision keeps counting
+// up, so derived data can't mistake the new contents for the old.
+void KShapeStore::clear()
+{
+    cx_.clear();
+    cy_.clear();
+    rx_.clear();
+    ry_.clear();
+    owner_.clear();
+    slots_.clear();
+    free_slots_.clear();
+    size_ = 0;
+    holes_ = 0;
+    ++revision_;
+}
+
+void KShapeStore::assign(const float *cx, const float *cy, const float *rx, const float *ry, size_t count)
+{
+    cx_.assign(cx, cx + count);
+    cy_.assign(cy, cy + count);
+    rx_.assign(rx, rx + count);
+    ry_.assign(ry, ry + count);
+    owner_.resize(count);
+    slots_.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        owner_[i] = static_cast<uint32_t>(i);
+        slots_[i] = Slot{static_cast<uint32_t>(i), 0};
+    }
+    free_slots_.clear();
+    size_ = count;
+    holes_ = 0;
+    ++revision_;
+}
+
+uint32_t KShapeStore::append(uint32_t slot, const KEllipseF& ellipse)
+{
+    cx_.push_back(ellipse.cx);
+    cy_.push_back(ellipse.cy);
+    rx_.push_back(ellipse.rx);
+    ry_.push_back(ellipse.ry);
+    owner_.push_back(slot);
+    return static_cast<uint32_t>(owner_.size() - 1);
+}
+
+void KShapeStore::leave_hole(uint32_t position)
+{
+    owner_[position] = kHole;
+    ++holes_;
+}
+
+// Squeezes out the holes once there are more of them than shapes,
+// keeping the order of the rest.
+void KShapeStore::compact()
+{
+    if (holes_ <= size_ && holes_ < owner_.size())
+        return;
+
+    size_t out = 0;
+    for (size_t i = 0; i < owner_.size(); ++i)
+    {
+        uint32_t slot = owner_[i];
+        if (slot == kHole)
+            continue;
+        cx_[out] = cx_[i];
+        cy_[out] = cy_[i];
+        rx_[out] = rx_[i];
+        ry_[out] = ry_[i];
+        owner_[out] = slot;
+        slots_[slot].position = static_cast<uint32_t>(out);
+        ++out;
+    }
+    cx_.resize(out);
+    cy_.resize(out);
+    rx_.resize(out);
+    ry_.resize(out);
+    owner_.resize(out);
+    holes_ = 0;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ellipses in flat arrays, one per field, in back-to-front order, so
+// that drawing and testing all of them streams through memory. Shapes
+// are named by handles from a slot map, which stay valid while the
+// arrays below them are reordered; a handle to an erased shape is
+// recognised by its generation and never aliases a newer shape.
+//
+// bring_to_front() is O(1): it leaves a hole at the shape's old
+// position and appends the shape at the top. Holes are skipped when
+// iterating, and squeezed out once they outnumber the live shapes,
+// which costs amortized O(1) per operation.
+//
+// USAGE:
+//
+// KShapeStore store;
+// KShapeHandle h = store.insert(KEllipseF{100.f, 100.f, 20.f, 10.f});
+// store.bring_to_front(h);
+// for (size_t i = 0; i < store.span(); ++i)
+//     if (store.alive(i))
+//         draw(store.cx()[i], store.cy()[i], store.rx()[i], store.ry()[i]);
+
+struct KShapeHandle
+{
+    uint32_t index{UINT32_MAX};
+    uint32_t generation{};
+};
+
+inline bool operator==(KShapeHandle a, KShapeHandle b)
+{
+    return a.index == b.index && a.generation == b.generation;
+}
+
+inline bool operator!=(KShapeHandle a, KShapeHandle b)
+{
+    return !(a == b);
+}
+
+struct KEllipseF
+{
+    float cx;
+    float cy;
+    float rx;
+    float ry;
+};
+
+class KShapeStore
+{
+public:
+    KShapeHandle insert(const KEllipseF& ellipse);
+    void erase(KShapeHandle handle);
+    bool valid(KShapeHandle handle) const;
+
+    KEllipseF get(KShapeHandle handle) const;
+    void set(KShapeHandle handle, const KEllipseF& ellipse);
+    void bring_to_front(KShapeHandle handle);
+    void clear();
+
+    // Replaces the contents with count ellipses, back to front, given a
+    // field at a time, in one copy per field. Like clear(), drops all
+    // handles from before.
+    void assign(const float *cx, const float *cy, const float *rx, const float *ry, size_t count);
+
+    // Position in back-to-front order: a larger depth is drawn later,
+    // over a smaller one. Only comparable between calls that don't
+    // change the order.
+    uint32_t depth(KShapeHandle handle) const;
+
+    // The slot of a handle, dense in [0, slot_count()), for side tables
+    // such as a spatial index.
+    uint32_t slot(KShapeHandle handle) const;
+    size_t slot_count() const;
+    KShapeHandle handle_of_slot(uint32_t slot) const;
+    uint32_t slot_at(size_t i) const;       // Of a live position i.
+
+    size_t size() const;
+
+    // Goes up with every change to the shapes or their order, so that
+    // anything derived from the store can tell when it is stale.
+    uint64_t revision() const;
+
+    // Structure-of-arrays view in back-to-front order, span() entries
+    // long including holes.
+    size_t span() const;
+    bool alive(size_t i) const;
+    const float* cx() const;
+    const float* cy() const;
+    const float* rx() const;
+    const float* ry() const;
+    KEllipseF at(size_t i) const;
+
+private:
+    static const uint32_t kHole{UINT32_MAX};
+
+    struct Slot
+    {
+        uint32_t position;      // In the arrays; kHole while free.
+        uint32_t generation;
+    };
+
+    uint32_t append(uint32_t slot, const KEllipseF& ellipse);
+    void leave_hole(uint32_t position);
+    void compact();
+
+    std::vector<float> cx_;
+    std::vector<float> cy_;
+    std::vector<float> rx_;
+    std::vector<float> ry_;
+    std::vector<uint32_t> owner_;       // Slot at each position; kHole for a hole.
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    size_t size_{};
+    size_t holes_{};
+    uint64_t revision_{};
+};
+
+inline size_t KShapeStore::size() const { return size_; }
+
+inline uint64_t KShapeStore::revision() const { return revision_; }
+
+inline size_t KShapeStore::span() const { return owner_.size(); }
+
+inline bool KShapeStore::alive(size_t i) const { return owner_[i] != kHole; }
+
+inline const float* KShapeStore::cx() const { return cx_.data(); }
+
+inline const float* KShapeStore::cy() const { return cy_.data(); }
+
+inline const float* KShapeStore::rx() const { return rx_.data(); }
+
+inline const float* KShapeStore::ry() const { return ry_.data(); }
+
+inline KEllipseF KShapeStore::at(size_t i) const { return KEllipseF{cx_[i], cy_[i], rx_[i], ry_[i]}; }
+
+inline size_t KShapeStore::slot_count() const { return slots_.size(); }
+
+inline uint32_t KShapeStore::slot(KShapeHandle handle) const { return handle.index; }
+
+inline uint32_t KShapeStore::slot_at(size_t i) const { return owner_[i]; }
+
+inline KShapeHandle KShapeStore::handle_of_slot(uint32_t slot) const { return KShapeHandle{slot, slots_[slot].generation}; }
+
+inline bool KShapeStore::valid(KShapeHandle handle) const
+{
+    return handle.index < slots_.size() &&
+           slots_[handle.index].generation == handle.generation &&
+           slots_[handle.index].position != kHole;
+}
+
+inline uint32_t KShapeStore::depth(KShapeHandle handle) const { return slots_[handle.index].position; }
+
+inline KEllipseF KShapeStore::get(KShapeHandle handle) const { return at(slots_[handle.index].position); }
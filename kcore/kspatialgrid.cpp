@@ -0,0 +1,181 @@
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include "kspatialgrid.h"
+
+static KAABB combine(const KAABB& a, const KAABB& b)
+{
+    return KAABB{std::min(a.left, b.left), std::min(a.top, b.top),
+                 std::max(a.right, b.right), std::max(a.bottom, b.bottom)};
+}
+
+void KSpatialGrid::erase_id(std::vector<Entry>& entries, int id)
+{
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (entries[i].id == id)
+        {
+            entries[i] = entries.back();
+            entries.pop_back();
+            return;
+        }
+    }
+    assert(false);
+}
+
+void KSpatialGrid::insert(int id, const KAABB& box)
+{
+    if (static_cast<size_t>(id) >= placements_.size())
+        placements_.resize(id + 1, Placement{});
+    assert(!placements_[id].present);
+    placements_[id] = Placement{box, -1, -1, -1, -1, true};
+    ++size_;
+    if (size_ > 2 * laid_out_size_)
+        layout();
+    else
+        place(id);
+}
+
+void KSpatialGrid::move(int id, const KAABB& box)
+{
+    Placement& p = placements_[id];
+    assert(p.present);
+    if (p.x0 >= 0 &&
+        cell_x(box.left) == p.x0 && cell_x(box.right) == p.x1 &&
+        cell_y(box.top) == p.y0 && cell_y(box.bottom) == p.y1)
+    {
+        // Same cells: just update the copies.
+        p.box = box;
+        for (int y = p.y0; y <= p.y1; ++y)
+            for (int x = p.x0; x <= p.x1; ++x)
+                for (Entry& e : cells_[y * columns_ + x])
+                    if (e.id == id)
+                        e.box = box;
+        return;
+    }
+    unplace(id);
+    p.box = box;
+    place(id);
+}
+
+void KSpatialGrid::remove(int id)
+{
+    assert(placements_[id].present);
+    unplace(id);
+    placements_[id].present = false;
+    --size_;
+}
+
+void KSpatialGrid::assign(const KAABB *boxes, size_t count)
+{
+    placements_.resize(count);
+    for (size_t id = 0; id < count; ++id)
+        placements_[id] = Placement{boxes[id], -1, -1, -1, -1, true};
+    size_ = count;
+    if (count > 0)
+    {
+        layout();
+    }
+    else
+    {
+        cells_.clear();
+        oversized_.clear();
+        laid_out_size_ = 0;
+    }
+}
+
+void KSpatialGrid::reserve_bounds(const KAABB& bounds)
+{
+    bounds_ = combine(bounds_, bounds);
+}
+
+void KSpatialGrid::place(int id)
+{
+    Placement& p = placements_[id];
+    if (!cells_.empty())
+    {
+        p.x0 = cell_x(p.box.left);
+        p.x1 = cell_x(p.box.right);
+        p.y0 = cell_y(p.box.top);
+        p.y1 = cell_y(p.box.bottom);
+        if ((p.x1 - p.x0 + 1) * (p.y1 - p.y0 + 1) <= kMaxCells)
+        {
+            for (int y = p.y0; y <= p.y1; ++y)
+                for (int x = p.x0; x <= p.x1; ++x)
+                    cells_[y * columns_ + x].push_back(Entry{id, p.box});
+            return;
+        }
+    }
+    p.x0 = p.y0 = p.x1 = p.y1 = -1;
+    oversized_.push_back(Entry{id, p.box});
+}
+
+void KSpatialGrid::unplace(int id)
+{
+    const Placement& p = placements_[id];
+    if (p.x0 < 0)
+    {
+        erase_id(oversized_, id);
+        return;
+    }
+    for (int y = p.y0; y <= p.y1; ++y)
+        for (int x = p.x0; x <= p.x1; ++x)
+            erase_id(cells_[y * columns_ + x], id);
+}
+
+// Sizes cells at the mean box extent, or larger if that would make
+// more cells than boxes, over the area all boxes cover. A query reads
+// every box overlapping its cell, which grows with the cell's size plus
+// the boxes'; cells of twice the extent hold about twice as many, while
+// cells smaller than the extent cost more in inserts and moves than
+// they save.
+void KSpatialGrid::layout()
+{
+    KAABB bounds = bounds_;
+    double extent = 0.0;
+    for (const Placement& p : placements_)
+    {
+        if (!p.present)
+            continue;
+        bounds = combine(bounds, p.box);
+        extent += std::max(p.box.right - p.box.left, p.box.bottom - p.box.top);
+    }
+    float width = std::max(bounds.right - bounds.left, 1.f);
+    float height = std::max(bounds.bottom - bounds.top, 1.f);
+    float cell_size = std::max({static_cast<float>(extent / size_),
+                                std::sqrt(width * height / size_),
+                                1.f});
+
+    origin_x_ = bounds.left;
+    origin_y_ = bounds.top;
+    inv_cell_size_ = 1.f / cell_size;
+    columns_ = std::min(static_cast<int>(width / cell_size) + 1, 1 << 14);
+    rows_ = std::min(static_cast<int>(height / cell_size) + 1, 1 << 14);
+    cells_.assign(static_cast<size_t>(columns_) * rows_, std::vector<Entry>{});
+    oversized_.clear();
+    laid_out_size_ = size_;
+
+    // Count first and size every bucket exactly, which saves the
+    // reallocations of growing them one entry at a time.
+    std::vector<uint32_t> counts(cells_.size(), 0);
+    for (const Placement& p : placements_)
+    {
+        if (!p.present)
+            continue;
+        int x0 = cell_x(p.box.left);
+        int x1 = cell_x(p.box.right);
+        int y0 = cell_y(p.box.top);
+        int y1 = cell_y(p.box.bottom);
+        if ((x1 - x0 + 1) * (y1 - y0 + 1) > kMaxCells)
+            continue;
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                ++counts[y * columns_ + x];
+    }
+    for (size_t i = 0; i < cells_.size(); ++i)
+        cells_[i].reserve(counts[i]);
+
+    for (size_t id = 0; id < placements_.size(); ++id)
+        if (placements_[id].present)
+            place(static_cast<int>(id));
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Uniform grid of buckets over the plane, for finding the boxes that
+// contain a point. A box goes into every cell it overlaps, so a query
+// reads a single cell. Cells are sized from the boxes themselves, at
+// about their mean extent, and the grid lays itself out again as the
+// count doubles, which keeps a bucket at a handful of entries
+// whatever the scene's scale. Boxes spanning more than kMaxCells cells
+// are kept on a side list that every query scans instead, which bounds
+// the cost of moving a large box.
+//
+// Ids are small integers chosen by the caller, such as indices into
+// its own arrays. Coordinates outside the grid fall into the border
+// cells.
+//
+// USAGE:
+//
+// KSpatialGrid grid;
+// grid.insert(id, KAABB{x0, y0, x1, y1});
+// grid.move(id, KAABB{x0 + dx, y0 + dy, x1 + dx, y1 + dy});
+// grid.query(x, y, [&](int id, const KAABB& box) { test(id, box); });
+
+struct KAABB
+{
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+class KSpatialGrid
+{
+public:
+    static const int kMaxCells{64};
+
+    void insert(int id, const KAABB& box);
+    void move(int id, const KAABB& box);
+    void remove(int id);
+
+    // Replaces the contents with count boxes, with ids 0 to count - 1,
+    // laying out the grid once rather than as it grows.
+    void assign(const KAABB *boxes, size_t count);
+
+    // Calls fn(id, box) for every box that contains (x, y). The box is
+    // the grid's copy, read from the bucket the query scans anyway, so
+    // a caller that can decide from it saves a lookup of its own.
+    template <typename F>
+    void query(float x, float y, F fn) const;
+
+    // Makes sure the grid covers bounds, e.g. the visible canvas.
+    void reserve_bounds(const KAABB& bounds);
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        int id;
+        KAABB box;
+    };
+
+    struct Placement
+    {
+        KAABB box;
+        int x0, y0;     // Cell range, inclusive; x0 < 0 when on the
+        int x1, y1;     // oversized list or not in the grid at all.
+        bool present;
+    };
+
+    static void erase_id(std::vector<Entry>& entries, int id);
+    int cell_x(float x) const;
+    int cell_y(float y) const;
+    void place(int id);
+    void unplace(int id);
+    void layout();
+
+    std::vector<std::vector<Entry>> cells_;
+    std::vector<Entry> oversized_;
+    std::vector<Placement> placements_;
+    KAABB bounds_{0.f, 0.f, 0.f, 0.f};
+    float origin_x_{};
+    float origin_y_{};
+    float inv_cell_size_{1.f};
+    int columns_{};
+    int rows_{};
+    size_t size_{};
+    size_t laid_out_size_{};
+};
+
+inline size_t KSpatialGrid::size() const { return size_; }
+
+inline int KSpatialGrid::cell_x(float x) const
+{
+    return static_cast<int>(std::clamp((x - origin_x_) * inv_cell_size_, 0.f, static_cast<float>(columns_ - 1)));
+}
+
+inline int KSpatialGrid::cell_y(float y) const
+{
+    return static_cast<int>(std::clamp((y - origin_y_) * inv_cell_size_, 0.f, static_cast<float>(rows_ - 1)));
+}
+
+template <typename F>
+void KSpatialGrid::query(float x, float y, F fn) const
+{
+    if (!cells_.empty())
+    {
+        for (const Entry& e : cells_[cell_y(y) * columns_ + cell_x(x)])
+            if (x >= e.box.left && x <= e.box.right && y >= e.box.top && y <= e.box.bottom)
+                fn(e.id, e.box);
+    }
+    for (const Entry& e : oversized_)
+        if (x >= e.box.left && x <= e.box.right && y >= e.box.top && y <= e.box.bottom)
+            fn(e.id, e.box);
+}
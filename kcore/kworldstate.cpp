@@ -1,6 +1,5 @@
 #include <cmath>
 #include "kmath.h"
-#include "kclock.h"
 #include "kworldstate.h"
 
 KWorldState::KWorldState()
@@ -9,11 +8,9 @@ KWorldState::KWorldState()
 
 }
 
-void KWorldState::update(const KClock& clock,
-                         const float4x4 &view_matrix,
-                         const float4x4 &inverse_view_matrix)
+void KWorldState::step(float dt)
 {
-    float displacement = obj_speed * clock.dt;
+    float displacement = obj_speed * dt;
     if (input[static_cast<int>(Movement::kUp)])
         obj_pos.y += displacement;
     if (input[static_cast<int>(Movement::kDown)])
@@ -22,14 +19,19 @@ void KWorldState::update(const KClock& clock,
         obj_pos.x -= displacement;
     if (input[static_cast<int>(Movement::kRight)])
         obj_pos.x += displacement;
+}
 
-    obj_color.x = 0.5f * (sinf(change_frequency * static_cast<float>(clock.t)) + 1.0f);
+void KWorldState::update(double t,
+                         const float4x4 &view_matrix,
+                         const float4x4 &inverse_view_matrix)
+{
+    obj_color.x = 0.5f * (sinf(change_frequency * static_cast<float>(t)) + 1.0f);
     obj_color.y = 1.0f - obj_color.x;
     obj_color.z = 0.0f;
     obj_color.w = 1.0f;
 
-    float rotation_x_delta = 0.2f * static_cast<float>(K_PI * clock.t);
-    float rotation_y_delta = 0.1f * static_cast<float>(K_PI * clock.t);
+    float rotation_x_delta = 0.2f * static_cast<float>(K_PI * t);
+    float rotation_y_delta = 0.1f * static_cast<float>(K_PI * t);
 
     float4x4 obj_model_matrix = rotation_x_matrix(rotation_x_delta) * rotation_y_matrix(rotation_y_delta) * translation_matrix(obj_pos);
     float4x4 obj_inverse_model_matrix = translation_matrix(-obj_pos) * rotation_y_matrix(-rotation_y_delta) * rotation_x_matrix(-rotation_x_delta);
@@ -41,22 +43,22 @@ void KWorldState::update(const KClock& clock,
     light_pos_eye = light_mv_matrix.cols[3];
 }
 
-void KWorldState::keypress(WPARAM key, bool keystate)
+void KWorldState::keypress(KKey key, bool keystate)
 {
-    if (key == 'W')
+    if (key == KKey::kW)
         input[static_cast<int>(Movement::kUp)] = keystate;
-    else if (key == 'A')
+    else if (key == KKey::kA)
         input[static_cast<int>(Movement::kLeft)] = keystate;
-    else if (key == 'S')
+    else if (key == KKey::kS)
         input[static_cast<int>(Movement::kDown)] = keystate;
-    else if (key == 'D')
+    else if (key == KKey::kD)
         input[static_cast<int>(Movement::kRight)] = keystate;
-    else if (key == VK_UP)
+    else if (key == KKey::kUp)
         input[static_cast<int>(Movement::kUp)] = keystate;
-    else if (key == VK_LEFT)
+    else if (key == KKey::kLeft)
         input[static_cast<int>(Movement::kLeft)] = keystate;
-    else if (key == VK_DOWN)
+    else if (key == KKey::kDown)
         input[static_cast<int>(Movement::kDown)] = keystate;
-    else if (key == VK_RIGHT)
+    else if (key == KKey::kRight)
         input[static_cast<int>(Movement::kRight)] = keystate;
 }
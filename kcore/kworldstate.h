@@ -1,6 +1,7 @@
 #pragma once
 
 #include "kmath.h"
+#include "kinput.h"
 
 enum class Movement
 {
@@ -15,10 +16,13 @@ class KWorldState
 {
 public:
     KWorldState();
-    void update(const KClock& clock,
+    // Moves the object by one step of dt seconds, from the keys held down.
+    void step(float dt);
+    // Poses the scene at simulated time t, in seconds.
+    void update(double t,
                 const float4x4 &view_matrix,
                 const float4x4 &inverse_view_matrix);
-    void keypress(WPARAM key, bool keystate);
+    void keypress(KKey key, bool keystate);
     
     float3 obj_pos{0, 0, 0};
     float4 obj_color{1, 1, 1};